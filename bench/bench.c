@@ -0,0 +1,1112 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             bench.c
+--
+-- PROGRAM:                 bench.out
+--
+-- FUNCTIONS:
+--                          int main(int argc, char *argv[])
+--                          void benchFail(const char *msg)
+--                          uint64_t nowNs(void)
+--                          bool sendAll(const int sock, const char *buffer, size_t length)
+--                          bool recvAll(const int sock, char *buffer, size_t length)
+--                          int benchConnect(const int port)
+--                          bool waitForPort(const int port, const pid_t pid, const int timeoutMs)
+--                          void backendAccept(const int epfd, bench_peer *listener)
+--                          void backendSink(bench_peer *peer, const char *buffer, size_t length)
+--                          void backendRun(const int echoPort, const int sinkPort)
+--                          long memoryOf(const pid_t pid)
+--                          long memoryTree(const pid_t pid)
+--                          double benchThroughput(const int port, const uint64_t bytes)
+--                          int compareSamples(const void *a, const void *b)
+--                          void benchLatency(const int port, const int count, uint64_t *samples)
+--                          double benchConnections(const int port, const int count)
+--                          void benchIdle(const int port, const int count, const pid_t pid, long *before, long *after)
+--                          pid_t startForwarder(const char *path, const char *dir, char *const *args)
+--                          void usage(const char *name)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Loopback benchmark for the forwarder. Starts a backend process with an echo port and a sink
+-- port, writes a forwarder.conf with one path to each into a temporary directory and runs the
+-- forwarder there. Then measures, through the forwarder:
+--
+--  - bulk throughput, one connection sending to the sink
+--  - round trip latency percentiles of small messages to the echo port
+--  - connections per second, each connecting, doing one round trip and closing
+--  - memory per thousand idle connections
+--
+-- The results are written to stdout as one JSON object so runs of different builds can be
+-- compared. Everything else goes to stderr.
+---------------------------------------------------------------------------------------*/
+
+#define BACKEND_OFFSET 100
+#define BACKEND_BACKLOG 1024
+#define BACKEND_EVENTS 64
+#define IO_SIZE 65536
+#define MESSAGE_SIZE 64
+#define WARMUP_ROUNDS 100
+#define START_TIMEOUT 5000
+#define SETTLE_DELAY 200000
+
+#include "bench.h"
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "net.h"
+
+static pid_t backendPid = -1;
+static pid_t forwarderPid = -1;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                main
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int main(int argc, char *argv[])
+--                              int argc: The number of command line arguments.
+--                              char *argv[]: The command line arguments.
+--
+-- RETURNS:                 The exit code.
+--
+-- NOTES:
+-- Sets up the backend and the forwarder, runs every benchmark and prints the results. The open
+-- file limit is raised first since the forwarder and the backend inherit it and the idle
+-- benchmark needs three sockets per connection.
+--------------------------------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    char forwarder[PATH_MAX];
+    char dir[] = "/tmp/fwbench.XXXXXX";
+    char path[PATH_MAX];
+    char workers[16];
+    const char *engine = "epoll";
+    const char *relay = "copy";
+    const char *binary = "./forwarder.out";
+    int basePort = 18000;
+    uint64_t bulk = 256;
+    int rounds = 20000;
+    int connections = 2000;
+    int idle = 1000;
+    int opt;
+    FILE *conf;
+    struct rlimit limit;
+    uint64_t *samples;
+    double bulkSeconds;
+    double connectSeconds;
+    long before;
+    long after;
+
+    snprintf(workers, sizeof(workers), "1");
+    while ((opt = getopt(argc, argv, "f:e:r:w:p:b:n:c:i:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            binary = optarg;
+            break;
+        case 'e':
+            engine = optarg;
+            break;
+        case 'r':
+            relay = optarg;
+            break;
+        case 'w':
+            snprintf(workers, sizeof(workers), "%d", atoi(optarg));
+            break;
+        case 'p':
+            basePort = atoi(optarg);
+            break;
+        case 'b':
+            bulk = strtoull(optarg, NULL, 10);
+            break;
+        case 'n':
+            rounds = atoi(optarg);
+            break;
+        case 'c':
+            connections = atoi(optarg);
+            break;
+        case 'i':
+            idle = atoi(optarg);
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (basePort <= 0 || basePort + BACKEND_OFFSET + 1 > 65535 || bulk == 0 || rounds <= 0 || connections <= 0
+        || idle <= 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (realpath(binary, forwarder) == NULL)
+    {
+        benchFail(binary);
+    }
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    // a client that goes away must fail the send, not kill the benchmark
+    signal(SIGPIPE, SIG_IGN);
+
+    if (mkdtemp(dir) == NULL)
+    {
+        benchFail("mkdtemp");
+    }
+    snprintf(path, sizeof(path), "%s/forwarder.conf", dir);
+    if ((conf = fopen(path, "w")) == NULL)
+    {
+        benchFail(path);
+    }
+    fprintf(conf, "127.0.0.1:%d -> 127.0.0.1:%d\n", basePort, basePort + BACKEND_OFFSET);
+    fprintf(conf, "127.0.0.1:%d -> 127.0.0.1:%d\n", basePort + 1, basePort + BACKEND_OFFSET + 1);
+    fclose(conf);
+
+    if ((backendPid = fork()) == -1)
+    {
+        benchFail("fork");
+    }
+    if (backendPid == 0)
+    {
+        backendRun(basePort + BACKEND_OFFSET, basePort + BACKEND_OFFSET + 1);
+    }
+    if (!waitForPort(basePort + BACKEND_OFFSET, backendPid, START_TIMEOUT)
+        || !waitForPort(basePort + BACKEND_OFFSET + 1, backendPid, START_TIMEOUT))
+    {
+        benchFail("Backend did not start");
+    }
+
+    forwarderPid = startForwarder(forwarder, dir,
+                                  (char *const[]){forwarder, "-e", (char *)engine, "-r", (char *)relay, "-w", workers, NULL});
+    if (!waitForPort(basePort, forwarderPid, START_TIMEOUT) || !waitForPort(basePort + 1, forwarderPid, START_TIMEOUT))
+    {
+        benchFail("Forwarder did not start, see forwarder.log");
+    }
+
+    fprintf(stderr, "Throughput: %lu MiB\n", bulk);
+    bulkSeconds = benchThroughput(basePort + 1, bulk << 20);
+
+    fprintf(stderr, "Latency: %d round trips\n", rounds);
+    if ((samples = malloc(sizeof(uint64_t) * rounds)) == NULL)
+    {
+        benchFail("malloc");
+    }
+    benchLatency(basePort, rounds, samples);
+
+    fprintf(stderr, "Connections: %d\n", connections);
+    connectSeconds = benchConnections(basePort, connections);
+
+    fprintf(stderr, "Idle: %d connections\n", idle);
+    benchIdle(basePort, idle, forwarderPid, &before, &after);
+
+    printf("{\n");
+    printf("  \"engine\": \"%s\",\n  \"relay\": \"%s\",\n  \"workers\": %s,\n", engine, relay, workers);
+    printf("  \"throughput\": {\"bytes\": %lu, \"seconds\": %.6f, \"mib_per_sec\": %.1f},\n", bulk << 20, bulkSeconds,
+           bulk / bulkSeconds);
+    printf("  \"latency_us\": {\"round_trips\": %d, \"message_bytes\": %d, \"p50\": %.1f, \"p90\": %.1f, "
+           "\"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f},\n",
+           rounds, MESSAGE_SIZE, samples[(rounds - 1) / 2] / 1e3, samples[(rounds - 1) * 90 / 100] / 1e3,
+           samples[(rounds - 1) * 99 / 100] / 1e3, samples[(rounds - 1) * 999 / 1000] / 1e3, samples[rounds - 1] / 1e3);
+    printf("  \"connections\": {\"count\": %d, \"seconds\": %.6f, \"per_sec\": %.1f},\n", connections, connectSeconds,
+           connections / connectSeconds);
+    printf("  \"idle\": {\"connections\": %d, \"rss_kib_before\": %ld, \"rss_kib_after\": %ld, \"rss_kib_per_1k\": %.1f}\n",
+           idle, before, after, (after - before) * 1000.0 / idle);
+    printf("}\n");
+    fflush(stdout);
+
+    kill(-forwarderPid, SIGTERM);
+    kill(backendPid, SIGTERM);
+    waitpid(forwarderPid, NULL, 0);
+    waitpid(backendPid, NULL, 0);
+
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/forwarder.log", dir);
+    unlink(path);
+    rmdir(dir);
+    free(samples);
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                benchFail
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void benchFail(const char *msg)
+--                              const char *msg: Error message.
+--
+-- NOTES:
+-- Prints an error message, stops the backend and the forwarder if they are running and exits with
+-- exit code 1.
+--------------------------------------------------------------------------------------------------*/
+void benchFail(const char *msg)
+{
+    if (errno)
+    {
+        perror(msg);
+    }
+    else
+    {
+        fprintf(stderr, "%s\n", msg);
+    }
+
+    if (forwarderPid > 0)
+    {
+        kill(-forwarderPid, SIGTERM);
+    }
+    if (backendPid > 0)
+    {
+        kill(backendPid, SIGTERM);
+    }
+    exit(EXIT_FAILURE);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                nowNs
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uint64_t nowNs(void)
+--
+-- RETURNS:                 The time of the monotonic clock in nanoseconds.
+--------------------------------------------------------------------------------------------------*/
+uint64_t nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                sendAll
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool sendAll(const int sock, const char *buffer, size_t length)
+--                              const int sock: The blocking socket to send on.
+--                              const char *buffer: The data to send.
+--                              size_t length: The number of bytes to send.
+--
+-- RETURNS:                 True if everything was sent, false otherwise.
+--------------------------------------------------------------------------------------------------*/
+bool sendAll(const int sock, const char *buffer, size_t length)
+{
+    ssize_t n;
+
+    while (length > 0)
+    {
+        if ((n = send(sock, buffer, length, 0)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        buffer += n;
+        length -= n;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                recvAll
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool recvAll(const int sock, char *buffer, size_t length)
+--                              const int sock: The blocking socket to receive on.
+--                              char *buffer: Where to put the data.
+--                              size_t length: The number of bytes to receive.
+--
+-- RETURNS:                 True if length bytes were received, false if the connection closed or
+--                          failed first.
+--------------------------------------------------------------------------------------------------*/
+bool recvAll(const int sock, char *buffer, size_t length)
+{
+    ssize_t n;
+
+    while (length > 0)
+    {
+        if ((n = recv(sock, buffer, length, 0)) <= 0)
+        {
+            if (n == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        buffer += n;
+        length -= n;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                benchConnect
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int benchConnect(const int port)
+--                              const int port: The port on 127.0.0.1 to connect to.
+--
+-- RETURNS:                 The connected socket, or -1 on failure.
+--
+-- NOTES:
+-- Opens a blocking connection with Nagle's algorithm turned off so round trips are not delayed.
+--------------------------------------------------------------------------------------------------*/
+int benchConnect(const int port)
+{
+    int sock = -1;
+    int arg = 1;
+    struct sockaddr_in addr;
+
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (!createConnectedSocket(&sock, &addr))
+    {
+        if (sock != -1)
+        {
+            close(sock);
+        }
+        return -1;
+    }
+
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &arg, sizeof(arg));
+    return sock;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                waitForPort
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool waitForPort(const int port, const pid_t pid, const int timeoutMs)
+--                              const int port: The port on 127.0.0.1 to wait for.
+--                              const pid_t pid: The process that will listen on the port.
+--                              const int timeoutMs: How long to wait.
+--
+-- RETURNS:                 True once the port accepts connections, false if it does not within
+--                          timeoutMs milliseconds or the process exits.
+--------------------------------------------------------------------------------------------------*/
+bool waitForPort(const int port, const pid_t pid, const int timeoutMs)
+{
+    int sock;
+    uint64_t deadline = nowNs() + (uint64_t)timeoutMs * 1000000;
+
+    while (nowNs() < deadline)
+    {
+        if ((sock = benchConnect(port)) != -1)
+        {
+            close(sock);
+            return true;
+        }
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            return false;
+        }
+        usleep(20000);
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                backendAccept
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void backendAccept(const int epfd, bench_peer *listener)
+--                              const int epfd: The epoll instance of the backend.
+--                              bench_peer *listener: The listener that is readable.
+--
+-- NOTES:
+-- Accepts every pending connection. Accepted sockets stay blocking so replies are always sent in
+-- full, and are only read when epoll reports them readable.
+--------------------------------------------------------------------------------------------------*/
+void backendAccept(const int epfd, bench_peer *listener)
+{
+    int sock;
+    int arg = 1;
+    bench_peer *peer;
+    struct epoll_event ev;
+
+    while ((sock = accept4(listener->fd, NULL, NULL, SOCK_CLOEXEC)) != -1)
+    {
+        if ((peer = calloc(1, sizeof(bench_peer))) == NULL)
+        {
+            benchFail("calloc");
+        }
+        peer->kind = listener->kind == PEER_ECHO_LISTENER ? PEER_ECHO : PEER_SINK;
+        peer->fd = sock;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &arg, sizeof(arg));
+
+        ev.events = EPOLLIN;
+        ev.data.ptr = peer;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+        {
+            close(sock);
+            free(peer);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                backendSink
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void backendSink(bench_peer *peer, const char *buffer, size_t length)
+--                              bench_peer *peer: The sink connection the data came from.
+--                              const char *buffer: The data that was read.
+--                              size_t length: The number of bytes read.
+--
+-- NOTES:
+-- A transfer to the sink is an 8 byte length followed by that many bytes, and is answered with a
+-- single byte once all of it has arrived. The forwarder closes both sides as soon as one side
+-- closes, so the client cannot signal the end of a transfer by shutting down its write side.
+--------------------------------------------------------------------------------------------------*/
+void backendSink(bench_peer *peer, const char *buffer, size_t length)
+{
+    size_t take;
+
+    while (length > 0)
+    {
+        if (peer->have < sizeof(peer->header))
+        {
+            take = sizeof(peer->header) - peer->have < length ? sizeof(peer->header) - peer->have : length;
+            memcpy(peer->header + peer->have, buffer, take);
+            peer->have += take;
+            buffer += take;
+            length -= take;
+            if (peer->have == sizeof(peer->header))
+            {
+                memcpy(&peer->remaining, peer->header, sizeof(peer->remaining));
+            }
+        }
+        else
+        {
+            take = peer->remaining < length ? peer->remaining : length;
+            peer->remaining -= take;
+            buffer += take;
+            length -= take;
+        }
+
+        if (peer->have == sizeof(peer->header) && peer->remaining == 0)
+        {
+            sendAll(peer->fd, "k", 1);
+            peer->have = 0;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                backendRun
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void backendRun(const int echoPort, const int sinkPort)
+--                              const int echoPort: The port that echoes everything back.
+--                              const int sinkPort: The port that discards what it is sent.
+--
+-- NOTES:
+-- Body of the backend process. Serves both ports from one level-triggered epoll loop until it is
+-- killed. Does not return.
+--------------------------------------------------------------------------------------------------*/
+void backendRun(const int echoPort, const int sinkPort)
+{
+    int epfd;
+    int count;
+    ssize_t n;
+    char *buffer;
+    bench_peer listeners[2] = {{.kind = PEER_ECHO_LISTENER}, {.kind = PEER_SINK_LISTENER}};
+    bench_peer *peer;
+    struct epoll_event ev;
+    struct epoll_event events[BACKEND_EVENTS];
+
+    if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1 || (buffer = malloc(IO_SIZE)) == NULL)
+    {
+        benchFail("backend");
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!createListeningSocket(&listeners[i].fd, i == 0 ? echoPort : sinkPort, false, BACKEND_BACKLOG))
+        {
+            benchFail("Backend could not listen");
+        }
+        ev.events = EPOLLIN;
+        ev.data.ptr = listeners + i;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, listeners[i].fd, &ev) == -1)
+        {
+            benchFail("epoll_ctl");
+        }
+    }
+
+    while (1)
+    {
+        if ((count = epoll_wait(epfd, events, BACKEND_EVENTS, -1)) == -1)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            peer = events[i].data.ptr;
+            if (peer->kind == PEER_ECHO_LISTENER || peer->kind == PEER_SINK_LISTENER)
+            {
+                backendAccept(epfd, peer);
+                continue;
+            }
+
+            if ((n = recv(peer->fd, buffer, IO_SIZE, MSG_DONTWAIT)) == -1 && (errno == EAGAIN || errno == EINTR))
+            {
+                continue;
+            }
+            if (n <= 0 || (peer->kind == PEER_ECHO && !sendAll(peer->fd, buffer, n)))
+            {
+                close(peer->fd);
+                free(peer);
+                continue;
+            }
+            if (peer->kind == PEER_SINK)
+            {
+                backendSink(peer, buffer, n);
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                memoryOf
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               long memoryOf(const pid_t pid)
+--                              const pid_t pid: The process to measure.
+--
+-- RETURNS:                 The memory used by the process in KiB, 0 if it cannot be read.
+--
+-- NOTES:
+-- Reads the proportional set size from smaps_rollup, which splits pages shared between forked
+-- processes among them, and falls back to VmRSS on kernels that do not have it.
+--------------------------------------------------------------------------------------------------*/
+long memoryOf(const pid_t pid)
+{
+    char path[64];
+    char line[256];
+    long kib = 0;
+    FILE *file;
+
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+    if ((file = fopen(path, "r")) != NULL)
+    {
+        while (fgets(line, sizeof(line), file))
+        {
+            if (sscanf(line, "Pss: %ld", &kib) == 1)
+            {
+                break;
+            }
+        }
+        fclose(file);
+        if (kib > 0)
+        {
+            return kib;
+        }
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    if ((file = fopen(path, "r")) != NULL)
+    {
+        while (fgets(line, sizeof(line), file))
+        {
+            if (sscanf(line, "VmRSS: %ld", &kib) == 1)
+            {
+                break;
+            }
+        }
+        fclose(file);
+    }
+
+    return kib;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                memoryTree
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               long memoryTree(const pid_t pid)
+--                              const pid_t pid: The process to measure.
+--
+-- RETURNS:                 The memory used by the process and all of its descendants in KiB.
+--
+-- NOTES:
+-- The fork engine keeps its connections in child processes, so they have to be counted too.
+--------------------------------------------------------------------------------------------------*/
+long memoryTree(const pid_t pid)
+{
+    char path[300];
+    char stat[512];
+    char *end;
+    int parent;
+    long kib = memoryOf(pid);
+    DIR *proc;
+    FILE *file;
+    struct dirent *entry;
+
+    if ((proc = opendir("/proc")) == NULL)
+    {
+        return kib;
+    }
+
+    while ((entry = readdir(proc)) != NULL)
+    {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+        {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+        if ((file = fopen(path, "r")) == NULL)
+        {
+            continue;
+        }
+        // the command name may contain spaces, the parent pid is the second field after it
+        if (fgets(stat, sizeof(stat), file) && (end = strrchr(stat, ')')) != NULL
+            && sscanf(end + 2, "%*c %d", &parent) == 1 && parent == pid)
+        {
+            kib += memoryTree(atoi(entry->d_name));
+        }
+        fclose(file);
+    }
+
+    closedir(proc);
+    return kib;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                benchThroughput
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               double benchThroughput(const int port, const uint64_t bytes)
+--                              const int port: The forwarded port of the sink.
+--                              const uint64_t bytes: The number of bytes to send.
+--
+-- RETURNS:                 The number of seconds it took until the sink had received everything.
+--------------------------------------------------------------------------------------------------*/
+double benchThroughput(const int port, const uint64_t bytes)
+{
+    int sock;
+    char *buffer;
+    char ack;
+    uint64_t left = bytes;
+    uint64_t start;
+    uint64_t end;
+
+    if ((buffer = malloc(IO_SIZE)) == NULL)
+    {
+        benchFail("malloc");
+    }
+    memset(buffer, 'x', IO_SIZE);
+
+    if ((sock = benchConnect(port)) == -1)
+    {
+        benchFail("Could not connect to the forwarder");
+    }
+
+    start = nowNs();
+    if (!sendAll(sock, (const char *)&bytes, sizeof(bytes)))
+    {
+        benchFail("Throughput connection closed");
+    }
+    while (left > 0)
+    {
+        if (!sendAll(sock, buffer, left < IO_SIZE ? left : IO_SIZE))
+        {
+            benchFail("Throughput connection closed");
+        }
+        left -= left < IO_SIZE ? left : IO_SIZE;
+    }
+    if (!recvAll(sock, &ack, 1))
+    {
+        benchFail("Throughput connection closed");
+    }
+    end = nowNs();
+
+    close(sock);
+    free(buffer);
+    return (end - start) / 1e9;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                compareSamples
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int compareSamples(const void *a, const void *b)
+--                              const void *a: A uint64_t sample.
+--                              const void *b: Another uint64_t sample.
+--
+-- RETURNS:                 Less than, equal to or greater than 0 as a is less than, equal to or
+--                          greater than b.
+--------------------------------------------------------------------------------------------------*/
+int compareSamples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                benchLatency
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void benchLatency(const int port, const int count, uint64_t *samples)
+--                              const int port: The forwarded port of the echo backend.
+--                              const int count: The number of round trips to time.
+--                              uint64_t *samples: Where to put the round trip times, in nanoseconds.
+--
+-- NOTES:
+-- Sends MESSAGE_SIZE bytes and waits for them to come back, one message at a time over a single
+-- connection. The first WARMUP_ROUNDS round trips are not timed. The samples are sorted.
+--------------------------------------------------------------------------------------------------*/
+void benchLatency(const int port, const int count, uint64_t *samples)
+{
+    int sock;
+    char message[MESSAGE_SIZE];
+    uint64_t start;
+
+    memset(message, 'x', sizeof(message));
+    if ((sock = benchConnect(port)) == -1)
+    {
+        benchFail("Could not connect to the forwarder");
+    }
+
+    for (int i = -WARMUP_ROUNDS; i < count; i++)
+    {
+        start = nowNs();
+        if (!sendAll(sock, message, sizeof(message)) || !recvAll(sock, message, sizeof(message)))
+        {
+            benchFail("Latency connection closed");
+        }
+        if (i >= 0)
+        {
+            samples[i] = nowNs() - start;
+        }
+    }
+    close(sock);
+
+    qsort(samples, count, sizeof(uint64_t), compareSamples);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                benchConnections
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               double benchConnections(const int port, const int count)
+--                              const int port: The forwarded port of the echo backend.
+--                              const int count: The number of connections to make.
+--
+-- RETURNS:                 The number of seconds the connections took.
+--
+-- NOTES:
+-- Makes count connections one after the other. Each one sends a byte and waits for the echo, so
+-- the forwarder has to accept it and connect upstream, before it is closed.
+--------------------------------------------------------------------------------------------------*/
+double benchConnections(const int port, const int count)
+{
+    int sock;
+    char byte = 'x';
+    uint64_t start = nowNs();
+
+    for (int i = 0; i < count; i++)
+    {
+        if ((sock = benchConnect(port)) == -1)
+        {
+            benchFail("Could not connect to the forwarder");
+        }
+        if (!sendAll(sock, &byte, 1) || !recvAll(sock, &byte, 1))
+        {
+            benchFail("Connection closed before the echo");
+        }
+        close(sock);
+    }
+
+    return (nowNs() - start) / 1e9;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                benchIdle
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void benchIdle(const int port, const int count, const pid_t pid, long *before, long *after)
+--                              const int port: The forwarded port of the echo backend.
+--                              const int count: The number of idle connections to open.
+--                              const pid_t pid: The forwarder process.
+--                              long *before: Where to put the memory of the forwarder before, in KiB.
+--                              long *after: Where to put the memory with the connections open, in KiB.
+--
+-- NOTES:
+-- Opens count connections and does one round trip on each so they are relayed end to end, then
+-- measures the forwarder with all of them idle and closes them.
+--------------------------------------------------------------------------------------------------*/
+void benchIdle(const int port, const int count, const pid_t pid, long *before, long *after)
+{
+    int *socks;
+    char byte = 'x';
+
+    if ((socks = malloc(sizeof(int) * count)) == NULL)
+    {
+        benchFail("malloc");
+    }
+
+    usleep(SETTLE_DELAY);
+    *before = memoryTree(pid);
+    for (int i = 0; i < count; i++)
+    {
+        if ((socks[i] = benchConnect(port)) == -1)
+        {
+            benchFail("Could not connect to the forwarder");
+        }
+        if (!sendAll(socks[i], &byte, 1) || !recvAll(socks[i], &byte, 1))
+        {
+            benchFail("Idle connection closed");
+        }
+    }
+    usleep(SETTLE_DELAY);
+    *after = memoryTree(pid);
+
+    for (int i = 0; i < count; i++)
+    {
+        close(socks[i]);
+    }
+    free(socks);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                startForwarder
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               pid_t startForwarder(const char *path, const char *dir, char *const *args)
+--                              const char *path: The absolute path of the forwarder.
+--                              const char *dir: The directory holding the generated forwarder.conf.
+--                              char *const *args: The command line of the forwarder.
+--
+-- RETURNS:                 The pid of the forwarder.
+--
+-- NOTES:
+-- Runs the forwarder in dir, since it reads forwarder.conf from its working directory, with its
+-- output going to forwarder.log there. The forwarder gets its own process group so the processes
+-- of the fork engine can be stopped along with it.
+--------------------------------------------------------------------------------------------------*/
+pid_t startForwarder(const char *path, const char *dir, char *const *args)
+{
+    int log;
+    pid_t pid;
+
+    if ((pid = fork()) == -1)
+    {
+        benchFail("fork");
+    }
+    if (pid > 0)
+    {
+        setpgid(pid, pid);
+        return pid;
+    }
+
+    setpgid(0, 0);
+    if (chdir(dir) == -1 || (log = open("forwarder.log", O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+    {
+        perror(dir);
+        _exit(EXIT_FAILURE);
+    }
+    dup2(log, STDOUT_FILENO);
+    dup2(log, STDERR_FILENO);
+    close(log);
+
+    execv(path, args);
+    perror(path);
+    _exit(EXIT_FAILURE);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                usage
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void usage(const char *name)
+--                              const char *name: The name the program was invoked with.
+--
+-- NOTES:
+-- Prints the command line options.
+--------------------------------------------------------------------------------------------------*/
+void usage(const char *name)
+{
+    printf("Usage: %s [-f forwarder] [-e engine] [-r relay] [-w workers] [-p port] [-b MiB] [-n rounds]\n"
+           "          [-c connections] [-i idle]\n", name);
+    printf("    -f forwarder    the forwarder to run (default ./forwarder.out)\n");
+    printf("    -e, -r, -w      passed on to the forwarder (default epoll, copy, 1)\n");
+    printf("    -p port         first forwarded port, the backend uses port + 100 (default 18000)\n");
+    printf("    -b MiB          bulk transfer size (default 256)\n");
+    printf("    -n rounds       small message round trips (default 20000)\n");
+    printf("    -c connections  connections for the connection rate (default 2000)\n");
+    printf("    -i idle         idle connections for the memory use (default 1000)\n");
+}
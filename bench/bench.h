@@ -0,0 +1,45 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef enum
+{
+    PEER_ECHO_LISTENER,
+    PEER_SINK_LISTENER,
+    PEER_ECHO,
+    PEER_SINK
+} peer_kind;
+
+typedef struct bench_peer
+{
+    peer_kind kind;
+    int fd;
+    char header[sizeof(uint64_t)];
+    size_t have;
+    uint64_t remaining;
+} bench_peer;
+
+void benchFail(const char *msg);
+uint64_t nowNs(void);
+bool sendAll(const int sock, const char *buffer, size_t length);
+bool recvAll(const int sock, char *buffer, size_t length);
+int benchConnect(const int port);
+bool waitForPort(const int port, const pid_t pid, const int timeoutMs);
+void backendAccept(const int epfd, bench_peer *listener);
+void backendSink(bench_peer *peer, const char *buffer, size_t length);
+void backendRun(const int echoPort, const int sinkPort);
+long memoryOf(const pid_t pid);
+long memoryTree(const pid_t pid);
+double benchThroughput(const int port, const uint64_t bytes);
+int compareSamples(const void *a, const void *b);
+void benchLatency(const int port, const int count, uint64_t *samples);
+double benchConnections(const int port, const int count);
+void benchIdle(const int port, const int count, const pid_t pid, long *before, long *after);
+pid_t startForwarder(const char *path, const char *dir, char *const *args);
+void usage(const char *name);
+
+#endif // BENCH_H
@@ -0,0 +1,692 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             check.c
+--
+-- PROGRAM:                 check.out
+--
+-- FUNCTIONS:
+--                          int main(void)
+--                          bool expect(const char *name, const int64_t got, const int64_t want)
+--                          int64_t drain(limit_bucket *bucket, const long long nowMs)
+--                          int64_t earned(const long rate, const long long stepMs, const long long untilMs)
+--                          bool checkRing(void)
+--                          bool checkAcl(void)
+--                          int timerLevel(timer_wheel *wheel, wheel_timer *timer)
+--                          bool checkWheel(void)
+--                          FILE *captureStart(int *saved)
+--                          void captureStop(FILE *capture, const int saved, char *out, const size_t size)
+--                          int errorColumn(const char *line)
+--                          bool checkParser(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Self-checks of code that needs no sockets, linked against the objects of the forwarder. The token
+-- bucket math of limit.c is driven with made up timestamps, so every run sees the same refills and
+-- the results can be compared exactly, and so is the timer wheel of wheel.c. The hash ring of
+-- balance.c and the access list trie of acl.c are checked on fixed rules and addresses, the parser
+-- of io.c and the cache of cache.c on fixed lines. Run with make check, which fails if any result
+-- differs from what is expected.
+---------------------------------------------------------------------------------------*/
+
+#include "check.h"
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                main
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int main(void)
+--
+-- RETURNS:                 0 if every check passed, 1 otherwise.
+--
+-- NOTES:
+-- Rates that earn less than a token per LIMIT_TICK must still earn their whole rate over a second
+-- whatever the refill interval, and a bucket must never hold more than its burst. The checks of the
+-- other modules are run after those of the buckets.
+--------------------------------------------------------------------------------------------------*/
+int main(void)
+{
+    bool ok = true;
+    limit_bucket bucket;
+
+    ok &= expect("50/s refilled every tick", earned(50, LIMIT_TICK, 1000), 50);
+    ok &= expect("7/s refilled every 13 ms", earned(7, 13, 3003), 21);
+    ok &= expect("3/s refilled every 333 ms", earned(3, 333, 999), 2);
+    ok &= expect("1000000/s refilled every 17 ms", earned(1000000, 17, 1003), 1003000);
+
+    bucketInit(&bucket, 100, 10, 0);
+    ok &= expect("starts full", bucketAvailable(&bucket, 0), 10);
+    bucketCharge(&bucket, 25);
+    ok &= expect("owes what was read past its tokens", bucketAvailable(&bucket, 0), -15);
+    ok &= expect("no refill within a tick", bucketAvailable(&bucket, LIMIT_TICK - 1), -15);
+    ok &= expect("pays back before letting through", bucketAvailable(&bucket, 200), 5);
+    ok &= expect("capped at its burst", bucketAvailable(&bucket, 100000), 10);
+    ok &= expect("long idle does not overflow", bucketAvailable(&bucket, INT64_MAX / 2), 10);
+
+    bucketInit(&bucket, 0, 0, 0);
+    bucketCharge(&bucket, 1000);
+    ok &= expect("no limit", bucketAvailable(&bucket, 1000), INT64_MAX);
+
+    ok &= checkRing();
+    ok &= checkAcl();
+    ok &= checkWheel();
+    ok &= checkParser();
+
+    printf("%s\n", ok ? "All checks passed" : "Some checks failed");
+    return ok ? 0 : 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                expect
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool expect(const char *name, const int64_t got, const int64_t want)
+--                              const char *name: What is being checked.
+--                              const int64_t got: The result.
+--                              const int64_t want: The expected result.
+--
+-- RETURNS:                 True if the result is the expected one.
+--------------------------------------------------------------------------------------------------*/
+bool expect(const char *name, const int64_t got, const int64_t want)
+{
+    if (got != want)
+    {
+        printf("FAIL %s: got %" PRId64 ", want %" PRId64 "\n", name, got, want);
+        return false;
+    }
+    printf("ok   %s\n", name);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                drain
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int64_t drain(limit_bucket *bucket, const long long nowMs)
+--                              limit_bucket *bucket: The bucket to empty.
+--                              const long long nowMs: The made up current time.
+--
+-- RETURNS:                 The whole tokens that were taken out of the bucket.
+--------------------------------------------------------------------------------------------------*/
+int64_t drain(limit_bucket *bucket, const long long nowMs)
+{
+    int64_t tokens = bucketAvailable(bucket, nowMs);
+
+    if (tokens > 0)
+    {
+        bucketCharge(bucket, tokens);
+        return tokens;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                earned
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int64_t earned(const long rate, const long long stepMs, const long long untilMs)
+--                              const long rate: The rate of the bucket, in tokens per second.
+--                              const long long stepMs: How often the bucket is looked at.
+--                              const long long untilMs: How long the bucket is looked at.
+--
+-- RETURNS:                 The tokens taken out of the bucket after it was first emptied.
+--
+-- NOTES:
+-- Empties a bucket and takes every whole token out of it every stepMs milliseconds, the way a busy
+-- connection would.
+--------------------------------------------------------------------------------------------------*/
+int64_t earned(const long rate, const long long stepMs, const long long untilMs)
+{
+    limit_bucket bucket;
+    int64_t total = 0;
+
+    bucketInit(&bucket, rate, rate, 0);
+    drain(&bucket, 0);
+    for (long long now = stepMs; now <= untilMs; now += stepMs)
+    {
+        total += drain(&bucket, now);
+    }
+    return total;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                checkRing
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool checkRing(void)
+--
+-- RETURNS:                 True if every check of the hash ring passed.
+--
+-- NOTES:
+-- ringSearch is run on a ring of three points, where hashes past the last point must wrap around to
+-- the first. A hash path of three backends must then send a client to the same backend every time,
+-- also after its ring was built again, and must spread a range of clients over every backend.
+--------------------------------------------------------------------------------------------------*/
+bool checkRing(void)
+{
+    bool ok = true;
+    lb_point points[] = {{10, 0}, {20, 1}, {30, 2}};
+    fwd_path path;
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(9000)};
+    struct sockaddr_in client = {.sin_family = AF_INET};
+    fwd_backend *first;
+    int moved = 0;
+    int used[3] = {0};
+
+    bzero(&path, sizeof(path));
+    path.ring = points;
+    path.ringSize = 3;
+    ok &= expect("ring below the first point", ringSearch(&path, 0), 0);
+    ok &= expect("ring on a point", ringSearch(&path, 20), 1);
+    ok &= expect("ring between points", ringSearch(&path, 21), 2);
+    ok &= expect("ring wraps past the last point", ringSearch(&path, 31), 0);
+    ok &= expect("ring wraps at the top", ringSearch(&path, UINT32_MAX), 0);
+
+    bzero(&path, sizeof(path));
+    path.policy = LB_HASH;
+    for (int i = 1; i <= 3; i++)
+    {
+        addr.sin_addr.s_addr = htonl(0x0a000000 + i);
+        addBackend(&path, &addr);
+    }
+    balanceInit(&path);
+
+    client.sin_addr.s_addr = htonl(0xc0a80001);
+    first = pickBackend(&path, &client);
+    for (int i = 0; i < 100; i++)
+    {
+        moved += pickBackend(&path, &client) != first;
+    }
+    balanceInit(&path);
+    moved += pickBackend(&path, &client) != first;
+    ok &= expect("same client, same backend", moved, 0);
+
+    for (int i = 0; i < 256; i++)
+    {
+        client.sin_addr.s_addr = htonl(0xc0a80000 + i);
+        used[pickBackend(&path, &client) - path.backends] = 1;
+    }
+    ok &= expect("clients spread over every backend", used[0] + used[1] + used[2], 3);
+
+    free(path.ring);
+    free(path.backends);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                checkAcl
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool checkAcl(void)
+--
+-- RETURNS:                 True if every check of the access list trie passed.
+--
+-- NOTES:
+-- Nested prefixes must be matched by the longest one, a /0 rule must sit on the root and match
+-- every address, and of two rules with the same prefix the later one must win. Two prefixes that
+-- only differ in their last bit must be split under a node without a rule, and a shorter prefix
+-- added later must be put between the split and the root.
+--------------------------------------------------------------------------------------------------*/
+bool checkAcl(void)
+{
+    bool ok = true;
+    fwd_path path;
+
+    bzero(&path, sizeof(path));
+    aclParseList(&path, "10.0.0.0/8", false);
+    aclParseList(&path, "10.1.0.0/16", true);
+    aclParseList(&path, "10.1.2.0/24", false);
+    aclParseList(&path, "10.1.2.3/32", true);
+    aclCompile(&path);
+    ok &= expect("acl host rule", aclMatch(path.acl, ntohl(inet_addr("10.1.2.3"))), 3);
+    ok &= expect("acl /24 under the host", aclMatch(path.acl, ntohl(inet_addr("10.1.2.4"))), 2);
+    ok &= expect("acl /16 under the /24", aclMatch(path.acl, ntohl(inet_addr("10.1.3.1"))), 1);
+    ok &= expect("acl /8 under the /16", aclMatch(path.acl, ntohl(inet_addr("10.2.0.1"))), 0);
+    ok &= expect("acl unmatched", aclMatch(path.acl, ntohl(inet_addr("11.0.0.1"))), -1);
+    ok &= expect("acl unmatched refused with allow rules",
+                 aclAdmits(path.acl, (struct in_addr){inet_addr("11.0.0.1")}), false);
+    ok &= expect("acl admits the host", aclAdmits(path.acl, (struct in_addr){inet_addr("10.1.2.3")}), true);
+    aclFree(path.acl);
+
+    bzero(&path, sizeof(path));
+    aclParseList(&path, "0.0.0.0/0", true);
+    aclParseList(&path, "192.168.0.0/16", false);
+    aclCompile(&path);
+    ok &= expect("acl /0 on the root", path.acl->nodes[0].rule, 0);
+    ok &= expect("acl /0 matches anything", aclMatch(path.acl, ntohl(inet_addr("8.8.8.8"))), 0);
+    ok &= expect("acl /0 matches the top", aclMatch(path.acl, UINT32_MAX), 0);
+    ok &= expect("acl longer than /0", aclMatch(path.acl, ntohl(inet_addr("192.168.1.1"))), 1);
+    aclFree(path.acl);
+
+    bzero(&path, sizeof(path));
+    aclParseList(&path, "172.16.0.0/12", true);
+    aclParseList(&path, "172.16.0.0/12", false);
+    aclCompile(&path);
+    ok &= expect("acl duplicate, later wins", aclMatch(path.acl, ntohl(inet_addr("172.20.0.1"))), 1);
+    ok &= expect("acl duplicate shares a node", path.acl->nodeCount, 2);
+    aclFree(path.acl);
+
+    bzero(&path, sizeof(path));
+    aclParseList(&path, "10.0.0.0/24", true);
+    aclParseList(&path, "10.0.1.0/24", false);
+    aclCompile(&path);
+    ok &= expect("acl split node added", path.acl->nodeCount, 4);
+    ok &= expect("acl split node has no rule", path.acl->nodes[path.acl->nodes[0].child[0]].rule, -1);
+    ok &= expect("acl split node length", path.acl->nodes[path.acl->nodes[0].child[0]].length, 23);
+    ok &= expect("acl left of the split", aclMatch(path.acl, ntohl(inet_addr("10.0.0.5"))), 0);
+    ok &= expect("acl right of the split", aclMatch(path.acl, ntohl(inet_addr("10.0.1.5"))), 1);
+    ok &= expect("acl past the split", aclMatch(path.acl, ntohl(inet_addr("10.0.2.5"))), -1);
+    aclFree(path.acl);
+
+    bzero(&path, sizeof(path));
+    aclParseList(&path, "10.0.0.0/24", true);
+    aclParseList(&path, "10.0.1.0/24", false);
+    aclParseList(&path, "10.0.0.0/16", false);
+    aclCompile(&path);
+    ok &= expect("acl shorter prefix put above the split", path.acl->nodeCount, 5);
+    ok &= expect("acl shorter prefix under the root", path.acl->nodes[path.acl->nodes[0].child[0]].length, 16);
+    ok &= expect("acl split still matches", aclMatch(path.acl, ntohl(inet_addr("10.0.1.5"))), 1);
+    ok &= expect("acl shorter prefix matches", aclMatch(path.acl, ntohl(inet_addr("10.0.2.5"))), 2);
+    aclFree(path.acl);
+
+    return ok;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                timerLevel
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int timerLevel(timer_wheel *wheel, wheel_timer *timer)
+--                              timer_wheel *wheel: The wheel the timer was added to.
+--                              wheel_timer *timer: An armed timer.
+--
+-- RETURNS:                 The level of the slot the timer is linked into.
+--------------------------------------------------------------------------------------------------*/
+int timerLevel(timer_wheel *wheel, wheel_timer *timer)
+{
+    return (int)((timer->slot - &wheel->slots[0][0]) / WHEEL_SLOTS);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                checkWheel
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool checkWheel(void)
+--
+-- RETURNS:                 True if every check of the timer wheel passed.
+--
+-- NOTES:
+-- A timer on each of the levels 1 to 4 must cascade down and expire on its own tick, not one
+-- earlier. A timer cancelled after it cascaded must not expire, and must leave the timer that
+-- shares its slot with it where it can still be moved. A timer past the reach of the top level must
+-- wait in the last slot of that level and be placed again when the slot cascades. Stepping up to
+-- that slot one tick at a time would take minutes, so the check moves the wheel to the start of the
+-- slot directly, which is what wheelExpire would get to since no other timer is armed.
+--------------------------------------------------------------------------------------------------*/
+bool checkWheel(void)
+{
+    bool ok = true;
+    timer_wheel wheel;
+    wheel_timer timers[WHEEL_LEVELS];
+    wheel_timer other;
+    long long span = 1;
+    long long due[WHEEL_LEVELS];
+    char name[64];
+
+    memset(timers, 0, sizeof(timers));
+    wheelInit(&wheel, 0);
+    for (int level = 1; level < WHEEL_LEVELS; level++)
+    {
+        span *= WHEEL_SLOTS;
+        due[level] = span + 6;
+        wheelAdd(&wheel, timers + level, due[level] * WHEEL_TICK);
+        snprintf(name, sizeof(name), "wheel timer on level %d", level);
+        ok &= expect(name, timerLevel(&wheel, timers + level), level);
+    }
+    for (int level = 1; level < WHEEL_LEVELS; level++)
+    {
+        snprintf(name, sizeof(name), "wheel level %d not early", level);
+        ok &= expect(name, wheelExpire(&wheel, due[level] * WHEEL_TICK - 1) == NULL, true);
+        snprintf(name, sizeof(name), "wheel level %d cascaded to level 0", level);
+        ok &= expect(name, timerLevel(&wheel, timers + level), 0);
+        snprintf(name, sizeof(name), "wheel level %d on time", level);
+        ok &= expect(name, wheelExpire(&wheel, due[level] * WHEEL_TICK) == timers + level, true);
+    }
+    ok &= expect("wheel empty", wheel.count, 0);
+
+    memset(timers, 0, sizeof(timers));
+    memset(&other, 0, sizeof(other));
+    wheelInit(&wheel, 0);
+    wheelAdd(&wheel, timers, 8292 * WHEEL_TICK);
+    wheelAdd(&wheel, &other, 8293 * WHEEL_TICK);
+    ok &= expect("wheel cancelled timer on level 2", timerLevel(&wheel, timers), 2);
+    wheelExpire(&wheel, 8200 * WHEEL_TICK);
+    ok &= expect("wheel cancelled timer cascaded", timerLevel(&wheel, timers), 1);
+    ok &= expect("wheel cascaded timers share a slot", timers[0].slot == other.slot, true);
+    wheelCancel(&wheel, timers);
+    ok &= expect("wheel cancel counted", wheel.count, 1);
+    wheelAdd(&wheel, &other, 8400 * WHEEL_TICK);
+    ok &= expect("wheel cancelled timer not expired", wheelExpire(&wheel, 8293 * WHEEL_TICK) == NULL, true);
+    ok &= expect("wheel neighbour moved", wheelExpire(&wheel, 8400 * WHEEL_TICK) == &other, true);
+    ok &= expect("wheel neighbour alone", other.next == NULL, true);
+
+    memset(timers, 0, sizeof(timers));
+    wheelInit(&wheel, 0);
+    span *= WHEEL_SLOTS;
+    due[0] = span + 3 * (span / WHEEL_SLOTS) + 7;
+    wheelAdd(&wheel, timers, due[0] * WHEEL_TICK);
+    ok &= expect("wheel clamped to the last slot", timers[0].slot == &wheel.slots[WHEEL_LEVELS - 1][WHEEL_SLOTS - 1],
+                 true);
+    wheel.tick = (WHEEL_SLOTS - 1) * (span / WHEEL_SLOTS);
+    ok &= expect("wheel clamped not early", wheelExpire(&wheel, wheel.tick * WHEEL_TICK) == NULL, true);
+    ok &= expect("wheel clamped placed again", timers[0].slot == &wheel.slots[WHEEL_LEVELS - 1][3], true);
+    wheel.tick = (WHEEL_SLOTS + 3) * (span / WHEEL_SLOTS);
+    ok &= expect("wheel clamped cascaded", wheelExpire(&wheel, wheel.tick * WHEEL_TICK) == NULL, true);
+    ok &= expect("wheel clamped down to level 0", timerLevel(&wheel, timers), 0);
+    ok &= expect("wheel clamped not early at the end", wheelExpire(&wheel, due[0] * WHEEL_TICK - 1) == NULL, true);
+    ok &= expect("wheel clamped on time", wheelExpire(&wheel, due[0] * WHEEL_TICK) == timers, true);
+
+    return ok;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                captureStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               FILE *captureStart(int *saved)
+--                              int *saved: Where to keep the real stdout for captureStop.
+--
+-- RETURNS:                 The file the log lines now go to.
+--
+-- NOTES:
+-- Without the logger thread the log lines are written straight to stdout, so pointing stdout at a
+-- temporary file catches what the forwarder logs until captureStop.
+--------------------------------------------------------------------------------------------------*/
+FILE *captureStart(int *saved)
+{
+    FILE *capture;
+
+    fflush(stdout);
+    if ((capture = tmpfile()) == NULL || (*saved = dup(STDOUT_FILENO)) == -1
+        || dup2(fileno(capture), STDOUT_FILENO) == -1)
+    {
+        die("capture");
+    }
+    return capture;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                captureStop
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void captureStop(FILE *capture, const int saved, char *out, const size_t size)
+--                              FILE *capture: The file from captureStart.
+--                              const int saved: The real stdout from captureStart.
+--                              char *out: Where to place what was logged.
+--                              const size_t size: The size of out.
+--
+-- NOTES:
+-- Puts stdout back and reads what was logged in the meantime, cut to the size of out.
+--------------------------------------------------------------------------------------------------*/
+void captureStop(FILE *capture, const int saved, char *out, const size_t size)
+{
+    size_t length;
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    rewind(capture);
+    length = fread(out, 1, size - 1, capture);
+    out[length] = 0;
+    fclose(capture);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                errorColumn
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int errorColumn(const char *line)
+--                              const char *line: A line of a configuration file.
+--
+-- RETURNS:                 The column of the error parseConfLine logged for the line, 0 if it
+--                          logged none.
+--------------------------------------------------------------------------------------------------*/
+int errorColumn(const char *line)
+{
+    fwd_path path;
+    FILE *capture;
+    int saved;
+    char logged[512];
+    const char *error;
+    int column = 0;
+
+    capture = captureStart(&saved);
+    if (parseConfLine(line, 1, &path) == 1)
+    {
+        pathFree(&path);
+    }
+    captureStop(capture, saved, logged, sizeof(logged));
+
+    if ((error = strstr(logged, "forwarder.conf:1:")) != NULL)
+    {
+        column = atoi(error + strlen("forwarder.conf:1:"));
+    }
+    return column;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                checkParser
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool checkParser(void)
+--
+-- RETURNS:                 True if every check of the parser and the cache passed.
+--
+-- NOTES:
+-- The errors of parseConfLine must point at the first character of what is wrong, counting the
+-- blanks a line starts with. sortPaths must order the paths by port and address and keep the last
+-- of two lines for the same path. The table must come back from cacheSave and cacheLoad with its
+-- addresses, backends, options and rules, and a cache written for another version of the file
+-- must be refused.
+--------------------------------------------------------------------------------------------------*/
+bool checkParser(void)
+{
+    bool ok = true;
+    const char *lines[] = {
+        "127.0.0.1:80 -> 127.0.0.1:81",
+        "127.0.0.2:70 -> 127.0.0.1:71",
+        "127.0.0.1:80 -> 127.0.0.1:82",
+        "127.0.0.1:70 -> 127.0.0.1:72",
+        "127.0.0.3:90 -> 127.0.0.1:91,127.0.0.1:92 lb=hash rate=2048 allow=10.0.0.0/8",
+    };
+    const int count = sizeof(lines) / sizeof(lines[0]);
+    fwd_path parsed[sizeof(lines) / sizeof(lines[0])];
+    path_entry entries[sizeof(lines) / sizeof(lines[0])];
+    fwd_path *paths;
+    fwd_path *loaded = NULL;
+    int size;
+    int loadedSize = 0;
+    struct stat conf;
+    char name[] = "/tmp/check.cache.XXXXXX";
+    char logged[512];
+    FILE *capture;
+    int saved;
+    int fd;
+    bool same;
+
+    ok &= expect("parse error at the arrow", errorColumn("127.0.0.1:80 => 127.0.0.1:81"), 13);
+    ok &= expect("parse error at the backend", errorColumn("127.0.0.1:80 -> 127.0.0.1:81,127.0.0.1:99999"), 30);
+    ok &= expect("parse error at the empty backend", errorColumn("127.0.0.1:80 -> 127.0.0.1:81,,127.0.0.1:82"), 30);
+    ok &= expect("parse error at the option", errorColumn("127.0.0.1:80 -> 127.0.0.1:81 nope=1"), 30);
+    ok &= expect("parse error after blanks", errorColumn("  127.0.0.1:80 -> 127.0.0.1:81 lb=hash rate=abc"), 40);
+    ok &= expect("parse no error", errorColumn("127.0.0.1:80 -> 127.0.0.1:81 lb=hash rate=2048"), 0);
+
+    capture = captureStart(&saved);
+    for (int i = 0; i < count; i++)
+    {
+        parseConfLine(lines[i], i + 1, parsed + i);
+        // keyed the way parseConfFileForPaths keys them
+        entries[i].key = (uint64_t)parsed[i].udp << 48 | (uint64_t)ntohs(parsed[i].in.sin_port) << 32
+                         | ntohl(parsed[i].in.sin_addr.s_addr);
+        entries[i].line = i + 1;
+        entries[i].index = i;
+    }
+    size = sortPaths(parsed, entries, count, &paths);
+    captureStop(capture, saved, logged, sizeof(logged));
+    ok &= expect("sort drops the duplicate", size, count - 1);
+    ok &= expect("sort logs the duplicate", strstr(logged, "forwarder.conf:3: replaces the path of line 1") != NULL,
+                 true);
+    ok &= expect("sort by port, then address", ntohs(paths[0].out.sin_port), 72);
+    ok &= expect("sort by address", ntohs(paths[1].out.sin_port), 71);
+    ok &= expect("sort keeps the last line", ntohs(paths[2].out.sin_port), 82);
+    ok &= expect("sort by port", ntohs(paths[3].out.sin_port), 91);
+
+    memset(&conf, 0, sizeof(conf));
+    conf.st_size = 100;
+    conf.st_mtim.tv_sec = 1;
+    conf.st_ino = 2;
+    if ((fd = mkstemp(name)) == -1)
+    {
+        die("mkstemp");
+    }
+    close(fd);
+
+    capture = captureStart(&saved);
+    ok &= expect("cache saved", cacheSave(name, &conf, paths, size), true);
+    ok &= expect("cache loaded", cacheLoad(name, &conf, &loaded, &loadedSize), true);
+    captureStop(capture, saved, logged, sizeof(logged));
+    ok &= expect("cache size", loadedSize, size);
+    same = loadedSize == size;
+    for (int i = 0; same && i < size; i++)
+    {
+        same = loaded[i].in.sin_addr.s_addr == paths[i].in.sin_addr.s_addr
+               && loaded[i].in.sin_port == paths[i].in.sin_port && loaded[i].backendCount == paths[i].backendCount
+               && loaded[i].policy == paths[i].policy && loaded[i].rate == paths[i].rate;
+        for (int j = 0; same && j < paths[i].backendCount; j++)
+        {
+            same = loaded[i].backends[j].addr.sin_addr.s_addr == paths[i].backends[j].addr.sin_addr.s_addr
+                   && loaded[i].backends[j].addr.sin_port == paths[i].backends[j].addr.sin_port;
+        }
+    }
+    ok &= expect("cache paths and backends", same, true);
+    if (loadedSize == size)
+    {
+        ok &= expect("cache options", loaded[3].policy == LB_HASH && loaded[3].rate == 2048, true);
+        ok &= expect("cache rules", loaded[3].acl && loaded[3].acl->ruleCount == 1
+                     && loaded[3].acl->rules[0].prefix == 0x0a000000 && loaded[3].acl->rules[0].length == 8
+                     && loaded[3].acl->rules[0].allow, true);
+    }
+    for (int i = 0; i < loadedSize; i++)
+    {
+        pathFree(loaded + i);
+    }
+    free(loaded);
+
+    conf.st_mtim.tv_sec = 2;
+    capture = captureStart(&saved);
+    ok &= expect("cache refused for a changed file", cacheLoad(name, &conf, &loaded, &loadedSize), false);
+    captureStop(capture, saved, logged, sizeof(logged));
+    unlink(name);
+
+    for (int i = 0; i < size; i++)
+    {
+        pathFree(paths + i);
+    }
+    free(paths);
+    return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "acl.h"
+#include "balance.h"
+#include "cache.h"
+#include "io.h"
+#include "limit.h"
+#include "reload.h"
+#include "wheel.h"
+
+bool expect(const char *name, const int64_t got, const int64_t want);
+int64_t drain(limit_bucket *bucket, const long long nowMs);
+int64_t earned(const long rate, const long long stepMs, const long long untilMs);
+bool checkRing(void);
+bool checkAcl(void);
+int timerLevel(timer_wheel *wheel, wheel_timer *timer);
+bool checkWheel(void);
+FILE *captureStart(int *saved);
+void captureStop(FILE *capture, const int saved, char *out, const size_t size);
+int errorColumn(const char *line);
+bool checkParser(void);
+
+#endif // CHECK_H
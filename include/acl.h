@@ -0,0 +1,56 @@
+#ifndef ACL_H
+#define ACL_H
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "res.h"
+
+#define ACL_MASK(length) ((length) ? 0xFFFFFFFFu << (32 - (length)) : 0)
+#define ACL_BIT(addr, index) (((addr) >> (31 - (index))) & 1)
+#define ACL_RULE_SIZE 32
+
+typedef struct acl_rule
+{
+    uint32_t prefix;
+    int length;
+    bool allow;
+    size_t hits;
+} acl_rule;
+
+typedef struct acl_node
+{
+    uint32_t prefix;
+    int length;
+    int rule;
+    int child[2];
+} acl_node;
+
+typedef struct path_acl
+{
+    acl_rule *rules;
+    int ruleCount;
+    int ruleLimit;
+    acl_node *nodes;
+    int nodeCount;
+    bool allowUnmatched;
+    size_t unmatchedHits;
+} fwd_acl;
+
+bool parseCidr(const char *text, uint32_t *prefix, int *length);
+bool aclAdd(fwd_path *path, const uint32_t prefix, const int length, const bool allow);
+bool aclParseList(fwd_path *path, const char *list, const bool allow);
+bool aclLoad(fwd_path *path, const char *file);
+int aclNode(fwd_acl *acl, const uint32_t prefix, const int length, const int rule);
+void aclInsert(fwd_acl *acl, const int rule);
+bool aclCompile(fwd_path *path);
+int aclMatch(const fwd_acl *acl, const uint32_t addr);
+bool aclAllows(fwd_acl *acl, const struct in_addr addr);
+bool aclAdmits(const fwd_acl *acl, const struct in_addr addr);
+void aclFormatRule(const acl_rule *rule, char *out, const size_t size);
+bool aclSame(const fwd_acl *a, const fwd_acl *b);
+void aclFree(fwd_acl *acl);
+
+#endif // ACL_H
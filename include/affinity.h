@@ -0,0 +1,23 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define AFFINITY_NAMES_SIZE 256
+
+bool affinityParseList(const char *list, cpu_set_t *set);
+bool affinityReadList(const char *file, cpu_set_t *set);
+int affinityScanIrqs(cpu_set_t *cpus, const int cpu, char *names, const size_t size);
+bool affinityParse(const char *value);
+int affinityCount(void);
+int affinityWorkers(void);
+int affinityCpu(const int id);
+int affinityNode(const int cpu);
+void *affinityAlloc(const size_t size, const int node);
+bool affinitySpawn(void *(*routine)(void *), void *arg, const int cpu);
+void affinityReport(const int count);
+
+#endif // AFFINITY_H
@@ -0,0 +1,21 @@
+#ifndef BALANCE_H
+#define BALANCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "res.h"
+
+bool addBackend(fwd_path *path, const struct sockaddr_in *addr);
+uint32_t hashAddress(const uint32_t addr, const uint32_t salt);
+int comparePoints(const void *a, const void *b);
+bool balanceInit(fwd_path *path);
+uint32_t balanceRandom(void);
+int ringSearch(fwd_path *path, const uint32_t hash);
+fwd_backend *policyBackend(fwd_path *path, const struct sockaddr_in *client);
+fwd_backend *pickBackend(fwd_path *path, const struct sockaddr_in *client);
+fwd_backend *alternateBackend(fwd_path *path, fwd_backend *first, const int n);
+void backendAcquire(fwd_backend *backend);
+void backendRelease(fwd_backend *backend);
+
+#endif // BALANCE_H
@@ -0,0 +1,39 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "res.h"
+
+#define CACHE_MAGIC "FWDTABLE"
+#define CACHE_VERSION 2
+#define CACHE_LIMIT (1 << 24)
+
+typedef struct cache_header
+{
+    char magic[8];
+    uint32_t version;
+    char build[32];
+    uint32_t pathSize;
+    uint32_t backendSize;
+    uint32_t ruleSize;
+    uint32_t layout;
+    int32_t count;
+    int64_t confSize;
+    int64_t confSeconds;
+    int64_t confNanoseconds;
+    uint64_t confInode;
+    uint64_t confDevice;
+} cache_header;
+
+uint32_t cacheLayout(void);
+void cacheHeader(cache_header *header, const struct stat *conf, const int count);
+bool cacheWritePath(FILE *file, const fwd_path *path);
+bool cacheReadPath(FILE *file, fwd_path *path);
+bool cacheSave(const char *name, const struct stat *conf, const fwd_path *paths, const int size);
+bool cacheLoad(const char *name, const struct stat *conf, fwd_path **paths, int *size);
+
+#endif // CACHE_H
@@ -0,0 +1,14 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <signal.h>
+
+#include "res.h"
+
+void controlSignals(sigset_t *set);
+void blockControlSignals(void);
+void unblockControlSignals(void);
+void reportStats(fwd_path *paths, const int size);
+void controlRoutine(void);
+
+#endif // CONTROL_H
\ No newline at end of file
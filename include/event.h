@@ -0,0 +1,181 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "limit.h"
+#include "metrics.h"
+#include "relay.h"
+#include "res.h"
+#include "tcpinfo.h"
+#include "wheel.h"
+
+#define CONNECT_ATTEMPTS 3
+#define CONNECT_ATTEMPT_DELAY 250
+
+// every worker has a slot for the listening socket of every port
+#define NET_PORTS 65536
+
+typedef enum
+{
+    EV_LISTENER,
+    EV_CLIENT,
+    EV_UPSTREAM,
+    EV_CONNECTING,
+    EV_POOLED,
+    EV_CONTROL,
+    EV_MIRROR
+} ev_kind;
+
+typedef enum
+{
+    POOL_EMPTY,
+    POOL_CONNECTING,
+    POOL_READY
+} pool_state;
+
+typedef struct event_endpoint
+{
+    ev_kind kind;
+    int fd;
+    void *owner;
+} ev_endpoint;
+
+typedef struct connect_attempt
+{
+    ev_endpoint ep;
+    struct forwarding_conn *conn;
+    fwd_backend *backend;
+} fwd_attempt;
+
+typedef struct mirror_endpoint
+{
+    ev_endpoint ep;
+    struct forwarding_conn *conn;
+    relay_dir *dir;
+    relay_mirror relay;
+    size_t bytesCounted;
+    size_t droppedCounted;
+} fwd_mirror;
+
+typedef struct forwarding_conn
+{
+    ev_endpoint client;
+    ev_endpoint upstream;
+    fwd_path *path;
+    fwd_backend *backend;
+    fwd_metrics *metrics;
+    limit_client *limitClient;
+    long long startedUs;
+    fwd_attempt attempts[CONNECT_ATTEMPTS];
+    int attemptsActive;
+    int attemptsStarted;
+    long long nextAttempt;
+    long long deadline;
+    long long lastActive;
+    wheel_timer timer;
+    bool connected;
+    bool closed;
+    relay_dir toUpstream;
+    relay_dir toClient;
+    fwd_mirror mirrors[2];
+    tcp_stats tcp;
+    bool throttled;
+    struct forwarding_conn *prev;
+    struct forwarding_conn *next;
+    struct forwarding_conn *throttledPrev;
+    struct forwarding_conn *throttledNext;
+} fwd_conn;
+
+typedef struct pooled_socket
+{
+    ev_endpoint ep;
+    struct forwarding_listener *listener;
+    fwd_backend *backend;
+    pool_state state;
+    time_t since;
+} fwd_pooled;
+
+typedef struct listen_socket
+{
+    ev_endpoint ep;
+    int port;
+    int refs;
+    bool reported;
+} fwd_socket;
+
+typedef struct forwarding_listener
+{
+    fwd_socket *socket;
+    fwd_path *path;
+    fwd_metrics *metrics;
+    fwd_pooled *pool;
+    time_t poolRetry;
+} fwd_listener;
+
+typedef struct event_worker
+{
+    int id;
+    int cpu;
+    int epfd;
+    ev_endpoint control;
+    fwd_config *config;
+    fwd_listener **listeners;
+    int listenerCount;
+    fwd_socket **ports;
+    fwd_conn *conns;
+    fwd_conn *connecting;
+    fwd_conn *closed;
+    fwd_conn *throttled;
+    long long nextTick;
+    timer_wheel wheel;
+    size_t connCount;
+    time_t now;
+    long long nowMs;
+    time_t lastSweep;
+    bool pooling;
+    bool poolDirty;
+    bool reusePort;
+    bool reload;
+} fwd_worker;
+
+bool workerInit(fwd_worker *worker, fwd_config *config, const int id, const bool reusePort);
+fwd_socket *socketOpen(fwd_worker *worker, fwd_path *path);
+void socketRelease(fwd_worker *worker, fwd_socket *socket);
+fwd_listener *listenerOpen(fwd_worker *worker, fwd_path *path);
+void listenerPool(fwd_worker *worker, fwd_listener *listener);
+void listenerDrain(fwd_worker *worker, fwd_listener *listener);
+void listenerClose(fwd_worker *worker, fwd_listener *listener);
+void workerReload(fwd_worker *worker);
+void workerApply(fwd_worker *worker, fwd_config *config);
+void workerQueues(fwd_worker *worker);
+void workerRun(fwd_worker *worker);
+void *workerThread(void *arg);
+void workerAccept(fwd_worker *worker, fwd_socket *socket);
+bool connStartAttempt(fwd_worker *worker, fwd_conn *conn);
+void connAttemptEvent(fwd_worker *worker, fwd_attempt *attempt);
+void connDropAttempt(fwd_worker *worker, fwd_attempt *attempt);
+void connEstablish(fwd_worker *worker, fwd_conn *conn, fwd_attempt *attempt);
+void connArm(fwd_worker *worker, fwd_conn *conn);
+void connExpire(fwd_worker *worker, fwd_conn *conn);
+void connLink(fwd_conn **list, fwd_conn *conn);
+void connUnlink(fwd_conn **list, fwd_conn *conn);
+void connPump(fwd_worker *worker, fwd_conn *conn);
+void connThrottle(fwd_worker *worker, fwd_conn *conn);
+void connUnthrottle(fwd_worker *worker, fwd_conn *conn);
+void workerTick(fwd_worker *worker);
+void connClose(fwd_worker *worker, fwd_conn *conn);
+void connMirror(fwd_worker *worker, fwd_conn *conn);
+void mirrorFlush(fwd_worker *worker, fwd_mirror *mirror);
+void mirrorClose(fwd_worker *worker, fwd_mirror *mirror);
+void mirrorAccount(fwd_mirror *mirror);
+void poolRefill(fwd_worker *worker, fwd_listener *listener);
+void poolEvent(fwd_worker *worker, fwd_pooled *pooled, const unsigned events);
+void poolDiscard(fwd_worker *worker, fwd_pooled *pooled);
+int poolTake(fwd_worker *worker, fwd_listener *listener, fwd_backend *backend);
+void poolSweep(fwd_worker *worker);
+void eventRoutine(fwd_config *config);
+
+#endif // EVENT_H
@@ -0,0 +1,74 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "res.h"
+#include "wheel.h"
+
+#define HEALTH_FALL 3
+#define HEALTH_EVENTS 64
+#define HEALTH_SIZE(count) (sizeof(fwd_health) * (count) + sizeof(int))
+
+typedef enum
+{
+    HEALTH_UP,
+    HEALTH_DOWN,
+    HEALTH_TRIAL
+} health_state;
+
+typedef struct backend_health
+{
+    int state;
+    int failures;
+    int successes;
+    long long retryAt;
+    uint64_t ejections;
+    uint64_t checksPassed;
+    uint64_t checksFailed;
+} fwd_health;
+
+typedef struct health_probe
+{
+    fwd_path *path;
+    fwd_backend *backend;
+    int fd;
+    bool connected;
+    bool reading;
+    size_t sent;
+    size_t matched;
+    wheel_timer timer;
+} health_probe;
+
+typedef struct health_checker
+{
+    int epfd;
+    int control;
+    fwd_config *config;
+    health_probe *probes;
+    int probeCount;
+    timer_wheel wheel;
+} health_checker;
+
+bool healthParsePayload(const char *value, char *out, size_t *length);
+bool healthInit(fwd_path *path);
+void healthFree(fwd_health *health, const int count);
+int *healthOpenCount(fwd_path *path);
+bool healthAvailable(fwd_path *path, fwd_backend *backend, const long long nowMs);
+bool healthUsable(fwd_path *path, fwd_backend *backend);
+void healthOpen(fwd_path *path, fwd_backend *backend, const long long nowMs, const char *reason);
+void healthConnected(fwd_path *path, fwd_backend *backend);
+void healthFailed(fwd_path *path, fwd_backend *backend, const long long nowMs);
+void healthProbed(fwd_path *path, fwd_backend *backend, const bool passed, const long long nowMs);
+void healthProbeStart(health_checker *checker, health_probe *probe, const long long nowMs);
+void healthProbeEvent(health_checker *checker, health_probe *probe, const unsigned events, const long long nowMs);
+void healthProbeFinish(health_checker *checker, health_probe *probe, const bool passed, const long long nowMs);
+void healthLoad(health_checker *checker, fwd_config *config, const long long nowMs);
+void healthUnload(health_checker *checker);
+void healthReload(health_checker *checker, const long long nowMs);
+void *healthThread(void *arg);
+bool healthStart(void);
+
+#endif // HEALTH_H
@@ -3,15 +3,40 @@
 
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #include "res.h"
 
+typedef struct path_entry
+{
+    uint64_t key;
+    int line;
+    int index;
+} path_entry;
+
 void logWithLevel(const char *level, const char *format, va_list args);
 void Log(const char *format, ...);
 void Error(const char *format, ...);
+void LogConn(const char *format, ...);
 
-bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort);
+bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort, const char **rest);
+const char *parseBackend(const char *line, char *addr, int *port);
+bool parseBackends(const char *line, fwd_path *path, const char **rest);
+bool parseNumber(const char *value, const long min, const long max, long *out);
+bool parseOption(const char *key, const char *value, fwd_path *path);
+bool parseTuning(const char *key, const char *value, net_tuning *tuning);
+bool parseOptions(const char *line, fwd_path *path, const char **failed);
+void initPath(fwd_path *path);
 bool fillAddr(struct sockaddr_in *out, const char *address, const int port);
+size_t copyLine(const char **cursor, const char *end, char *buffer);
+void prefetchHosts(const char *data, const size_t size);
+void parseError(const int line, const int column, const char *format, ...);
+int parseConfLine(const char *line, const int number, fwd_path *path);
+int comparePathEntries(const void *a, const void *b);
+int sortPaths(fwd_path *parsed, path_entry *entries, const int count, fwd_path **paths);
+void compilePaths(fwd_path *paths, const int size);
 
 bool parseConfFileForPaths(fwd_path **paths, int *size);
 
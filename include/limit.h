@@ -0,0 +1,61 @@
+#ifndef LIMIT_H
+#define LIMIT_H
+
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "res.h"
+
+#define LIMIT_TICK 10
+#define LIMIT_BURST_DIVISOR 4
+#define LIMIT_MIN_BURST 16384
+#define LIMIT_CLIENT_BUCKETS 1024
+#define LIMIT_CLIENT_IDLE 60000
+#define LIMIT_MILLI 1000
+
+typedef struct token_bucket
+{
+    int64_t tokens;
+    int64_t rate;
+    int64_t burst;
+    long long lastMs;
+} limit_bucket;
+
+typedef struct limit_client
+{
+    uint32_t addr;
+    int refs;
+    long long lastUsed;
+    limit_bucket toUpstream;
+    limit_bucket toClient;
+    limit_bucket conns;
+    struct limit_client *next;
+} limit_client;
+
+typedef struct path_limits
+{
+    limit_bucket toUpstream;
+    limit_bucket toClient;
+    limit_bucket conns;
+    long clientRate;
+    long clientConnRate;
+    pthread_mutex_t lock;
+    limit_client **clients;
+} fwd_limits;
+
+void bucketInit(limit_bucket *bucket, const long rate, const long burst, const long long nowMs);
+void bucketRefill(limit_bucket *bucket, const long long nowMs);
+int64_t bucketAvailable(limit_bucket *bucket, const long long nowMs);
+void bucketCharge(limit_bucket *bucket, const int64_t amount);
+bool limitInit(fwd_path *path);
+void limitFree(fwd_limits *limits);
+limit_client *limitClientAcquire(fwd_limits *limits, const struct in_addr addr, const long long nowMs);
+void limitClientRelease(fwd_limits *limits, limit_client *client, const long long nowMs);
+bool limitAdmit(fwd_limits *limits, limit_client *client, const long long nowMs);
+size_t limitAvailable(fwd_limits *limits, limit_client *client, const bool toUpstream, const long long nowMs);
+void limitCharge(fwd_limits *limits, limit_client *client, const bool toUpstream, const size_t bytes);
+
+#endif // LIMIT_H
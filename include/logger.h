@@ -0,0 +1,41 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#define LOG_MESSAGE_SIZE 232
+#define LOG_RING_SIZE 1024
+
+typedef struct log_record
+{
+    time_t when;
+    const char *level;
+    int length;
+    char message[LOG_MESSAGE_SIZE];
+} log_record;
+
+typedef struct log_ring
+{
+    log_record records[LOG_RING_SIZE];
+    size_t head;
+    size_t tail;
+    size_t dropped;
+    struct log_ring *next;
+} log_ring;
+
+bool logStart(void);
+void logSubmit(const char *level, const char *format, va_list args);
+log_ring *logThreadRing(void);
+const char *logTimestamp(const time_t when);
+int logFormat(char *out, const size_t size, const time_t when, const char *level, const char *message, const int length);
+void logWrite(const char *buffer, size_t length);
+bool logDrain(void);
+void *logWriterThread(void *arg);
+void logFlush(void);
+void logAfterFork(void);
+bool logConnAllowed(void);
+
+#endif // LOGGER_H
@@ -1,10 +1,20 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#include <stdbool.h>
+
 #include "io.h"
 #include "res.h"
+#include "tcpinfo.h"
 
 int main(int argc, char *argv[]);
+void forkPath(fwd_path *path);
+void forkReconcile(fwd_config *old, fwd_config *config);
 void childRoutine(fwd_path *path);
+void connectionRoutine(fwd_path *path, const int inSocket, fwd_backend *first);
+bool connectUpstream(fwd_path *path, fwd_backend *first, int *sock, fwd_backend **backend);
+void forwardAndExit(const int from, const int to, const char *name, const fwd_path *path, const long long startedMs, tcp_stats *stats);
+bool forwardAlive(const int from, const int to, const fwd_path *path, const long long startedMs, const tcp_stats *stats);
+void usage(const char *name);
 
 #endif // MAIN_H
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "acl.h"
+#include "res.h"
+
+#define HIST_SUB_BITS 2
+#define HIST_MAX_EXP 36
+#define HIST_BUCKETS ((HIST_MAX_EXP - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+#define METRICS_LABEL_SIZE 64
+
+typedef struct latency_histogram
+{
+    uint64_t buckets[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+} fwd_histogram;
+
+typedef struct path_metrics
+{
+    uint64_t accepted;
+    uint64_t closed;
+    uint64_t connectFailures;
+    uint64_t rejected;
+    uint64_t bytesToUpstream;
+    uint64_t bytesToClient;
+    uint64_t queued;
+    uint64_t throttledToUpstream;
+    uint64_t throttledToClient;
+    uint64_t rateLimited;
+    uint64_t unavailable;
+    uint64_t connectTimeouts;
+    uint64_t idleTimeouts;
+    uint64_t lifetimeTimeouts;
+    uint64_t mirroredToUpstream;
+    uint64_t mirroredToClient;
+    uint64_t mirrorDroppedToUpstream;
+    uint64_t mirrorDroppedToClient;
+    int listenFd;
+    fwd_histogram connectTime;
+    fwd_histogram sessionTime;
+    // indexed by TCP_LEG_CLIENT and TCP_LEG_UPSTREAM
+    fwd_histogram tcpRtt[2];
+    fwd_histogram tcpDeliveryRate[2];
+    fwd_histogram tcpCwnd[2];
+    fwd_histogram tcpRetrans[2];
+} __attribute__((aligned(64))) fwd_metrics;
+
+typedef enum
+{
+    TOTAL_ACCEPTED,
+    TOTAL_ACTIVE,
+    TOTAL_REJECTED,
+    TOTAL_RATE_LIMITED,
+    TOTAL_UNAVAILABLE,
+    TOTAL_CONNECT_FAILURES,
+    TOTAL_CONNECT_TIMEOUTS,
+    TOTAL_IDLE_TIMEOUTS,
+    TOTAL_LIFETIME_TIMEOUTS,
+    TOTAL_BYTES_TO_UPSTREAM,
+    TOTAL_BYTES_TO_CLIENT,
+    TOTAL_QUEUED,
+    TOTAL_THROTTLED_TO_UPSTREAM,
+    TOTAL_THROTTLED_TO_CLIENT,
+    TOTAL_MIRRORED_TO_UPSTREAM,
+    TOTAL_MIRRORED_TO_CLIENT,
+    TOTAL_MIRROR_DROPPED_TO_UPSTREAM,
+    TOTAL_MIRROR_DROPPED_TO_CLIENT,
+    TOTAL_ACCEPT_QUEUE_LENGTH,
+    TOTAL_ACCEPT_QUEUE_LIMIT,
+    TOTAL_POOL_HITS,
+    TOTAL_POOL_MISSES,
+    METRICS_TOTALS
+} metrics_total;
+
+typedef struct metrics_series
+{
+    const char *name;
+    const char *type;
+    const char *labels;
+    metrics_total total;
+} metrics_series;
+
+typedef struct metrics_histogram
+{
+    const char *name;
+    size_t offset;
+    int minExp;
+    int maxExp;
+    bool seconds;
+} metrics_histogram;
+
+bool metricsInit(fwd_path *paths, const int size, const int shards);
+bool metricsAttach(fwd_path *paths, const int size);
+fwd_metrics *metricsShard(fwd_path *path, const int shard);
+void metricsAdd(uint64_t *counter, const uint64_t value);
+int histogramBucket(const uint64_t value);
+uint64_t histogramUpper(const int bucket);
+void histogramRecord(fwd_histogram *hist, const uint64_t value);
+void metricsWriteHistogram(FILE *out, const char *name, const char *label, fwd_path *path, const size_t offset, const int minExp, const int maxExp, const bool seconds);
+void metricsSum(fwd_path *path, uint64_t *totals);
+void metricsWrite(FILE *out, fwd_path *paths, const int size);
+void metricsWriteHealth(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE]);
+void metricsWriteTcpInfo(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE]);
+void metricsWriteAcl(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE]);
+bool metricsListen(int *sock, const char *spec);
+void metricsServe(const int client);
+void *metricsThread(void *arg);
+bool metricsStart(const char *spec);
+void metricsStop(void);
+
+#endif // METRICS_H
@@ -1,13 +1,51 @@
 #ifndef NET_H
 #define NET_H
 
+#include <stdbool.h>
 #include <sys/types.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
+
+#ifndef TCP_CA_NAME_MAX
+#define TCP_CA_NAME_MAX 16
+#endif
+#ifndef TCP_FASTOPEN_CONNECT
+#define TCP_FASTOPEN_CONNECT 30
+#endif
+
+// -1 leaves the kernel default
+typedef struct socket_tuning
+{
+    int nodelay;
+    int quickack;
+    int rcvbuf;
+    int sndbuf;
+    int fastopen;
+    int deferAccept;
+    int keepIdle;
+    int keepInterval;
+    int keepCount;
+    int notsentLowat;
+    char congestion[TCP_CA_NAME_MAX];
+} net_tuning;
 
 int uwuCreateTCPSocket(int *sock);
 int createConnectedSocket(int *sock, struct sockaddr_in *addr);
 int uwuCreateBoundSocket(int *sock, const short port);
+int uwuCreateReusePortSocket(int *sock, const short port);
 int uwuAcceptSocket(const int listenSocket, int *newSocket, struct sockaddr_in *client);
 int uwuSetSocketTimeout(const size_t sec, const size_t usec, const int sock);
+int uwuSetNonBlocking(const int sock);
+int uwuSetBlocking(const int sock);
+int createNonBlockingConnectedSocket(int *sock, struct sockaddr_in *addr, const net_tuning *tuning);
+int createListeningSocket(int *sock, const short port, const bool reusePort, const int backlog);
+void uwuResetSocket(const int sock);
+int uwuCreateUDPSocket(int *sock);
+int createBoundUDPSocket(int *sock, const short port);
+int createConnectedUDPSocket(int *sock, struct sockaddr_in *addr);
+void uwuInitTuning(net_tuning *tuning);
+int uwuTuneSocket(const int sock, const net_tuning *tuning, const bool listening);
+void uwuTuneAccepted(const int sock, const net_tuning *tuning);
+int uwuSetIncomingCpu(const int sock, const int cpu);
 
 #endif // NET_H
\ No newline at end of file
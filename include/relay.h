@@ -0,0 +1,96 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define RELAY_BUFFER_SIZE 16384
+#define RELAY_PIPE_SIZE 65536
+#define RELAY_MIN_SHIFT 12
+#define RELAY_CLASSES 5
+#define RELAY_POOL_KEEP 32
+#define RELAY_CLASS_SIZE(class) ((size_t)1 << (RELAY_MIN_SHIFT + (class)))
+
+typedef enum
+{
+    RELAY_EOF,
+    RELAY_FAILED,
+    RELAY_TIMEOUT
+} relay_end;
+
+typedef struct relay_pool
+{
+    char *free[RELAY_CLASSES];
+    int count[RELAY_CLASSES];
+    size_t inUse;
+    size_t pooled;
+    bool registered;
+    struct relay_pool *next;
+} relay_pool;
+
+typedef struct relay_chunk
+{
+    struct relay_chunk *next;
+    size_t start;
+    size_t end;
+    unsigned char sizeClass;
+    char data[];
+} relay_chunk;
+
+typedef struct relay_mirror
+{
+    int fd;
+    int pipe[2];
+    size_t piped;
+    size_t limit;
+    size_t bytes;
+    size_t dropped;
+    bool open;
+    bool shut;
+} relay_mirror;
+
+typedef struct relay_direction
+{
+    relay_chunk *head;
+    relay_chunk *tail;
+    size_t queued;
+    size_t limit;
+    size_t allowance;
+    int pipe[2];
+    size_t piped;
+    size_t bytes;
+    unsigned char sizeClass;
+    bool eof;
+    bool shut;
+    bool spliced;
+    relay_mirror *mirror;
+} relay_dir;
+
+relay_pool *relayPool(void);
+void relayAccount(const ssize_t inUse, const ssize_t pooled);
+void relayMemory(size_t *inUse, size_t *pooled);
+char *relayBorrow(const int sizeClass);
+void relayReturn(char *buffer, const int sizeClass);
+size_t relayCapacity(const relay_chunk *chunk);
+relay_chunk *relayPush(relay_dir *dir);
+void relayPop(relay_dir *dir);
+void relayPut(relay_dir *dir);
+void relayAdapt(relay_dir *dir, const size_t n, const size_t size);
+bool relayInitSplice(relay_dir *dir);
+void relayRelease(relay_dir *dir);
+bool relayPending(const relay_dir *dir);
+size_t relayQueued(const relay_dir *dir);
+bool relayShutdown(const int to, relay_dir *dir);
+int relayCopy(const int from, const int to, relay_dir *dir);
+int relaySplice(const int from, const int to, relay_dir *dir);
+int relayDirection(const int from, const int to, relay_dir *dir);
+bool relayMirrorInit(relay_mirror *mirror, const size_t limit);
+void relayMirrorTee(relay_dir *dir, const size_t n);
+void relayMirrorWrite(relay_dir *dir, const char *data, const size_t n);
+int relayMirrorFlush(relay_dir *dir);
+void relayMirrorRelease(relay_mirror *mirror);
+ssize_t relayCopyBlocking(const int from, const int to, relay_end *end);
+ssize_t relaySpliceBlocking(const int from, const int to, relay_end *end);
+
+#endif // RELAY_H
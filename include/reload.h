@@ -0,0 +1,29 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include <stdbool.h>
+
+#include "res.h"
+
+fwd_config *configCreate(fwd_path *paths, const int size);
+void configIndex(fwd_config *config);
+fwd_path *configFind(const fwd_config *config, const struct sockaddr_in *in, const bool udp);
+fwd_path *configRoute(const fwd_config *config, const struct sockaddr_in *client, const int port);
+void configStart(fwd_path *paths, const int size);
+fwd_config *configCurrent(void);
+fwd_config *configAcquireCurrent(void);
+void configAcquire(fwd_config *config);
+void configRelease(fwd_config *config);
+bool pathSame(const fwd_path *a, const fwd_path *b);
+void configDiff(fwd_config *old, fwd_config *config);
+void configPublish(fwd_config *config);
+bool configReload(void);
+void configDrain(void);
+bool configDrained(void);
+int configRegister(void);
+void configNotify(void);
+void pathFree(fwd_path *path);
+void configFree(fwd_config *config);
+void configCollect(void);
+
+#endif // RELOAD_H
@@ -4,13 +4,130 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "net.h"
+
+#define HEALTH_PAYLOAD_SIZE 64
+#define MIRROR_UPSTREAM 1
+#define MIRROR_CLIENT 2
+
+typedef enum
+{
+    LB_ROUND_ROBIN,
+    LB_LEAST_CONN,
+    LB_HASH
+} lb_policy;
+
+typedef struct forwarding_backend
+{
+    struct sockaddr_in addr;
+    char name[INET_ADDRSTRLEN];
+    size_t active;
+} fwd_backend;
+
+typedef struct hash_ring_point
+{
+    uint32_t hash;
+    int backend;
+} lb_point;
 
 typedef struct fowarding_path
 {
     struct sockaddr_in in;
     struct sockaddr_in out;
+    char inName[INET_ADDRSTRLEN];
+    fwd_backend *backends;
+    int backendCount;
+    lb_policy policy;
+    size_t nextBackend;
+    lb_point *ring;
+    int ringSize;
+    int connectTimeout;
+    int poolSize;
+    int poolIdle;
+    bool udp;
+    int udpIdle;
+    int idleTimeout;
+    int maxLifetime;
+    size_t queueLimit;
+    int backlog;
+    net_tuning clientTuning;
+    net_tuning upstreamTuning;
+    long rate;
+    long clientRate;
+    long connRate;
+    long clientConnRate;
+    int healthInterval;
+    int healthTimeout;
+    int healthFall;
+    int healthRise;
+    int healthCooldown;
+    char healthSend[HEALTH_PAYLOAD_SIZE];
+    size_t healthSendLength;
+    char healthExpect[HEALTH_PAYLOAD_SIZE];
+    size_t healthExpectLength;
+    bool mirrored;
+    struct sockaddr_in mirror;
+    int mirrorDirections;
+    size_t mirrorBuffer;
+    bool tcpInfo;
+    int tcpInfoInterval;
+    size_t poolHits;
+    size_t poolMisses;
+    size_t poolDiscards;
+    struct path_metrics *metrics;
+    struct path_acl *acl;
+    struct path_limits *limits;
+    struct backend_health *health;
+    struct forwarding_config *config;
+    int previous;
+    bool backendsMoved;
+    bool metricsMoved;
+    pid_t pid;
+    int listenFd;
 } fwd_path;
 
+typedef struct forwarding_config
+{
+    fwd_path *paths;
+    int size;
+    int *index;
+    size_t slots;
+    size_t refs;
+    struct forwarding_config *newer;
+} fwd_config;
+
+typedef enum
+{
+    ENGINE_EPOLL,
+    ENGINE_FORK,
+    ENGINE_URING
+} engine_kind;
+
+typedef enum
+{
+    RELAY_COPY,
+    RELAY_SPLICE
+} relay_mode;
+
+typedef struct forwarder_options
+{
+    engine_kind engine;
+    relay_mode relay;
+    int workers;
+    int logRate;
+    const char *metrics;
+    int resolveTtl;
+    const char *cache;
+} fwd_options;
+
+extern fwd_options options;
+
 void die(const char *msg);
+long long monotonicMs(void);
+long long monotonicUs(void);
 
 #endif // RES_H
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define HOST_BUFFER_SIZE 256
+
+typedef struct resolved_host
+{
+    char name[HOST_BUFFER_SIZE];
+    struct in_addr addr;
+    bool resolved;
+    time_t expires;
+    unsigned long seen;
+    int next;
+} fwd_host;
+
+typedef struct resolve_task
+{
+    char name[HOST_BUFFER_SIZE];
+    int host;
+    struct in_addr addr;
+    bool resolved;
+} resolve_task;
+
+typedef struct resolve_batch
+{
+    resolve_task *tasks;
+    int count;
+    int next;
+} resolve_batch;
+
+bool resolveName(const char *name, struct in_addr *addr);
+unsigned hashName(const char *name);
+int hostFind(const char *name);
+void hostsBegin(void);
+void hostAdd(const char *name);
+bool hostLookup(const char *name, struct in_addr *addr);
+fwd_host *hostsCopy(int *count);
+void hostSeed(const fwd_host *host);
+void *resolveWorker(void *arg);
+void resolveBatch(resolve_task *tasks, const int count);
+int hostsUpdate(resolve_task *tasks, const int count, const time_t now);
+resolve_task *hostsDue(const bool all, const time_t now, int *count);
+void hostsResolve(void);
+void *resolveThread(void *arg);
+bool resolveStart(void);
+
+#endif // RESOLVE_H
@@ -0,0 +1,57 @@
+#ifndef TCPINFO_H
+#define TCPINFO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "metrics.h"
+#include "res.h"
+
+#define TCP_LEG_CLIENT 0
+#define TCP_LEG_UPSTREAM 1
+#define TCP_LEGS 2
+
+// the kernel's struct tcp_info goes on past the end of the one in glibc, see linux/tcp.h
+typedef struct tcp_info_full
+{
+    struct tcp_info base;
+    uint64_t pacingRate;
+    uint64_t maxPacingRate;
+    uint64_t bytesAcked;
+    uint64_t bytesReceived;
+    uint32_t segsOut;
+    uint32_t segsIn;
+    uint32_t notsentBytes;
+    uint32_t minRtt;
+    uint32_t dataSegsIn;
+    uint32_t dataSegsOut;
+    uint64_t deliveryRate;
+} tcp_info_full;
+
+typedef struct tcp_leg
+{
+    uint32_t rtt;
+    uint32_t rttVar;
+    uint32_t minRtt;
+    uint32_t maxRtt;
+    uint32_t retrans;
+    uint32_t cwnd;
+    uint64_t deliveryRate;
+    uint64_t maxDeliveryRate;
+    bool sampled;
+} tcp_leg;
+
+typedef struct tcp_stats
+{
+    tcp_leg legs[TCP_LEGS];
+    long long nextSample;
+    int samples;
+} tcp_stats;
+
+void tcpInfoStart(tcp_stats *stats, const fwd_path *path, const long long nowMs);
+bool tcpInfoRead(const int sock, tcp_leg *leg);
+void tcpInfoSample(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics);
+void tcpInfoTick(tcp_stats *stats, const fwd_path *path, const int client, const int upstream, fwd_metrics *metrics, const long long nowMs);
+void tcpInfoFinish(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics, const fwd_path *path, const char *backend, const long long durationUs);
+
+#endif // TCPINFO_H
@@ -0,0 +1,123 @@
+#ifndef UDP_H
+#define UDP_H
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "limit.h"
+#include "metrics.h"
+#include "res.h"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#define UDP_BATCH 32
+#define UDP_BUFFER_SIZE 65536
+#define UDP_MIN_BUCKETS 1024
+#define UDP_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+
+typedef enum
+{
+    UDP_LISTENER,
+    UDP_FLOW,
+    UDP_CONTROL
+} udp_kind;
+
+typedef struct udp_endpoint
+{
+    udp_kind kind;
+    int fd;
+    void *owner;
+} udp_endpoint;
+
+typedef struct udp_flow
+{
+    udp_endpoint ep;
+    struct udp_listener *listener;
+    fwd_path *path;
+    fwd_backend *backend;
+    fwd_metrics *metrics;
+    limit_client *limitClient;
+    struct sockaddr_in client;
+    uint32_t hash;
+    long long startedUs;
+    time_t lastActive;
+    bool closed;
+    struct udp_flow *hashNext;
+    struct udp_flow *older;
+    struct udp_flow *newer;
+} udp_flow;
+
+typedef struct udp_listener
+{
+    udp_endpoint ep;
+    fwd_path *path;
+    fwd_metrics *metrics;
+    udp_flow *oldest;
+    udp_flow *newest;
+} udp_listener;
+
+typedef struct udp_batch
+{
+    struct mmsghdr recv[UDP_BATCH];
+    struct mmsghdr send[UDP_BATCH];
+    struct iovec recvIov[UDP_BATCH];
+    struct iovec sendIov[UDP_BATCH];
+    struct sockaddr_in addrs[UDP_BATCH];
+    char recvControl[UDP_BATCH][UDP_CONTROL_SIZE] __attribute__((aligned(8)));
+    char sendControl[UDP_BATCH][UDP_CONTROL_SIZE] __attribute__((aligned(8)));
+    int segments[UDP_BATCH];
+    char *buffers;
+} udp_batch;
+
+typedef struct udp_worker
+{
+    int epfd;
+    int shard;
+    udp_endpoint control;
+    fwd_config *config;
+    udp_listener **listeners;
+    int listenerCount;
+    udp_flow **buckets;
+    size_t bucketCount;
+    size_t flowCount;
+    udp_flow *closed;
+    time_t now;
+    time_t lastSweep;
+    bool gro;
+    bool reload;
+    udp_batch batch;
+} udp_worker;
+
+bool udpWorkerInit(udp_worker *worker, fwd_config *config, const int shard);
+udp_listener *udpListenerOpen(udp_worker *worker, fwd_path *path);
+void udpListenerClose(udp_worker *worker, udp_listener *listener);
+void udpReload(udp_worker *worker);
+void udpApply(udp_worker *worker, fwd_config *config);
+void udpRun(udp_worker *worker);
+void *udpThread(void *arg);
+void udpReceive(udp_worker *worker, udp_listener *listener);
+void udpReturn(udp_worker *worker, udp_flow *flow);
+int udpRead(udp_worker *worker, const int sock);
+void udpPrepare(udp_worker *worker, const int index, struct sockaddr_in *to);
+void udpSend(udp_worker *worker, const int sock, const int first, const int count);
+void udpSendSplit(const int sock, struct msghdr *msg, const int segment);
+uint32_t udpHash(const udp_listener *listener, const struct sockaddr_in *client);
+udp_flow *udpFlowFind(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client);
+udp_flow *udpFlowOpen(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client);
+void udpFlowGrow(udp_worker *worker);
+void udpFlowTouch(udp_worker *worker, udp_flow *flow);
+void udpFlowClose(udp_worker *worker, udp_flow *flow);
+bool udpFlowAllow(udp_flow *flow, const bool toUpstream, const size_t len);
+void udpSweep(udp_worker *worker);
+bool udpStart(fwd_config *config, const int shard);
+
+#endif // UDP_H
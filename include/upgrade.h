@@ -0,0 +1,65 @@
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+#include <limits.h>
+#include <stdbool.h>
+
+#include "resolve.h"
+
+#define UPGRADE_ENV "FORWARDER_UPGRADE_FD"
+#define UPGRADE_TIMEOUT 10
+
+typedef enum
+{
+    UPGRADE_TCP,
+    UPGRADE_UDP,
+    UPGRADE_METRICS
+} upgrade_kind;
+
+typedef enum
+{
+    UPGRADE_HOST,
+    UPGRADE_SOCKET,
+    UPGRADE_END
+} upgrade_type;
+
+typedef struct upgrade_socket
+{
+    int fd;
+    upgrade_kind kind;
+    int port;
+    int slot;
+} upgrade_socket;
+
+typedef struct upgrade_list
+{
+    upgrade_socket *sockets;
+    int count;
+    int limit;
+} upgrade_list;
+
+typedef struct upgrade_record
+{
+    upgrade_type type;
+    upgrade_kind kind;
+    int port;
+    int slot;
+    fwd_host host;
+} upgrade_record;
+
+void upgradeInit(char *argv[]);
+void upgradeAppend(upgrade_list *list, const int fd, const upgrade_kind kind, const int port, const int slot);
+void upgradeTrack(const int fd, const upgrade_kind kind, const int port, const int slot);
+bool upgradeUntrack(const int fd);
+int upgradeTake(const upgrade_kind kind, const int port, const int slot);
+bool upgradeListen(int *sock, const int port, const int slot, const bool reusePort, const int backlog);
+void upgradeCloseAll(const int keep);
+bool upgradeSend(const int channel, const upgrade_record *record, const int fd);
+bool upgradeRecv(const int channel, upgrade_record *record, int *fd);
+bool upgradeHandOver(const int channel);
+char **upgradeEnvironment(const int channel);
+bool upgradeStart(void);
+void upgradeReceive(void);
+void upgradeReady(void);
+
+#endif // UPGRADE_H
@@ -0,0 +1,182 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "limit.h"
+#include "metrics.h"
+#include "res.h"
+#include "tcpinfo.h"
+#include "wheel.h"
+
+typedef struct io_uring_ring
+{
+    int fd;
+    unsigned entries;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    struct io_uring_sqe *sqes;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    unsigned sqeTail;
+    unsigned sqeSubmitted;
+    void *sqMap;
+    size_t sqMapSize;
+    void *cqMap;
+    size_t cqMapSize;
+    size_t sqesSize;
+} fwd_uring;
+
+typedef enum
+{
+    URING_ACCEPT,
+    URING_CONNECT,
+    URING_READ,
+    URING_WRITE,
+    URING_POLL,
+    URING_CONTROL,
+    URING_TICK,
+    URING_WHEEL
+} uring_kind;
+
+typedef struct uring_operation
+{
+    uring_kind kind;
+    void *owner;
+} uring_op;
+
+typedef struct uring_direction
+{
+    uring_op op;
+    struct uring_connection *conn;
+    int from;
+    int to;
+    char *buffer;
+    int bufIndex;
+    size_t want;
+    size_t len;
+    size_t off;
+    size_t bytes;
+    bool eof;
+    struct uring_direction *throttledNext;
+} uring_dir;
+
+typedef struct uring_connection
+{
+    uring_op connectOp;
+    int client;
+    int upstream;
+    fwd_path *path;
+    fwd_metrics *metrics;
+    limit_client *limitClient;
+    long long startedUs;
+    fwd_backend *first;
+    fwd_backend *backend;
+    int attempts;
+    long long deadline;
+    struct __kernel_timespec timeout;
+    bool connected;
+    long long lastActive;
+    wheel_timer timer;
+    uring_dir toUpstream;
+    uring_dir toClient;
+    tcp_stats tcp;
+    int inflight;
+    bool closing;
+} uring_conn;
+
+typedef struct uring_socket
+{
+    uring_op op;
+    int fd;
+    int port;
+    int refs;
+    fwd_config *config;
+    bool reported;
+    bool closing;
+    bool shared;
+} uring_socket;
+
+typedef struct uring_listener
+{
+    uring_socket *socket;
+    fwd_path *path;
+    fwd_metrics *metrics;
+} uring_listener;
+
+typedef struct uring_worker
+{
+    int id;
+    int cpu;
+    fwd_uring ring;
+    uring_op control;
+    int controlFd;
+    uint64_t controlValue;
+    fwd_config *config;
+    uring_listener **listeners;
+    int listenerCount;
+    uring_socket **ports;
+    bool reusePort;
+    bool multishot;
+    bool registered;
+    char *slab;
+    int *freeBuffers;
+    int freeCount;
+    uring_op tick;
+    struct __kernel_timespec tickTimeout;
+    uring_dir *throttled;
+    timer_wheel wheel;
+    uring_op wheelOp;
+    struct __kernel_timespec wheelTimeout;
+    bool wheelArmed;
+    long long nowMs;
+    size_t connCount;
+} uring_worker;
+
+bool uringSetup(fwd_uring *ring, const unsigned entries);
+void uringTeardown(fwd_uring *ring);
+void uringReserve(fwd_uring *ring, const unsigned count);
+struct io_uring_sqe *uringGetSqe(fwd_uring *ring);
+int uringSubmit(fwd_uring *ring, const unsigned wait);
+bool uringRegisterBuffers(fwd_uring *ring, char *slab, const int count, const size_t size);
+
+bool uringWorkerInit(uring_worker *worker, fwd_config *config, const int id, const bool reusePort);
+uring_socket *uringSocketOpen(uring_worker *worker, fwd_path *path);
+void uringSocketRelease(uring_worker *worker, uring_socket *socket);
+uring_listener *uringListenerOpen(uring_worker *worker, fwd_path *path);
+void uringListenerClose(uring_worker *worker, uring_listener *listener);
+void uringPostControl(uring_worker *worker);
+void uringReload(uring_worker *worker);
+void uringQueues(uring_worker *worker);
+void uringWorkerRun(uring_worker *worker);
+void *uringWorkerThread(void *arg);
+void uringArmAccept(uring_worker *worker, uring_socket *socket);
+void uringAccept(uring_worker *worker, uring_socket *socket, const int res, const unsigned flags);
+void uringAdmit(uring_worker *worker, uring_socket *socket, const int sock);
+bool uringConnect(uring_worker *worker, uring_conn *conn);
+void uringBufferTake(uring_worker *worker, uring_dir *dir);
+void uringBufferPut(uring_worker *worker, uring_dir *dir);
+void uringPostPoll(uring_worker *worker, uring_dir *dir);
+void uringPostRead(uring_worker *worker, uring_dir *dir);
+void uringPostWrite(uring_worker *worker, uring_dir *dir);
+void uringRead(uring_worker *worker, uring_dir *dir);
+void uringThrottle(uring_worker *worker, uring_dir *dir);
+void uringTick(uring_worker *worker);
+void uringArm(uring_worker *worker, uring_conn *conn);
+void uringExpire(uring_worker *worker, uring_conn *conn);
+void uringTimers(uring_worker *worker);
+void uringComplete(uring_worker *worker, uring_op *op, const int res, const unsigned flags);
+void uringConnClose(uring_worker *worker, uring_conn *conn);
+void uringConnRelease(uring_worker *worker, uring_conn *conn);
+bool uringAvailable(void);
+void uringRoutine(fwd_config *config);
+
+#endif // URING_H
@@ -0,0 +1,35 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stddef.h>
+
+#define WHEEL_TICK 10
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 5
+
+typedef struct wheel_timer
+{
+    struct wheel_timer *prev;
+    struct wheel_timer *next;
+    struct wheel_timer **slot;
+    long long due;
+    void *owner;
+} wheel_timer;
+
+typedef struct timer_wheel
+{
+    long long tick;
+    size_t count;
+    wheel_timer *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+} timer_wheel;
+
+void wheelInit(timer_wheel *wheel, const long long nowMs);
+void wheelAdd(timer_wheel *wheel, wheel_timer *timer, const long long dueMs);
+void wheelCancel(timer_wheel *wheel, wheel_timer *timer);
+void wheelPlace(timer_wheel *wheel, wheel_timer *timer);
+void wheelCascade(timer_wheel *wheel, const int level);
+wheel_timer *wheelExpire(timer_wheel *wheel, const long long nowMs);
+int wheelTimeout(timer_wheel *wheel, const long long nowMs);
+
+#endif // WHEEL_H
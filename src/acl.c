@@ -0,0 +1,602 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             acl.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool parseCidr(const char *text, uint32_t *prefix, int *length)
+--                          bool aclAdd(fwd_path *path, const uint32_t prefix, const int length, const bool allow)
+--                          bool aclParseList(fwd_path *path, const char *list, const bool allow)
+--                          bool aclLoad(fwd_path *path, const char *file)
+--                          int aclNode(fwd_acl *acl, const uint32_t prefix, const int length, const int rule)
+--                          void aclInsert(fwd_acl *acl, const int rule)
+--                          bool aclCompile(fwd_path *path)
+--                          int aclMatch(const fwd_acl *acl, const uint32_t addr)
+--                          bool aclAllows(fwd_acl *acl, const struct in_addr addr)
+--                          bool aclAdmits(const fwd_acl *acl, const struct in_addr addr)
+--                          void aclFormatRule(const acl_rule *rule, char *out, const size_t size)
+--                          bool aclSame(const fwd_acl *a, const fwd_acl *b)
+--                          void aclFree(fwd_acl *acl)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Client address access lists. The allow, deny and acl options of a path add CIDR rules, and once
+-- the line is parsed they are compiled into a path compressed binary trie (a Patricia trie). Every
+-- node holds the prefix that leads to it, so a lookup skips every run of bits that no rule splits
+-- on and visits at most one node per distinct prefix length on the way down, whatever the number
+-- of rules. The nodes live in one array sized for the worst case of two nodes per rule.
+--
+-- The most specific matching rule decides. When two rules have the same prefix the later one
+-- wins. A client that matches no rule is refused if the path has any allow rule and admitted
+-- otherwise. A path without rules gets a single allow rule for its incoming address, which is the
+-- exact match the forwarder always did.
+---------------------------------------------------------------------------------------*/
+
+#define ACL_LINE_SIZE 128
+
+#include "acl.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io.h"
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                parseCidr
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool parseCidr(const char *text, uint32_t *prefix, int *length)
+--                              const char *text: A dotted decimal address, optionally followed by /length.
+--                              uint32_t *prefix: Pointer to where the prefix, in host order, will be placed.
+--                              int *length: Pointer to where the prefix length will be placed.
+--
+-- RETURNS:                 True if text is a valid prefix, false otherwise.
+--
+-- NOTES:
+-- An address without a length is a /32. Bits past the length are cleared.
+--------------------------------------------------------------------------------------------------*/
+bool parseCidr(const char *text, uint32_t *prefix, int *length)
+{
+    char addr[INET_ADDRSTRLEN];
+    const char *slash = strchr(text, '/');
+    size_t size = slash ? (size_t)(slash - text) : strlen(text);
+    struct in_addr parsed;
+    long number = 32;
+
+    if (size >= sizeof(addr))
+    {
+        return false;
+    }
+    memcpy(addr, text, size);
+    addr[size] = 0;
+
+    if (inet_pton(AF_INET, addr, &parsed) != 1 || (slash && !parseNumber(slash + 1, 0, 32, &number)))
+    {
+        return false;
+    }
+
+    *length = number;
+    *prefix = ntohl(parsed.s_addr) & ACL_MASK(*length);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclAdd
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclAdd(fwd_path *path, const uint32_t prefix, const int length, const bool allow)
+--                              fwd_path *path: The path to add the rule to.
+--                              const uint32_t prefix: The prefix in host order.
+--                              const int length: The prefix length.
+--                              const bool allow: Whether matching clients are admitted.
+--
+-- RETURNS:                 True if the rule was added, false if memory could not be allocated.
+--
+-- NOTES:
+-- Appends a rule to the access list of the path, creating the list if needed. The trie is only
+-- built by aclCompile.
+--------------------------------------------------------------------------------------------------*/
+bool aclAdd(fwd_path *path, const uint32_t prefix, const int length, const bool allow)
+{
+    fwd_acl *acl;
+    acl_rule *rules;
+
+    if (path->acl == NULL && (path->acl = calloc(1, sizeof(fwd_acl))) == NULL)
+    {
+        return false;
+    }
+    acl = path->acl;
+
+    if (acl->ruleCount == acl->ruleLimit)
+    {
+        acl->ruleLimit = acl->ruleLimit ? acl->ruleLimit * 2 : 4;
+        if ((rules = realloc(acl->rules, sizeof(acl_rule) * acl->ruleLimit)) == NULL)
+        {
+            return false;
+        }
+        acl->rules = rules;
+    }
+
+    acl->rules[acl->ruleCount].prefix = prefix;
+    acl->rules[acl->ruleCount].length = length;
+    acl->rules[acl->ruleCount].allow = allow;
+    acl->rules[acl->ruleCount].hits = 0;
+    acl->ruleCount++;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclParseList
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclParseList(fwd_path *path, const char *list, const bool allow)
+--                              fwd_path *path: The path to add the rules to.
+--                              const char *list: Comma separated prefixes.
+--                              const bool allow: Whether the prefixes are allowed or denied.
+--
+-- RETURNS:                 True if every prefix was valid, false otherwise.
+--
+-- NOTES:
+-- Handles the value of the allow and deny options.
+--------------------------------------------------------------------------------------------------*/
+bool aclParseList(fwd_path *path, const char *list, const bool allow)
+{
+    char buffer[ACL_LINE_SIZE * 2];
+    char *save;
+    char *token;
+    uint32_t prefix;
+    int length;
+
+    if (strlen(list) >= sizeof(buffer))
+    {
+        return false;
+    }
+    strcpy(buffer, list);
+
+    for (token = strtok_r(buffer, ",", &save); token; token = strtok_r(NULL, ",", &save))
+    {
+        if (!parseCidr(token, &prefix, &length))
+        {
+            return false;
+        }
+        if (!aclAdd(path, prefix, length, allow))
+        {
+            die("realloc");
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclLoad
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclLoad(fwd_path *path, const char *file)
+--                              fwd_path *path: The path to add the rules to.
+--                              const char *file: The access list file.
+--
+-- RETURNS:                 True if the file was read and every line was valid, false otherwise.
+--
+-- NOTES:
+-- Handles the acl option. Every line of the file is "allow prefix" or "deny prefix". Empty lines
+-- and lines starting with # are ignored.
+--------------------------------------------------------------------------------------------------*/
+bool aclLoad(fwd_path *path, const char *file)
+{
+    FILE *aclFile;
+    char lineBuffer[ACL_LINE_SIZE];
+    char action[8];
+    char cidr[ACL_LINE_SIZE];
+    uint32_t prefix;
+    int length;
+    int line = 0;
+    int fields;
+
+    if ((aclFile = fopen(file, "r")) == NULL)
+    {
+        Error("Could not open: %s", file);
+        return false;
+    }
+
+    while (fgets(lineBuffer, ACL_LINE_SIZE, aclFile))
+    {
+        line++;
+        if ((fields = sscanf(lineBuffer, "%7s %127s", action, cidr)) < 1 || action[0] == '#')
+        {
+            continue;
+        }
+
+        if (fields != 2 || (strcmp(action, "allow") && strcmp(action, "deny")) || !parseCidr(cidr, &prefix, &length))
+        {
+            Error("Invalid rule on line %d of %s", line, file);
+            fclose(aclFile);
+            return false;
+        }
+
+        if (!aclAdd(path, prefix, length, !strcmp(action, "allow")))
+        {
+            die("realloc");
+        }
+    }
+
+    fclose(aclFile);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclNode
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int aclNode(fwd_acl *acl, const uint32_t prefix, const int length, const int rule)
+--                              fwd_acl *acl: The access list to add the node to.
+--                              const uint32_t prefix: The prefix that leads to the node.
+--                              const int length: The length of the prefix.
+--                              const int rule: The rule of the node, -1 for a node that only splits.
+--
+-- RETURNS:                 The index of the new node.
+--------------------------------------------------------------------------------------------------*/
+int aclNode(fwd_acl *acl, const uint32_t prefix, const int length, const int rule)
+{
+    acl_node *node = acl->nodes + acl->nodeCount;
+
+    node->prefix = prefix & ACL_MASK(length);
+    node->length = length;
+    node->rule = rule;
+    node->child[0] = -1;
+    node->child[1] = -1;
+    return acl->nodeCount++;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclInsert
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void aclInsert(fwd_acl *acl, const int rule)
+--                              fwd_acl *acl: The access list whose trie to insert into.
+--                              const int rule: The index of the rule to insert.
+--
+-- NOTES:
+-- Walks down from the root while the prefix of the next node is a prefix of the rule. The rule
+-- ends up on an existing node of the same prefix, as a new leaf, or on a node that is put between
+-- two nodes. If the rule and the node it stopped at only share part of their bits, a node that
+-- only splits at the first bit they differ on is added above both.
+--------------------------------------------------------------------------------------------------*/
+void aclInsert(fwd_acl *acl, const int rule)
+{
+    uint32_t prefix = acl->rules[rule].prefix;
+    int length = acl->rules[rule].length;
+    int node = 0;
+    int child;
+    int common;
+    int split;
+    int bit;
+    uint32_t diff;
+
+    while (acl->nodes[node].length != length)
+    {
+        bit = ACL_BIT(prefix, acl->nodes[node].length);
+        if ((child = acl->nodes[node].child[bit]) == -1)
+        {
+            acl->nodes[node].child[bit] = aclNode(acl, prefix, length, rule);
+            return;
+        }
+
+        // the number of leading bits the rule shares with the child, up to the shorter of the two
+        diff = prefix ^ acl->nodes[child].prefix;
+        common = diff ? __builtin_clz(diff) : 32;
+        common = common < length ? common : length;
+        common = common < acl->nodes[child].length ? common : acl->nodes[child].length;
+
+        if (common == acl->nodes[child].length)
+        {
+            node = child;
+            continue;
+        }
+
+        if (common == length)
+        {
+            split = aclNode(acl, prefix, length, rule);
+        }
+        else
+        {
+            split = aclNode(acl, prefix, common, -1);
+            acl->nodes[split].child[ACL_BIT(prefix, common)] = aclNode(acl, prefix, length, rule);
+        }
+        acl->nodes[split].child[ACL_BIT(acl->nodes[child].prefix, common)] = child;
+        acl->nodes[node].child[bit] = split;
+        return;
+    }
+
+    acl->nodes[node].rule = rule;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclCompile
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclCompile(fwd_path *path)
+--                              fwd_path *path: The parsed path.
+--
+-- RETURNS:                 True if the trie was built, false if memory could not be allocated.
+--
+-- NOTES:
+-- Builds the trie of the rules of the path. A path without rules only admits its incoming address.
+--------------------------------------------------------------------------------------------------*/
+bool aclCompile(fwd_path *path)
+{
+    fwd_acl *acl;
+
+    if (path->acl == NULL && !aclAdd(path, ntohl(path->in.sin_addr.s_addr), 32, true))
+    {
+        return false;
+    }
+    acl = path->acl;
+
+    if ((acl->nodes = malloc(sizeof(acl_node) * (acl->ruleCount * 2 + 1))) == NULL)
+    {
+        return false;
+    }
+    acl->nodeCount = 0;
+    aclNode(acl, 0, 0, -1);
+
+    acl->allowUnmatched = true;
+    for (int i = 0; i < acl->ruleCount; i++)
+    {
+        acl->allowUnmatched = acl->allowUnmatched && !acl->rules[i].allow;
+        aclInsert(acl, i);
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclMatch
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int aclMatch(const fwd_acl *acl, const uint32_t addr)
+--                              const fwd_acl *acl: The compiled access list.
+--                              const uint32_t addr: The client address in host order.
+--
+-- RETURNS:                 The index of the most specific rule that matches addr, -1 if none does.
+--------------------------------------------------------------------------------------------------*/
+int aclMatch(const fwd_acl *acl, const uint32_t addr)
+{
+    int best = -1;
+    const acl_node *node;
+
+    for (int i = 0; i != -1; i = node->child[ACL_BIT(addr, node->length)])
+    {
+        node = acl->nodes + i;
+        if ((addr ^ node->prefix) & ACL_MASK(node->length))
+        {
+            break;
+        }
+        if (node->rule != -1)
+        {
+            best = node->rule;
+        }
+        if (node->length == 32)
+        {
+            break;
+        }
+    }
+
+    return best;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclAllows
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclAllows(fwd_acl *acl, const struct in_addr addr)
+--                              fwd_acl *acl: The compiled access list.
+--                              const struct in_addr addr: The address of the client.
+--
+-- RETURNS:                 True if the client is admitted, false otherwise.
+--
+-- NOTES:
+-- Looks the client up and counts a hit on the rule that decided. Safe to call from every worker.
+--------------------------------------------------------------------------------------------------*/
+bool aclAllows(fwd_acl *acl, const struct in_addr addr)
+{
+    int rule = aclMatch(acl, ntohl(addr.s_addr));
+
+    if (rule == -1)
+    {
+        __atomic_fetch_add(&acl->unmatchedHits, 1, __ATOMIC_RELAXED);
+        return acl->allowUnmatched;
+    }
+
+    __atomic_fetch_add(&acl->rules[rule].hits, 1, __ATOMIC_RELAXED);
+    return acl->rules[rule].allow;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclAdmits
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclAdmits(const fwd_acl *acl, const struct in_addr addr)
+--                              const fwd_acl *acl: The compiled access list.
+--                              const struct in_addr addr: The address of the client.
+--
+-- RETURNS:                 True if the client would be admitted, false otherwise.
+--
+-- NOTES:
+-- Same as aclAllows without counting a hit, for choosing between the paths of a port.
+--------------------------------------------------------------------------------------------------*/
+bool aclAdmits(const fwd_acl *acl, const struct in_addr addr)
+{
+    int rule = aclMatch(acl, ntohl(addr.s_addr));
+
+    return rule == -1 ? acl->allowUnmatched : acl->rules[rule].allow;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclFormatRule
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void aclFormatRule(const acl_rule *rule, char *out, const size_t size)
+--                              const acl_rule *rule: The rule to format.
+--                              char *out: The buffer to format into, ACL_RULE_SIZE bytes is enough.
+--                              const size_t size: The size of out.
+--
+-- NOTES:
+-- Formats a rule as "allow 10.0.0.0/8" for the statistics.
+--------------------------------------------------------------------------------------------------*/
+void aclFormatRule(const acl_rule *rule, char *out, const size_t size)
+{
+    char addr[INET_ADDRSTRLEN];
+    struct in_addr prefix = {.s_addr = htonl(rule->prefix)};
+
+    inet_ntop(AF_INET, &prefix, addr, sizeof(addr));
+    snprintf(out, size, "%s %s/%d", rule->allow ? "allow" : "deny", addr, rule->length);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclSame
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool aclSame(const fwd_acl *a, const fwd_acl *b)
+--                              const fwd_acl *a: An access list.
+--                              const fwd_acl *b: The access list to compare it to.
+--
+-- RETURNS:                 True if both lists have the same rules in the same order.
+--------------------------------------------------------------------------------------------------*/
+bool aclSame(const fwd_acl *a, const fwd_acl *b)
+{
+    if (a->ruleCount != b->ruleCount)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < a->ruleCount; i++)
+    {
+        if (a->rules[i].prefix != b->rules[i].prefix || a->rules[i].length != b->rules[i].length
+            || a->rules[i].allow != b->rules[i].allow)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                aclFree
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void aclFree(fwd_acl *acl)
+--                              fwd_acl *acl: The access list to free, may be NULL.
+--------------------------------------------------------------------------------------------------*/
+void aclFree(fwd_acl *acl)
+{
+    if (acl == NULL)
+    {
+        return;
+    }
+
+    free(acl->rules);
+    free(acl->nodes);
+    free(acl);
+}
@@ -0,0 +1,599 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             affinity.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool affinityParseList(const char *list, cpu_set_t *set)
+--                          bool affinityReadList(const char *file, cpu_set_t *set)
+--                          int affinityScanIrqs(cpu_set_t *cpus, const int cpu, char *names, const size_t size)
+--                          bool affinityParse(const char *value)
+--                          int affinityCount(void)
+--                          int affinityWorkers(void)
+--                          int affinityCpu(const int id)
+--                          int affinityNode(const int cpu)
+--                          void *affinityAlloc(const size_t size, const int node)
+--                          bool affinitySpawn(void *(*routine)(void *), void *arg, const int cpu)
+--                          void affinityReport(const int count)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Pins the worker threads of the epoll and io_uring engines to CPUs. The CPUs come from the -c
+-- option, as a list, as every CPU the process may run on, or as the CPUs that handle the
+-- interrupts of the network devices. Worker n runs on the n-th CPU of the list, wrapping around
+-- when there are more workers than CPUs.
+--
+-- A pinned worker sets SO_INCOMING_CPU on its listeners, so the kernel hands a new connection to
+-- the worker on the CPU that received its packets and the connection is served where its
+-- interrupts land. A worker's state and relay slab are allocated on the NUMA node of its CPU with
+-- affinityAlloc. Everything else it allocates, connections and relay buffers, is allocated by the
+-- worker itself, which the kernel places on the node it runs on the first time it is touched.
+--
+-- The topology is read from sysfs and procfs. Without them, or without NUMA, the workers are
+-- still pinned and the nodes are reported as unknown.
+---------------------------------------------------------------------------------------*/
+
+#include "affinity.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <linux/mempolicy.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "io.h"
+
+static int cpus[CPU_SETSIZE];
+static int cpuCount = 0;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityParseList
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool affinityParseList(const char *list, cpu_set_t *set)
+--                              const char *list: The CPU list, such as 0-3,8.
+--                              cpu_set_t *set: The set to fill.
+--
+-- RETURNS:                 True if the list was valid and named at least one CPU, false otherwise.
+--
+-- NOTES:
+-- Parses a comma separated list of CPUs and CPU ranges, the format of the kernel's *_list files,
+-- which end in a newline.
+--------------------------------------------------------------------------------------------------*/
+bool affinityParseList(const char *list, cpu_set_t *set)
+{
+    long first;
+    long last;
+    char *end;
+
+    CPU_ZERO(set);
+    while (*list && *list != '\n')
+    {
+        first = strtol(list, &end, 10);
+        if (end == list || first < 0 || first >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        last = first;
+        if (*end == '-')
+        {
+            list = end + 1;
+            last = strtol(list, &end, 10);
+            if (end == list || last < first || last >= CPU_SETSIZE)
+            {
+                return false;
+            }
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+        {
+            CPU_SET(cpu, set);
+        }
+
+        list = end;
+        if (*list == ',')
+        {
+            list++;
+        }
+        else if (*list && *list != '\n')
+        {
+            return false;
+        }
+    }
+
+    return CPU_COUNT(set) > 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityReadList
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool affinityReadList(const char *file, cpu_set_t *set)
+--                              const char *file: The file holding a CPU list.
+--                              cpu_set_t *set: The set to fill.
+--
+-- RETURNS:                 True if the file was read and named at least one CPU, false otherwise.
+--
+-- NOTES:
+-- Reads a CPU list file such as /proc/irq/N/smp_affinity_list.
+--------------------------------------------------------------------------------------------------*/
+bool affinityReadList(const char *file, cpu_set_t *set)
+{
+    FILE *in;
+    char line[1024];
+    bool read;
+
+    if ((in = fopen(file, "r")) == NULL)
+    {
+        return false;
+    }
+    read = fgets(line, sizeof(line), in) != NULL;
+    fclose(in);
+
+    return read && affinityParseList(line, set);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityScanIrqs
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int affinityScanIrqs(cpu_set_t *cpus, const int cpu, char *names, const size_t size)
+--                              cpu_set_t *cpus: Set to every CPU that handles one of the interrupts,
+--                                               NULL if not needed.
+--                              const int cpu: The CPU to name the interrupts of, -1 for none.
+--                              char *names: Where to write the interrupts cpu handles, as
+--                                           interface:irq separated by spaces, NULL if not needed.
+--                              const size_t size: The size of names.
+--
+-- RETURNS:                 The number of interrupts of network devices found.
+--
+-- NOTES:
+-- Walks the MSI interrupts of every network device in /sys/class/net, one or more per RX queue
+-- on multiqueue NICs. Virtual interfaces have no device and are skipped. The CPUs an interrupt is
+-- delivered to are taken from effective_affinity_list, or from smp_affinity_list on kernels
+-- older than 4.15. An interrupt that is not in use has no effective CPU and is skipped.
+--------------------------------------------------------------------------------------------------*/
+int affinityScanIrqs(cpu_set_t *cpus, const int cpu, char *names, const size_t size)
+{
+    DIR *nics;
+    DIR *irqs;
+    struct dirent *nic;
+    struct dirent *irq;
+    char path[PATH_MAX];
+    cpu_set_t set;
+    size_t used = 0;
+    int found = 0;
+
+    if (cpus)
+    {
+        CPU_ZERO(cpus);
+    }
+    if (names && size)
+    {
+        names[0] = '\0';
+    }
+    if ((nics = opendir("/sys/class/net")) == NULL)
+    {
+        return 0;
+    }
+
+    while ((nic = readdir(nics)) != NULL)
+    {
+        snprintf(path, sizeof(path), "/sys/class/net/%s/device/msi_irqs", nic->d_name);
+        if (nic->d_name[0] == '.' || (irqs = opendir(path)) == NULL)
+        {
+            continue;
+        }
+
+        while ((irq = readdir(irqs)) != NULL)
+        {
+            if (irq->d_name[0] == '.')
+            {
+                continue;
+            }
+            snprintf(path, sizeof(path), "/proc/irq/%s/effective_affinity_list", irq->d_name);
+            if (access(path, R_OK) == -1)
+            {
+                snprintf(path, sizeof(path), "/proc/irq/%s/smp_affinity_list", irq->d_name);
+            }
+            if (!affinityReadList(path, &set))
+            {
+                continue;
+            }
+
+            found++;
+            if (cpus)
+            {
+                CPU_OR(cpus, cpus, &set);
+            }
+            if (names && cpu >= 0 && CPU_ISSET(cpu, &set) && used < size)
+            {
+                used += snprintf(names + used, size - used, "%s%s:%s", used ? " " : "", nic->d_name, irq->d_name);
+            }
+        }
+        closedir(irqs);
+    }
+    closedir(nics);
+
+    return found;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityParse
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool affinityParse(const char *value)
+--                              const char *value: The value of the -c option.
+--
+-- RETURNS:                 True if the workers will be pinned, false if value named no CPU.
+--
+-- NOTES:
+-- Sets the CPUs the workers are pinned to: the CPUs of a list, every CPU the process may run on
+-- for "auto", or the ones of those that handle the interrupts of the network devices for "irq".
+--------------------------------------------------------------------------------------------------*/
+bool affinityParse(const char *value)
+{
+    cpu_set_t set;
+    cpu_set_t allowed;
+
+    if (!strcmp(value, "auto") || !strcmp(value, "irq"))
+    {
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+        {
+            return false;
+        }
+        set = allowed;
+        if (!strcmp(value, "irq") && affinityScanIrqs(&set, -1, NULL, 0) == 0)
+        {
+            Error("Found no interrupts of network devices to pin workers to");
+            return false;
+        }
+        CPU_AND(&set, &set, &allowed);
+    }
+    else if (!affinityParseList(value, &set))
+    {
+        return false;
+    }
+
+    cpuCount = 0;
+    for (int i = 0; i < CPU_SETSIZE; i++)
+    {
+        if (CPU_ISSET(i, &set))
+        {
+            cpus[cpuCount++] = i;
+        }
+    }
+
+    return cpuCount > 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityCount
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int affinityCount(void)
+--
+-- RETURNS:                 The number of CPUs the workers are pinned to, 0 if they are not pinned.
+--------------------------------------------------------------------------------------------------*/
+int affinityCount(void)
+{
+    return cpuCount;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityWorkers
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int affinityWorkers(void)
+--
+-- RETURNS:                 The number of workers to start for one per core, at least 1.
+--
+-- NOTES:
+-- One worker for every CPU the workers are pinned to, or else for every CPU the process may run
+-- on, so a process limited to a few CPUs by a cpuset or taskset does not start a worker for every
+-- CPU of the machine.
+--------------------------------------------------------------------------------------------------*/
+int affinityWorkers(void)
+{
+    cpu_set_t allowed;
+    long online;
+
+    if (cpuCount > 0)
+    {
+        return cpuCount;
+    }
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0)
+    {
+        return CPU_COUNT(&allowed);
+    }
+    return (online = sysconf(_SC_NPROCESSORS_ONLN)) > 0 ? online : 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityCpu
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int affinityCpu(const int id)
+--                              const int id: The index of the worker.
+--
+-- RETURNS:                 The CPU the worker is pinned to, -1 if workers are not pinned.
+--------------------------------------------------------------------------------------------------*/
+int affinityCpu(const int id)
+{
+    return cpuCount ? cpus[id % cpuCount] : -1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityNode
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int affinityNode(const int cpu)
+--                              const int cpu: The CPU to look up, -1 for none.
+--
+-- RETURNS:                 The NUMA node of the CPU, -1 if it is not known.
+--
+-- NOTES:
+-- Kernels with NUMA link every CPU in sysfs to its node as /sys/devices/system/cpu/cpuN/nodeM.
+--------------------------------------------------------------------------------------------------*/
+int affinityNode(const int cpu)
+{
+    DIR *dir;
+    struct dirent *entry;
+    char path[PATH_MAX];
+    int node = -1;
+
+    if (cpu < 0)
+    {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    if ((dir = opendir(path)) == NULL)
+    {
+        return -1;
+    }
+    while (node == -1 && (entry = readdir(dir)) != NULL)
+    {
+        if (sscanf(entry->d_name, "node%d", &node) != 1)
+        {
+            node = -1;
+        }
+    }
+    closedir(dir);
+
+    return node;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityAlloc
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *affinityAlloc(const size_t size, const int node)
+--                              const size_t size: The number of bytes to allocate.
+--                              const int node: The NUMA node to allocate on, -1 for any.
+--
+-- RETURNS:                 The zeroed memory, to be released with free, NULL if it could not be
+--                          allocated.
+--
+-- NOTES:
+-- Allocates whole pages so no other allocation shares them, and asks the kernel with mbind to
+-- prefer the node for them before they are zeroed, which is when they are placed. MPOL_MF_MOVE
+-- moves pages malloc had already touched. The node is only a preference: the memory comes from
+-- another node when it is full, and from anywhere on kernels without NUMA.
+--------------------------------------------------------------------------------------------------*/
+void *affinityAlloc(const size_t size, const int node)
+{
+    void *memory;
+    unsigned long mask;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t length = (size + page - 1) / page * page;
+
+    if (posix_memalign(&memory, page, length))
+    {
+        return NULL;
+    }
+
+    if (node >= 0 && node < (int)(sizeof(mask) * CHAR_BIT))
+    {
+        mask = 1UL << node;
+        // the kernel reads one bit less than maxnode
+        syscall(SYS_mbind, memory, length, MPOL_PREFERRED, &mask, sizeof(mask) * CHAR_BIT + 1, MPOL_MF_MOVE);
+    }
+    memset(memory, 0, length);
+
+    return memory;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinitySpawn
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool affinitySpawn(void *(*routine)(void *), void *arg, const int cpu)
+--                              void *(*routine)(void *): The entry point of the thread.
+--                              void *arg: The argument of routine.
+--                              const int cpu: The CPU to pin the thread to, -1 for none.
+--
+-- RETURNS:                 True if the thread was started, false otherwise.
+--
+-- NOTES:
+-- Starts a detached thread that is pinned from its first instruction, so its stack and whatever
+-- it allocates first are already placed on its node. A CPU the process may not run on is reported
+-- and the thread is started unpinned.
+--------------------------------------------------------------------------------------------------*/
+bool affinitySpawn(void *(*routine)(void *), void *arg, const int cpu)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    cpu_set_t set;
+    bool pinned = false;
+    bool started;
+
+    pthread_attr_init(&attr);
+    if (cpu != -1)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pinned = !pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    }
+
+    started = !pthread_create(&thread, &attr, routine, arg);
+    if (!started && pinned)
+    {
+        Error("Could not pin a worker to CPU %d, leaving it unpinned", cpu);
+        started = !pthread_create(&thread, NULL, routine, arg);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (!started)
+    {
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                affinityReport
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void affinityReport(const int count)
+--                              const int count: The number of workers.
+--
+-- NOTES:
+-- Logs the CPU and NUMA node of every worker along with the network interrupts its CPU handles,
+-- then the CPUs that handle network interrupts but run no worker. Connections whose packets
+-- arrive on those CPUs have no listener there and are spread over the workers by the usual
+-- SO_REUSEPORT hash.
+--------------------------------------------------------------------------------------------------*/
+void affinityReport(const int count)
+{
+    char names[AFFINITY_NAMES_SIZE];
+    char node[16];
+    cpu_set_t served;
+    cpu_set_t handling;
+    uint64_t nodes = 0;
+    int nodeId;
+    int cpu;
+
+    if (cpuCount == 0)
+    {
+        Log("Workers are not pinned, %ld CPUs online", sysconf(_SC_NPROCESSORS_ONLN));
+        return;
+    }
+
+    CPU_ZERO(&served);
+    for (int i = 0; i < count; i++)
+    {
+        cpu = affinityCpu(i);
+        CPU_SET(cpu, &served);
+        if ((nodeId = affinityNode(cpu)) == -1)
+        {
+            snprintf(node, sizeof(node), "unknown");
+        }
+        else
+        {
+            snprintf(node, sizeof(node), "%d", nodeId);
+            nodes |= nodeId < 64 ? 1ULL << nodeId : 0;
+        }
+        affinityScanIrqs(NULL, cpu, names, sizeof(names));
+        Log("Worker %d on CPU %d, NUMA node %s, network interrupts: %s", i, cpu, node, names[0] ? names : "none");
+    }
+    Log("Pinned %d workers to %d CPUs on %d NUMA nodes", count, CPU_COUNT(&served), __builtin_popcountll(nodes));
+
+    affinityScanIrqs(&handling, -1, NULL, 0);
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &handling) && !CPU_ISSET(cpu, &served))
+        {
+            affinityScanIrqs(NULL, cpu, names, sizeof(names));
+            Log("CPU %d handles network interrupts %s but runs no worker", cpu, names);
+        }
+    }
+}
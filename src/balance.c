@@ -0,0 +1,520 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             balance.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool addBackend(fwd_path *path, const struct sockaddr_in *addr)
+--                          uint32_t hashAddress(const uint32_t addr, const uint32_t salt)
+--                          int comparePoints(const void *a, const void *b)
+--                          bool balanceInit(fwd_path *path)
+--                          uint32_t balanceRandom(void)
+--                          int ringSearch(fwd_path *path, const uint32_t hash)
+--                          fwd_backend *policyBackend(fwd_path *path, const struct sockaddr_in *client)
+--                          fwd_backend *pickBackend(fwd_path *path, const struct sockaddr_in *client)
+--                          fwd_backend *alternateBackend(fwd_path *path, fwd_backend *first, const int n)
+--                          void backendAcquire(fwd_backend *backend)
+--                          void backendRelease(fwd_backend *backend)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Chooses which backend of a path a new client is forwarded to. Every policy is lock free and
+-- O(1) on the accept path except consistent hashing which is a binary search over the hash ring,
+-- O(log n) in the number of backends.
+--
+-- rr   - Round robin over the backends.
+-- lc   - Least connections. Sets of up to SMALL_BACKEND_SET backends are scanned, larger sets use
+--        the power of two choices, the less loaded of two random backends, which keeps selection
+--        O(1) with hundreds of backends and is within a small constant of the true minimum.
+-- hash - Consistent hashing on the client address so a client keeps going to the same backend
+--        and only the clients of a removed backend move when the set changes.
+--
+-- When the circuit of the chosen backend is open, clients of a hash path go on along the ring to
+-- the next backend whose circuit is closed, so the clients of the broken backend are spread over
+-- the others like a removed backend's would be. Other paths draw random backends until one is
+-- closed, which takes about count / closed draws, and only look at every backend if
+-- FAILOVER_DRAWS draws all missed. A path whose every circuit is open fails at once.
+---------------------------------------------------------------------------------------*/
+
+#define RING_POINTS_PER_BACKEND 160
+#define SMALL_BACKEND_SET 8
+#define FAILOVER_DRAWS 8
+
+#include "balance.h"
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "health.h"
+
+static __thread uint32_t randomState;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                addBackend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool addBackend(fwd_path *path, const struct sockaddr_in *addr)
+--                              fwd_path *path: The path to add the backend to.
+--                              const struct sockaddr_in *addr: The address of the backend.
+--
+-- RETURNS:                 True if the backend was added, false otherwise.
+--------------------------------------------------------------------------------------------------*/
+bool addBackend(fwd_path *path, const struct sockaddr_in *addr)
+{
+    fwd_backend *backends;
+
+    if ((backends = realloc(path->backends, sizeof(fwd_backend) * (path->backendCount + 1))) == NULL)
+    {
+        return false;
+    }
+
+    path->backends = backends;
+    bzero(backends + path->backendCount, sizeof(fwd_backend));
+    backends[path->backendCount].addr = *addr;
+    // formatted once here so logging a connection does not have to
+    inet_ntop(AF_INET, &addr->sin_addr, backends[path->backendCount].name, INET_ADDRSTRLEN);
+    path->backendCount++;
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hashAddress
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uint32_t hashAddress(const uint32_t addr, const uint32_t salt)
+--                              const uint32_t addr: The value to hash.
+--                              const uint32_t salt: Mixed into the hash to get independent hashes.
+--
+-- RETURNS:                 The hash.
+--
+-- NOTES:
+-- The murmur3 finalizer. Cheap, and spreads neighbouring addresses over the whole ring.
+--------------------------------------------------------------------------------------------------*/
+uint32_t hashAddress(const uint32_t addr, const uint32_t salt)
+{
+    uint32_t h = addr ^ (salt * 0x9e3779b9);
+
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                comparePoints
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int comparePoints(const void *a, const void *b)
+--                              const void *a: The first lb_point.
+--                              const void *b: The second lb_point.
+--
+-- RETURNS:                 Negative, zero or positive as a sorts before, with or after b.
+--------------------------------------------------------------------------------------------------*/
+int comparePoints(const void *a, const void *b)
+{
+    uint32_t x = ((const lb_point *)a)->hash;
+    uint32_t y = ((const lb_point *)b)->hash;
+
+    return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                balanceInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool balanceInit(fwd_path *path)
+--                              fwd_path *path: The path whose backends have all been added.
+--
+-- RETURNS:                 True if the path is ready for pickBackend, false otherwise.
+--
+-- NOTES:
+-- Builds the sorted hash ring of a path that uses consistent hashing. Every backend gets
+-- RING_POINTS_PER_BACKEND points on the ring so clients spread evenly across the backends.
+--------------------------------------------------------------------------------------------------*/
+bool balanceInit(fwd_path *path)
+{
+    lb_point *point;
+
+    free(path->ring);
+    path->ring = NULL;
+    path->ringSize = 0;
+
+    if (path->policy != LB_HASH || path->backendCount < 2)
+    {
+        return true;
+    }
+
+    if ((path->ring = malloc(sizeof(lb_point) * path->backendCount * RING_POINTS_PER_BACKEND)) == NULL)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < path->backendCount; i++)
+    {
+        for (int j = 0; j < RING_POINTS_PER_BACKEND; j++)
+        {
+            point = path->ring + path->ringSize++;
+            point->hash = hashAddress(path->backends[i].addr.sin_addr.s_addr,
+                                      hashAddress(path->backends[i].addr.sin_port, j));
+            point->backend = i;
+        }
+    }
+    qsort(path->ring, path->ringSize, sizeof(lb_point), comparePoints);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                balanceRandom
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uint32_t balanceRandom(void)
+--
+-- RETURNS:                 A pseudo random number.
+--
+-- NOTES:
+-- A per thread xorshift generator, good enough to pick backends without sharing any state.
+--------------------------------------------------------------------------------------------------*/
+uint32_t balanceRandom(void)
+{
+    if (randomState == 0)
+    {
+        randomState = hashAddress((uint32_t)(uintptr_t)&randomState, (uint32_t)time(NULL)) | 1;
+    }
+
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return randomState;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                ringSearch
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int ringSearch(fwd_path *path, const uint32_t hash)
+--                              fwd_path *path: A path with a hash ring.
+--                              const uint32_t hash: The hash of the client.
+--
+-- RETURNS:                 The index of the first point of the ring at or after the hash.
+--
+-- NOTES:
+-- A binary search over the sorted ring that wraps around to the first point past the last.
+--------------------------------------------------------------------------------------------------*/
+int ringSearch(fwd_path *path, const uint32_t hash)
+{
+    int low = 0;
+    int high = path->ringSize;
+    int middle;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (path->ring[middle].hash < hash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low == path->ringSize ? 0 : low;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                policyBackend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Search the ring with ringSearch.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_backend *policyBackend(fwd_path *path, const struct sockaddr_in *client)
+--                              fwd_path *path: The path the client connected to.
+--                              const struct sockaddr_in *client: The address of the client.
+--
+-- RETURNS:                 The backend to forward the client to.
+--
+-- NOTES:
+-- Picks a backend with the policy of the path, whatever the health of the backend.
+--------------------------------------------------------------------------------------------------*/
+fwd_backend *policyBackend(fwd_path *path, const struct sockaddr_in *client)
+{
+    int count = path->backendCount;
+    int best;
+    int other;
+
+    if (count == 1)
+    {
+        return path->backends;
+    }
+
+    switch (path->policy)
+    {
+    case LB_LEAST_CONN:
+        if (count <= SMALL_BACKEND_SET)
+        {
+            // start somewhere new every time so ties are spread out
+            best = __atomic_fetch_add(&path->nextBackend, 1, __ATOMIC_RELAXED) % count;
+            for (int i = 1; i < count; i++)
+            {
+                other = (best + i) % count;
+                if (__atomic_load_n(&path->backends[other].active, __ATOMIC_RELAXED)
+                    < __atomic_load_n(&path->backends[best].active, __ATOMIC_RELAXED))
+                {
+                    best = other;
+                }
+            }
+            return path->backends + best;
+        }
+
+        best = balanceRandom() % count;
+        other = (best + 1 + balanceRandom() % (count - 1)) % count;
+        if (__atomic_load_n(&path->backends[other].active, __ATOMIC_RELAXED)
+            < __atomic_load_n(&path->backends[best].active, __ATOMIC_RELAXED))
+        {
+            best = other;
+        }
+        return path->backends + best;
+
+    case LB_HASH:
+        return path->backends + path->ring[ringSearch(path, hashAddress(client->sin_addr.s_addr, 0))].backend;
+
+    case LB_ROUND_ROBIN:
+    default:
+        return path->backends + __atomic_fetch_add(&path->nextBackend, 1, __ATOMIC_RELAXED) % count;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                pickBackend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Route around backends whose circuit is open.
+--                          October 17, 2026 - Fail over along the ring or to random closed circuits.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_backend *pickBackend(fwd_path *path, const struct sockaddr_in *client)
+--                              fwd_path *path: The path the client connected to.
+--                              const struct sockaddr_in *client: The address of the client.
+--
+-- RETURNS:                 The backend to forward the client to, or NULL if the circuit of every
+--                          backend of the path is open.
+--
+-- NOTES:
+-- Picks a backend with policyBackend. If its circuit is open the client goes to another backend
+-- whose circuit is closed, the next one on the ring for hash paths and the first of a few random
+-- draws otherwise, the less loaded of two for least connections, so the policy only loses the
+-- clients of the broken backend. Does not count the client against the backend, engines that track
+-- their connections do that with backendAcquire and backendRelease.
+--------------------------------------------------------------------------------------------------*/
+fwd_backend *pickBackend(fwd_path *path, const struct sockaddr_in *client)
+{
+    fwd_backend *first = policyBackend(path, client);
+    fwd_backend *backend;
+    fwd_backend *best = NULL;
+    int count = path->backendCount;
+    int start;
+
+    if (path->health == NULL || healthAvailable(path, first, monotonicMs()))
+    {
+        return first;
+    }
+
+    // open circuits only get their trial through the policy, so there is nothing else to look for
+    if (__atomic_load_n(healthOpenCount(path), __ATOMIC_RELAXED) >= count)
+    {
+        return NULL;
+    }
+
+    if (path->policy == LB_HASH && path->ringSize > 0)
+    {
+        start = ringSearch(path, hashAddress(client->sin_addr.s_addr, 0));
+        for (int i = 1; i < path->ringSize; i++)
+        {
+            backend = path->backends + path->ring[(start + i) % path->ringSize].backend;
+            if (healthUsable(path, backend))
+            {
+                return backend;
+            }
+        }
+        return NULL;
+    }
+
+    for (int i = 0; i < FAILOVER_DRAWS; i++)
+    {
+        backend = path->backends + balanceRandom() % count;
+        if (!healthUsable(path, backend))
+        {
+            continue;
+        }
+        if (path->policy != LB_LEAST_CONN)
+        {
+            return backend;
+        }
+        if (best == NULL)
+        {
+            best = backend;
+        }
+        else if (__atomic_load_n(&backend->active, __ATOMIC_RELAXED) < __atomic_load_n(&best->active, __ATOMIC_RELAXED))
+        {
+            return backend;
+        }
+        else
+        {
+            return best;
+        }
+    }
+    if (best != NULL)
+    {
+        return best;
+    }
+
+    start = balanceRandom() % count;
+    for (int i = 0; i < count; i++)
+    {
+        backend = path->backends + (start + i) % count;
+        if (healthUsable(path, backend))
+        {
+            return backend;
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                alternateBackend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_backend *alternateBackend(fwd_path *path, fwd_backend *first, const int n)
+--                              fwd_path *path: The path the client connected to.
+--                              fwd_backend *first: The backend chosen by pickBackend.
+--                              const int n: How many backends have been tried so far.
+--
+-- RETURNS:                 The backend to try next.
+--
+-- NOTES:
+-- Walks the backends of the path in order starting from the one pickBackend chose, so when a
+-- connect is slow or fails the other backends are tried one after another. n = 0 is first itself.
+--------------------------------------------------------------------------------------------------*/
+fwd_backend *alternateBackend(fwd_path *path, fwd_backend *first, const int n)
+{
+    return path->backends + (first - path->backends + n) % path->backendCount;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                backendAcquire
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void backendAcquire(fwd_backend *backend)
+--                              fwd_backend *backend: The backend a connection was forwarded to.
+--
+-- NOTES:
+-- Counts a new connection against a backend for the least connections policy.
+--------------------------------------------------------------------------------------------------*/
+void backendAcquire(fwd_backend *backend)
+{
+    __atomic_fetch_add(&backend->active, 1, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                backendRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void backendRelease(fwd_backend *backend)
+--                              fwd_backend *backend: The backend a connection to was closed.
+--
+-- NOTES:
+-- Undoes backendAcquire once the connection closes.
+--------------------------------------------------------------------------------------------------*/
+void backendRelease(fwd_backend *backend)
+{
+    __atomic_fetch_sub(&backend->active, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,425 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             cache.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          uint32_t cacheLayout(void)
+--                          void cacheHeader(cache_header *header, const struct stat *conf, const int count)
+--                          bool cacheWritePath(FILE *file, const fwd_path *path)
+--                          bool cacheReadPath(FILE *file, fwd_path *path)
+--                          bool cacheSave(const char *name, const struct stat *conf, const fwd_path *paths, const int size)
+--                          bool cacheLoad(const char *name, const struct stat *conf, fwd_path **paths, int *size)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- The binary cache of the path table, enabled with -b. Once forwarder.conf has been parsed its
+-- sorted table is written out as a header followed by every path, its backends and its access
+-- list rules, so the next start, or a reload of an unchanged file, reads the table back instead of
+-- parsing it again.
+--
+-- The header records the size, modification time, inode and device of forwarder.conf, the build of
+-- the program and a hash of where the written fields sit in their structures, and the cache is only
+-- used while all of them still match. Everything that is set up at run time, such as the metrics,
+-- limits and health state, is left out and rebuilt after loading. Tables that use host names or acl
+-- files are never written, as the cache could not tell when those change.
+---------------------------------------------------------------------------------------*/
+
+#include "cache.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "acl.h"
+#include "balance.h"
+#include "io.h"
+#include "reload.h"
+
+#define CACHE_FIELD(hash, type, field)                                                                     \
+    ((hash) = hashAddress((hash) ^ (uint32_t)offsetof(type, field), (uint32_t)sizeof(((type *)0)->field)))
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                cacheLayout
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uint32_t cacheLayout(void)
+--
+-- RETURNS:                 A hash of the offset and size of every field the cache keeps.
+--
+-- NOTES:
+-- The sizes of the structures alone miss fields that were moved or swapped, and the build time
+-- of cache.c misses structures changed without cache.c being rebuilt. A field added to fwd_path,
+-- fwd_backend, net_tuning or acl_rule that is read back from the cache has to be listed here.
+--------------------------------------------------------------------------------------------------*/
+uint32_t cacheLayout(void)
+{
+    uint32_t hash = 0;
+
+    // the options of a path, as written by cacheWritePath
+    CACHE_FIELD(hash, fwd_path, in);
+    CACHE_FIELD(hash, fwd_path, out);
+    CACHE_FIELD(hash, fwd_path, inName);
+    CACHE_FIELD(hash, fwd_path, backendCount);
+    CACHE_FIELD(hash, fwd_path, policy);
+    CACHE_FIELD(hash, fwd_path, connectTimeout);
+    CACHE_FIELD(hash, fwd_path, poolSize);
+    CACHE_FIELD(hash, fwd_path, poolIdle);
+    CACHE_FIELD(hash, fwd_path, udp);
+    CACHE_FIELD(hash, fwd_path, udpIdle);
+    CACHE_FIELD(hash, fwd_path, idleTimeout);
+    CACHE_FIELD(hash, fwd_path, maxLifetime);
+    CACHE_FIELD(hash, fwd_path, queueLimit);
+    CACHE_FIELD(hash, fwd_path, backlog);
+    CACHE_FIELD(hash, fwd_path, clientTuning);
+    CACHE_FIELD(hash, fwd_path, upstreamTuning);
+    CACHE_FIELD(hash, fwd_path, rate);
+    CACHE_FIELD(hash, fwd_path, clientRate);
+    CACHE_FIELD(hash, fwd_path, connRate);
+    CACHE_FIELD(hash, fwd_path, clientConnRate);
+    CACHE_FIELD(hash, fwd_path, healthInterval);
+    CACHE_FIELD(hash, fwd_path, healthTimeout);
+    CACHE_FIELD(hash, fwd_path, healthFall);
+    CACHE_FIELD(hash, fwd_path, healthRise);
+    CACHE_FIELD(hash, fwd_path, healthCooldown);
+    CACHE_FIELD(hash, fwd_path, healthSend);
+    CACHE_FIELD(hash, fwd_path, healthSendLength);
+    CACHE_FIELD(hash, fwd_path, healthExpect);
+    CACHE_FIELD(hash, fwd_path, healthExpectLength);
+    CACHE_FIELD(hash, fwd_path, mirrored);
+    CACHE_FIELD(hash, fwd_path, mirror);
+    CACHE_FIELD(hash, fwd_path, mirrorDirections);
+    CACHE_FIELD(hash, fwd_path, mirrorBuffer);
+    CACHE_FIELD(hash, fwd_path, tcpInfo);
+    CACHE_FIELD(hash, fwd_path, tcpInfoInterval);
+    CACHE_FIELD(hash, net_tuning, nodelay);
+    CACHE_FIELD(hash, net_tuning, quickack);
+    CACHE_FIELD(hash, net_tuning, rcvbuf);
+    CACHE_FIELD(hash, net_tuning, sndbuf);
+    CACHE_FIELD(hash, net_tuning, fastopen);
+    CACHE_FIELD(hash, net_tuning, deferAccept);
+    CACHE_FIELD(hash, net_tuning, keepIdle);
+    CACHE_FIELD(hash, net_tuning, keepInterval);
+    CACHE_FIELD(hash, net_tuning, keepCount);
+    CACHE_FIELD(hash, net_tuning, notsentLowat);
+    CACHE_FIELD(hash, net_tuning, congestion);
+    CACHE_FIELD(hash, fwd_backend, addr);
+    CACHE_FIELD(hash, fwd_backend, name);
+    CACHE_FIELD(hash, acl_rule, prefix);
+    CACHE_FIELD(hash, acl_rule, length);
+    CACHE_FIELD(hash, acl_rule, allow);
+
+    return hash;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                cacheHeader
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void cacheHeader(cache_header *header, const struct stat *conf, const int count)
+--                              cache_header *header: The header to fill.
+--                              const struct stat *conf: The status of the configuration file.
+--                              const int count: The number of paths in the table.
+--
+-- NOTES:
+-- Fills the header a cache of the configuration file must have for this build. The header is
+-- cleared first so it can be compared as a whole.
+--------------------------------------------------------------------------------------------------*/
+void cacheHeader(cache_header *header, const struct stat *conf, const int count)
+{
+    memset(header, 0, sizeof(cache_header));
+    memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+    header->version = CACHE_VERSION;
+    strncpy(header->build, __DATE__ " " __TIME__, sizeof(header->build) - 1);
+    header->pathSize = sizeof(fwd_path);
+    header->backendSize = sizeof(fwd_backend);
+    header->ruleSize = sizeof(acl_rule);
+    header->layout = cacheLayout();
+    header->count = count;
+    header->confSize = conf->st_size;
+    header->confSeconds = conf->st_mtim.tv_sec;
+    header->confNanoseconds = conf->st_mtim.tv_nsec;
+    header->confInode = conf->st_ino;
+    header->confDevice = conf->st_dev;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                cacheWritePath
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool cacheWritePath(FILE *file, const fwd_path *path)
+--                              FILE *file: The cache being written.
+--                              const fwd_path *path: The parsed path to write.
+--
+-- RETURNS:                 True if the path was written, false otherwise.
+--
+-- NOTES:
+-- Writes the options of a path with its run time fields cleared, then its backends, then the
+-- number of its access list rules and the rules.
+--------------------------------------------------------------------------------------------------*/
+bool cacheWritePath(FILE *file, const fwd_path *path)
+{
+    fwd_path copy = *path;
+    int ruleCount = path->acl ? path->acl->ruleCount : 0;
+
+    copy.backends = NULL;
+    copy.nextBackend = 0;
+    copy.ring = NULL;
+    copy.ringSize = 0;
+    copy.poolHits = 0;
+    copy.poolMisses = 0;
+    copy.poolDiscards = 0;
+    copy.metrics = NULL;
+    copy.acl = NULL;
+    copy.limits = NULL;
+    copy.health = NULL;
+    copy.config = NULL;
+    copy.previous = 0;
+    copy.backendsMoved = false;
+    copy.metricsMoved = false;
+    copy.pid = 0;
+    copy.listenFd = 0;
+
+    return fwrite(&copy, sizeof(fwd_path), 1, file) == 1
+           && fwrite(path->backends, sizeof(fwd_backend), path->backendCount, file) == (size_t)path->backendCount
+           && fwrite(&ruleCount, sizeof(int), 1, file) == 1
+           && (ruleCount == 0 || fwrite(path->acl->rules, sizeof(acl_rule), ruleCount, file) == (size_t)ruleCount);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                cacheReadPath
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool cacheReadPath(FILE *file, fwd_path *path)
+--                              FILE *file: The cache being read.
+--                              fwd_path *path: The path to fill.
+--
+-- RETURNS:                 True if a whole path was read, false otherwise.
+--
+-- NOTES:
+-- Reads back a path written by cacheWritePath. The access list rules are added again with aclAdd,
+-- the path still has to be compiled like a parsed one. On failure the path can be freed with
+-- pathFree.
+--------------------------------------------------------------------------------------------------*/
+bool cacheReadPath(FILE *file, fwd_path *path)
+{
+    acl_rule rule;
+    int ruleCount;
+
+    if (fread(path, sizeof(fwd_path), 1, file) != 1)
+    {
+        bzero(path, sizeof(fwd_path));
+        return false;
+    }
+    path->backends = NULL;
+    path->ring = NULL;
+    path->metrics = NULL;
+    path->acl = NULL;
+    path->limits = NULL;
+    path->health = NULL;
+    path->config = NULL;
+
+    if (path->backendCount < 1 || path->backendCount > CACHE_LIMIT)
+    {
+        return false;
+    }
+    if ((path->backends = malloc(sizeof(fwd_backend) * path->backendCount)) == NULL)
+    {
+        die("malloc");
+    }
+    if (fread(path->backends, sizeof(fwd_backend), path->backendCount, file) != (size_t)path->backendCount)
+    {
+        return false;
+    }
+    for (int i = 0; i < path->backendCount; i++)
+    {
+        path->backends[i].active = 0;
+    }
+
+    if (fread(&ruleCount, sizeof(int), 1, file) != 1 || ruleCount < 0 || ruleCount > CACHE_LIMIT)
+    {
+        return false;
+    }
+    for (int i = 0; i < ruleCount; i++)
+    {
+        if (fread(&rule, sizeof(acl_rule), 1, file) != 1)
+        {
+            return false;
+        }
+        if (!aclAdd(path, rule.prefix, rule.length, rule.allow))
+        {
+            die("malloc");
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                cacheSave
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool cacheSave(const char *name, const struct stat *conf, const fwd_path *paths, const int size)
+--                              const char *name: The cache file.
+--                              const struct stat *conf: The status of the parsed configuration file.
+--                              const fwd_path *paths: The parsed table, before it is compiled.
+--                              const int size: The number of paths.
+--
+-- RETURNS:                 True if the cache was written, false otherwise.
+--
+-- NOTES:
+-- Writes the table to name.tmp and renames it over name, so a forwarder starting at the same time
+-- never reads half a cache.
+--------------------------------------------------------------------------------------------------*/
+bool cacheSave(const char *name, const struct stat *conf, const fwd_path *paths, const int size)
+{
+    char tmpName[PATH_MAX];
+    cache_header header;
+    FILE *file;
+    bool written;
+
+    if (snprintf(tmpName, sizeof(tmpName), "%s.tmp", name) >= (int)sizeof(tmpName)
+        || (file = fopen(tmpName, "w")) == NULL)
+    {
+        Error("Could not write the cache %s", name);
+        return false;
+    }
+
+    cacheHeader(&header, conf, size);
+    written = fwrite(&header, sizeof(cache_header), 1, file) == 1;
+    for (int i = 0; written && i < size; i++)
+    {
+        written = cacheWritePath(file, paths + i);
+    }
+
+    if (fclose(file) || !written || rename(tmpName, name))
+    {
+        Error("Could not write the cache %s", name);
+        unlink(tmpName);
+        return false;
+    }
+
+    Log("Cached %d paths in %s", size, name);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                cacheLoad
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool cacheLoad(const char *name, const struct stat *conf, fwd_path **paths, int *size)
+--                              const char *name: The cache file.
+--                              const struct stat *conf: The status of the configuration file.
+--                              fwd_path **paths: Pointer to where the table will be placed.
+--                              int *size: Pointer to where the number of paths will be placed.
+--
+-- RETURNS:                 True if the table was read from the cache, false if the cache is
+--                          missing, stale or damaged and the file has to be parsed.
+--
+-- NOTES:
+-- The table is allocated to its exact size, or to one path when it is empty, like a parsed one.
+--------------------------------------------------------------------------------------------------*/
+bool cacheLoad(const char *name, const struct stat *conf, fwd_path **paths, int *size)
+{
+    cache_header header;
+    cache_header expected;
+    FILE *file;
+    int count = 0;
+    bool read;
+
+    if ((file = fopen(name, "r")) == NULL)
+    {
+        Log("No cache in %s, parsing", name);
+        return false;
+    }
+
+    read = fread(&header, sizeof(cache_header), 1, file) == 1 && header.count >= 0 && header.count <= CACHE_LIMIT;
+    if (read)
+    {
+        cacheHeader(&expected, conf, header.count);
+        read = !memcmp(&header, &expected, sizeof(cache_header));
+    }
+    if (!read)
+    {
+        Log("Cache %s is stale, parsing", name);
+        fclose(file);
+        return false;
+    }
+
+    if ((*paths = malloc(sizeof(fwd_path) * (header.count > 0 ? header.count : 1))) == NULL)
+    {
+        die("malloc");
+    }
+    while (read && count < header.count)
+    {
+        read = cacheReadPath(file, *paths + count);
+        count++;
+    }
+    read = read && fgetc(file) == EOF;
+    fclose(file);
+
+    if (!read)
+    {
+        Error("Cache %s is damaged, parsing", name);
+        for (int i = 0; i < count; i++)
+        {
+            pathFree(*paths + i);
+        }
+        free(*paths);
+        return false;
+    }
+
+    *size = count;
+    return true;
+}
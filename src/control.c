@@ -0,0 +1,258 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             control.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          void controlSignals(sigset_t *set)
+--                          void blockControlSignals(void)
+--                          void unblockControlSignals(void)
+--                          void reportStats(fwd_path *paths, const int size)
+--                          void controlRoutine(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Contains the control thread. The workers never see the control signals, they are all taken
+-- synchronously by the thread that started the workers. With the fork engine this is the main
+-- process and its path processes unblock the signals again.
+--
+-- SIGUSR1 - Logs the statistics of every path.
+-- SIGHUP - Reloads forwarder.conf.
+-- SIGUSR2 - Upgrades to the binary on disk, see upgrade.c, then drains and exits.
+---------------------------------------------------------------------------------------*/
+
+#include "control.h"
+
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "acl.h"
+#include "io.h"
+#include "main.h"
+#include "metrics.h"
+#include "relay.h"
+#include "reload.h"
+#include "upgrade.h"
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                controlSignals
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Added SIGUSR2 for upgrades.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void controlSignals(sigset_t *set)
+--                              sigset_t *set: The set to fill.
+--
+-- NOTES:
+-- Fills set with the signals handled by controlRoutine.
+--------------------------------------------------------------------------------------------------*/
+void controlSignals(sigset_t *set)
+{
+    sigemptyset(set);
+    sigaddset(set, SIGUSR1);
+    sigaddset(set, SIGHUP);
+    sigaddset(set, SIGUSR2);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                blockControlSignals
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Block SIGHUP for reloads.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void blockControlSignals(void)
+--
+-- NOTES:
+-- Blocks the control signals in the calling thread. Must be called before the worker threads are
+-- created so they inherit the mask and the signals are left for controlRoutine.
+--------------------------------------------------------------------------------------------------*/
+void blockControlSignals(void)
+{
+    sigset_t set;
+
+    controlSignals(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                unblockControlSignals
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void unblockControlSignals(void)
+--
+-- NOTES:
+-- Restores the default handling of the control signals in a forked process.
+--------------------------------------------------------------------------------------------------*/
+void unblockControlSignals(void)
+{
+    sigset_t set;
+
+    controlSignals(&set);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                reportStats
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Log the access list hits.
+--                          October 17, 2026 - Log the relay buffer memory.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void reportStats(fwd_path *paths, const int size)
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--
+-- NOTES:
+-- Logs the warm pool hits, misses and discards of every path that has a pool. A hit is a client
+-- that was handed a pooled socket, a miss is one that had to wait for its own connect. Also logs
+-- the hits of every access list rule that has matched a client, with the fork engine these are
+-- only counted in the path processes and are not seen here. The memory held by relay buffers is
+-- logged first, for the same reason it is always 0 with the fork engine.
+--------------------------------------------------------------------------------------------------*/
+void reportStats(fwd_path *paths, const int size)
+{
+    char rule[ACL_RULE_SIZE];
+    size_t hits;
+    size_t inUse;
+    size_t pooled;
+
+    relayMemory(&inUse, &pooled);
+    Log("Relay buffers: %zu bytes in use, %zu bytes pooled", inUse, pooled);
+
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < paths[i].acl->ruleCount; j++)
+        {
+            if ((hits = __atomic_load_n(&paths[i].acl->rules[j].hits, __ATOMIC_RELAXED)) > 0)
+            {
+                aclFormatRule(paths[i].acl->rules + j, rule, sizeof(rule));
+                Log("Access list for port %d: %s, %zu hits", ntohs(paths[i].in.sin_port), rule, hits);
+            }
+        }
+        if ((hits = __atomic_load_n(&paths[i].acl->unmatchedHits, __ATOMIC_RELAXED)) > 0)
+        {
+            Log("Access list for port %d: unmatched, %zu hits", ntohs(paths[i].in.sin_port), hits);
+        }
+
+        if (paths[i].poolSize == 0)
+        {
+            continue;
+        }
+
+        Log("Pool for port %d: %zu hits, %zu misses, %zu discarded", ntohs(paths[i].in.sin_port),
+            __atomic_load_n(&paths[i].poolHits, __ATOMIC_RELAXED),
+            __atomic_load_n(&paths[i].poolMisses, __ATOMIC_RELAXED),
+            __atomic_load_n(&paths[i].poolDiscards, __ATOMIC_RELAXED));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                controlRoutine
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Reload on SIGHUP and free unused configurations.
+--                          October 17, 2026 - Upgrade on SIGUSR2 and exit once drained.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void controlRoutine(void)
+--
+-- NOTES:
+-- Waits for the control signals blocked by blockControlSignals and handles them. Wakes up every
+-- second to free the configuration generations that are no longer used and to reap path
+-- processes of the fork engine that have exited. Does not return.
+--
+-- Once the workers are up, tells the old process of an upgrade that this one is serving. After
+-- this process has been upgraded itself it stops listening, ignores reloads, and exits as soon as
+-- the last connection has closed. Connections of the fork engine are processes of their own, so
+-- it exits right away and leaves them running.
+--------------------------------------------------------------------------------------------------*/
+void controlRoutine(void)
+{
+    sigset_t set;
+    fwd_config *old;
+    bool draining = false;
+    struct timespec timeout = {.tv_sec = 1, .tv_nsec = 0};
+
+    controlSignals(&set);
+    upgradeReady();
+
+    while (1)
+    {
+        switch (sigtimedwait(&set, NULL, &timeout))
+        {
+        case SIGUSR1:
+            reportStats(configCurrent()->paths, configCurrent()->size);
+            break;
+        case SIGHUP:
+            old = configCurrent();
+            if (draining)
+            {
+                Log("Draining, ignoring the reload");
+            }
+            else if (configReload() && options.engine == ENGINE_FORK)
+            {
+                forkReconcile(old, configCurrent());
+            }
+            break;
+        case SIGUSR2:
+            old = configCurrent();
+            if (!draining && upgradeStart())
+            {
+                draining = true;
+                metricsStop();
+                configDrain();
+                if (options.engine == ENGINE_FORK)
+                {
+                    forkReconcile(old, configCurrent());
+                }
+            }
+            break;
+        }
+
+        configCollect();
+        if (draining && configDrained())
+        {
+            Log("Every connection has closed, exiting");
+            exit(EXIT_SUCCESS);
+        }
+        while (waitpid(-1, NULL, WNOHANG) > 0)
+        {
+        }
+    }
+}
@@ -0,0 +1,2211 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             event.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool workerInit(fwd_worker *worker, fwd_config *config, const int id, const bool reusePort)
+--                          fwd_socket *socketOpen(fwd_worker *worker, fwd_path *path)
+--                          void socketRelease(fwd_worker *worker, fwd_socket *socket)
+--                          fwd_listener *listenerOpen(fwd_worker *worker, fwd_path *path)
+--                          void listenerPool(fwd_worker *worker, fwd_listener *listener)
+--                          void listenerDrain(fwd_worker *worker, fwd_listener *listener)
+--                          void listenerClose(fwd_worker *worker, fwd_listener *listener)
+--                          void workerReload(fwd_worker *worker)
+--                          void workerApply(fwd_worker *worker, fwd_config *config)
+--                          void workerQueues(fwd_worker *worker)
+--                          void workerRun(fwd_worker *worker)
+--                          void *workerThread(void *arg)
+--                          void workerAccept(fwd_worker *worker, fwd_socket *socket)
+--                          bool connStartAttempt(fwd_worker *worker, fwd_conn *conn)
+--                          void connAttemptEvent(fwd_worker *worker, fwd_attempt *attempt)
+--                          void connDropAttempt(fwd_worker *worker, fwd_attempt *attempt)
+--                          void connEstablish(fwd_worker *worker, fwd_conn *conn, fwd_attempt *attempt)
+--                          void connArm(fwd_worker *worker, fwd_conn *conn)
+--                          void connExpire(fwd_worker *worker, fwd_conn *conn)
+--                          void connLink(fwd_conn **list, fwd_conn *conn)
+--                          void connUnlink(fwd_conn **list, fwd_conn *conn)
+--                          void connPump(fwd_worker *worker, fwd_conn *conn)
+--                          void connThrottle(fwd_worker *worker, fwd_conn *conn)
+--                          void connUnthrottle(fwd_worker *worker, fwd_conn *conn)
+--                          void workerTick(fwd_worker *worker)
+--                          void connClose(fwd_worker *worker, fwd_conn *conn)
+--                          void connMirror(fwd_worker *worker, fwd_conn *conn)
+--                          void mirrorFlush(fwd_worker *worker, fwd_mirror *mirror)
+--                          void mirrorClose(fwd_worker *worker, fwd_mirror *mirror)
+--                          void mirrorAccount(fwd_mirror *mirror)
+--                          void poolRefill(fwd_worker *worker, fwd_listener *listener)
+--                          void poolEvent(fwd_worker *worker, fwd_pooled *pooled, const unsigned events)
+--                          void poolDiscard(fwd_worker *worker, fwd_pooled *pooled)
+--                          int poolTake(fwd_worker *worker, fwd_listener *listener, fwd_backend *backend)
+--                          void poolSweep(fwd_worker *worker)
+--                          void eventRoutine(fwd_config *config)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Edge-triggered epoll engine. Every listener and every relayed socket pair of a worker is served
+-- from one event loop. Each accepted connection is tracked by a fwd_conn struct instead of a pair
+-- of forked processes. With more than one worker, every worker runs on its own thread with its own
+-- SO_REUSEPORT listening socket for every port so the kernel spreads new connections across the
+-- workers. Paths that share a port and differ in their incoming address share the socket of the
+-- port, and the path of a client is picked with configRoute once it has been accepted.
+--
+-- Paths with the pool option keep a warm pool of upstream connections in every worker. Pooled
+-- sockets are connected and refilled from the event loop in the background, and a newly accepted
+-- client is handed a pooled socket instead of waiting for its own handshake with path.out.
+--
+-- Upstream connects never block the loop. A connection that is still connecting after
+-- CONNECT_ATTEMPT_DELAY milliseconds races a second connect to the next backend of the path, the
+-- first to succeed is kept, and the connection is given up after path.connectTimeout milliseconds.
+--
+-- Paths with the mirror option send a copy of one or both directions of every connection to a
+-- mirror, over connections of their own. The copy goes through a small pipe per direction that
+-- is filled by tee and never waited on, see relay.c, so the mirror can lag or fail without the
+-- connection it copies noticing.
+--
+-- Connect deadlines, idle timeouts and lifetimes are kept on a timer wheel per worker, so arming
+-- and cancelling the timer of a connection costs the same however many connections there are, and
+-- the loop only wakes up when the next timer is due.
+--
+-- On a reload every worker is woken through its eventfd and moves its listeners over to the new
+-- paths. Connections hold a reference on the generation they were accepted under and keep using
+-- its backends until they close.
+--
+-- Sockets are removed from epoll before they are closed. epoll only forgets a socket once every
+-- descriptor of it is closed, and after an upgrade the listeners are still open in the new process,
+-- as is everything else for the moment between its fork and its exec.
+---------------------------------------------------------------------------------------*/
+
+#define MAX_EVENTS 256
+#define POOL_RETRY_DELAY 1
+
+#include "event.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "acl.h"
+#include "affinity.h"
+#include "balance.h"
+#include "control.h"
+#include "health.h"
+#include "io.h"
+#include "net.h"
+#include "reload.h"
+#include "udp.h"
+#include "upgrade.h"
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Serve a configuration generation and listen for reloads.
+--                          October 17, 2026 - Leave UDP paths to the UDP worker.
+--                          October 17, 2026 - Set up the timer wheel.
+--                          October 17, 2026 - Note the CPU the worker is pinned to.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool workerInit(fwd_worker *worker, fwd_config *config, const int id, const bool reusePort)
+--                              fwd_worker *worker: The worker to initialize.
+--                              fwd_config *config: The configuration generation to serve.
+--                              const int id: The index of the worker, used to pick its metrics shard.
+--                              const bool reusePort: Whether the listeners are shared with other workers.
+--
+-- RETURNS:                 True if the epoll instance was created and at least one listener was
+--                          registered or there are only UDP paths, false otherwise.
+--
+-- NOTES:
+-- Creates the epoll instance of the worker, registers its reload eventfd and opens a listener for
+-- every path of the configuration. A path whose port cannot be listened on is logged and skipped so
+-- the other paths keep working. The worker holds a reference on the configuration it serves.
+--------------------------------------------------------------------------------------------------*/
+bool workerInit(fwd_worker *worker, fwd_config *config, const int id, const bool reusePort)
+{
+    int open = 0;
+    int tcp = 0;
+    struct epoll_event ev;
+
+    bzero(worker, sizeof(fwd_worker));
+    worker->id = id;
+    worker->cpu = affinityCpu(id);
+    worker->reusePort = reusePort;
+    wheelInit(&worker->wheel, monotonicMs());
+
+    if ((worker->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        Error("Could not create epoll instance");
+        return false;
+    }
+
+    if ((worker->control.fd = configRegister()) == -1)
+    {
+        Error("Could not create reload eventfd");
+        return false;
+    }
+    worker->control.kind = EV_CONTROL;
+    worker->control.owner = worker;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &worker->control;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->control.fd, &ev) == -1)
+    {
+        Error("Could not register reload eventfd");
+        return false;
+    }
+
+    if ((worker->listeners = calloc(config->size, sizeof(fwd_listener *))) == NULL
+        || (worker->ports = calloc(NET_PORTS, sizeof(fwd_socket *))) == NULL)
+    {
+        die("calloc");
+    }
+    worker->listenerCount = config->size;
+    worker->config = config;
+    configAcquire(config);
+
+    for (int i = 0; i < config->size; i++)
+    {
+        tcp += !config->paths[i].udp;
+        if ((worker->listeners[i] = listenerOpen(worker, config->paths + i)) != NULL)
+        {
+            open++;
+        }
+    }
+    workerQueues(worker);
+
+    return open > 0 || tcp == 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                socketOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Reference counted by the paths of the port.
+--                          October 17, 2026 - Listen with the backlog and socket options of the path.
+--                          October 17, 2026 - Take the socket over from the old process of an upgrade.
+--                          October 17, 2026 - Prefer the listener of a pinned worker for its CPU.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_socket *socketOpen(fwd_worker *worker, fwd_path *path)
+--                              fwd_worker *worker: The worker that will own the socket.
+--                              fwd_path *path: The path to listen for.
+--
+-- RETURNS:                 The listening socket of the port of the path, NULL if the port could
+--                          not be listened on.
+--
+-- NOTES:
+-- Every port is listened on through one socket per worker, shared by every path of the port, so
+-- clients of paths that differ only in their incoming address are never handed to the socket of the
+-- wrong path by SO_REUSEPORT. The first path of a port creates a non-blocking socket with its
+-- backlog and client side socket options and registers it with the worker's epoll instance, the
+-- others take a reference on it. After an upgrade the socket of the old process is used instead of
+-- a new one.
+--------------------------------------------------------------------------------------------------*/
+fwd_socket *socketOpen(fwd_worker *worker, fwd_path *path)
+{
+    int port = ntohs(path->in.sin_port);
+    int sock;
+    fwd_socket *socket;
+    struct epoll_event ev;
+
+    if ((socket = worker->ports[port]) != NULL)
+    {
+        socket->refs++;
+        return socket;
+    }
+
+    if (!upgradeListen(&sock, port, worker->id, worker->reusePort, path->backlog))
+    {
+        Error("Could not listen on port %d, skipping", port);
+        return NULL;
+    }
+    if (!uwuTuneSocket(sock, &path->clientTuning, true))
+    {
+        Error("Could not set every socket option on port %d", port);
+    }
+    if (worker->reusePort && worker->cpu != -1 && !uwuSetIncomingCpu(sock, worker->cpu))
+    {
+        Error("Could not set SO_INCOMING_CPU on port %d", port);
+    }
+
+    if ((socket = calloc(1, sizeof(fwd_socket))) == NULL)
+    {
+        die("calloc");
+    }
+    socket->ep.kind = EV_LISTENER;
+    socket->ep.fd = sock;
+    socket->ep.owner = socket;
+    socket->port = port;
+    socket->refs = 1;
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &socket->ep;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+    {
+        Error("Could not register listener for port %d, skipping", port);
+        upgradeUntrack(sock);
+        close(sock);
+        free(socket);
+        return NULL;
+    }
+
+    worker->ports[port] = socket;
+    Log("Listening for connection on port %d ...", port);
+    return socket;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                socketRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Stop tracking the socket for upgrades and remove it from epoll.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void socketRelease(fwd_worker *worker, fwd_socket *socket)
+--                              fwd_worker *worker: The worker that owns the socket.
+--                              fwd_socket *socket: The socket a path stopped using.
+--
+-- NOTES:
+-- Drops the reference of a path on the socket of its port, and stops listening on the port once
+-- no path uses it anymore.
+--------------------------------------------------------------------------------------------------*/
+void socketRelease(fwd_worker *worker, fwd_socket *socket)
+{
+    if (--socket->refs > 0)
+    {
+        return;
+    }
+
+    upgradeUntrack(socket->ep.fd);
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, socket->ep.fd, NULL);
+    close(socket->ep.fd);
+    worker->ports[socket->port] = NULL;
+    Log("Stopped listening on port %d", socket->port);
+    free(socket);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                listenerOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Skip UDP paths.
+--                          October 17, 2026 - Listen with the backlog and socket options of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_listener *listenerOpen(fwd_worker *worker, fwd_path *path)
+--                              fwd_worker *worker: The worker that will own the listener.
+--                              fwd_path *path: The path to listen for.
+--
+-- RETURNS:                 The new listener, NULL if the path is a UDP path or the port could not
+--                          be listened on.
+--
+-- NOTES:
+-- Creates the listener of the path on the listening socket of its port and allocates the warm
+-- pool of the path, which is filled after the current batch.
+--------------------------------------------------------------------------------------------------*/
+fwd_listener *listenerOpen(fwd_worker *worker, fwd_path *path)
+{
+    fwd_socket *socket;
+    fwd_listener *listener;
+
+    // served by the UDP worker
+    if (path->udp)
+    {
+        return NULL;
+    }
+
+    if ((socket = socketOpen(worker, path)) == NULL)
+    {
+        return NULL;
+    }
+
+    if ((listener = calloc(1, sizeof(fwd_listener))) == NULL)
+    {
+        die("calloc");
+    }
+    listener->socket = socket;
+    listener->path = path;
+    listener->metrics = metricsShard(path, worker->id);
+    listenerPool(worker, listener);
+    return listener;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                listenerPool
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void listenerPool(fwd_worker *worker, fwd_listener *listener)
+--                              fwd_worker *worker: The worker that owns the listener.
+--                              fwd_listener *listener: The listener to allocate the pool of.
+--
+-- NOTES:
+-- Allocates an empty warm pool of path.poolSize sockets for the listener, if the path has one.
+--------------------------------------------------------------------------------------------------*/
+void listenerPool(fwd_worker *worker, fwd_listener *listener)
+{
+    if (listener->path->poolSize <= 0)
+    {
+        return;
+    }
+
+    if ((listener->pool = calloc(listener->path->poolSize, sizeof(fwd_pooled))) == NULL)
+    {
+        die("calloc");
+    }
+    for (int i = 0; i < listener->path->poolSize; i++)
+    {
+        listener->pool[i].ep.kind = EV_POOLED;
+        listener->pool[i].ep.fd = -1;
+        listener->pool[i].ep.owner = listener->pool + i;
+        listener->pool[i].listener = listener;
+    }
+    listener->poolRetry = 0;
+    worker->pooling = true;
+    worker->poolDirty = true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                listenerDrain
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void listenerDrain(fwd_worker *worker, fwd_listener *listener)
+--                              fwd_worker *worker: The worker that owns the listener.
+--                              fwd_listener *listener: The listener to drain the pool of.
+--
+-- NOTES:
+-- Closes every socket in the warm pool of the listener and frees the pool.
+--------------------------------------------------------------------------------------------------*/
+void listenerDrain(fwd_worker *worker, fwd_listener *listener)
+{
+    for (int i = 0; listener->pool && i < listener->path->poolSize; i++)
+    {
+        if (listener->pool[i].state != POOL_EMPTY)
+        {
+            poolDiscard(worker, listener->pool + i);
+        }
+    }
+    free(listener->pool);
+    listener->pool = NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                listenerClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void listenerClose(fwd_worker *worker, fwd_listener *listener)
+--                              fwd_worker *worker: The worker that owns the listener.
+--                              fwd_listener *listener: The listener to close.
+--
+-- NOTES:
+-- Releases the listening socket of the port of the listener and frees the listener along with its
+-- warm pool. Connections that were accepted on it are not affected.
+--------------------------------------------------------------------------------------------------*/
+void listenerClose(fwd_worker *worker, fwd_listener *listener)
+{
+    listenerDrain(worker, listener);
+    if (listener->metrics->listenFd == listener->socket->ep.fd)
+    {
+        listener->metrics->listenFd = -1;
+    }
+    socketRelease(worker, listener->socket);
+    free(listener);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerReload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void workerReload(fwd_worker *worker)
+--                              fwd_worker *worker: The worker that was told about a reload.
+--
+-- NOTES:
+-- Empties the reload eventfd and moves the worker forward through every generation published
+-- since the one it serves. Generations are applied one at a time since the paths of a generation
+-- only refer to the generation right before it.
+--------------------------------------------------------------------------------------------------*/
+void workerReload(fwd_worker *worker)
+{
+    uint64_t value;
+    fwd_config *next;
+
+    while (read(worker->control.fd, &value, sizeof(value)) == sizeof(value))
+    {
+    }
+
+    while ((next = __atomic_load_n(&worker->config->newer, __ATOMIC_ACQUIRE)) != NULL)
+    {
+        workerApply(worker, next);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerApply
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Apply the backlog and socket options of changed paths.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void workerApply(fwd_worker *worker, fwd_config *config)
+--                              fwd_worker *worker: The worker to update.
+--                              fwd_config *config: The generation that follows the one the worker serves.
+--
+-- NOTES:
+-- Moves the listeners of the worker over to the paths of the next generation. A path that is still
+-- there keeps its listening socket, so no client trying to connect during the reload is refused.
+-- Its warm pool is kept if the path is unchanged and refilled from the new backends otherwise, in
+-- which case the new backlog and socket options are also set on the listening socket, which the
+-- other paths of the port share. Listeners of new paths are opened before listeners of removed
+-- paths are closed, so a port that moves between addresses in one reload keeps its socket and the
+-- clients waiting on it. Paths that could not be listened on before are retried.
+--------------------------------------------------------------------------------------------------*/
+void workerApply(fwd_worker *worker, fwd_config *config)
+{
+    fwd_config *old = worker->config;
+    fwd_listener **listeners;
+    fwd_listener *listener;
+    fwd_path *path;
+
+    if ((listeners = calloc(config->size + 1, sizeof(fwd_listener *))) == NULL)
+    {
+        die("calloc");
+    }
+
+    for (int i = 0; i < config->size; i++)
+    {
+        path = config->paths + i;
+        if (path->previous == -1 || (listener = worker->listeners[path->previous]) == NULL)
+        {
+            continue;
+        }
+        worker->listeners[path->previous] = NULL;
+
+        // an unchanged path carries its backends over, so the pooled sockets still point at them
+        if (!old->paths[path->previous].backendsMoved)
+        {
+            listenerDrain(worker, listener);
+            listen(listener->socket->ep.fd, path->backlog);
+            uwuTuneSocket(listener->socket->ep.fd, &path->clientTuning, true);
+        }
+        listener->path = path;
+        listener->metrics = metricsShard(path, worker->id);
+        if (listener->pool == NULL)
+        {
+            listenerPool(worker, listener);
+        }
+        listeners[i] = listener;
+    }
+
+    // new paths are opened first so a port they share with removed paths keeps its socket
+    worker->pooling = false;
+    for (int i = 0; i < config->size; i++)
+    {
+        if (listeners[i] == NULL)
+        {
+            listeners[i] = listenerOpen(worker, config->paths + i);
+        }
+        worker->pooling = worker->pooling || (listeners[i] && listeners[i]->pool);
+    }
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if (worker->listeners[i])
+        {
+            listenerClose(worker, worker->listeners[i]);
+        }
+    }
+
+    free(worker->listeners);
+    worker->listeners = listeners;
+    worker->listenerCount = config->size;
+    worker->config = config;
+    configAcquire(config);
+    configRelease(old);
+    workerQueues(worker);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerQueues
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void workerQueues(fwd_worker *worker)
+--                              fwd_worker *worker: The worker whose listeners changed.
+--
+-- NOTES:
+-- Picks the metrics shard that reports the accept queue of every listening socket of the worker.
+-- The paths of a port share its socket, so only the first of them in the configuration reports it
+-- and the queue is not counted once per path.
+--------------------------------------------------------------------------------------------------*/
+void workerQueues(fwd_worker *worker)
+{
+    fwd_listener *listener;
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if (worker->listeners[i])
+        {
+            worker->listeners[i]->socket->reported = false;
+        }
+    }
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if ((listener = worker->listeners[i]) == NULL)
+        {
+            continue;
+        }
+        listener->metrics->listenFd = listener->socket->reported ? -1 : listener->socket->ep.fd;
+        listener->socket->reported = true;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerRun
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect through connStartAttempt with a deadline.
+--                          October 17, 2026 - Apply reloads after the batch.
+--                          October 17, 2026 - Pump throttled connections every LIMIT_TICK milliseconds.
+--                          October 17, 2026 - Run the timers of the connections from the timer wheel.
+--                          October 17, 2026 - Dispatch mirror sockets.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void workerRun(fwd_worker *worker)
+--                              fwd_worker *worker: The initialized worker to run.
+--
+-- NOTES:
+-- The event loop. Waits for readiness on any registered socket and dispatches it to the listener
+-- or connection that owns it. Connections closed while handling a batch of events are only freed
+-- once the whole batch has been handled since a later event in the batch may still point at them.
+-- Reloads are applied, and warm pools swept once a second and refilled, after the batch for the
+-- same reason. The wait is cut short when the next timer on the wheel of the worker is due.
+--------------------------------------------------------------------------------------------------*/
+void workerRun(fwd_worker *worker)
+{
+    int count;
+    int timeout = worker->pooling ? 1000 : -1;
+    ev_endpoint *ep;
+    fwd_conn *conn;
+    fwd_mirror *mirror;
+    wheel_timer *timer;
+    wheel_timer *next;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1)
+    {
+        if ((count = epoll_wait(worker->epfd, events, MAX_EVENTS, timeout)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            die("epoll_wait");
+        }
+        worker->now = time(NULL);
+        worker->nowMs = monotonicMs();
+
+        for (int i = 0; i < count; i++)
+        {
+            ep = events[i].data.ptr;
+            switch (ep->kind)
+            {
+            case EV_LISTENER:
+                workerAccept(worker, ep->owner);
+                break;
+            case EV_UPSTREAM:
+                conn = ep->owner;
+                if (!conn->closed)
+                {
+                    connPump(worker, conn);
+                }
+                break;
+            case EV_CONNECTING:
+                connAttemptEvent(worker, ep->owner);
+                break;
+            case EV_CLIENT:
+                conn = ep->owner;
+                if (!conn->closed && conn->connected)
+                {
+                    connPump(worker, conn);
+                }
+                break;
+            case EV_POOLED:
+                poolEvent(worker, ep->owner, events[i].events);
+                break;
+            case EV_MIRROR:
+                mirror = ep->owner;
+                if (!mirror->conn->closed)
+                {
+                    mirrorFlush(worker, mirror);
+                }
+                break;
+            case EV_CONTROL:
+                worker->reload = true;
+                break;
+            }
+        }
+
+        if (worker->throttled && worker->nowMs >= worker->nextTick)
+        {
+            workerTick(worker);
+        }
+
+        // listeners are only replaced once no event of the batch can point at them anymore
+        if (worker->reload)
+        {
+            worker->reload = false;
+            workerReload(worker);
+        }
+
+        // the handlers may arm a timer again, which reuses its link
+        for (timer = wheelExpire(&worker->wheel, worker->nowMs); timer; timer = next)
+        {
+            next = timer->next;
+            connExpire(worker, timer->owner);
+        }
+
+        timeout = wheelTimeout(&worker->wheel, worker->nowMs);
+        if (worker->pooling && (timeout == -1 || timeout > 1000))
+        {
+            timeout = 1000;
+        }
+        if (worker->throttled && (timeout == -1 || timeout > worker->nextTick - worker->nowMs))
+        {
+            timeout = worker->nextTick > worker->nowMs ? worker->nextTick - worker->nowMs : 0;
+        }
+
+        while (worker->closed)
+        {
+            conn = worker->closed;
+            worker->closed = conn->next;
+            free(conn);
+        }
+
+        if (worker->pooling && worker->now != worker->lastSweep)
+        {
+            poolSweep(worker);
+        }
+
+        if (worker->poolDirty)
+        {
+            worker->poolDirty = false;
+            for (int i = 0; i < worker->listenerCount; i++)
+            {
+                if (worker->listeners[i] && worker->listeners[i]->pool)
+                {
+                    poolRefill(worker, worker->listeners[i]);
+                }
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *workerThread(void *arg)
+--                              void *arg: The fwd_worker to run.
+--
+-- RETURNS:                 NULL.
+--
+-- NOTES:
+-- Thread entry point for a worker.
+--------------------------------------------------------------------------------------------------*/
+void *workerThread(void *arg)
+{
+    workerRun(arg);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerAccept
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Connect through connStartAttempt with a deadline.
+--                          October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Hold a reference on the configuration generation.
+--                          October 17, 2026 - Admit clients through the access list of the path.
+--                          October 17, 2026 - Bound the relay queues by the queue option of the path.
+--                          October 17, 2026 - Refuse clients over the connection rates of the path.
+--                          October 17, 2026 - Set the socket options accepted sockets do not inherit.
+--                          October 17, 2026 - Arm the timer of the connection.
+--                          October 17, 2026 - Reset clients when the circuit of every backend is open.
+--                          October 17, 2026 - Start the mirrors of the connection.
+--                          October 17, 2026 - Start the TCP_INFO telemetry of pooled connections.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void workerAccept(fwd_worker *worker, fwd_socket *socket)
+--                              fwd_worker *worker: The worker that owns the socket.
+--                              fwd_socket *socket: The listening socket that is readable.
+--
+-- NOTES:
+-- Accepts every pending connection on the socket of a port and picks the path of each client with
+-- configRoute, clients no path of the port is for are reset. Clients refused by the access list of
+-- the path or over one of its connection rates are reset right away, the rest are assigned a
+-- backend by pickBackend and handed a socket to it from the warm pool of the path if one is ready.
+-- Relaying starts right away for a pooled socket. Otherwise the connection waits on the connecting
+-- list of the worker while connStartAttempt connects to the backend without blocking the accept
+-- loop.
+--------------------------------------------------------------------------------------------------*/
+void workerAccept(fwd_worker *worker, fwd_socket *socket)
+{
+    int inSocket;
+    int outSocket;
+    bool pooled;
+    fwd_path *path;
+    fwd_listener *listener;
+    fwd_backend *backend;
+    fwd_conn *conn;
+    limit_client *limitClient;
+    struct epoll_event ev;
+    struct sockaddr_in incomingStruct;
+    socklen_t length;
+
+    while (1)
+    {
+        length = sizeof(incomingStruct);
+        if ((inSocket = accept4(socket->ep.fd, (struct sockaddr *)&incomingStruct, &length, SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                Error("No incoming connection");
+            }
+            return;
+        }
+
+        // the paths of the port share the socket, the client belongs to one of them
+        if ((path = configRoute(worker->config, &incomingStruct, socket->port)) == NULL
+            || (listener = worker->listeners[path - worker->config->paths]) == NULL)
+        {
+            uwuResetSocket(inSocket);
+            continue;
+        }
+
+        // refused before anything else is done for the client
+        if (!aclAllows(listener->path->acl, incomingStruct.sin_addr))
+        {
+            uwuResetSocket(inSocket);
+            metricsAdd(&listener->metrics->rejected, 1);
+            LogConn("Refused connection from %s", inet_ntoa(incomingStruct.sin_addr));
+            continue;
+        }
+
+        limitClient = limitClientAcquire(listener->path->limits, incomingStruct.sin_addr, worker->nowMs);
+        if (!limitAdmit(listener->path->limits, limitClient, worker->nowMs))
+        {
+            limitClientRelease(listener->path->limits, limitClient, worker->nowMs);
+            uwuResetSocket(inSocket);
+            metricsAdd(&listener->metrics->rateLimited, 1);
+            LogConn("Rate limited connection from %s", inet_ntoa(incomingStruct.sin_addr));
+            continue;
+        }
+        uwuTuneAccepted(inSocket, &listener->path->clientTuning);
+        LogConn("Connection accpeted from %s", inet_ntoa(incomingStruct.sin_addr));
+
+        // failing fast beats every client waiting out a connect to a backend known to be down
+        if ((backend = pickBackend(listener->path, &incomingStruct)) == NULL)
+        {
+            limitClientRelease(listener->path->limits, limitClient, worker->nowMs);
+            uwuResetSocket(inSocket);
+            metricsAdd(&listener->metrics->unavailable, 1);
+            LogConn("No backend available for connection from %s", inet_ntoa(incomingStruct.sin_addr));
+            continue;
+        }
+
+        LogConn("Connecting to destination host");
+        pooled = listener->pool && (outSocket = poolTake(worker, listener, backend)) != -1;
+        if (listener->pool)
+        {
+            __atomic_fetch_add(pooled ? &listener->path->poolHits : &listener->path->poolMisses, 1, __ATOMIC_RELAXED);
+        }
+
+        if ((conn = calloc(1, sizeof(fwd_conn))) == NULL)
+        {
+            die("calloc");
+        }
+        conn->path = listener->path;
+        conn->backend = backend;
+        conn->metrics = listener->metrics;
+        conn->limitClient = limitClient;
+        conn->startedUs = monotonicUs();
+        conn->timer.owner = conn;
+        metricsAdd(&conn->metrics->accepted, 1);
+        conn->toUpstream.limit = listener->path->queueLimit;
+        conn->toClient.limit = listener->path->queueLimit;
+        conn->client.kind = EV_CLIENT;
+        conn->client.fd = inSocket;
+        conn->client.owner = conn;
+        conn->upstream.kind = EV_UPSTREAM;
+        conn->upstream.fd = pooled ? outSocket : -1;
+        conn->upstream.owner = conn;
+        for (int i = 0; i < CONNECT_ATTEMPTS; i++)
+        {
+            conn->attempts[i].ep.kind = EV_CONNECTING;
+            conn->attempts[i].ep.fd = -1;
+            conn->attempts[i].ep.owner = conn->attempts + i;
+            conn->attempts[i].conn = conn;
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            conn->mirrors[i].ep.kind = EV_MIRROR;
+            conn->mirrors[i].ep.fd = -1;
+            conn->mirrors[i].ep.owner = conn->mirrors + i;
+            conn->mirrors[i].conn = conn;
+        }
+
+        if (options.relay == RELAY_SPLICE && (!relayInitSplice(&conn->toUpstream) || !relayInitSplice(&conn->toClient)))
+        {
+            relayRelease(&conn->toUpstream);
+            Error("Could not create splice pipes, copying instead");
+        }
+
+        // both sockets stay registered for reads and writes for their whole life
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = &conn->client;
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, inSocket, &ev) == -1)
+        {
+            Error("Could not register incoming socket");
+            relayRelease(&conn->toUpstream);
+            relayRelease(&conn->toClient);
+            close(inSocket);
+            if (pooled)
+            {
+                close(outSocket);
+            }
+            limitClientRelease(listener->path->limits, limitClient, worker->nowMs);
+            free(conn);
+            continue;
+        }
+
+        if (!pooled)
+        {
+            conn->deadline = worker->nowMs + listener->path->connectTimeout;
+            configAcquire(conn->path->config);
+            connLink(&worker->connecting, conn);
+            worker->connCount++;
+            if (!connStartAttempt(worker, conn))
+            {
+                Error("Could not connect to outgoing server");
+                connClose(worker, conn);
+                continue;
+            }
+            connArm(worker, conn);
+            continue;
+        }
+
+        // a pooled socket is already registered and only needs to point at its new owner
+        ev.data.ptr = &conn->upstream;
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_MOD, outSocket, &ev) == -1)
+        {
+            Error("Could not register outgoing socket");
+            relayRelease(&conn->toUpstream);
+            relayRelease(&conn->toClient);
+            close(inSocket);
+            close(outSocket);
+            limitClientRelease(listener->path->limits, limitClient, worker->nowMs);
+            free(conn);
+            continue;
+        }
+
+        configAcquire(conn->path->config);
+        connLink(&worker->conns, conn);
+        worker->connCount++;
+        conn->connected = true;
+        conn->lastActive = worker->nowMs;
+        tcpInfoStart(&conn->tcp, conn->path, worker->nowMs);
+        connArm(worker, conn);
+        backendAcquire(backend);
+        histogramRecord(&conn->metrics->connectTime, monotonicUs() - conn->startedUs);
+        LogConn("Connected %s to  %s (pooled)", conn->path->inName, conn->backend->name);
+        connMirror(worker, conn);
+        connPump(worker, conn);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connStartAttempt
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect with the upstream socket options of the path.
+--                          October 17, 2026 - Skip backends whose circuit is open and report failed connects.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool connStartAttempt(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection that needs an upstream socket.
+--
+-- RETURNS:                 True if a connect was started, false if every backend has been tried or
+--                          CONNECT_ATTEMPTS connects are already running.
+--
+-- NOTES:
+-- Starts a non-blocking connect to the next backend that has not been tried yet, beginning with
+-- the one pickBackend chose. Backends that fail right away are skipped, and so are the others
+-- while their circuit is open. The next attempt is scheduled CONNECT_ATTEMPT_DELAY milliseconds
+-- later in case this one is slow.
+--------------------------------------------------------------------------------------------------*/
+bool connStartAttempt(fwd_worker *worker, fwd_conn *conn)
+{
+    int sock;
+    fwd_attempt *attempt = NULL;
+    struct epoll_event ev;
+
+    for (int i = 0; i < CONNECT_ATTEMPTS && !attempt; i++)
+    {
+        if (conn->attempts[i].ep.fd == -1)
+        {
+            attempt = conn->attempts + i;
+        }
+    }
+
+    if (!attempt)
+    {
+        return false;
+    }
+
+    while (conn->attemptsStarted < conn->path->backendCount)
+    {
+        attempt->backend = alternateBackend(conn->path, conn->backend, conn->attemptsStarted++);
+        if (attempt->backend != conn->backend && !healthUsable(conn->path, attempt->backend))
+        {
+            continue;
+        }
+        if (!createNonBlockingConnectedSocket(&sock, &attempt->backend->addr, &conn->path->upstreamTuning))
+        {
+            Error("Could not connect to %s", attempt->backend->name);
+            healthFailed(conn->path, attempt->backend, worker->nowMs);
+            continue;
+        }
+
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.ptr = &attempt->ep;
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+        {
+            close(sock);
+            continue;
+        }
+
+        attempt->ep.fd = sock;
+        conn->attemptsActive++;
+        conn->nextAttempt = worker->nowMs + CONNECT_ATTEMPT_DELAY;
+        return true;
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connAttemptEvent
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Report failed connects to the circuit breaker.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connAttemptEvent(fwd_worker *worker, fwd_attempt *attempt)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_attempt *attempt: The connect attempt that had an event.
+--
+-- NOTES:
+-- Checks the outcome of a connect attempt. The first attempt to succeed becomes the upstream socket
+-- of the connection. A failed attempt immediately hands its place to the next backend, and the
+-- connection is closed once every backend has failed.
+--------------------------------------------------------------------------------------------------*/
+void connAttemptEvent(fwd_worker *worker, fwd_attempt *attempt)
+{
+    int err = 0;
+    socklen_t length = sizeof(err);
+    fwd_conn *conn = attempt->conn;
+
+    // the attempt lost the race or its connection was closed earlier in this batch
+    if (attempt->ep.fd == -1 || conn->closed)
+    {
+        return;
+    }
+
+    if (getsockopt(attempt->ep.fd, SOL_SOCKET, SO_ERROR, &err, &length) == -1 || err != 0)
+    {
+        Error("Could not connect to %s", attempt->backend->name);
+        healthFailed(conn->path, attempt->backend, worker->nowMs);
+        connDropAttempt(worker, attempt);
+        if (!connStartAttempt(worker, conn) && conn->attemptsActive == 0)
+        {
+            Error("Could not connect to outgoing server");
+            connClose(worker, conn);
+        }
+        return;
+    }
+
+    connEstablish(worker, conn, attempt);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connDropAttempt
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Remove the sockets from epoll before closing them.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connDropAttempt(fwd_worker *worker, fwd_attempt *attempt)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_attempt *attempt: The connect attempt to abandon.
+--
+-- NOTES:
+-- Closes the socket of a connect attempt and frees its slot.
+--------------------------------------------------------------------------------------------------*/
+void connDropAttempt(fwd_worker *worker, fwd_attempt *attempt)
+{
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, attempt->ep.fd, NULL);
+    close(attempt->ep.fd);
+    attempt->ep.fd = -1;
+    attempt->conn->attemptsActive--;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connEstablish
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Arm the timer of the connection.
+--                          October 17, 2026 - Report the connect to the circuit breaker.
+--                          October 17, 2026 - Start the mirrors of the connection.
+--                          October 17, 2026 - Start the TCP_INFO telemetry of the connection.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connEstablish(fwd_worker *worker, fwd_conn *conn, fwd_attempt *attempt)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection that is now connected.
+--                              fwd_attempt *attempt: The connect attempt that succeeded.
+--
+-- NOTES:
+-- Makes the socket of the winning attempt the upstream socket of the connection, abandons the
+-- other attempts and starts relaying anything the client has already sent.
+--------------------------------------------------------------------------------------------------*/
+void connEstablish(fwd_worker *worker, fwd_conn *conn, fwd_attempt *attempt)
+{
+    struct epoll_event ev;
+
+    conn->upstream.fd = attempt->ep.fd;
+    conn->backend = attempt->backend;
+    attempt->ep.fd = -1;
+    conn->attemptsActive--;
+    for (int i = 0; i < CONNECT_ATTEMPTS; i++)
+    {
+        if (conn->attempts[i].ep.fd != -1)
+        {
+            connDropAttempt(worker, conn->attempts + i);
+        }
+    }
+
+    connUnlink(&worker->connecting, conn);
+    connLink(&worker->conns, conn);
+    conn->connected = true;
+    conn->lastActive = worker->nowMs;
+    tcpInfoStart(&conn->tcp, conn->path, worker->nowMs);
+    connArm(worker, conn);
+    backendAcquire(conn->backend);
+    healthConnected(conn->path, conn->backend);
+    histogramRecord(&conn->metrics->connectTime, monotonicUs() - conn->startedUs);
+
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &conn->upstream;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_MOD, conn->upstream.fd, &ev) == -1)
+    {
+        Error("Could not register outgoing socket");
+        connClose(worker, conn);
+        return;
+    }
+
+    LogConn("Connected %s to  %s", conn->path->inName, conn->backend->name);
+    connMirror(worker, conn);
+    connPump(worker, conn);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connArm
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Wake up for the next TCP_INFO sample.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connArm(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection to set the timer of.
+--
+-- NOTES:
+-- Sets the timer of the connection on the wheel of the worker. A connecting connection is due for
+-- its next attempt or its deadline, a connected one for the idle timeout or the maximum lifetime of
+-- its path or its next TCP_INFO sample, and has no timer if it has none of them.
+--------------------------------------------------------------------------------------------------*/
+void connArm(fwd_worker *worker, fwd_conn *conn)
+{
+    long long due = LLONG_MAX;
+
+    if (!conn->connected)
+    {
+        wheelAdd(&worker->wheel, &conn->timer, conn->nextAttempt < conn->deadline ? conn->nextAttempt : conn->deadline);
+        return;
+    }
+
+    if (conn->path->idleTimeout)
+    {
+        due = conn->lastActive + conn->path->idleTimeout * 1000LL;
+    }
+    if (conn->path->maxLifetime && conn->startedUs / 1000 + conn->path->maxLifetime * 1000LL < due)
+    {
+        due = conn->startedUs / 1000 + conn->path->maxLifetime * 1000LL;
+    }
+    if (conn->tcp.nextSample < due)
+    {
+        due = conn->tcp.nextSample;
+    }
+
+    if (due == LLONG_MAX)
+    {
+        wheelCancel(&worker->wheel, &conn->timer);
+        return;
+    }
+    wheelAdd(&worker->wheel, &conn->timer, due);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connExpire
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Report timed out connects to the circuit breaker.
+--                          October 17, 2026 - Take the TCP_INFO samples that are due.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connExpire(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection whose timer expired.
+--
+-- NOTES:
+-- Closes connections that are still connecting after path.connectTimeout milliseconds, and starts
+-- a parallel attempt to the next backend for connections whose attempts have been running for
+-- CONNECT_ATTEMPT_DELAY milliseconds without an answer. Whichever attempt connects first wins.
+--
+-- Connected connections are closed once they are older than path.maxLifetime seconds or nothing
+-- was relayed in either direction for path.idleTimeout seconds. connPump only notes the time of the
+-- last activity, so a busy connection finds its idle timer has not really expired here and is
+-- armed again for the time left. The timer also takes the TCP_INFO samples of the connection.
+--------------------------------------------------------------------------------------------------*/
+void connExpire(fwd_worker *worker, fwd_conn *conn)
+{
+    if (conn->closed)
+    {
+        return;
+    }
+
+    if (!conn->connected)
+    {
+        if (worker->nowMs >= conn->deadline)
+        {
+            Error("Timed out connecting to outgoing server");
+            metricsAdd(&conn->metrics->connectTimeouts, 1);
+            for (int i = 0; i < CONNECT_ATTEMPTS; i++)
+            {
+                if (conn->attempts[i].ep.fd != -1)
+                {
+                    healthFailed(conn->path, conn->attempts[i].backend, worker->nowMs);
+                }
+            }
+            connClose(worker, conn);
+            return;
+        }
+
+        if (worker->nowMs >= conn->nextAttempt && !connStartAttempt(worker, conn))
+        {
+            // nothing left to start, only the deadline matters now
+            conn->nextAttempt = conn->deadline;
+        }
+        connArm(worker, conn);
+        return;
+    }
+
+    tcpInfoTick(&conn->tcp, conn->path, conn->client.fd, conn->upstream.fd, conn->metrics, worker->nowMs);
+    if (conn->path->maxLifetime && worker->nowMs >= conn->startedUs / 1000 + conn->path->maxLifetime * 1000LL)
+    {
+        LogConn("Connection to %s reached its maximum lifetime", conn->path->inName);
+        metricsAdd(&conn->metrics->lifetimeTimeouts, 1);
+        connClose(worker, conn);
+        return;
+    }
+
+    if (conn->path->idleTimeout && worker->nowMs >= conn->lastActive + conn->path->idleTimeout * 1000LL)
+    {
+        LogConn("Connection to %s was idle for %d seconds", conn->path->inName, conn->path->idleTimeout);
+        metricsAdd(&conn->metrics->idleTimeouts, 1);
+        connClose(worker, conn);
+        return;
+    }
+
+    connArm(worker, conn);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connLink
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connLink(fwd_conn **list, fwd_conn *conn)
+--                              fwd_conn **list: The head of the list.
+--                              fwd_conn *conn: The connection to add.
+--
+-- NOTES:
+-- Adds a connection to the front of one of the connection lists of a worker.
+--------------------------------------------------------------------------------------------------*/
+void connLink(fwd_conn **list, fwd_conn *conn)
+{
+    conn->prev = NULL;
+    conn->next = *list;
+    if (*list)
+    {
+        (*list)->prev = conn;
+    }
+    *list = conn;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connUnlink
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connUnlink(fwd_conn **list, fwd_conn *conn)
+--                              fwd_conn **list: The head of the list.
+--                              fwd_conn *conn: The connection to remove.
+--
+-- NOTES:
+-- Removes a connection from one of the connection lists of a worker.
+--------------------------------------------------------------------------------------------------*/
+void connUnlink(fwd_conn **list, fwd_conn *conn)
+{
+    if (conn->prev)
+    {
+        conn->prev->next = conn->next;
+    }
+    else
+    {
+        *list = conn->next;
+    }
+    if (conn->next)
+    {
+        conn->next->prev = conn->prev;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connPump
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Pass half-closes on and account the queued bytes.
+--                          October 17, 2026 - Apply the rate limits of the path.
+--                          October 17, 2026 - Note the last activity for the idle timeout.
+--                          October 17, 2026 - Write out the mirrors.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connPump(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection to relay data for.
+--
+-- NOTES:
+-- Relays data in both directions of a connected pair. When one side closes its end, the end of
+-- stream is passed on to the other side with relayShutdown once everything it sent has been
+-- delivered, and the other direction keeps going. The connection is closed once both directions
+-- have ended or either socket fails. The bytes queued by the connection are added to the metrics
+-- of the path as they change.
+--
+-- On a path with rate limits each direction may only read what limitAvailable allows and pays for
+-- what it read afterwards. A direction that ran out is counted as throttled and the connection is
+-- pumped again by workerTick once the buckets have been refilled.
+--
+-- Anything relayed in either direction counts as activity for the idle timeout of the path.
+--------------------------------------------------------------------------------------------------*/
+void connPump(fwd_worker *worker, fwd_conn *conn)
+{
+    fwd_limits *limits = conn->path->limits;
+    size_t toUpstream = conn->toUpstream.bytes;
+    size_t toClient = conn->toClient.bytes;
+    size_t queuedUpstream = relayQueued(&conn->toUpstream);
+    size_t queuedClient = relayQueued(&conn->toClient);
+    int result;
+
+    conn->toUpstream.allowance = limitAvailable(limits, conn->limitClient, true, worker->nowMs);
+    conn->toClient.allowance = limitAvailable(limits, conn->limitClient, false, worker->nowMs);
+    result = relayDirection(conn->client.fd, conn->upstream.fd, &conn->toUpstream) == -1
+             || relayDirection(conn->upstream.fd, conn->client.fd, &conn->toClient) == -1;
+    for (int i = 0; i < 2; i++)
+    {
+        if (conn->mirrors[i].dir)
+        {
+            mirrorFlush(worker, conn->mirrors + i);
+        }
+    }
+    metricsAdd(&conn->metrics->bytesToUpstream, conn->toUpstream.bytes - toUpstream);
+    metricsAdd(&conn->metrics->bytesToClient, conn->toClient.bytes - toClient);
+    metricsAdd(&conn->metrics->queued, relayQueued(&conn->toUpstream) + relayQueued(&conn->toClient) - queuedUpstream
+                                           - queuedClient);
+    if (conn->toUpstream.bytes != toUpstream || conn->toClient.bytes != toClient
+        || relayQueued(&conn->toUpstream) != queuedUpstream || relayQueued(&conn->toClient) != queuedClient)
+    {
+        conn->lastActive = worker->nowMs;
+    }
+    if (limits)
+    {
+        // what was read is what was written plus what the queue grew by
+        limitCharge(limits, conn->limitClient, true,
+            conn->toUpstream.bytes - toUpstream + relayQueued(&conn->toUpstream) - queuedUpstream);
+        limitCharge(limits, conn->limitClient, false,
+            conn->toClient.bytes - toClient + relayQueued(&conn->toClient) - queuedClient);
+    }
+    if (result)
+    {
+        connClose(worker, conn);
+        return;
+    }
+
+    if (limits && (conn->toUpstream.allowance == 0 || conn->toClient.allowance == 0))
+    {
+        metricsAdd(&conn->metrics->throttledToUpstream, conn->toUpstream.allowance == 0 && !conn->toUpstream.eof);
+        metricsAdd(&conn->metrics->throttledToClient, conn->toClient.allowance == 0 && !conn->toClient.eof);
+        connThrottle(worker, conn);
+    }
+
+    // both calls must run so each direction passes on its own end of stream
+    if (relayShutdown(conn->upstream.fd, &conn->toUpstream) & relayShutdown(conn->client.fd, &conn->toClient))
+    {
+        connClose(worker, conn);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Close the connect attempts of a connecting connection.
+--                          October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Release the configuration generation.
+--                          October 17, 2026 - Take the queued bytes off the metrics.
+--                          October 17, 2026 - Release the rate limit buckets of the client.
+--                          October 17, 2026 - Cancel the timer of the connection.
+--                          October 17, 2026 - Remove the sockets from epoll before closing them.
+--                          October 17, 2026 - Close the mirrors.
+--                          October 17, 2026 - Log the TCP_INFO summary of the connection.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connClose(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection to close.
+--
+-- NOTES:
+-- Logs which relay path was used and how much was relayed, drops whatever is still queued, closes
+-- both sockets, any splice pipes and any connect attempts still running, and moves the connection
+-- to the closed list of the worker where it will be freed at the end of the current event batch.
+--------------------------------------------------------------------------------------------------*/
+void connClose(fwd_worker *worker, fwd_conn *conn)
+{
+    if (conn->closed)
+    {
+        return;
+    }
+
+    LogConn("Closing connection to %s (%s relay, %zu bytes in, %zu bytes out)", conn->path->inName,
+        conn->toUpstream.spliced && conn->toClient.spliced ? "splice" : "copy", conn->toUpstream.bytes,
+        conn->toClient.bytes);
+    connUnthrottle(worker, conn);
+    wheelCancel(&worker->wheel, &conn->timer);
+    metricsAdd(&conn->metrics->queued, -(relayQueued(&conn->toUpstream) + relayQueued(&conn->toClient)));
+    for (int i = 0; i < 2; i++)
+    {
+        if (conn->mirrors[i].dir)
+        {
+            mirrorClose(worker, conn->mirrors + i);
+        }
+    }
+    if (conn->connected)
+    {
+        tcpInfoFinish(&conn->tcp, conn->client.fd, conn->upstream.fd, conn->metrics, conn->path, conn->backend->name,
+            monotonicUs() - conn->startedUs);
+    }
+    relayRelease(&conn->toUpstream);
+    relayRelease(&conn->toClient);
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, conn->client.fd, NULL);
+    close(conn->client.fd);
+    for (int i = 0; i < CONNECT_ATTEMPTS; i++)
+    {
+        if (conn->attempts[i].ep.fd != -1)
+        {
+            connDropAttempt(worker, conn->attempts + i);
+        }
+    }
+    if (conn->connected)
+    {
+        epoll_ctl(worker->epfd, EPOLL_CTL_DEL, conn->upstream.fd, NULL);
+        close(conn->upstream.fd);
+        backendRelease(conn->backend);
+    }
+    else
+    {
+        metricsAdd(&conn->metrics->connectFailures, 1);
+    }
+    conn->closed = true;
+    metricsAdd(&conn->metrics->closed, 1);
+    histogramRecord(&conn->metrics->sessionTime, monotonicUs() - conn->startedUs);
+
+    connUnlink(conn->connected ? &worker->conns : &worker->connecting, conn);
+    worker->connCount--;
+
+    limitClientRelease(conn->path->limits, conn->limitClient, worker->nowMs);
+
+    // the path and its backends may be freed by a reload from here on
+    configRelease(conn->path->config);
+
+    conn->next = worker->closed;
+    worker->closed = conn;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connMirror
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connMirror(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: A connection that has just been connected.
+--
+-- NOTES:
+-- Starts a non-blocking connect to path.mirror for every direction the path mirrors. The relay
+-- hands the mirror a copy of the direction from here on, which sits in the pipe of the mirror
+-- until its socket is connected. A mirror that cannot be set up only counts the copies as dropped,
+-- the connection itself is never failed over it.
+--------------------------------------------------------------------------------------------------*/
+void connMirror(fwd_worker *worker, fwd_conn *conn)
+{
+    int sock;
+    fwd_mirror *mirror;
+    struct epoll_event ev;
+
+    if (!conn->path->mirrored)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!(conn->path->mirrorDirections & (i == 0 ? MIRROR_UPSTREAM : MIRROR_CLIENT)))
+        {
+            continue;
+        }
+
+        mirror = conn->mirrors + i;
+        mirror->dir = i == 0 ? &conn->toUpstream : &conn->toClient;
+        mirror->dir->mirror = &mirror->relay;
+        if (!relayMirrorInit(&mirror->relay, conn->path->mirrorBuffer))
+        {
+            Error("Could not create mirror pipe");
+            continue;
+        }
+        if (!createNonBlockingConnectedSocket(&sock, &conn->path->mirror, NULL))
+        {
+            Error("Could not connect to mirror of %s", conn->path->inName);
+            relayMirrorRelease(&mirror->relay);
+            continue;
+        }
+
+        // the mirror is only ever written to
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.ptr = &mirror->ep;
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+        {
+            Error("Could not register mirror socket");
+            close(sock);
+            relayMirrorRelease(&mirror->relay);
+            continue;
+        }
+        mirror->ep.fd = sock;
+        mirror->relay.fd = sock;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                mirrorFlush
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void mirrorFlush(fwd_worker *worker, fwd_mirror *mirror)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_mirror *mirror: The mirror to write out.
+--
+-- NOTES:
+-- Writes what the mirror holds to its socket. A mirror whose socket failed, including one that
+-- never connected, is closed and drops everything from then on.
+--------------------------------------------------------------------------------------------------*/
+void mirrorFlush(fwd_worker *worker, fwd_mirror *mirror)
+{
+    // the relay releases a mirror whose socket failed while it was making room for more
+    if (mirror->ep.fd != -1 && (!mirror->relay.open || relayMirrorFlush(mirror->dir) == -1))
+    {
+        LogConn("Mirror of %s failed, dropping its copy", mirror->conn->path->inName);
+        mirrorClose(worker, mirror);
+        return;
+    }
+
+    mirrorAccount(mirror);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                mirrorClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void mirrorClose(fwd_worker *worker, fwd_mirror *mirror)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_mirror *mirror: The mirror to close.
+--
+-- NOTES:
+-- Gives the socket one last chance to take what is left, then closes it and the pipe. Whatever it
+-- did not take is counted as dropped.
+--------------------------------------------------------------------------------------------------*/
+void mirrorClose(fwd_worker *worker, fwd_mirror *mirror)
+{
+    if (mirror->ep.fd != -1)
+    {
+        relayMirrorFlush(mirror->dir);
+        epoll_ctl(worker->epfd, EPOLL_CTL_DEL, mirror->ep.fd, NULL);
+        close(mirror->ep.fd);
+        mirror->ep.fd = -1;
+        mirror->relay.fd = -1;
+    }
+
+    relayMirrorRelease(&mirror->relay);
+    mirrorAccount(mirror);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                mirrorAccount
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void mirrorAccount(fwd_mirror *mirror)
+--                              fwd_mirror *mirror: The mirror to account for.
+--
+-- NOTES:
+-- Adds what the mirror sent and dropped since it was last accounted to the metrics of the path.
+--------------------------------------------------------------------------------------------------*/
+void mirrorAccount(fwd_mirror *mirror)
+{
+    fwd_metrics *metrics = mirror->conn->metrics;
+    bool toUpstream = mirror->dir == &mirror->conn->toUpstream;
+
+    metricsAdd(toUpstream ? &metrics->mirroredToUpstream : &metrics->mirroredToClient,
+        mirror->relay.bytes - mirror->bytesCounted);
+    metricsAdd(toUpstream ? &metrics->mirrorDroppedToUpstream : &metrics->mirrorDroppedToClient,
+        mirror->relay.dropped - mirror->droppedCounted);
+    mirror->bytesCounted = mirror->relay.bytes;
+    mirror->droppedCounted = mirror->relay.dropped;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connThrottle
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connThrottle(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: A connection that ran out of tokens.
+--
+-- NOTES:
+-- Adds the connection to the throttled list of the worker, which workerTick goes through once
+-- every LIMIT_TICK milliseconds. A throttled connection left data unread, so no edge triggered
+-- event would wake it up again.
+--------------------------------------------------------------------------------------------------*/
+void connThrottle(fwd_worker *worker, fwd_conn *conn)
+{
+    if (conn->throttled)
+    {
+        return;
+    }
+
+    if (worker->throttled == NULL)
+    {
+        worker->nextTick = worker->nowMs + LIMIT_TICK;
+    }
+    conn->throttled = true;
+    conn->throttledPrev = NULL;
+    conn->throttledNext = worker->throttled;
+    if (worker->throttled)
+    {
+        worker->throttled->throttledPrev = conn;
+    }
+    worker->throttled = conn;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connUnthrottle
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connUnthrottle(fwd_worker *worker, fwd_conn *conn)
+--                              fwd_worker *worker: The worker that owns the connection.
+--                              fwd_conn *conn: The connection to take off the throttled list.
+--
+-- NOTES:
+-- Does nothing if the connection is not throttled.
+--------------------------------------------------------------------------------------------------*/
+void connUnthrottle(fwd_worker *worker, fwd_conn *conn)
+{
+    if (!conn->throttled)
+    {
+        return;
+    }
+
+    if (conn->throttledPrev)
+    {
+        conn->throttledPrev->throttledNext = conn->throttledNext;
+    }
+    else
+    {
+        worker->throttled = conn->throttledNext;
+    }
+    if (conn->throttledNext)
+    {
+        conn->throttledNext->throttledPrev = conn->throttledPrev;
+    }
+    conn->throttled = false;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                workerTick
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void workerTick(fwd_worker *worker)
+--                              fwd_worker *worker: The worker whose throttled connections to pump.
+--
+-- NOTES:
+-- Pumps every throttled connection once. The list is taken over first, so connections that run
+-- out again are put on a fresh list for the next tick.
+--------------------------------------------------------------------------------------------------*/
+void workerTick(fwd_worker *worker)
+{
+    fwd_conn *conn = worker->throttled;
+    fwd_conn *next;
+
+    worker->throttled = NULL;
+    for (; conn; conn = next)
+    {
+        next = conn->throttledNext;
+        conn->throttled = false;
+        connPump(worker, conn);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                poolRefill
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Connect with the upstream socket options of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void poolRefill(fwd_worker *worker, fwd_listener *listener)
+--                              fwd_worker *worker: The worker that owns the listener.
+--                              fwd_listener *listener: The listener whose pool should be filled.
+--
+-- NOTES:
+-- Starts a non-blocking connect for every empty slot of the pool. Slots are spread evenly over the
+-- backends of the path so every backend has its share of the pool. If a connect cannot
+-- be started, or the backend recently refused one, refilling is held off for POOL_RETRY_DELAY
+-- seconds so a dead backend is not hammered.
+--------------------------------------------------------------------------------------------------*/
+void poolRefill(fwd_worker *worker, fwd_listener *listener)
+{
+    int sock;
+    fwd_pooled *pooled;
+    struct epoll_event ev;
+
+    if (worker->now < listener->poolRetry)
+    {
+        return;
+    }
+
+    for (int i = 0; i < listener->path->poolSize; i++)
+    {
+        pooled = listener->pool + i;
+        if (pooled->state != POOL_EMPTY)
+        {
+            continue;
+        }
+
+        pooled->backend = listener->path->backends + i % listener->path->backendCount;
+        if (!createNonBlockingConnectedSocket(&sock, &pooled->backend->addr, &listener->path->upstreamTuning))
+        {
+            listener->poolRetry = worker->now + POOL_RETRY_DELAY;
+            return;
+        }
+
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = &pooled->ep;
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+        {
+            close(sock);
+            listener->poolRetry = worker->now + POOL_RETRY_DELAY;
+            return;
+        }
+
+        pooled->ep.fd = sock;
+        pooled->state = POOL_CONNECTING;
+        pooled->since = worker->now;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                poolEvent
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void poolEvent(fwd_worker *worker, fwd_pooled *pooled, const unsigned events)
+--                              fwd_worker *worker: The worker that owns the pooled socket.
+--                              fwd_pooled *pooled: The pooled socket that had an event.
+--                              const unsigned events: The epoll events that were reported.
+--
+-- NOTES:
+-- Marks a pooled socket as ready once its connect completes, and discards it if the connect fails
+-- or the backend closes it while it waits in the pool. Data the backend sends first, such as an
+-- SSH banner, is left in the socket and relayed once the socket is handed to a client.
+--------------------------------------------------------------------------------------------------*/
+void poolEvent(fwd_worker *worker, fwd_pooled *pooled, const unsigned events)
+{
+    int err = 0;
+    socklen_t length = sizeof(err);
+
+    // the socket was handed out or discarded earlier in this batch
+    if (pooled->state == POOL_EMPTY)
+    {
+        return;
+    }
+
+    if (pooled->state == POOL_CONNECTING && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+    {
+        if (getsockopt(pooled->ep.fd, SOL_SOCKET, SO_ERROR, &err, &length) == -1 || err != 0)
+        {
+            pooled->listener->poolRetry = worker->now + POOL_RETRY_DELAY;
+            poolDiscard(worker, pooled);
+            return;
+        }
+        pooled->state = POOL_READY;
+        pooled->since = worker->now;
+    }
+
+    if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+    {
+        poolDiscard(worker, pooled);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                poolDiscard
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Remove the sockets from epoll before closing them.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void poolDiscard(fwd_worker *worker, fwd_pooled *pooled)
+--                              fwd_worker *worker: The worker that owns the pooled socket.
+--                              fwd_pooled *pooled: The pooled socket to discard.
+--
+-- NOTES:
+-- Closes a pooled socket and empties its slot so it is refilled after the current batch. Only
+-- sockets that were ready count as discarded, failed connects do not.
+--------------------------------------------------------------------------------------------------*/
+void poolDiscard(fwd_worker *worker, fwd_pooled *pooled)
+{
+    if (pooled->state == POOL_READY)
+    {
+        __atomic_fetch_add(&pooled->listener->path->poolDiscards, 1, __ATOMIC_RELAXED);
+    }
+
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, pooled->ep.fd, NULL);
+    close(pooled->ep.fd);
+    pooled->ep.fd = -1;
+    pooled->state = POOL_EMPTY;
+    worker->poolDirty = true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                poolTake
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int poolTake(fwd_worker *worker, fwd_listener *listener, fwd_backend *backend)
+--                              fwd_worker *worker: The worker that owns the listener.
+--                              fwd_listener *listener: The listener whose pool to take from.
+--                              fwd_backend *backend: The backend the socket must be connected to.
+--
+-- RETURNS:                 A connected upstream socket, -1 if the pool has none for backend.
+--
+-- NOTES:
+-- Removes a ready socket from the pool. Sockets that have been idle for longer than path.poolIdle
+-- or that the backend has closed without us noticing yet are discarded instead of handed out. The
+-- returned socket is still registered with the worker's epoll instance.
+--------------------------------------------------------------------------------------------------*/
+int poolTake(fwd_worker *worker, fwd_listener *listener, fwd_backend *backend)
+{
+    int sock;
+    char byte;
+    ssize_t n;
+    fwd_pooled *pooled;
+
+    for (int i = 0; i < listener->path->poolSize; i++)
+    {
+        pooled = listener->pool + i;
+        if (pooled->state != POOL_READY || pooled->backend != backend)
+        {
+            continue;
+        }
+
+        if (worker->now - pooled->since > listener->path->poolIdle)
+        {
+            poolDiscard(worker, pooled);
+            continue;
+        }
+
+        n = recv(pooled->ep.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            poolDiscard(worker, pooled);
+            continue;
+        }
+
+        sock = pooled->ep.fd;
+        pooled->ep.fd = -1;
+        pooled->state = POOL_EMPTY;
+        worker->poolDirty = true;
+        return sock;
+    }
+
+    return -1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                poolSweep
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void poolSweep(fwd_worker *worker)
+--                              fwd_worker *worker: The worker whose pools to sweep.
+--
+-- NOTES:
+-- Discards every pooled socket that has been idle, or stuck connecting, for longer than the
+-- pool_idle of its path. Also marks the pools for refilling so slots left empty by a failed
+-- connect are retried.
+--------------------------------------------------------------------------------------------------*/
+void poolSweep(fwd_worker *worker)
+{
+    fwd_listener *listener;
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if ((listener = worker->listeners[i]) == NULL)
+        {
+            continue;
+        }
+        for (int j = 0; listener->pool && j < listener->path->poolSize; j++)
+        {
+            if (listener->pool[j].state != POOL_EMPTY && worker->now - listener->pool[j].since > listener->path->poolIdle)
+            {
+                poolDiscard(worker, listener->pool + j);
+            }
+        }
+    }
+
+    worker->lastSweep = worker->now;
+    worker->poolDirty = true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                eventRoutine
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Added worker threads.
+--                          October 17, 2026 - Workers always run on their own threads.
+--                          October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Serve configuration generations.
+--                          October 17, 2026 - Start the UDP worker.
+--                          October 17, 2026 - Ignore SIGPIPE.
+--                          October 17, 2026 - Pin the workers and allocate them on their NUMA nodes.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void eventRoutine(fwd_config *config)
+--                              fwd_config *config: The configuration generation to start with.
+--
+-- NOTES:
+-- Serves every path with options.workers event loops, one per core if options.workers is 0, or
+-- one per CPU given to -c. Workers are pinned to the CPUs of -c and allocated on their nodes. Every
+-- worker's listeners are created before any worker starts so bind errors are reported up front.
+-- The UDP paths are served by the UDP worker, which writes to a metrics shard of its own.
+-- Every worker is given its own thread and the calling thread is left to handle the control
+-- signals, including reloads, with controlRoutine. Does not return.
+--------------------------------------------------------------------------------------------------*/
+void eventRoutine(fwd_config *config)
+{
+    int count;
+    fwd_worker **workers;
+
+    // splicing into a socket the peer has closed must fail the splice, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((count = options.workers) <= 0)
+    {
+        count = affinityWorkers();
+    }
+
+    if ((workers = calloc(count, sizeof(fwd_worker *))) == NULL)
+    {
+        die("calloc");
+    }
+
+    if (!metricsInit(config->paths, config->size, count + 1))
+    {
+        die("Could not allocate metrics");
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if ((workers[i] = affinityAlloc(sizeof(fwd_worker), affinityNode(affinityCpu(i)))) == NULL)
+        {
+            die("malloc");
+        }
+        if (!workerInit(workers[i], config, i, count > 1))
+        {
+            die("Could not listen on any path");
+        }
+    }
+
+    if (!udpStart(config, count))
+    {
+        die("Could not start the UDP worker");
+    }
+
+    // workers inherit the mask so only the control thread sees the control signals
+    blockControlSignals();
+    if (options.metrics && !metricsStart(options.metrics))
+    {
+        die("Could not serve metrics");
+    }
+
+    Log("Starting %d workers", count);
+    affinityReport(count);
+    for (int i = 0; i < count; i++)
+    {
+        if (!affinitySpawn(workerThread, workers[i], workers[i]->cpu))
+        {
+            die("pthread_create");
+        }
+    }
+
+    controlRoutine();
+}
@@ -0,0 +1,971 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             health.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool healthParsePayload(const char *value, char *out, size_t *length)
+--                          bool healthInit(fwd_path *path)
+--                          void healthFree(fwd_health *health, const int count)
+--                          int *healthOpenCount(fwd_path *path)
+--                          bool healthAvailable(fwd_path *path, fwd_backend *backend, const long long nowMs)
+--                          bool healthUsable(fwd_path *path, fwd_backend *backend)
+--                          void healthOpen(fwd_path *path, fwd_backend *backend, const long long nowMs, const char *reason)
+--                          void healthConnected(fwd_path *path, fwd_backend *backend)
+--                          void healthFailed(fwd_path *path, fwd_backend *backend, const long long nowMs)
+--                          void healthProbed(fwd_path *path, fwd_backend *backend, const bool passed, const long long nowMs)
+--                          void healthProbeStart(health_checker *checker, health_probe *probe, const long long nowMs)
+--                          void healthProbeEvent(health_checker *checker, health_probe *probe, const unsigned events, const long long nowMs)
+--                          void healthProbeFinish(health_checker *checker, health_probe *probe, const bool passed, const long long nowMs)
+--                          void healthLoad(health_checker *checker, fwd_config *config, const long long nowMs)
+--                          void healthUnload(health_checker *checker)
+--                          void healthReload(health_checker *checker, const long long nowMs)
+--                          void *healthThread(void *arg)
+--                          bool healthStart(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Backend health checks and circuit breaking. Every backend of a TCP path with health_interval or
+-- health_fall has a circuit that is closed (HEALTH_UP) while the backend works. health_fall
+-- consecutive failures, either connects made for clients or probes, open it (HEALTH_DOWN) and
+-- pickBackend then routes around the backend, or fails fast when no backend of the path is left.
+-- After health_cooldown milliseconds one client at a time is let through as a trial
+-- (HEALTH_TRIAL), half open, and its connect closes the circuit again or opens it for another
+-- cooldown. health_rise passing probes in a row close it as well. The number of open circuits of a
+-- path is kept next to the circuits so pickBackend knows how much of the path is left without
+-- looking at every backend.
+--
+-- Probes are run by a single thread for every backend of every path. Each probe is a
+-- non-blocking connect, optionally followed by writing health_send and reading until the reply
+-- has started with health_expect, and is given health_timeout milliseconds. The probes wait on one
+-- epoll instance and are scheduled on a timer wheel, so the thread only wakes up when a probe is
+-- due or has an event, however many backends there are. The first probe of each backend is
+-- spread randomly over its interval so the backends are not all probed at once.
+--
+-- The state is updated with atomics only since every worker, and the thread, may change it. With
+-- the fork engine it lives in shared memory so the connection processes report their connects to
+-- the path process and the thread of the main process probes for both.
+---------------------------------------------------------------------------------------*/
+
+#include "health.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "balance.h"
+#include "io.h"
+#include "net.h"
+#include "reload.h"
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthParsePayload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool healthParsePayload(const char *value, char *out, size_t *length)
+--                              const char *value: The value of a health_send or health_expect option.
+--                              char *out: Buffer of HEALTH_PAYLOAD_SIZE bytes for the payload.
+--                              size_t *length: Pointer to where the length of the payload is placed.
+--
+-- RETURNS:                 True if value is a valid payload that fits, false otherwise.
+--
+-- NOTES:
+-- Options are separated by whitespace, so the payload is written with the escapes \r, \n, \t, \\
+-- and \xHH, for example "PING\r\n" or "GET\x20/health".
+--------------------------------------------------------------------------------------------------*/
+bool healthParsePayload(const char *value, char *out, size_t *length)
+{
+    unsigned int byte;
+    int used;
+
+    *length = 0;
+    while (*value)
+    {
+        if (*length == HEALTH_PAYLOAD_SIZE)
+        {
+            return false;
+        }
+
+        if (*value != '\\')
+        {
+            out[(*length)++] = *value++;
+            continue;
+        }
+
+        switch (value[1])
+        {
+        case 'r':
+            out[(*length)++] = '\r';
+            break;
+        case 'n':
+            out[(*length)++] = '\n';
+            break;
+        case 't':
+            out[(*length)++] = '\t';
+            break;
+        case '\\':
+            out[(*length)++] = '\\';
+            break;
+        case 'x':
+            if (sscanf(value + 2, "%2x%n", &byte, &used) != 1 || used != 2)
+            {
+                return false;
+            }
+            out[(*length)++] = byte;
+            value += 2;
+            break;
+        default:
+            return false;
+        }
+        value += 2;
+    }
+
+    return *length > 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Keep the number of open circuits after the circuits.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool healthInit(fwd_path *path)
+--                              fwd_path *path: A path whose backends and options have been parsed.
+--
+-- RETURNS:                 True if the health state was set up, false if memory ran out.
+--
+-- NOTES:
+-- Gives every backend of a path with health_interval or health_fall a closed circuit. Other paths,
+-- and UDP paths, keep path.health NULL and every backend is always available to them. A path with
+-- health checks but no health_fall opens the circuit after HEALTH_FALL failures. The fork engine
+-- maps the state shared so it is seen by every process forked for the path.
+--------------------------------------------------------------------------------------------------*/
+bool healthInit(fwd_path *path)
+{
+    fwd_health *health;
+
+    path->health = NULL;
+    if (path->udp || (path->healthInterval == 0 && path->healthFall == 0))
+    {
+        return true;
+    }
+
+    if (path->healthFall == 0)
+    {
+        path->healthFall = HEALTH_FALL;
+    }
+
+    if (options.engine == ENGINE_FORK)
+    {
+        health = mmap(NULL, HEALTH_SIZE(path->backendCount), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (health == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+    else if ((health = calloc(1, HEALTH_SIZE(path->backendCount))) == NULL)
+    {
+        return false;
+    }
+
+    path->health = health;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthFree
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Keep the number of open circuits after the circuits.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthFree(fwd_health *health, const int count)
+--                              fwd_health *health: The health state of a path, may be NULL.
+--                              const int count: The number of backends of the path.
+--------------------------------------------------------------------------------------------------*/
+void healthFree(fwd_health *health, const int count)
+{
+    if (health == NULL)
+    {
+        return;
+    }
+
+    if (options.engine == ENGINE_FORK)
+    {
+        munmap(health, HEALTH_SIZE(count));
+        return;
+    }
+
+    free(health);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthOpenCount
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int *healthOpenCount(fwd_path *path)
+--                              fwd_path *path: A path with health state.
+--
+-- RETURNS:                 The number of backends of the path whose circuit is not closed.
+--
+-- NOTES:
+-- The count follows the circuits, which are not closed one at a time, so it is only read and
+-- written with atomics. It is moved only by whoever swaps a circuit from or to HEALTH_UP.
+--------------------------------------------------------------------------------------------------*/
+int *healthOpenCount(fwd_path *path)
+{
+    return (int *)(path->health + path->backendCount);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthAvailable
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Only a circuit that is still open becomes a trial.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool healthAvailable(fwd_path *path, fwd_backend *backend, const long long nowMs)
+--                              fwd_path *path: The path the client connected to.
+--                              fwd_backend *backend: The backend the client would be sent to.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 True if the client may be sent to the backend, false otherwise.
+--
+-- NOTES:
+-- Called by pickBackend for a new client. An open circuit lets one client through once its
+-- cooldown is over, whoever moves the retry time forward with a compare and swap is the trial. A
+-- trial whose outcome is never reported, a client that left early, only holds the backend for one
+-- cooldown.
+--------------------------------------------------------------------------------------------------*/
+bool healthAvailable(fwd_path *path, fwd_backend *backend, const long long nowMs)
+{
+    fwd_health *health;
+    long long retryAt;
+    int state;
+
+    if (path->health == NULL)
+    {
+        return true;
+    }
+
+    health = path->health + (backend - path->backends);
+    if (__atomic_load_n(&health->state, __ATOMIC_ACQUIRE) == HEALTH_UP)
+    {
+        return true;
+    }
+
+    retryAt = __atomic_load_n(&health->retryAt, __ATOMIC_RELAXED);
+    if (nowMs < retryAt
+        || !__atomic_compare_exchange_n(&health->retryAt, &retryAt, nowMs + path->healthCooldown, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        return false;
+    }
+
+    // a circuit that was closed in the meantime stays closed
+    state = HEALTH_DOWN;
+    __atomic_compare_exchange_n(&health->state, &state, HEALTH_TRIAL, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    LogConn("Trying %s:%d of %s:%d again", backend->name, ntohs(backend->addr.sin_port), path->inName,
+            ntohs(path->in.sin_port));
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthUsable
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool healthUsable(fwd_path *path, fwd_backend *backend)
+--                              fwd_path *path: The path the client connected to.
+--                              fwd_backend *backend: A backend to fail over to.
+--
+-- RETURNS:                 True if the circuit of the backend is closed, false otherwise.
+--
+-- NOTES:
+-- Used when failing over to the other backends of a path, which skips open circuits without
+-- taking their trial.
+--------------------------------------------------------------------------------------------------*/
+bool healthUsable(fwd_path *path, fwd_backend *backend)
+{
+    return path->health == NULL
+           || __atomic_load_n(&path->health[backend - path->backends].state, __ATOMIC_ACQUIRE) == HEALTH_UP;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Count the open circuits of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthOpen(fwd_path *path, fwd_backend *backend, const long long nowMs, const char *reason)
+--                              fwd_path *path: The path of the backend.
+--                              fwd_backend *backend: The backend that failed.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--                              const char *reason: Why the circuit opens, for the log.
+--
+-- NOTES:
+-- Opens the circuit of a backend for path.healthCooldown milliseconds. Only the caller that finds
+-- the circuit closed logs it and counts it as an ejection.
+--------------------------------------------------------------------------------------------------*/
+void healthOpen(fwd_path *path, fwd_backend *backend, const long long nowMs, const char *reason)
+{
+    fwd_health *health = path->health + (backend - path->backends);
+
+    __atomic_store_n(&health->retryAt, nowMs + path->healthCooldown, __ATOMIC_RELAXED);
+    __atomic_store_n(&health->successes, 0, __ATOMIC_RELAXED);
+    if (__atomic_exchange_n(&health->state, HEALTH_DOWN, __ATOMIC_ACQ_REL) == HEALTH_UP)
+    {
+        __atomic_fetch_add(healthOpenCount(path), 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&health->ejections, 1, __ATOMIC_RELAXED);
+        Error("Backend %s:%d of %s:%d is down, %s", backend->name, ntohs(backend->addr.sin_port), path->inName,
+              ntohs(path->in.sin_port), reason);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthConnected
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Count the open circuits of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthConnected(fwd_path *path, fwd_backend *backend)
+--                              fwd_path *path: The path the client connected to.
+--                              fwd_backend *backend: The backend that was connected to.
+--
+-- NOTES:
+-- Reports a connect made for a client. It resets the failures of the backend and closes its
+-- circuit, a successful trial among others.
+--------------------------------------------------------------------------------------------------*/
+void healthConnected(fwd_path *path, fwd_backend *backend)
+{
+    fwd_health *health;
+
+    if (path->health == NULL)
+    {
+        return;
+    }
+
+    health = path->health + (backend - path->backends);
+    __atomic_store_n(&health->failures, 0, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&health->state, __ATOMIC_ACQUIRE) != HEALTH_UP
+        && __atomic_exchange_n(&health->state, HEALTH_UP, __ATOMIC_ACQ_REL) != HEALTH_UP)
+    {
+        __atomic_fetch_sub(healthOpenCount(path), 1, __ATOMIC_RELAXED);
+        Log("Backend %s:%d of %s:%d is up", backend->name, ntohs(backend->addr.sin_port), path->inName,
+            ntohs(path->in.sin_port));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthFailed
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthFailed(fwd_path *path, fwd_backend *backend, const long long nowMs)
+--                              fwd_path *path: The path the client connected to.
+--                              fwd_backend *backend: The backend that could not be connected to.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Reports a failed or timed out connect, made for a client or by a probe. The circuit opens after
+-- path.healthFall failures in a row, or at once when the failure was the trial.
+--------------------------------------------------------------------------------------------------*/
+void healthFailed(fwd_path *path, fwd_backend *backend, const long long nowMs)
+{
+    fwd_health *health;
+    int failures;
+    int state;
+
+    if (path->health == NULL)
+    {
+        return;
+    }
+
+    health = path->health + (backend - path->backends);
+    failures = __atomic_add_fetch(&health->failures, 1, __ATOMIC_RELAXED);
+    state = __atomic_load_n(&health->state, __ATOMIC_ACQUIRE);
+    if (state == HEALTH_TRIAL)
+    {
+        healthOpen(path, backend, nowMs, "the trial failed");
+    }
+    else if (state == HEALTH_UP && failures >= path->healthFall)
+    {
+        healthOpen(path, backend, nowMs, "too many failures");
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthProbed
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthProbed(fwd_path *path, fwd_backend *backend, const bool passed, const long long nowMs)
+--                              fwd_path *path: The path of the backend.
+--                              fwd_backend *backend: The backend that was probed.
+--                              const bool passed: Whether the probe passed.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Reports a probe. A failed probe counts like a failed connect. Passing probes reset the
+-- failures, and path.healthRise of them in a row close an open circuit.
+--------------------------------------------------------------------------------------------------*/
+void healthProbed(fwd_path *path, fwd_backend *backend, const bool passed, const long long nowMs)
+{
+    fwd_health *health = path->health + (backend - path->backends);
+
+    if (!passed)
+    {
+        __atomic_fetch_add(&health->checksFailed, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&health->successes, 0, __ATOMIC_RELAXED);
+        healthFailed(path, backend, nowMs);
+        return;
+    }
+
+    __atomic_fetch_add(&health->checksPassed, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&health->failures, 0, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&health->state, __ATOMIC_ACQUIRE) != HEALTH_UP
+        && __atomic_add_fetch(&health->successes, 1, __ATOMIC_RELAXED) >= path->healthRise)
+    {
+        healthConnected(path, backend);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthProbeStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthProbeStart(health_checker *checker, health_probe *probe, const long long nowMs)
+--                              health_checker *checker: The health check thread.
+--                              health_probe *probe: The probe that is due.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Starts the connect of a probe and arms its timeout. Probes connect with the upstream socket
+-- options of the path except fast open, whose connect completes before the backend has answered.
+--------------------------------------------------------------------------------------------------*/
+void healthProbeStart(health_checker *checker, health_probe *probe, const long long nowMs)
+{
+    net_tuning tuning = probe->path->upstreamTuning;
+    struct epoll_event ev;
+
+    tuning.fastopen = -1;
+    probe->connected = false;
+    probe->reading = false;
+    probe->sent = 0;
+    probe->matched = 0;
+
+    if (!createNonBlockingConnectedSocket(&probe->fd, &probe->backend->addr, &tuning))
+    {
+        probe->fd = -1;
+        healthProbeFinish(checker, probe, false, nowMs);
+        return;
+    }
+
+    ev.events = EPOLLOUT;
+    ev.data.ptr = probe;
+    if (epoll_ctl(checker->epfd, EPOLL_CTL_ADD, probe->fd, &ev) == -1)
+    {
+        // not the fault of the backend, try again next interval
+        close(probe->fd);
+        probe->fd = -1;
+        wheelAdd(&checker->wheel, &probe->timer, nowMs + probe->path->healthInterval);
+        return;
+    }
+
+    wheelAdd(&checker->wheel, &probe->timer, nowMs + probe->path->healthTimeout);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthProbeEvent
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthProbeEvent(health_checker *checker, health_probe *probe, const unsigned events, const long long nowMs)
+--                              health_checker *checker: The health check thread.
+--                              health_probe *probe: The probe whose socket had an event.
+--                              const unsigned events: The epoll events of the socket.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Moves a probe along: checks the connect, writes path.healthSend, then reads until the reply
+-- matches path.healthExpect. The reply is compared as it arrives and the probe fails on the first
+-- byte that differs or if the backend closes first.
+--------------------------------------------------------------------------------------------------*/
+void healthProbeEvent(health_checker *checker, health_probe *probe, const unsigned events, const long long nowMs)
+{
+    char buffer[HEALTH_PAYLOAD_SIZE];
+    fwd_path *path = probe->path;
+    struct epoll_event ev;
+    ssize_t n;
+    int err = 0;
+    socklen_t length = sizeof(err);
+
+    if (!probe->connected)
+    {
+        if (getsockopt(probe->fd, SOL_SOCKET, SO_ERROR, &err, &length) == -1 || err != 0)
+        {
+            healthProbeFinish(checker, probe, false, nowMs);
+            return;
+        }
+        probe->connected = true;
+    }
+
+    if (probe->sent < path->healthSendLength)
+    {
+        if ((n = send(probe->fd, path->healthSend + probe->sent, path->healthSendLength - probe->sent, MSG_NOSIGNAL))
+            == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                healthProbeFinish(checker, probe, false, nowMs);
+            }
+            return;
+        }
+        probe->sent += n;
+        if (probe->sent < path->healthSendLength)
+        {
+            return;
+        }
+    }
+
+    if (path->healthExpectLength == 0)
+    {
+        healthProbeFinish(checker, probe, true, nowMs);
+        return;
+    }
+
+    if (!probe->reading)
+    {
+        ev.events = EPOLLIN;
+        ev.data.ptr = probe;
+        if (epoll_ctl(checker->epfd, EPOLL_CTL_MOD, probe->fd, &ev) == -1)
+        {
+            healthProbeFinish(checker, probe, false, nowMs);
+            return;
+        }
+        probe->reading = true;
+        return;
+    }
+
+    if ((n = recv(probe->fd, buffer, path->healthExpectLength - probe->matched, 0)) == -1
+        && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        return;
+    }
+
+    if (n <= 0 || memcmp(buffer, path->healthExpect + probe->matched, n))
+    {
+        healthProbeFinish(checker, probe, false, nowMs);
+        return;
+    }
+
+    probe->matched += n;
+    if (probe->matched == path->healthExpectLength)
+    {
+        healthProbeFinish(checker, probe, true, nowMs);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthProbeFinish
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthProbeFinish(health_checker *checker, health_probe *probe, const bool passed, const long long nowMs)
+--                              health_checker *checker: The health check thread.
+--                              health_probe *probe: The probe that is done.
+--                              const bool passed: Whether the probe passed.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Reports a probe and schedules the next one. The socket is reset rather than closed so probing
+-- does not leave the forwarder with a TIME_WAIT socket for every probe.
+--------------------------------------------------------------------------------------------------*/
+void healthProbeFinish(health_checker *checker, health_probe *probe, const bool passed, const long long nowMs)
+{
+    if (probe->fd != -1)
+    {
+        epoll_ctl(checker->epfd, EPOLL_CTL_DEL, probe->fd, NULL);
+        uwuResetSocket(probe->fd);
+        probe->fd = -1;
+    }
+
+    healthProbed(probe->path, probe->backend, passed, nowMs);
+    wheelAdd(&checker->wheel, &probe->timer, nowMs + probe->path->healthInterval);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthLoad
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthLoad(health_checker *checker, fwd_config *config, const long long nowMs)
+--                              health_checker *checker: The health check thread.
+--                              fwd_config *config: The generation to probe, held by the thread.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Creates a probe for every backend of every path of a generation with health_interval and
+-- schedules its first run at a random point of the interval.
+--------------------------------------------------------------------------------------------------*/
+void healthLoad(health_checker *checker, fwd_config *config, const long long nowMs)
+{
+    fwd_path *path;
+    health_probe *probe;
+    int count = 0;
+
+    checker->config = config;
+    for (int i = 0; i < config->size; i++)
+    {
+        if (config->paths[i].health && config->paths[i].healthInterval)
+        {
+            count += config->paths[i].backendCount;
+        }
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    if ((checker->probes = calloc(count, sizeof(health_probe))) == NULL)
+    {
+        die("calloc");
+    }
+
+    for (int i = 0; i < config->size; i++)
+    {
+        path = config->paths + i;
+        if (!path->health || !path->healthInterval)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < path->backendCount; j++)
+        {
+            probe = checker->probes + checker->probeCount++;
+            probe->path = path;
+            probe->backend = path->backends + j;
+            probe->fd = -1;
+            probe->timer.owner = probe;
+            wheelAdd(&checker->wheel, &probe->timer, nowMs + balanceRandom() % path->healthInterval);
+        }
+    }
+
+    Log("Health checking %d backends", count);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthUnload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthUnload(health_checker *checker)
+--                              health_checker *checker: The health check thread.
+--
+-- NOTES:
+-- Abandons every probe of the generation the thread has been probing.
+--------------------------------------------------------------------------------------------------*/
+void healthUnload(health_checker *checker)
+{
+    for (int i = 0; i < checker->probeCount; i++)
+    {
+        if (checker->probes[i].fd != -1)
+        {
+            epoll_ctl(checker->epfd, EPOLL_CTL_DEL, checker->probes[i].fd, NULL);
+            close(checker->probes[i].fd);
+        }
+        wheelCancel(&checker->wheel, &checker->probes[i].timer);
+    }
+
+    free(checker->probes);
+    checker->probes = NULL;
+    checker->probeCount = 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthReload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void healthReload(health_checker *checker, const long long nowMs)
+--                              health_checker *checker: The health check thread.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Empties the reload eventfd and moves straight to the newest generation, since probing an older
+-- one is of no use to anyone. Unchanged paths keep their health state across the reload, only
+-- their probes start over.
+--------------------------------------------------------------------------------------------------*/
+void healthReload(health_checker *checker, const long long nowMs)
+{
+    uint64_t value;
+    fwd_config *newest = checker->config;
+    fwd_config *next;
+
+    while (read(checker->control, &value, sizeof(value)) == sizeof(value))
+    {
+    }
+
+    while ((next = __atomic_load_n(&newest->newer, __ATOMIC_ACQUIRE)) != NULL)
+    {
+        newest = next;
+    }
+
+    if (newest == checker->config)
+    {
+        return;
+    }
+
+    configAcquire(newest);
+    healthUnload(checker);
+    configRelease(checker->config);
+    healthLoad(checker, newest, nowMs);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *healthThread(void *arg)
+--                              void *arg: The health_checker to run.
+--
+-- RETURNS:                 Never returns.
+--
+-- NOTES:
+-- Event loop of the health checks. A reload is only applied once the whole batch of events has
+-- been handled, since it frees the probes the events point to.
+--------------------------------------------------------------------------------------------------*/
+void *healthThread(void *arg)
+{
+    health_checker *checker = arg;
+    struct epoll_event events[HEALTH_EVENTS];
+    wheel_timer *timer;
+    wheel_timer *next;
+    health_probe *probe;
+    long long nowMs;
+    bool reload;
+    int count;
+
+    while (1)
+    {
+        if ((count = epoll_wait(checker->epfd, events, HEALTH_EVENTS, wheelTimeout(&checker->wheel, monotonicMs())))
+            == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            die("epoll_wait");
+        }
+        nowMs = monotonicMs();
+
+        reload = false;
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.ptr == checker)
+            {
+                reload = true;
+                continue;
+            }
+
+            probe = events[i].data.ptr;
+            if (probe->fd != -1)
+            {
+                healthProbeEvent(checker, probe, events[i].events, nowMs);
+            }
+        }
+
+        for (timer = wheelExpire(&checker->wheel, nowMs); timer; timer = next)
+        {
+            next = timer->next;
+            probe = timer->owner;
+            if (probe->fd == -1)
+            {
+                healthProbeStart(checker, probe, nowMs);
+            }
+            else
+            {
+                healthProbeFinish(checker, probe, false, nowMs);
+            }
+        }
+
+        if (reload)
+        {
+            healthReload(checker, nowMs);
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                healthStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool healthStart(void)
+--
+-- RETURNS:                 True if the health check thread was started, false otherwise.
+--
+-- NOTES:
+-- Starts the thread that probes the backends of the current generation and of every later one.
+-- The control signals must already be blocked so the thread inherits the mask.
+--------------------------------------------------------------------------------------------------*/
+bool healthStart(void)
+{
+    health_checker *checker;
+    pthread_t thread;
+    struct epoll_event ev;
+
+    if ((checker = calloc(1, sizeof(health_checker))) == NULL)
+    {
+        return false;
+    }
+
+    wheelInit(&checker->wheel, monotonicMs());
+    if ((checker->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        free(checker);
+        return false;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = checker;
+    if ((checker->control = configRegister()) == -1
+        || epoll_ctl(checker->epfd, EPOLL_CTL_ADD, checker->control, &ev) == -1)
+    {
+        close(checker->epfd);
+        free(checker);
+        return false;
+    }
+
+    healthLoad(checker, configAcquireCurrent(), monotonicMs());
+    if (pthread_create(&thread, NULL, healthThread, checker))
+    {
+        return false;
+    }
+
+    pthread_detach(thread);
+    return true;
+}
@@ -7,8 +7,23 @@
 --                          void logWithLevel(const char *level, const char *format, va_list args)
 --                          void Log(const char *format, ...)
 --                          void Error(const char *format, ...)
---                          bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort)
+--                          void LogConn(const char *format, ...)
+--                          bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort, const char **rest)
+--                          const char *parseBackend(const char *line, char *addr, int *port)
+--                          bool parseBackends(const char *line, fwd_path *path, const char **rest)
+--                          bool parseNumber(const char *value, const long min, const long max, long *out)
+--                          bool parseOption(const char *key, const char *value, fwd_path *path)
+--                          bool parseTuning(const char *key, const char *value, net_tuning *tuning)
+--                          bool parseOptions(const char *line, fwd_path *path, const char **failed)
+--                          void initPath(fwd_path *path)
 --                          bool fillAddr(struct sockaddr_in *out, const char *address, const int port)
+--                          size_t copyLine(const char **cursor, const char *end, char *buffer)
+--                          void prefetchHosts(const char *data, const size_t size)
+--                          void parseError(const int line, const int column, const char *format, ...)
+--                          int parseConfLine(const char *line, const int number, fwd_path *path)
+--                          int comparePathEntries(const void *a, const void *b)
+--                          int sortPaths(fwd_path *parsed, path_entry *entries, const int count, fwd_path **paths)
+--                          void compilePaths(fwd_path *paths, const int size)
 --                          bool parseConfFileForPaths(fwd_path **paths, int *size)
 --
 -- DATE:                    April 1, 2019
@@ -25,27 +40,53 @@
 ---------------------------------------------------------------------------------------*/
 
 #define CONF_FILE "./forwarder.conf"
-#define LINE_BUFFER_SIZE 64
-#define IP_BUFFER_SIZE 16
+#define LINE_BUFFER_SIZE 4096
+#define CONF_ERROR_LIMIT 20
+#define DEFAULT_POOL_IDLE 60
+#define DEFAULT_CONNECT_TIMEOUT 5000
+#define DEFAULT_UDP_IDLE 30
+#define DEFAULT_QUEUE_LIMIT 262144
+#define DEFAULT_BACKLOG SOMAXCONN
+#define DEFAULT_HEALTH_TIMEOUT 1000
+#define DEFAULT_HEALTH_RISE 2
+#define DEFAULT_HEALTH_COOLDOWN 5000
+#define DEFAULT_MIRROR_BUFFER 65536
 
 #include "io.h"
 
+#include <arpa/inet.h>
 #include <ctype.h>
-#include <netdb.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "acl.h"
+#include "balance.h"
+#include "cache.h"
+#include "health.h"
+#include "limit.h"
+#include "logger.h"
+#include "net.h"
+#include "reload.h"
 #include "res.h"
+#include "resolve.h"
 
+// errors of the file being parsed and whether its table may be written to the cache
+static int parseErrors;
+static bool parseCacheable;
 
 /*---------------------------------------------------------------------------------------
 -- FUNCTION:                logWithLevel
 --
 -- DATE:                    April 1, 2019
 --
--- REVISIONS:               N/A
+-- REVISIONS:               October 17, 2026 - Lock stdout for the whole line.
+--                          October 17, 2026 - Hand the line to the asynchronous logger.
 --
 -- DESIGNER:                Benny Wang
 --
@@ -57,19 +98,12 @@
 --                              va_list args: Arguments fitting the string literal.
 --
 -- NOTES:
--- Generic logging function that prepends timestamp and severity level to logging message.
+-- Generic logging function that prepends timestamp and severity level to logging message. The
+-- line is handed to the logging backend in logger.c which writes it out.
 ---------------------------------------------------------------------------------------*/
 void logWithLevel(const char *level, const char *format, va_list args)
 {
-    char timestamp[100];
-    time_t now = time(NULL);
-    struct tm *t = localtime(&now);
-    strftime(timestamp, sizeof(timestamp) - 1, "%d/%m/%Y-%H:%M:%S", t);
-    printf("[ %s ] [%s] ", timestamp, level);
-
-    vprintf(format, args);
-
-    printf("\n");
+    logSubmit(level, format, args);
 }
 
 /*---------------------------------------------------------------------------------------
@@ -124,149 +158,203 @@ void Error(const char *format, ...)
     va_end(args);
 }
 
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                LogConn
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void LogConn(const char *format, ...)
+--                              const char *format: String literal to print.
+--                              ...: List of arguements fitting the provided string literal.
+--
+-- NOTES:
+-- Logs a message about a single connection with a normal serverity. These are the messages that
+-- flood the log under load, so they are subject to the -l rate limit.
+---------------------------------------------------------------------------------------*/
+void LogConn(const char *format, ...)
+{
+    va_list args;
+
+    if (!logConnAllowed())
+    {
+        return;
+    }
+
+    va_start(args, format);
+    logWithLevel("  LOG  ", format, args);
+    va_end(args);
+}
+
 /*---------------------------------------------------------------------------------------
 -- FUNCTION:                parseLine
 --
 -- DATE:                    April 1, 2019
 --
--- REVISIONS:               N/A
+-- REVISIONS:               October 17, 2026 - Return the rest of the line for the path options.
+--                          October 17, 2026 - Accept host names, bounded by HOST_BUFFER_SIZE.
+--                          October 17, 2026 - Parse both sides with parseBackend and point rest
+--                                             at the error on failure.
 --
 -- DESIGNER:                Benny Wang
 --
 -- PROGRAMMER:              Benny Wang
 --
--- INTERFACE:               bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort)
+-- INTERFACE:               bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort, const char **rest)
 --                              const char *line: The line to parse.
 --                              char *inAddr: Pointer to where the incoming address string will be placed.
 --                              int *inPort: Pointer to where the incoming port will be placed.
 --                              char *outAddr: Pointer to where the outgoing address string will be placed.
 --                              int *outPort: Pointer to where the outgoing port will be placed.
+--                              const char **rest: Pointer to where the start of the options will be placed.
 --
 -- RETURNS:                 True if the line was successfully parsed, false otherwise.
 --
 -- NOTES:
 -- Parses a line with the format "adress:port -> address:port". This function does not
 -- tolerate any error in the line format and will return false if the format is not met
--- exactly. Addresses must be in dotted decimal format.
+-- exactly, with rest pointing at the part of the line that is wrong. Addresses may be dotted
+-- decimal or host names. Anything after the outgoing port is left for parseOptions.
 ---------------------------------------------------------------------------------------*/
-bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort)
+bool parseLine(const char *line, char *inAddr, int *inPort, char *outAddr, int *outPort, const char **rest)
 {
     const char *delim = " -> ";
     const int delimSize = 4;
-    char portBuffer[6];
-    int i;
-    int j;
-    int secondIpStart;
-
-    bzero(portBuffer, 6);
+    const char *end;
 
-    for (i = 0; line[i] != 0; i++)
+    *rest = line;
+    if ((end = parseBackend(line, inAddr, inPort)) == NULL)
     {
-        if (line[i] == delim[0])
-        {
-            // compare to see if the delim has been found
-            for (j = 1; j < delimSize; j++)
-            {
-                if (line[i + j] != delim[j])
-                {
-                    // invalid format - delim mismatch
-                    return false;
-                }
-            }
-
-            if (j == delimSize)
-            {
-                // start of second ip has been found
-                secondIpStart = i + 4;
-                break;
-            }
-            else
-            {
-                // invalid format
-                return false;
-            }
-        }
+        return false;
     }
 
-    if (line[i] == 0)
+    *rest = end;
+    if (strncmp(end, delim, delimSize))
     {
-        // invalid format - delim was not found
+        // invalid format - delim mismatch
         return false;
     }
 
-    // grab first ip
-    for (j = 0; line[j] != ':'; j++)
+    *rest = end + delimSize;
+    if ((end = parseBackend(end + delimSize, outAddr, outPort)) == NULL)
     {
-        inAddr[j] = line[j];
+        return false;
     }
-    inAddr[j] = 0;
-    j++;
 
-    // extract port as a number
-    for (i = 0; isdigit(line[j]); i++, j++)
+    *rest = end;
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseBackend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Reject empty addresses, blanks in addresses and ports
+--                                             outside 1 to 65535.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               const char *parseBackend(const char *line, char *addr, int *port)
+--                              const char *line: The text right after the comma of a backend.
+--                              char *addr: Pointer to where the address string will be placed.
+--                              int *port: Pointer to where the port will be placed.
+--
+-- RETURNS:                 The text after the port, NULL if line does not start with address:port.
+---------------------------------------------------------------------------------------*/
+const char *parseBackend(const char *line, char *addr, int *port)
+{
+    char portBuffer[6];
+    int i;
+
+    // grab the address
+    for (i = 0; line[i] != ':'; i++)
     {
-        portBuffer[i] = line[j];
+        if (line[i] == 0 || line[i] == ',' || isspace((unsigned char)line[i]) || i == HOST_BUFFER_SIZE - 1)
+        {
+            return NULL;
+        }
+        addr[i] = line[i];
     }
-    portBuffer[i] = 0;
-    *inPort = atoi(portBuffer);
-
-    // grab second ip
-    for (j = 0; line[j + secondIpStart] != ':'; j++)
+    if (i == 0)
     {
-        outAddr[j] = line[j + secondIpStart];
+        return NULL;
     }
-    outAddr[j] = 0;
-    j++;
+    addr[i] = 0;
+    line += i + 1;
 
     // extract port as a number
-    for (i = 0; isdigit(line[j + secondIpStart]); i++, j++)
+    for (i = 0; isdigit(line[i]) && i < 5; i++)
     {
-        portBuffer[i] = line[j + secondIpStart];
+        portBuffer[i] = line[i];
     }
     portBuffer[i] = 0;
-    *outPort = atoi(portBuffer);
+    *port = atoi(portBuffer);
 
-    return true;
+    return i == 0 || isdigit(line[i]) || *port < 1 || *port > 65535 ? NULL : line + i;
 }
 
 /*---------------------------------------------------------------------------------------
--- FUNCTION:                fillAddr
+-- FUNCTION:                parseBackends
 --
--- DATE:                    April 1, 2019
+-- DATE:                    October 17, 2026
 --
--- REVISIONS:               N/A
+-- REVISIONS:               October 17, 2026 - Split the parsing of one backend into parseBackend.
+--                          October 17, 2026 - Point rest at the backend that failed.
 --
 -- DESIGNER:                Benny Wang
 --
 -- PROGRAMMER:              Benny Wang
 --
--- INTERFACE:               bool fillAddr(struct sockaddr_in *out, const char *address, const int port)
---                              struct sockaddr_in *out: Pointer to the struct to fill.
---                              const char *address: The address string to parse.
---                              const int port: The desired port to parse.
+-- INTERFACE:               bool parseBackends(const char *line, fwd_path *path, const char **rest)
+--                              const char *line: The rest of the line after the first outgoing port.
+--                              fwd_path *path: The path to add the backends to.
+--                              const char **rest: Pointer to where the start of the options, or the
+--                                                 backend that could not be read, will be placed.
 --
--- RETURNS:                 True if the struct was filled, false otherwise.
+-- RETURNS:                 True if every additional backend was parsed and resolved, false otherwise.
 --
 -- NOTES:
--- Sets the given sockaddr_in to an internet struct with the given address and port.
+-- Parses the additional backends of a line like "address:port -> address:port,address:port". Each
+-- one follows the previous backend's port after a comma, without spaces.
 ---------------------------------------------------------------------------------------*/
-bool fillAddr(struct sockaddr_in *out, const char *address, const int port)
+bool parseBackends(const char *line, fwd_path *path, const char **rest)
 {
-    struct hostent *hp;
-    out->sin_family = AF_INET;
-    out->sin_port = htons(port);
-    if ((hp = gethostbyname(address)) == NULL)
+    char addrBuffer[HOST_BUFFER_SIZE];
+    int port;
+    struct sockaddr_in addr;
+    const char *next;
+
+    while (*line == ',')
     {
-        return false;
+        *rest = line + 1;
+        if ((next = parseBackend(line + 1, addrBuffer, &port)) == NULL || !fillAddr(&addr, addrBuffer, port))
+        {
+            return false;
+        }
+
+        if (!addBackend(path, &addr))
+        {
+            die("realloc");
+        }
+        line = next;
     }
-    bcopy(hp->h_addr_list[0], (char *)&out->sin_addr, hp->h_length);
+
+    *rest = line;
     return true;
 }
 
 /*---------------------------------------------------------------------------------------
--- FUNCTION:                parseConfFileForPaths
+-- FUNCTION:                parseNumber
 --
--- DATE:                    April 1, 2019
+-- DATE:                    October 17, 2026
 --
 -- REVISIONS:               N/A
 --
@@ -274,110 +362,1000 @@ bool fillAddr(struct sockaddr_in *out, const char *address, const int port)
 --
 -- PROGRAMMER:              Benny Wang
 --
--- INTERFACE:               bool parseConfFileForPaths(fwd_path **paths, int *size)
---                              fwd_path **paths: Pointer to the array of paths structs.
---                              int *size: Pointer to the size of the fwd_path array.
+-- INTERFACE:               bool parseNumber(const char *value, const long min, const long max, long *out)
+--                              const char *value: The string to parse.
+--                              const long min: The smallest accepted value.
+--                              const long max: The largest accepted value.
+--                              long *out: Pointer to where the number will be placed.
 --
--- RETURNS:                 True if the file was parsed, false otherwise.
+-- RETURNS:                 True if value is a decimal number between min and max, false otherwise.
+---------------------------------------------------------------------------------------*/
+bool parseNumber(const char *value, const long min, const long max, long *out)
+{
+    char *end;
+
+    errno = 0;
+    *out = strtol(value, &end, 10);
+
+    return errno == 0 && end != value && *end == 0 && *out >= min && *out <= max;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseOption
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Added the allow, deny and acl options.
+--                          October 17, 2026 - Added the proto and udp_idle options.
+--                          October 17, 2026 - Added the queue option.
+--                          October 17, 2026 - Added the rate, client_rate, conn_rate and client_conn_rate options.
+--                          October 17, 2026 - Added the backlog and defer_accept options and the socket options.
+--                          October 17, 2026 - Added the idle_timeout and max_lifetime options.
+--                          October 17, 2026 - Added the health check options.
+--                          October 17, 2026 - Added the mirror options.
+--                          October 17, 2026 - Added the tcp_info option.
+--                          October 17, 2026 - Keep paths with an acl file out of the binary cache.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool parseOption(const char *key, const char *value, fwd_path *path)
+--                              const char *key: The name of the option.
+--                              const char *value: The value of the option.
+--                              fwd_path *path: The path the option applies to.
+--
+-- RETURNS:                 True if the option is known and its value is valid, false otherwise.
 --
 -- NOTES:
--- Given a pointer for the destination and size of a fwd_path array and a file, this
--- function will parse all the linse of the file following the format "address:port -> address:port"
--- and place them in the paths variable and set size to the size of paths.
+-- Applies a single key=value path option. The known options are:
+--     pool=N          keep N pre-connected upstream sockets per worker
+--     pool_idle=S     discard pooled sockets that have been idle for S seconds
+--     lb=rr|lc|hash   how clients are spread over the backends of the path
+--     connect_timeout=MS  give up connecting to the backends after MS milliseconds
+--     allow=CIDR,...  admit clients from these prefixes
+--     deny=CIDR,...   refuse clients from these prefixes
+--     acl=FILE        read allow and deny rules from FILE
+--     proto=tcp|udp   whether the path forwards connections or datagrams
+--     udp_idle=S      close UDP flows that have been idle for S seconds
+--     idle_timeout=S  close TCP connections that have been idle for S seconds, 0 for never
+--     max_lifetime=S  close TCP connections S seconds after they were accepted, 0 for never
+--     queue=BYTES     stop reading from a side once BYTES are queued for the other
+--     rate=BYTES      forward at most BYTES per second in each direction over the path
+--     client_rate=BYTES   forward at most BYTES per second in each direction per client address
+--     conn_rate=N     accept at most N connections per second on the path
+--     client_conn_rate=N  accept at most N connections per second per client address
+--     backlog=N       the length of the accept queue of the listening sockets
+--     defer_accept=S  only accept a connection once the client has sent data, waiting up to S seconds
+--     health_interval=MS  probe every backend every MS milliseconds, 0 for never
+--     health_timeout=MS   fail a probe that has not passed after MS milliseconds
+--     health_send=TEXT    write TEXT once a probe has connected
+--     health_expect=TEXT  pass a probe only once the reply has started with TEXT
+--     health_fall=N   open the circuit of a backend after N failures in a row
+--     health_rise=N   close the circuit of a backend after N passing probes in a row
+--     health_cooldown=MS  let a trial connection through an open circuit after MS milliseconds
+--     mirror=ADDR:PORT    send a copy of what is relayed to ADDR:PORT, one connection per direction
+--     mirror_direction=upstream|client|both  which directions are mirrored
+--     mirror_buffer=BYTES hold at most BYTES for a mirror, what does not fit is dropped
+--     tcp_info=MS     sample TCP_INFO of both sides every MS milliseconds, 0 for only at close
+-- and the socket options read by parseTuning, which apply to both sides of the path or, prefixed
+-- with client_ or upstream_, to one side only.
 ---------------------------------------------------------------------------------------*/
-bool parseConfFileForPaths(fwd_path **paths, int *size)
+bool parseOption(const char *key, const char *value, fwd_path *path)
 {
-    FILE *confFile;
-    char lineBuffer[LINE_BUFFER_SIZE];
-    char inIp[IP_BUFFER_SIZE];
-    char outIp[IP_BUFFER_SIZE];
-    int inPort;
-    int outPort;
-    unsigned int limit;
-    fwd_path tmp;
+    long number;
+    char host[HOST_BUFFER_SIZE];
+    int port;
+    const char *end;
 
-    Log("Opening conf file: %s", CONF_FILE);
-    if ((confFile = fopen(CONF_FILE, "r")) == NULL)
+    if (!strcmp(key, "pool"))
     {
-        Error("Could not open: %s", CONF_FILE);
-        return false;
+        if (!parseNumber(value, 0, 65536, &number))
+        {
+            return false;
+        }
+        path->poolSize = number;
     }
-
-    Log("Parsing log file");
-    limit = 1;
-    *size = 0;
-    if ((*paths = malloc(sizeof(fwd_path) * limit)) == NULL)
+    else if (!strcmp(key, "pool_idle"))
     {
-        Error("Could not allocate memory");
-        die("malloc");
+        if (!parseNumber(value, 1, 86400, &number))
+        {
+            return false;
+        }
+        path->poolIdle = number;
     }
-    while (true)
+    else if (!strcmp(key, "connect_timeout"))
     {
-        // clear buffers
-        bzero(&tmp, sizeof(fwd_path));
-        bzero(inIp, IP_BUFFER_SIZE);
-        bzero(outIp, IP_BUFFER_SIZE);
-
-        // extract line
-        if (!fgets(lineBuffer, LINE_BUFFER_SIZE, confFile))
+        if (!parseNumber(value, 1, 600000, &number))
         {
-            // break if eof or read errr occurs
-            break;
+            return false;
         }
-
-        // parse the line that was read
-        if (!parseLine(lineBuffer, inIp, &inPort, outIp, &outPort))
+        path->connectTimeout = number;
+    }
+    else if (!strcmp(key, "udp_idle"))
+    {
+        if (!parseNumber(value, 1, 86400, &number))
         {
-            Error("Could not read line, skipping");
-            continue;
+            return false;
+        }
+        path->udpIdle = number;
+    }
+    else if (!strcmp(key, "idle_timeout") || !strcmp(key, "max_lifetime"))
+    {
+        if (!parseNumber(value, 0, 864000, &number))
+        {
+            return false;
+        }
+        *(key[0] == 'i' ? &path->idleTimeout : &path->maxLifetime) = number;
+    }
+    else if (!strcmp(key, "queue"))
+    {
+        if (!parseNumber(value, 4096, 67108864, &number))
+        {
+            return false;
         }
+        path->queueLimit = number;
+    }
+    else if (!strcmp(key, "rate") || !strcmp(key, "client_rate"))
+    {
+        if (!parseNumber(value, 1024, 1L << 40, &number))
+        {
+            return false;
+        }
+        *(!strcmp(key, "rate") ? &path->rate : &path->clientRate) = number;
+    }
+    else if (!strcmp(key, "conn_rate") || !strcmp(key, "client_conn_rate"))
+    {
+        if (!parseNumber(value, 1, 1000000, &number))
+        {
+            return false;
+        }
+        *(!strcmp(key, "conn_rate") ? &path->connRate : &path->clientConnRate) = number;
+    }
+    else if (!strcmp(key, "backlog"))
+    {
+        if (!parseNumber(value, 1, 65535, &number))
+        {
+            return false;
+        }
+        path->backlog = number;
+    }
+    else if (!strcmp(key, "defer_accept"))
+    {
+        if (!parseNumber(value, 0, 3600, &number))
+        {
+            return false;
+        }
+        path->clientTuning.deferAccept = number;
+    }
+    else if (!strcmp(key, "health_interval"))
+    {
+        if (!parseNumber(value, 0, 3600000, &number))
+        {
+            return false;
+        }
+        path->healthInterval = number;
+    }
+    else if (!strcmp(key, "health_timeout") || !strcmp(key, "health_cooldown"))
+    {
+        if (!parseNumber(value, 1, 3600000, &number))
+        {
+            return false;
+        }
+        *(!strcmp(key, "health_timeout") ? &path->healthTimeout : &path->healthCooldown) = number;
+    }
+    else if (!strcmp(key, "health_fall") || !strcmp(key, "health_rise"))
+    {
+        if (!parseNumber(value, 1, 1000, &number))
+        {
+            return false;
+        }
+        *(!strcmp(key, "health_fall") ? &path->healthFall : &path->healthRise) = number;
+    }
+    else if (!strcmp(key, "health_send"))
+    {
+        return healthParsePayload(value, path->healthSend, &path->healthSendLength);
+    }
+    else if (!strcmp(key, "health_expect"))
+    {
+        return healthParsePayload(value, path->healthExpect, &path->healthExpectLength);
+    }
+    else if (!strcmp(key, "mirror"))
+    {
+        if ((end = parseBackend(value, host, &port)) == NULL || *end || !fillAddr(&path->mirror, host, port))
+        {
+            return false;
+        }
+        path->mirrored = true;
+    }
+    else if (!strcmp(key, "mirror_direction"))
+    {
+        if (!strcmp(value, "upstream"))
+        {
+            path->mirrorDirections = MIRROR_UPSTREAM;
+        }
+        else if (!strcmp(value, "client"))
+        {
+            path->mirrorDirections = MIRROR_CLIENT;
+        }
+        else if (!strcmp(value, "both"))
+        {
+            path->mirrorDirections = MIRROR_UPSTREAM | MIRROR_CLIENT;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (!strcmp(key, "mirror_buffer"))
+    {
+        if (!parseNumber(value, 4096, 1048576, &number))
+        {
+            return false;
+        }
+        path->mirrorBuffer = number;
+    }
+    else if (!strcmp(key, "tcp_info"))
+    {
+        if (!parseNumber(value, 0, 3600000, &number))
+        {
+            return false;
+        }
+        path->tcpInfo = true;
+        path->tcpInfoInterval = number;
+    }
+    else if (!strcmp(key, "proto"))
+    {
+        if (strcmp(value, "tcp") && strcmp(value, "udp"))
+        {
+            return false;
+        }
+        path->udp = !strcmp(value, "udp");
+    }
+    else if (!strcmp(key, "lb"))
+    {
+        if (!strcmp(value, "rr"))
+        {
+            path->policy = LB_ROUND_ROBIN;
+        }
+        else if (!strcmp(value, "lc"))
+        {
+            path->policy = LB_LEAST_CONN;
+        }
+        else if (!strcmp(value, "hash"))
+        {
+            path->policy = LB_HASH;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (!strcmp(key, "allow") || !strcmp(key, "deny"))
+    {
+        return aclParseList(path, value, !strcmp(key, "allow"));
+    }
+    else if (!strcmp(key, "acl"))
+    {
+        // the rules of a file are not part of the cache key
+        parseCacheable = false;
+        return aclLoad(path, value);
+    }
+    else if (!strncmp(key, "client_", 7))
+    {
+        return parseTuning(key + 7, value, &path->clientTuning);
+    }
+    else if (!strncmp(key, "upstream_", 9))
+    {
+        return parseTuning(key + 9, value, &path->upstreamTuning);
+    }
+    else
+    {
+        return parseTuning(key, value, &path->clientTuning) && parseTuning(key, value, &path->upstreamTuning);
+    }
+
+    return true;
+}
 
-        Log("Scanned %s:%d -> %s:%d", inIp, inPort, outIp, outPort);
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseTuning
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool parseTuning(const char *key, const char *value, net_tuning *tuning)
+--                              const char *key: The name of the option without its side prefix.
+--                              const char *value: The value of the option.
+--                              net_tuning *tuning: The socket options of one side of a path.
+--
+-- RETURNS:                 True if the option is known and its value is valid, false otherwise.
+--
+-- NOTES:
+-- Applies a single socket option. The known options are:
+--     nodelay=on|off  TCP_NODELAY
+--     quickack=on|off TCP_QUICKACK
+--     rcvbuf=BYTES    SO_RCVBUF
+--     sndbuf=BYTES    SO_SNDBUF
+--     fastopen=N      TCP_FASTOPEN with a queue of N on the client side, TCP_FASTOPEN_CONNECT
+--                     upstream if N is not 0
+--     keepalive=IDLE,INTERVAL,COUNT  SO_KEEPALIVE with TCP_KEEPIDLE, TCP_KEEPINTVL and TCP_KEEPCNT
+--     notsent_lowat=BYTES  TCP_NOTSENT_LOWAT
+--     congestion=NAME TCP_CONGESTION
+---------------------------------------------------------------------------------------*/
+bool parseTuning(const char *key, const char *value, net_tuning *tuning)
+{
+    long number;
+    int end = 0;
 
-        // populate the addr struct for incoming
-        if (!fillAddr(&(tmp.in), inIp, inPort))
+    if (!strcmp(key, "nodelay") || !strcmp(key, "quickack"))
+    {
+        if (strcmp(value, "on") && strcmp(value, "off"))
         {
-            Error("Could not get host for %s, skipping", inIp);
+            return false;
         }
-
-        // populate the addr struct for outgoing
-        if (!fillAddr(&(tmp.out), outIp, outPort))
+        *(!strcmp(key, "nodelay") ? &tuning->nodelay : &tuning->quickack) = !strcmp(value, "on");
+    }
+    else if (!strcmp(key, "rcvbuf") || !strcmp(key, "sndbuf") || !strcmp(key, "notsent_lowat"))
+    {
+        if (!parseNumber(value, 1, 1 << 30, &number))
         {
-            Error("Could not get host for %s, skipping", outPort);
+            return false;
         }
-
-        // resize array if needed
-        if (*size < limit)
+        if (!strcmp(key, "rcvbuf"))
+        {
+            tuning->rcvbuf = number;
+        }
+        else if (!strcmp(key, "sndbuf"))
         {
-            bcopy(&tmp, *paths + *size, sizeof(fwd_path));
-            (*size)++;
+            tuning->sndbuf = number;
         }
         else
         {
-            limit *= 2;
-            if ((*paths = realloc(*paths, sizeof(fwd_path) * limit)) == NULL)
-            {
-                Error("Could not allocate memory");
-                die("realloc");
-            }
-            bcopy(&tmp, *paths + *size, sizeof(fwd_path));
-            (*size)++;
+            tuning->notsentLowat = number;
         }
     }
-
-    Log("Closing conf file: %s", CONF_FILE);
-    if (fclose(confFile))
+    else if (!strcmp(key, "fastopen"))
+    {
+        if (!parseNumber(value, 0, 65535, &number))
+        {
+            return false;
+        }
+        tuning->fastopen = number;
+    }
+    else if (!strcmp(key, "keepalive"))
     {
-        Error("Could not close: %s", CONF_FILE);
+        return sscanf(value, "%d,%d,%d%n", &tuning->keepIdle, &tuning->keepInterval, &tuning->keepCount, &end) == 3
+               && value[end] == 0 && tuning->keepIdle > 0 && tuning->keepIdle <= 32767 && tuning->keepInterval > 0
+               && tuning->keepInterval <= 32767 && tuning->keepCount > 0 && tuning->keepCount <= 127;
     }
-    Log("Finished parsing log file");
-
-    // resize the array to be the exact size
-    if ((*paths = realloc(*paths, sizeof(fwd_path) * (*size))) == NULL)
+    else if (!strcmp(key, "congestion"))
     {
-        Error("Could not allocate memory");
-        die("realloc");
+        if (strlen(value) == 0 || strlen(value) >= TCP_CA_NAME_MAX)
+        {
+            return false;
+        }
+        strcpy(tuning->congestion, value);
+    }
+    else
+    {
+        return false;
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseOptions
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Walk the line in place and point failed at the option
+--                                             that was rejected.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool parseOptions(const char *line, fwd_path *path, const char **failed)
+--                              const char *line: The rest of the line after the outgoing port.
+--                              fwd_path *path: The path the options apply to.
+--                              const char **failed: Pointer to where the rejected option will be placed.
+--
+-- RETURNS:                 True if every option was applied, false otherwise.
+--
+-- NOTES:
+-- Parses the whitespace separated key=value options that may follow "address:port -> address:port".
+---------------------------------------------------------------------------------------*/
+bool parseOptions(const char *line, fwd_path *path, const char **failed)
+{
+    char key[LINE_BUFFER_SIZE];
+    char value[LINE_BUFFER_SIZE];
+    const char *equals;
+    size_t length;
+
+    for (line += strspn(line, " \t\r\n"); *line; line += strspn(line, " \t\r\n"))
+    {
+        *failed = line;
+        length = strcspn(line, " \t\r\n");
+        if ((equals = memchr(line, '=', length)) == NULL)
+        {
+            return false;
+        }
+
+        memcpy(key, line, equals - line);
+        key[equals - line] = 0;
+        memcpy(value, equals + 1, length - (equals - line) - 1);
+        value[length - (equals - line) - 1] = 0;
+
+        if (!parseOption(key, value, path))
+        {
+            return false;
+        }
+        line += length;
+    }
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                initPath
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Default the queue option.
+--                          October 17, 2026 - Set the default backlog and socket options.
+--                          October 17, 2026 - Default the health check options.
+--                          October 17, 2026 - Default the mirror options.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void initPath(fwd_path *path)
+--                              fwd_path *path: The path to initialize.
+--
+-- NOTES:
+-- Clears a path and sets every option to its default.
+---------------------------------------------------------------------------------------*/
+void initPath(fwd_path *path)
+{
+    bzero(path, sizeof(fwd_path));
+    path->poolIdle = DEFAULT_POOL_IDLE;
+    path->connectTimeout = DEFAULT_CONNECT_TIMEOUT;
+    path->udpIdle = DEFAULT_UDP_IDLE;
+    path->queueLimit = DEFAULT_QUEUE_LIMIT;
+    path->backlog = DEFAULT_BACKLOG;
+    path->healthTimeout = DEFAULT_HEALTH_TIMEOUT;
+    path->healthRise = DEFAULT_HEALTH_RISE;
+    path->healthCooldown = DEFAULT_HEALTH_COOLDOWN;
+    path->mirrorDirections = MIRROR_UPSTREAM;
+    path->mirrorBuffer = DEFAULT_MIRROR_BUFFER;
+    uwuInitTuning(&path->clientTuning);
+    uwuInitTuning(&path->upstreamTuning);
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                fillAddr
+--
+-- DATE:                    April 1, 2019
+--
+-- REVISIONS:               October 17, 2026 - Look the address up in the resolver cache.
+--                          October 17, 2026 - Note host names for the binary cache.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool fillAddr(struct sockaddr_in *out, const char *address, const int port)
+--                              struct sockaddr_in *out: Pointer to the struct to fill.
+--                              const char *address: The address string to parse.
+--                              const int port: The desired port to parse.
+--
+-- RETURNS:                 True if the struct was filled, false otherwise.
+--
+-- NOTES:
+-- Sets the given sockaddr_in to an internet struct with the given address and port. Host names
+-- collected by prefetchHosts are answered from the resolver cache, others are resolved here. A host
+-- name keeps the table being parsed out of the binary cache.
+---------------------------------------------------------------------------------------*/
+bool fillAddr(struct sockaddr_in *out, const char *address, const int port)
+{
+    bzero(out, sizeof(struct sockaddr_in));
+    out->sin_family = AF_INET;
+    out->sin_port = htons(port);
+    if (inet_pton(AF_INET, address, &out->sin_addr) == 1)
+    {
+        return true;
+    }
+
+    // a resolved name may change, so the table is not cached
+    parseCacheable = false;
+    return hostLookup(address, &out->sin_addr);
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                copyLine
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               size_t copyLine(const char **cursor, const char *end, char *buffer)
+--                              const char **cursor: The start of the line, moved to the next one.
+--                              const char *end: The end of the mapped file.
+--                              char *buffer: A LINE_BUFFER_SIZE buffer for the line.
+--
+-- RETURNS:                 The length of the line without its newline. Lines of LINE_BUFFER_SIZE
+--                          or more are cut short in buffer.
+--
+-- NOTES:
+-- Copies one line of the mapped configuration file into buffer as a string, without the newline
+-- and the carriage return of files written on Windows.
+---------------------------------------------------------------------------------------*/
+size_t copyLine(const char **cursor, const char *end, char *buffer)
+{
+    const char *newline = memchr(*cursor, '\n', end - *cursor);
+    size_t length = (newline ? newline : end) - *cursor;
+    size_t copied = length < LINE_BUFFER_SIZE ? length : LINE_BUFFER_SIZE - 1;
+
+    memcpy(buffer, *cursor, copied);
+    buffer[copied] = 0;
+    if (copied > 0 && buffer[copied - 1] == '\r')
+    {
+        buffer[copied - 1] = 0;
+    }
+
+    *cursor = newline ? newline + 1 : end;
+    return length;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                prefetchHosts
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Read the lines from the mapped file.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void prefetchHosts(const char *data, const size_t size)
+--                              const char *data: The mapped configuration file.
+--                              const size_t size: The size of the file.
+--
+-- NOTES:
+-- Collects every address of every line and resolves the host names among them in parallel with
+-- hostsResolve, so the file can then be parsed against the warm cache. Lines that do not parse are
+-- left for parseConfFileForPaths to report.
+---------------------------------------------------------------------------------------*/
+void prefetchHosts(const char *data, const size_t size)
+{
+    char lineBuffer[LINE_BUFFER_SIZE];
+    char inHost[HOST_BUFFER_SIZE];
+    char outHost[HOST_BUFFER_SIZE];
+    int inPort;
+    int outPort;
+    const char *cursor = data;
+    const char *rest;
+
+    hostsBegin();
+    while (cursor < data + size)
+    {
+        copyLine(&cursor, data + size, lineBuffer);
+        if (!parseLine(lineBuffer + strspn(lineBuffer, " \t"), inHost, &inPort, outHost, &outPort, &rest))
+        {
+            continue;
+        }
+
+        hostAdd(inHost);
+        hostAdd(outHost);
+        while (*rest == ',' && (rest = parseBackend(rest + 1, outHost, &outPort)) != NULL)
+        {
+            hostAdd(outHost);
+        }
+    }
+
+    hostsResolve();
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseError
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void parseError(const int line, const int column, const char *format, ...)
+--                              const int line: The line of the error, from 1.
+--                              const int column: The column of the error, from 1.
+--                              const char *format: The printf format of the message.
+--
+-- NOTES:
+-- Counts an error of the configuration file and logs it as "file:line:column: message". Only the
+-- first CONF_ERROR_LIMIT errors are logged so a broken generated file does not flood the log.
+---------------------------------------------------------------------------------------*/
+void parseError(const int line, const int column, const char *format, ...)
+{
+    char message[LINE_BUFFER_SIZE];
+    va_list args;
+
+    if (parseErrors++ >= CONF_ERROR_LIMIT)
+    {
+        return;
+    }
+
+    va_start(args, format);
+    vsnprintf(message, LINE_BUFFER_SIZE, format, args);
+    va_end(args);
+    Error("%s:%d:%d: %s", CONF_FILE, line, column, message);
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseConfLine
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int parseConfLine(const char *line, const int number, fwd_path *path)
+--                              const char *line: The line to parse.
+--                              const int number: The number of the line, for the errors.
+--                              fwd_path *path: The path to fill.
+--
+-- RETURNS:                 1 if path was filled, 0 for a blank or comment line and -1 if the line
+--                          has an error.
+--
+-- NOTES:
+-- Parses one line of the configuration file: the incoming and outgoing address, the additional
+-- backends and the options. Lines starting with # are comments. An error is reported with
+-- parseError at the column where the line stopped making sense, and whatever was set up for the
+-- path is freed.
+---------------------------------------------------------------------------------------*/
+int parseConfLine(const char *line, const int number, fwd_path *path)
+{
+    char inHost[HOST_BUFFER_SIZE];
+    char outHost[HOST_BUFFER_SIZE];
+    int inPort;
+    int outPort;
+    const char *start = line + strspn(line, " \t");
+    const char *rest;
+
+    if (*start == 0 || *start == '#')
+    {
+        return 0;
+    }
+
+    initPath(path);
+    if (!parseLine(start, inHost, &inPort, outHost, &outPort, &rest))
+    {
+        parseError(number, rest - line + 1, "Expected address:port -> address:port");
+        return -1;
+    }
+
+    if (!fillAddr(&path->in, inHost, inPort))
+    {
+        parseError(number, start - line + 1, "Could not get host for %s", inHost);
+        return -1;
+    }
+    inet_ntop(AF_INET, &path->in.sin_addr, path->inName, INET_ADDRSTRLEN);
+
+    if (!fillAddr(&path->out, outHost, outPort))
+    {
+        parseError(number, strstr(start, " -> ") + 4 - line + 1, "Could not get host for %s", outHost);
+        return -1;
+    }
+
+    // the first outgoing address is the first backend, any others follow it
+    if (!addBackend(path, &path->out))
+    {
+        die("realloc");
+    }
+
+    if (!parseBackends(rest, path, &rest))
+    {
+        parseError(number, rest - line + 1, "Invalid or unresolved backend %.*s", (int)strcspn(rest, ", \t"), rest);
+        pathFree(path);
+        return -1;
+    }
+
+    if (!parseOptions(rest, path, &rest))
+    {
+        parseError(number, rest - line + 1, "Invalid option %.*s", (int)strcspn(rest, " \t"), rest);
+        pathFree(path);
+        return -1;
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                comparePathEntries
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int comparePathEntries(const void *a, const void *b)
+--                              const void *a: A path_entry.
+--                              const void *b: Another path_entry.
+--
+-- RETURNS:                 Less than, equal to or more than 0 as a sorts before, with or after b.
+--
+-- NOTES:
+-- Orders the paths by protocol, port and incoming address, and the same path by line.
+---------------------------------------------------------------------------------------*/
+int comparePathEntries(const void *a, const void *b)
+{
+    const path_entry *first = a;
+    const path_entry *second = b;
+
+    if (first->key != second->key)
+    {
+        return first->key < second->key ? -1 : 1;
+    }
+    return first->line - second->line;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                sortPaths
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int sortPaths(fwd_path *parsed, path_entry *entries, const int count, fwd_path **paths)
+--                              fwd_path *parsed: The paths in the order of the file.
+--                              path_entry *entries: The key and line of every parsed path.
+--                              const int count: The number of parsed paths.
+--                              fwd_path **paths: Pointer to where the table will be placed.
+--
+-- RETURNS:                 The number of paths in the table.
+--
+-- NOTES:
+-- Builds the path table: the parsed paths sorted by protocol, port and incoming address, with one
+-- path for each of them. When a path is listed more than once the last line wins and the others
+-- are freed. The table is allocated to its exact size, or to one path when it is empty.
+---------------------------------------------------------------------------------------*/
+int sortPaths(fwd_path *parsed, path_entry *entries, const int count, fwd_path **paths)
+{
+    int size = 0;
+
+    qsort(entries, count, sizeof(path_entry), comparePathEntries);
+    for (int i = 0; i + 1 < count; i++)
+    {
+        if (entries[i].key == entries[i + 1].key)
+        {
+            Log("%s:%d: replaces the path of line %d", CONF_FILE, entries[i + 1].line, entries[i].line);
+            pathFree(parsed + entries[i].index);
+            entries[i].index = -1;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        size += entries[i].index != -1;
+    }
+    if ((*paths = malloc(sizeof(fwd_path) * (size > 0 ? size : 1))) == NULL)
+    {
+        die("malloc");
+    }
+
+    size = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[i].index != -1)
+        {
+            (*paths)[size++] = parsed[entries[i].index];
+        }
+    }
+
+    return size;
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                compilePaths
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void compilePaths(fwd_path *paths, const int size)
+--                              fwd_path *paths: The path table.
+--                              const int size: The number of paths.
+--
+-- NOTES:
+-- Sets up the balancing, access list, limits and health state of every path of a table, whether
+-- it was parsed or loaded from the cache.
+---------------------------------------------------------------------------------------*/
+void compilePaths(fwd_path *paths, const int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        if (!balanceInit(paths + i) || !aclCompile(paths + i) || !limitInit(paths + i) || !healthInit(paths + i))
+        {
+            die("malloc");
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------------------
+-- FUNCTION:                parseConfFileForPaths
+--
+-- DATE:                    April 1, 2019
+--
+-- REVISIONS:               October 17, 2026 - Parse path options.
+--                          October 17, 2026 - Format the incoming address once for logging.
+--                          October 17, 2026 - Do not fail on a file without paths.
+--                          October 17, 2026 - Resolve every host name up front with prefetchHosts.
+--                          October 17, 2026 - Compile the access list of every path.
+--                          October 17, 2026 - Set up the health state of every path.
+--                          October 17, 2026 - Map the file, reject it on any error, sort and
+--                                             deduplicate the paths and use the binary cache.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool parseConfFileForPaths(fwd_path **paths, int *size)
+--                              fwd_path **paths: Pointer to the array of paths structs.
+--                              int *size: Pointer to the size of the fwd_path array.
+--
+-- RETURNS:                 True if the file was parsed, false otherwise.
+--
+-- NOTES:
+-- Given a pointer for the destination and size of a fwd_path array and a file, this
+-- function will parse all the linse of the file following the format "address:port -> address:port"
+-- and place them in the paths variable and set size to the size of paths. The outgoing address may
+-- be followed by more backends and options, see parseBackends and parseOptions.
+--
+-- The file is mapped and read once for the host names and once for the paths, without a copy
+-- beyond the current line, and the table is allocated once for the number of lines. Every line is
+-- checked and a single error rejects the whole file, so a reload keeps the running paths rather
+-- than losing the broken ones. The table is sorted by sortPaths, which also drops the paths
+-- listed more than once. With -b the table is loaded from the cache file while it matches the
+-- configuration file and written to it after a parse.
+---------------------------------------------------------------------------------------*/
+bool parseConfFileForPaths(fwd_path **paths, int *size)
+{
+    int fd;
+    struct stat info;
+    char *data = NULL;
+    const char *cursor;
+    const char *end;
+    char lineBuffer[LINE_BUFFER_SIZE];
+    int lines = 1;
+    int number = 0;
+    int count = 0;
+    fwd_path *parsed;
+    path_entry *entries;
+    long long started = monotonicUs();
+
+    Log("Opening conf file: %s", CONF_FILE);
+    if ((fd = open(CONF_FILE, O_RDONLY | O_CLOEXEC)) == -1 || fstat(fd, &info) == -1)
+    {
+        Error("Could not open: %s", CONF_FILE);
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    if (options.cache && cacheLoad(options.cache, &info, paths, size))
+    {
+        close(fd);
+        hostsBegin();
+        compilePaths(*paths, *size);
+        Log("Loaded %d paths from %s in %lld us", *size, options.cache, monotonicUs() - started);
+        return true;
+    }
+
+    if (info.st_size > 0 && (data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+    {
+        Error("Could not map: %s", CONF_FILE);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    end = info.st_size > 0 ? data + info.st_size : data;
+    if (data)
+    {
+        madvise(data, info.st_size, MADV_SEQUENTIAL);
+    }
+
+    prefetchHosts(data, info.st_size);
+
+    // every line holds at most one path
+    for (cursor = data; cursor < end && (cursor = memchr(cursor, '\n', end - cursor)) != NULL; cursor++)
+    {
+        lines++;
+    }
+    if ((parsed = malloc(sizeof(fwd_path) * lines)) == NULL || (entries = malloc(sizeof(path_entry) * lines)) == NULL)
+    {
+        die("malloc");
+    }
+
+    parseErrors = 0;
+    parseCacheable = true;
+    for (cursor = data; cursor < end;)
+    {
+        number++;
+        if (copyLine(&cursor, end, lineBuffer) >= LINE_BUFFER_SIZE)
+        {
+            parseError(number, LINE_BUFFER_SIZE, "Line is longer than %d characters", LINE_BUFFER_SIZE - 1);
+        }
+        else if (parseConfLine(lineBuffer, number, parsed + count) == 1)
+        {
+            entries[count].key = (uint64_t)parsed[count].udp << 48 | (uint64_t)ntohs(parsed[count].in.sin_port) << 32
+                                 | ntohl(parsed[count].in.sin_addr.s_addr);
+            entries[count].line = number;
+            entries[count].index = count;
+            count++;
+        }
+    }
+    if (data)
+    {
+        munmap(data, info.st_size);
+    }
+
+    if (parseErrors > 0)
+    {
+        Error("%s has %d errors%s, keeping no paths from it", CONF_FILE, parseErrors,
+              parseErrors > CONF_ERROR_LIMIT ? ", only the first were logged" : "");
+        for (int i = 0; i < count; i++)
+        {
+            pathFree(parsed + i);
+        }
+        free(parsed);
+        free(entries);
+        return false;
+    }
+
+    *size = sortPaths(parsed, entries, count, paths);
+    free(parsed);
+    free(entries);
+
+    if (options.cache && parseCacheable)
+    {
+        cacheSave(options.cache, &info, *paths, *size);
+    }
+    else if (options.cache)
+    {
+        Log("Not caching %s, it uses host names or acl files", CONF_FILE);
+    }
+
+    compilePaths(*paths, *size);
+    Log("Compiled %d paths from %d lines in %lld us", *size, number, monotonicUs() - started);
+
+    return true;
+}
@@ -0,0 +1,486 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             limit.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          void bucketInit(limit_bucket *bucket, const long rate, const long burst, const long long nowMs)
+--                          void bucketRefill(limit_bucket *bucket, const long long nowMs)
+--                          int64_t bucketAvailable(limit_bucket *bucket, const long long nowMs)
+--                          void bucketCharge(limit_bucket *bucket, const int64_t amount)
+--                          bool limitInit(fwd_path *path)
+--                          void limitFree(fwd_limits *limits)
+--                          limit_client *limitClientAcquire(fwd_limits *limits, const struct in_addr addr, const long long nowMs)
+--                          void limitClientRelease(fwd_limits *limits, limit_client *client, const long long nowMs)
+--                          bool limitAdmit(fwd_limits *limits, limit_client *client, const long long nowMs)
+--                          size_t limitAvailable(fwd_limits *limits, limit_client *client, const bool toUpstream, const long long nowMs)
+--                          void limitCharge(fwd_limits *limits, limit_client *client, const bool toUpstream, const size_t bytes)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Token bucket rate limits. The rate, conn_rate, client_rate and client_conn_rate options of a path
+-- give it a bucket for the bytes of each direction and one for new connections, and every client
+-- address a set of the same buckets of its own. A connection may only read while both its path
+-- and its client have tokens left in the bucket of that direction, and pays for what it read
+-- afterwards, so each read costs one load before and one atomic subtraction after whatever its
+-- size. A bucket can go below zero by what was read on the last token, which is paid back before
+-- it lets anything through again.
+--
+-- Buckets are not refilled by timers. Whoever looks at a bucket first after LIMIT_TICK milliseconds
+-- have passed claims the refill with a compare and swap on its timestamp and adds the tokens of the
+-- whole interval at once. Tokens are kept in thousandths, so a rate earns exactly rate of them
+-- every millisecond and no fraction of a token is lost between refills. The path buckets are shared
+-- by every worker and updated with atomics only. Client buckets are kept in a table on the path
+-- that is locked when a connection starts and ends, entries are dropped once no connection uses
+-- them and they have been idle long enough to be full again.
+---------------------------------------------------------------------------------------*/
+
+#include "limit.h"
+
+#include <stdlib.h>
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                bucketInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void bucketInit(limit_bucket *bucket, const long rate, const long burst, const long long nowMs)
+--                              limit_bucket *bucket: The bucket to set up.
+--                              const long rate: Tokens added per second, 0 for no limit.
+--                              const long burst: The most tokens the bucket holds.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Sets up a full bucket. Its tokens and burst are kept in thousandths of a token.
+--------------------------------------------------------------------------------------------------*/
+void bucketInit(limit_bucket *bucket, const long rate, const long burst, const long long nowMs)
+{
+    bucket->rate = rate;
+    bucket->burst = (int64_t)burst * LIMIT_MILLI;
+    bucket->tokens = bucket->burst;
+    bucket->lastMs = nowMs;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                bucketRefill
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void bucketRefill(limit_bucket *bucket, const long long nowMs)
+--                              limit_bucket *bucket: The bucket to refill, which has a limit.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Adds the tokens earned since the last refill, at most once every LIMIT_TICK milliseconds. Only
+-- the thread that moves the timestamp forward adds tokens, so concurrent callers never add the
+-- same interval twice. Every millisecond earns rate thousandths of a token, which is exact for any
+-- rate. Long idle intervals are cut short of overflowing, the bucket is full long before that. The
+-- bucket is then capped at its burst size.
+--------------------------------------------------------------------------------------------------*/
+void bucketRefill(limit_bucket *bucket, const long long nowMs)
+{
+    long long last = __atomic_load_n(&bucket->lastMs, __ATOMIC_RELAXED);
+    int64_t elapsed = nowMs - last;
+    int64_t tokens;
+
+    if (nowMs - last < LIMIT_TICK
+        || !__atomic_compare_exchange_n(&bucket->lastMs, &last, nowMs, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    if (elapsed > INT64_MAX / 4 / bucket->rate)
+    {
+        elapsed = INT64_MAX / 4 / bucket->rate;
+    }
+    tokens = __atomic_add_fetch(&bucket->tokens, bucket->rate * elapsed, __ATOMIC_RELAXED);
+    while (tokens > bucket->burst
+           && !__atomic_compare_exchange_n(&bucket->tokens, &tokens, bucket->burst, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                bucketAvailable
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int64_t bucketAvailable(limit_bucket *bucket, const long long nowMs)
+--                              limit_bucket *bucket: The bucket to look at.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 The tokens in the bucket, which may be negative, or INT64_MAX if the
+--                          bucket has no limit.
+--------------------------------------------------------------------------------------------------*/
+int64_t bucketAvailable(limit_bucket *bucket, const long long nowMs)
+{
+    if (bucket->rate == 0)
+    {
+        return INT64_MAX;
+    }
+
+    bucketRefill(bucket, nowMs);
+    return __atomic_load_n(&bucket->tokens, __ATOMIC_RELAXED) / LIMIT_MILLI;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                bucketCharge
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void bucketCharge(limit_bucket *bucket, const int64_t amount)
+--                              limit_bucket *bucket: The bucket to take from.
+--                              const int64_t amount: The number of tokens used.
+--
+-- NOTES:
+-- Takes tokens out of a bucket that has a limit. The bucket may go below zero.
+--------------------------------------------------------------------------------------------------*/
+void bucketCharge(limit_bucket *bucket, const int64_t amount)
+{
+    if (bucket->rate != 0)
+    {
+        __atomic_sub_fetch(&bucket->tokens, amount * LIMIT_MILLI, __ATOMIC_RELAXED);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool limitInit(fwd_path *path)
+--                              fwd_path *path: A path whose options have been parsed.
+--
+-- RETURNS:                 True if the limits were set up, false if memory ran out.
+--
+-- NOTES:
+-- Creates the buckets of a path that has any rate option. Paths without one keep path.limits NULL
+-- and pay nothing. Byte buckets hold a quarter of a second of their rate plus LIMIT_MIN_BURST so
+-- slow rates still allow whole reads, connection buckets hold a whole second.
+--------------------------------------------------------------------------------------------------*/
+bool limitInit(fwd_path *path)
+{
+    fwd_limits *limits;
+    long long now = monotonicMs();
+
+    path->limits = NULL;
+    if (path->rate == 0 && path->connRate == 0 && path->clientRate == 0 && path->clientConnRate == 0)
+    {
+        return true;
+    }
+
+    if ((limits = calloc(1, sizeof(fwd_limits))) == NULL)
+    {
+        return false;
+    }
+
+    bucketInit(&limits->toUpstream, path->rate, path->rate / LIMIT_BURST_DIVISOR + LIMIT_MIN_BURST, now);
+    bucketInit(&limits->toClient, path->rate, path->rate / LIMIT_BURST_DIVISOR + LIMIT_MIN_BURST, now);
+    bucketInit(&limits->conns, path->connRate, path->connRate, now);
+    limits->clientRate = path->clientRate;
+    limits->clientConnRate = path->clientConnRate;
+    pthread_mutex_init(&limits->lock, NULL);
+
+    if ((path->clientRate || path->clientConnRate)
+        && (limits->clients = calloc(LIMIT_CLIENT_BUCKETS, sizeof(limit_client *))) == NULL)
+    {
+        free(limits);
+        return false;
+    }
+
+    path->limits = limits;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitFree
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void limitFree(fwd_limits *limits)
+--                              fwd_limits *limits: The limits to free, may be NULL.
+--
+-- NOTES:
+-- Frees the buckets of a path and of all its clients.
+--------------------------------------------------------------------------------------------------*/
+void limitFree(fwd_limits *limits)
+{
+    limit_client *client;
+
+    if (limits == NULL)
+    {
+        return;
+    }
+
+    for (int i = 0; limits->clients && i < LIMIT_CLIENT_BUCKETS; i++)
+    {
+        while ((client = limits->clients[i]) != NULL)
+        {
+            limits->clients[i] = client->next;
+            free(client);
+        }
+    }
+    free(limits->clients);
+    pthread_mutex_destroy(&limits->lock);
+    free(limits);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitClientAcquire
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               limit_client *limitClientAcquire(fwd_limits *limits, const struct in_addr addr, const long long nowMs)
+--                              fwd_limits *limits: The limits of the path, may be NULL.
+--                              const struct in_addr addr: The address of the client.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 The buckets of the client, or NULL if the path has no per client limits.
+--
+-- NOTES:
+-- Finds or creates the buckets of a client and takes a reference on them, which the connection
+-- gives back with limitClientRelease. Unused entries idle for LIMIT_CLIENT_IDLE milliseconds are
+-- dropped from the chain on the way.
+--------------------------------------------------------------------------------------------------*/
+limit_client *limitClientAcquire(fwd_limits *limits, const struct in_addr addr, const long long nowMs)
+{
+    limit_client **link;
+    limit_client *client;
+
+    if (limits == NULL || limits->clients == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&limits->lock);
+    link = limits->clients + (addr.s_addr * 2654435761u) % LIMIT_CLIENT_BUCKETS;
+    while ((client = *link) != NULL && client->addr != addr.s_addr)
+    {
+        if (client->refs == 0 && nowMs - client->lastUsed >= LIMIT_CLIENT_IDLE)
+        {
+            *link = client->next;
+            free(client);
+            continue;
+        }
+        link = &client->next;
+    }
+
+    if (client == NULL)
+    {
+        if ((client = calloc(1, sizeof(limit_client))) == NULL)
+        {
+            die("calloc");
+        }
+        client->addr = addr.s_addr;
+        bucketInit(&client->toUpstream, limits->clientRate, limits->clientRate / LIMIT_BURST_DIVISOR + LIMIT_MIN_BURST, nowMs);
+        bucketInit(&client->toClient, limits->clientRate, limits->clientRate / LIMIT_BURST_DIVISOR + LIMIT_MIN_BURST, nowMs);
+        bucketInit(&client->conns, limits->clientConnRate, limits->clientConnRate, nowMs);
+        *link = client;
+    }
+
+    client->refs++;
+    client->lastUsed = nowMs;
+    pthread_mutex_unlock(&limits->lock);
+    return client;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitClientRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void limitClientRelease(fwd_limits *limits, limit_client *client, const long long nowMs)
+--                              fwd_limits *limits: The limits of the path.
+--                              limit_client *client: The buckets from limitClientAcquire, may be NULL.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Drops the reference of a connection on the buckets of its client. The entry stays in the table
+-- so a client that reconnects right away still finds its buckets as it left them.
+--------------------------------------------------------------------------------------------------*/
+void limitClientRelease(fwd_limits *limits, limit_client *client, const long long nowMs)
+{
+    if (client == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&limits->lock);
+    client->refs--;
+    client->lastUsed = nowMs;
+    pthread_mutex_unlock(&limits->lock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitAdmit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool limitAdmit(fwd_limits *limits, limit_client *client, const long long nowMs)
+--                              fwd_limits *limits: The limits of the path, may be NULL.
+--                              limit_client *client: The buckets of the client, may be NULL.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 True if the connection may be opened, false if it is over a connection
+--                          rate.
+--
+-- NOTES:
+-- Takes a connection token from the path and from the client. Nothing is taken if either is out.
+--------------------------------------------------------------------------------------------------*/
+bool limitAdmit(fwd_limits *limits, limit_client *client, const long long nowMs)
+{
+    if (limits == NULL)
+    {
+        return true;
+    }
+
+    if (bucketAvailable(&limits->conns, nowMs) < 1 || (client && bucketAvailable(&client->conns, nowMs) < 1))
+    {
+        return false;
+    }
+
+    bucketCharge(&limits->conns, 1);
+    if (client)
+    {
+        bucketCharge(&client->conns, 1);
+    }
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitAvailable
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               size_t limitAvailable(fwd_limits *limits, limit_client *client, const bool toUpstream, const long long nowMs)
+--                              fwd_limits *limits: The limits of the path, may be NULL.
+--                              limit_client *client: The buckets of the client, may be NULL.
+--                              const bool toUpstream: The direction about to be read.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 How many bytes the direction may read, 0 if it is throttled and SIZE_MAX
+--                          if it has no limit.
+--------------------------------------------------------------------------------------------------*/
+size_t limitAvailable(fwd_limits *limits, limit_client *client, const bool toUpstream, const long long nowMs)
+{
+    int64_t available;
+    int64_t own;
+
+    if (limits == NULL)
+    {
+        return SIZE_MAX;
+    }
+
+    available = bucketAvailable(toUpstream ? &limits->toUpstream : &limits->toClient, nowMs);
+    if (client && (own = bucketAvailable(toUpstream ? &client->toUpstream : &client->toClient, nowMs)) < available)
+    {
+        available = own;
+    }
+
+    if (available <= 0)
+    {
+        return 0;
+    }
+    return available == INT64_MAX ? SIZE_MAX : (size_t)available;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                limitCharge
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void limitCharge(fwd_limits *limits, limit_client *client, const bool toUpstream, const size_t bytes)
+--                              fwd_limits *limits: The limits of the path, may be NULL.
+--                              limit_client *client: The buckets of the client, may be NULL.
+--                              const bool toUpstream: The direction that was read.
+--                              const size_t bytes: The number of bytes read.
+--
+-- NOTES:
+-- Pays for what a direction read out of the buckets of its path and client.
+--------------------------------------------------------------------------------------------------*/
+void limitCharge(fwd_limits *limits, limit_client *client, const bool toUpstream, const size_t bytes)
+{
+    if (limits == NULL || bytes == 0)
+    {
+        return;
+    }
+
+    bucketCharge(toUpstream ? &limits->toUpstream : &limits->toClient, bytes);
+    if (client)
+    {
+        bucketCharge(toUpstream ? &client->toUpstream : &client->toClient, bytes);
+    }
+}
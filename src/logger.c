@@ -0,0 +1,525 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             logger.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool logStart(void)
+--                          void logSubmit(const char *level, const char *format, va_list args)
+--                          log_ring *logThreadRing(void)
+--                          const char *logTimestamp(const time_t when)
+--                          int logFormat(char *out, const size_t size, const time_t when, const char *level, const char *message, const int length)
+--                          void logWrite(const char *buffer, size_t length)
+--                          bool logDrain(void)
+--                          void *logWriterThread(void *arg)
+--                          void logFlush(void)
+--                          void logAfterFork(void)
+--                          bool logConnAllowed(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- The logging backend behind Log and Error. Once logStart has been called every thread that logs
+-- gets its own single producer, single consumer ring of fixed size records. Producers only format
+-- the message into the next free record and publish it, there is no lock, no system call and no
+-- time formatting on their side. A dedicated writer thread drains every ring, adds the timestamp,
+-- which is only formatted once per second, and writes the lines out in large batches. When a
+-- ring is full the record is dropped and counted rather than blocking the producer.
+--
+-- Before logStart, and in forked children which do not inherit the writer thread, every line is
+-- formatted and written with a single write so lines from different processes never interleave.
+---------------------------------------------------------------------------------------*/
+
+#define LOG_BATCH_SIZE 65536
+#define LOG_LINE_SIZE 320
+#define LOG_IDLE_SLEEP 10000000
+
+#include "logger.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "res.h"
+
+static log_ring *rings;
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static bool logAsync;
+static time_t connLogSecond;
+static int connLogCount;
+static size_t connLogSuppressed;
+static time_t lastSuppressReport;
+static char batch[LOG_BATCH_SIZE];
+static __thread log_ring *threadRing;
+static __thread time_t cachedSecond = -1;
+static __thread char cachedTimestamp[32];
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool logStart(void)
+--
+-- RETURNS:                 True if logging is now asynchronous, false if it stays synchronous.
+--
+-- NOTES:
+-- Starts the writer thread and switches every later log call over to the rings. Whatever is still
+-- in the rings when the process exits is written out by logFlush.
+--------------------------------------------------------------------------------------------------*/
+bool logStart(void)
+{
+    pthread_t thread;
+
+    if (logAsync)
+    {
+        return true;
+    }
+
+    if (pthread_atfork(NULL, NULL, logAfterFork) != 0 || atexit(logFlush) != 0)
+    {
+        return false;
+    }
+
+    if (pthread_create(&thread, NULL, logWriterThread, NULL) != 0)
+    {
+        return false;
+    }
+    pthread_detach(thread);
+
+    __atomic_store_n(&logAsync, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logSubmit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void logSubmit(const char *level, const char *format, va_list args)
+--                              const char *level: The log serverity level, must be a string literal.
+--                              const char *format: The string literal for the format.
+--                              va_list args: Arguments fitting the string literal.
+--
+-- NOTES:
+-- Formats the message into the next record of the ring of the calling thread and publishes it to
+-- the writer thread. The message is formatted here because arguments such as the buffer returned
+-- by inet_ntoa do not outlive the call. Falls back to writing the line directly when logging is
+-- synchronous or the thread has no ring.
+--------------------------------------------------------------------------------------------------*/
+void logSubmit(const char *level, const char *format, va_list args)
+{
+    int length;
+    size_t tail;
+    log_ring *ring;
+    log_record *record;
+    char message[LOG_MESSAGE_SIZE];
+    char line[LOG_LINE_SIZE];
+
+    if (!__atomic_load_n(&logAsync, __ATOMIC_ACQUIRE) || (ring = logThreadRing()) == NULL)
+    {
+        if ((length = vsnprintf(message, sizeof(message), format, args)) < 0)
+        {
+            return;
+        }
+        length = logFormat(line, sizeof(line), time(NULL), level, message,
+                           length < LOG_MESSAGE_SIZE ? length : LOG_MESSAGE_SIZE - 1);
+        logWrite(line, length);
+        return;
+    }
+
+    tail = ring->tail;
+    if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == LOG_RING_SIZE)
+    {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    record = ring->records + (tail & (LOG_RING_SIZE - 1));
+    record->when = time(NULL);
+    record->level = level;
+    if ((length = vsnprintf(record->message, LOG_MESSAGE_SIZE, format, args)) < 0)
+    {
+        length = 0;
+    }
+    record->length = length < LOG_MESSAGE_SIZE ? length : LOG_MESSAGE_SIZE - 1;
+
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logThreadRing
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               log_ring *logThreadRing(void)
+--
+-- RETURNS:                 The ring of the calling thread, NULL if it could not be allocated.
+--
+-- NOTES:
+-- Allocates the ring of a thread the first time it logs and registers it with the writer thread.
+-- This is the only time a producer takes a lock. Rings live as long as the process since the
+-- threads that log are the long lived workers.
+--------------------------------------------------------------------------------------------------*/
+log_ring *logThreadRing(void)
+{
+    if (threadRing)
+    {
+        return threadRing;
+    }
+
+    if ((threadRing = calloc(1, sizeof(log_ring))) == NULL)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&ringsLock);
+    threadRing->next = rings;
+    rings = threadRing;
+    pthread_mutex_unlock(&ringsLock);
+
+    return threadRing;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logTimestamp
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               const char *logTimestamp(const time_t when)
+--                              const time_t when: The time to format.
+--
+-- RETURNS:                 The formatted time.
+--
+-- NOTES:
+-- Formats a time the way log lines show it. The string is cached per thread and only formatted
+-- again once the second changes.
+--------------------------------------------------------------------------------------------------*/
+const char *logTimestamp(const time_t when)
+{
+    struct tm t;
+
+    if (when != cachedSecond)
+    {
+        localtime_r(&when, &t);
+        strftime(cachedTimestamp, sizeof(cachedTimestamp), "%d/%m/%Y-%H:%M:%S", &t);
+        cachedSecond = when;
+    }
+
+    return cachedTimestamp;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logFormat
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int logFormat(char *out, const size_t size, const time_t when, const char *level, const char *message, const int length)
+--                              char *out: The buffer to place the line in.
+--                              const size_t size: The size of out.
+--                              const time_t when: When the message was logged.
+--                              const char *level: The log serverity level.
+--                              const char *message: The message.
+--                              const int length: The length of the message.
+--
+-- RETURNS:                 The length of the line placed in out.
+--
+-- NOTES:
+-- Prepends the timestamp and severity level to a message and ends it with a newline.
+--------------------------------------------------------------------------------------------------*/
+int logFormat(char *out, const size_t size, const time_t when, const char *level, const char *message, const int length)
+{
+    int n = snprintf(out, size, "[ %s ] [%s] %.*s\n", logTimestamp(when), level, length, message);
+
+    return n < (int)size ? n : (int)size - 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logWrite
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void logWrite(const char *buffer, size_t length)
+--                              const char *buffer: The lines to write.
+--                              size_t length: The number of bytes to write.
+--
+-- NOTES:
+-- Writes formatted lines to stdout, retrying after interrupts and partial writes.
+--------------------------------------------------------------------------------------------------*/
+void logWrite(const char *buffer, size_t length)
+{
+    ssize_t n;
+
+    while (length > 0)
+    {
+        if ((n = write(STDOUT_FILENO, buffer, length)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        buffer += n;
+        length -= n;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logDrain
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool logDrain(void)
+--
+-- RETURNS:                 True if anything was written, false otherwise.
+--
+-- NOTES:
+-- Formats every published record of every ring into the batch buffer and writes the buffer out
+-- whenever it fills up. Records dropped because a ring was full, and connection messages held
+-- back by the -l rate limit, are reported as one line each. Must be called with ringsLock held.
+--------------------------------------------------------------------------------------------------*/
+bool logDrain(void)
+{
+    size_t used = 0;
+    size_t head;
+    size_t tail;
+    size_t count;
+    time_t now = time(NULL);
+    log_record *record;
+    char message[LOG_MESSAGE_SIZE];
+
+    for (log_ring *ring = rings; ring; ring = ring->next)
+    {
+        head = ring->head;
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            if (LOG_BATCH_SIZE - used < LOG_LINE_SIZE)
+            {
+                logWrite(batch, used);
+                used = 0;
+            }
+            record = ring->records + (head & (LOG_RING_SIZE - 1));
+            used += logFormat(batch + used, LOG_BATCH_SIZE - used, record->when, record->level, record->message,
+                              record->length);
+        }
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+
+        if ((count = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED)) > 0)
+        {
+            if (LOG_BATCH_SIZE - used < LOG_LINE_SIZE)
+            {
+                logWrite(batch, used);
+                used = 0;
+            }
+            used += logFormat(batch + used, LOG_BATCH_SIZE - used, now, " ERROR ", message,
+                              snprintf(message, sizeof(message), "Dropped %zu log messages, log ring full", count));
+        }
+    }
+
+    // reported at most once a second so the report does not become the flood
+    if (now != lastSuppressReport && (count = __atomic_exchange_n(&connLogSuppressed, 0, __ATOMIC_RELAXED)) > 0)
+    {
+        lastSuppressReport = now;
+        if (LOG_BATCH_SIZE - used < LOG_LINE_SIZE)
+        {
+            logWrite(batch, used);
+            used = 0;
+        }
+        used += logFormat(batch + used, LOG_BATCH_SIZE - used, now, "  LOG  ", message,
+                          snprintf(message, sizeof(message), "Suppressed %zu connection messages", count));
+    }
+
+    logWrite(batch, used);
+    return used > 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logWriterThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *logWriterThread(void *arg)
+--                              void *arg: Unused.
+--
+-- RETURNS:                 NULL, never returns.
+--
+-- NOTES:
+-- Body of the writer thread. Drains the rings for as long as there is something to write, and
+-- sleeps for LOG_IDLE_SLEEP nanoseconds whenever they are all empty so producers never have to
+-- wake it.
+--------------------------------------------------------------------------------------------------*/
+void *logWriterThread(void *arg)
+{
+    bool wrote;
+    struct timespec idle = {0, LOG_IDLE_SLEEP};
+
+    while (1)
+    {
+        pthread_mutex_lock(&ringsLock);
+        wrote = logDrain();
+        pthread_mutex_unlock(&ringsLock);
+
+        if (!wrote)
+        {
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logFlush
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void logFlush(void)
+--
+-- NOTES:
+-- Writes out everything still in the rings. Registered with atexit so the messages logged right
+-- before the process exits, such as the one from die, are not lost.
+--------------------------------------------------------------------------------------------------*/
+void logFlush(void)
+{
+    if (!__atomic_load_n(&logAsync, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&ringsLock);
+    logDrain();
+    pthread_mutex_unlock(&ringsLock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logAfterFork
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void logAfterFork(void)
+--
+-- NOTES:
+-- Runs in the child after every fork. The child has no writer thread, so it goes back to writing
+-- its lines directly. Records copied from the parent's rings belong to the parent and are left
+-- for its writer thread.
+--------------------------------------------------------------------------------------------------*/
+void logAfterFork(void)
+{
+    logAsync = false;
+    threadRing = NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                logConnAllowed
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool logConnAllowed(void)
+--
+-- RETURNS:                 True if another connection message may be logged this second, false
+--                          otherwise.
+--
+-- NOTES:
+-- Rate limits the per connection messages to options.logRate a second, shared by every thread.
+-- The counter is reset by whichever thread first sees a new second, so the limit is approximate
+-- around the change of second. Held back messages are counted and reported by logDrain.
+--------------------------------------------------------------------------------------------------*/
+bool logConnAllowed(void)
+{
+    time_t now;
+
+    if (options.logRate == 0)
+    {
+        return true;
+    }
+
+    now = time(NULL);
+    if (__atomic_exchange_n(&connLogSecond, now, __ATOMIC_RELAXED) != now)
+    {
+        __atomic_store_n(&connLogCount, 0, __ATOMIC_RELAXED);
+    }
+
+    if (__atomic_add_fetch(&connLogCount, 1, __ATOMIC_RELAXED) <= options.logRate)
+    {
+        return true;
+    }
+
+    __atomic_fetch_add(&connLogSuppressed, 1, __ATOMIC_RELAXED);
+    return false;
+}
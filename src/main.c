@@ -5,7 +5,14 @@
 --
 -- FUNCTIONS:
 --                          int main(int argc, char *argv[])
+--                          void forkPath(fwd_path *path)
+--                          void forkReconcile(fwd_config *old, fwd_config *config)
 --                          void childRoutine(fwd_path *path)
+--                          void connectionRoutine(fwd_path *path, const int inSocket, fwd_backend *first)
+--                          bool connectUpstream(fwd_path *path, fwd_backend *first, int *sock, fwd_backend **backend)
+--                          void forwardAndExit(const int from, const int to, const char *name, const fwd_path *path, const long long startedMs, tcp_stats *stats)
+--                          bool forwardAlive(const int from, const int to, const fwd_path *path, const long long startedMs, const tcp_stats *stats)
+--                          void usage(const char *name)
 --
 -- DATE:                    March 20, 2019
 --
@@ -20,24 +27,52 @@
 -- proccesses which handle the network io.
 ---------------------------------------------------------------------------------------*/
 
-#define READ_BUFFER_SIZE 65535
-
 #include "main.h"
 
 #include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "acl.h"
+#include "affinity.h"
+#include "balance.h"
+#include "control.h"
+#include "event.h"
+#include "health.h"
+#include "logger.h"
 #include "net.h"
+#include "relay.h"
+#include "reload.h"
+#include "resolve.h"
+#include "udp.h"
+#include "upgrade.h"
+#include "uring.h"
 
 /*--------------------------------------------------------------------------------------------------
 -- FUNCTION:                main
 --
 -- DATE:                    March 20, 2019
 --
--- REVISIONS:               N/A
+-- REVISIONS:               October 17, 2026 - Added the epoll engine and the -e option.
+--                          October 17, 2026 - Added the -r option.
+--                          October 17, 2026 - Added the -w option.
+--                          October 17, 2026 - Added the io_uring engine.
+--                          October 17, 2026 - Added the asynchronous logger and the -l option.
+--                          October 17, 2026 - Added the -m option.
+--                          October 17, 2026 - Run the fork engine from controlRoutine so it can reload.
+--                          October 17, 2026 - Added the -d option and the resolver refresh thread.
+--                          October 17, 2026 - Start the UDP worker with the fork engine.
+--                          October 17, 2026 - Take over from the old process of an upgrade.
+--                          October 17, 2026 - Start the health check thread.
+--                          October 17, 2026 - Added the -c option.
+--                          October 17, 2026 - Added the -b option.
 --
 -- DESIGNER:                Benny Wang, William Murpy
 --
@@ -50,12 +85,13 @@
 -- RETURNS:                 The exit code.
 --
 -- NOTES:
--- The main entry point of the program. Parses the configuration file and then forks a processes for
--- each connection and allows the child processes to handle the forwarding.
+-- The main entry point of the program. Parses the configuration file and then either serves every
+-- path from epoll event loops (the default), io_uring rings with "-e uring", or, with "-e fork",
+-- forks a process for each connection and allows the child processes to handle the forwarding.
 --------------------------------------------------------------------------------------------------*/
 int main(int argc, char *argv[])
 {
-    int *pids;
+    int opt;
 
     // number of paths
     int pathSize = 0;
@@ -63,45 +99,247 @@ int main(int argc, char *argv[])
     // array of paths
     fwd_path *paths;
 
+    while ((opt = getopt(argc, argv, "e:r:w:c:l:m:d:b:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'e':
+            if (!strcmp(optarg, "fork"))
+            {
+                options.engine = ENGINE_FORK;
+            }
+            else if (!strcmp(optarg, "epoll"))
+            {
+                options.engine = ENGINE_EPOLL;
+            }
+            else if (!strcmp(optarg, "uring"))
+            {
+                options.engine = ENGINE_URING;
+            }
+            else
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r':
+            if (!strcmp(optarg, "splice"))
+            {
+                options.relay = RELAY_SPLICE;
+            }
+            else if (!strcmp(optarg, "copy"))
+            {
+                options.relay = RELAY_COPY;
+            }
+            else
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w':
+            options.workers = atoi(optarg);
+            break;
+        case 'c':
+            if (!affinityParse(optarg))
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'l':
+            options.logRate = atoi(optarg);
+            break;
+        case 'm':
+            options.metrics = optarg;
+            break;
+        case 'd':
+            options.resolveTtl = atoi(optarg);
+            break;
+        case 'b':
+            options.cache = optarg;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // every thread started from here on inherits the mask, only controlRoutine takes the signals
+    blockControlSignals();
+
+    if (!logStart())
+    {
+        Error("Could not start the log writer, logging synchronously");
+    }
+
     Log("Starting forwarder");
 
+    // before parsing, an upgrade hands over the resolved names along with the sockets
+    upgradeInit(argv);
+
     // Parse log file, your job to free paths
     if (!parseConfFileForPaths(&paths, &pathSize))
     {
         die("Could not parse file");
     }
 
-    if ((pids = malloc(sizeof(int) * pathSize)) == NULL)
+    // the paths are owned by the configuration from here on, SIGHUP replaces them
+    configStart(paths, pathSize);
+
+    if (!resolveStart())
+    {
+        Error("Could not start the resolver thread, host names will not be refreshed");
+    }
+
+    if (!healthStart())
+    {
+        Error("Could not start the health check thread, backends will not be probed");
+    }
+
+    if (options.engine == ENGINE_URING)
     {
-        die("Could not allocate memory");
+        Log("Using io_uring engine");
+        uringRoutine(configCurrent());
     }
 
-    // do stuff with forwarding paths here
+    if (options.engine == ENGINE_EPOLL)
+    {
+        Log("Using epoll engine");
+        eventRoutine(configCurrent());
+    }
+
+    Log("Using fork engine");
+    blockControlSignals();
     for (int i = 0; i < pathSize; i++)
     {
-        pids[i] = fork();
-        if (pids[i])
+        forkPath(paths + i);
+    }
+
+    if (!udpStart(configCurrent(), 0))
+    {
+        die("Could not start the UDP worker");
+    }
+
+    controlRoutine();
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                forkPath
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Skip UDP paths.
+--                          October 17, 2026 - Listen in the main process so the socket can be upgraded.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void forkPath(fwd_path *path)
+--                              fwd_path *path: The path to serve.
+--
+-- NOTES:
+-- Forks the process that serves path with the fork engine and records its pid in path. UDP paths
+-- are served by the UDP worker of the main process instead. The listening socket is opened here,
+-- unless the path already has one, and kept in path so an upgrade can hand it over. The child
+-- closes the sockets of every other path.
+--------------------------------------------------------------------------------------------------*/
+void forkPath(fwd_path *path)
+{
+    if (path->udp)
+    {
+        return;
+    }
+
+    if (path->listenFd == -1 && !upgradeListen(&path->listenFd, ntohs(path->in.sin_port), 0, false, path->backlog))
+    {
+        Error("Could not listen on port %d, skipping", ntohs(path->in.sin_port));
+        return;
+    }
+
+    if ((path->pid = fork()) == -1)
+    {
+        path->pid = 0;
+        Error("Could not fork for port %d", ntohs(path->in.sin_port));
+        return;
+    }
+
+    if (path->pid == 0)
+    {
+        upgradeCloseAll(path->listenFd);
+        unblockControlSignals();
+        childRoutine(path);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                forkReconcile
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Hand the listening socket of a changed path over.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void forkReconcile(fwd_config *old, fwd_config *config)
+--                              fwd_config *old: The generation that was running.
+--                              fwd_config *config: The generation that replaced it.
+--
+-- NOTES:
+-- Applies a reload to the fork engine. The process of every path that was removed or changed is
+-- stopped and waited for, then a process is forked for every path that does not have one.
+-- Unchanged paths keep their process, configDiff carried its pid and socket over. A changed path
+-- takes over the listening socket of its predecessor so no client is refused in between, and the
+-- sockets of removed paths are closed. The connections of a stopped path are processes of their
+-- own and keep running until they close.
+--------------------------------------------------------------------------------------------------*/
+void forkReconcile(fwd_config *old, fwd_config *config)
+{
+    fwd_path *prev;
+
+    for (int i = 0; i < old->size; i++)
+    {
+        if (!old->paths[i].backendsMoved && old->paths[i].pid > 0)
         {
-            // parent
-            continue;
+            kill(old->paths[i].pid, SIGTERM);
+            waitpid(old->paths[i].pid, NULL, 0);
         }
-        else
+    }
+
+    for (int i = 0; i < config->size; i++)
+    {
+        prev = config->paths[i].previous != -1 ? old->paths + config->paths[i].previous : NULL;
+        if (prev && !prev->backendsMoved)
         {
-            // child
-            childRoutine(paths + i);
+            config->paths[i].listenFd = prev->listenFd;
+            prev->listenFd = -1;
         }
     }
 
-    for (int i = 0; i < pathSize; i++)
+    for (int i = 0; i < old->size; i++)
     {
-        waitpid(pids[i], NULL, 0);
+        if (!old->paths[i].backendsMoved && old->paths[i].listenFd != -1)
+        {
+            upgradeUntrack(old->paths[i].listenFd);
+            close(old->paths[i].listenFd);
+            old->paths[i].listenFd = -1;
+        }
     }
 
-    // parseConfFileForPaths does malloc/realloc
-    free(paths);
-
-    Log("Stopping");
-    return 0;
+    for (int i = 0; i < config->size; i++)
+    {
+        if (config->paths[i].pid == 0)
+        {
+            forkPath(config->paths + i);
+        }
+    }
 }
 
 /*--------------------------------------------------------------------------------------------------
@@ -109,7 +347,14 @@ int main(int argc, char *argv[])
 --
 -- DATE:                    April 1, 2019
 --
--- REVISIONS:               N/A
+-- REVISIONS:               October 17, 2026 - Moved the relay loops to forwardAndExit.
+--                          October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Connect in a child so a slow backend cannot stall accepts.
+--                          October 17, 2026 - Admit clients through the access list of the path.
+--                          October 17, 2026 - Listen with the backlog and socket options of the path.
+--                          October 17, 2026 - Let the kernel reap the connection processes.
+--                          October 17, 2026 - Accept on the socket opened by forkPath.
+--                          October 17, 2026 - Reset clients when the circuit of every backend is open.
 --
 -- DESIGNER:                Benny Wang, William Murpy
 --
@@ -119,31 +364,36 @@ int main(int argc, char *argv[])
 --                              fwd_path *path: Pointer to struct that contains the in and out structs.
 --
 -- NOTES:
--- Creates a connection between path.in and path.out and forwrads data between the two. A socket is first
--- created and listens on path.in.sin_port for connections. The address stored in path.in connects, a
--- connect call is made to path.out. Once connections are established on in both directions, The process
--- forks, the parent will block on read and write all data from path.in to path.out, and the child will
--- read and write all data from path.out to path.in. If either of the connections closes, everything
--- will close and exit.
+-- Creates a connection between path.in and path.out and forwards data between the two. Accepts
+-- connections on the socket forkPath opened on path.in.sin_port, after applying the backlog and
+-- socket options of the path to it again since it may have served an older version of the path.
+-- When a client admitted by the access list of the path connects, the process forks and the child
+-- runs connectionRoutine while the parent goes straight back to accepting, so connecting to a slow
+-- or unreachable backend never holds up the next client. Connection processes are reaped by the
+-- kernel as they exit.
 --------------------------------------------------------------------------------------------------*/
 void childRoutine(fwd_path *path)
 {
-    int numRead;
-    char buffer[READ_BUFFER_SIZE];
-
-    int listenSocket;
+    int listenSocket = path->listenFd;
     int inSocket;
-    int outSocket;
+    fwd_backend *backend;
     struct sockaddr_in incomingStruct;
 
-    if (!uwuCreateBoundSocket(&listenSocket, ntohs(path->in.sin_port)))
+    if (!uwuSetBlocking(listenSocket))
     {
-        die("Could not bind incoming socket");
+        die("Could not set the listening socket to blocking");
     }
 
-    listen(listenSocket, 5);
+    if (!uwuTuneSocket(listenSocket, &path->clientTuning, true))
+    {
+        Error("Could not set every socket option on port %d", ntohs(path->in.sin_port));
+    }
+    listen(listenSocket, path->backlog);
     Log("Listening for connection ...");
 
+    // connection processes are never waited for, so let the kernel reap them
+    signal(SIGCHLD, SIG_IGN);
+
     while (1)
     {
         if (!uwuAcceptSocket(listenSocket, &inSocket, &incomingStruct))
@@ -151,57 +401,425 @@ void childRoutine(fwd_path *path)
             Error("No incoming connection");
             continue;
         }
-        Log("Connection accpeted from %s", inet_ntoa(incomingStruct.sin_addr));
 
-        if (incomingStruct.sin_addr.s_addr != path->in.sin_addr.s_addr)
+        if (!aclAllows(path->acl, incomingStruct.sin_addr))
         {
-            close(inSocket);
-            Error("Invalid incoming address, skipping");
+            uwuResetSocket(inSocket);
+            LogConn("Refused connection from %s", inet_ntoa(incomingStruct.sin_addr));
             continue;
         }
+        uwuTuneAccepted(inSocket, &path->clientTuning);
+        LogConn("Connection accpeted from %s", inet_ntoa(incomingStruct.sin_addr));
 
-        Log("Connecting to destination host");
-        if (!createConnectedSocket(&outSocket, &path->out))
+        // picked here so the state of the policy is kept between connections
+        if ((backend = pickBackend(path, &incomingStruct)) == NULL)
         {
-            close(inSocket);
-            Error("Could not connect to outgoing server");
+            uwuResetSocket(inSocket);
+            LogConn("No backend available for connection from %s", inet_ntoa(incomingStruct.sin_addr));
             continue;
         }
+        if (!fork()) // child
+        {
+            close(listenSocket);
+            connectionRoutine(path, inSocket, backend);
+        }
+        close(inSocket);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connectionRoutine
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Hand the path and the start of the connection to the relays.
+--                          October 17, 2026 - Keep the TCP_INFO telemetry in the upstream relay.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void connectionRoutine(fwd_path *path, const int inSocket, fwd_backend *first)
+--                              fwd_path *path: The path the client connected to.
+--                              const int inSocket: The accepted client socket.
+--                              fwd_backend *first: The backend chosen by pickBackend.
+--
+-- NOTES:
+-- Body of the forked process of one connection. Connects to a backend of the path with
+-- connectUpstream, then forks once more. The child will read and write all data from path.in to
+-- the backend and this process will read and write all data from the backend to path.in, both
+-- with forwardAndExit. Exits if no backend could be reached. The lifetime of the connection is
+-- counted from here. The TCP_INFO telemetry of both sockets is kept by this process only.
+--------------------------------------------------------------------------------------------------*/
+void connectionRoutine(fwd_path *path, const int inSocket, fwd_backend *first)
+{
+    int outSocket;
+    fwd_backend *backend;
+    tcp_stats stats;
+    long long startedMs = monotonicMs();
 
-        Log("Connected %s to  %s", inet_ntoa(path->in.sin_addr), inet_ntoa(path->out.sin_addr));
+    LogConn("Connecting to destination host");
+    if (!connectUpstream(path, first, &outSocket, &backend))
+    {
+        close(inSocket);
+        Error("Could not connect to outgoing server");
+        exit(EXIT_FAILURE);
+    }
 
-        if (!fork()) // child
+    LogConn("Connected %s to  %s", path->inName, backend->name);
+
+    if (!fork()) // child
+    {
+        LogConn("Forwarding for data from %s to %s", path->inName, backend->name);
+        forwardAndExit(inSocket, outSocket, path->inName, path, startedMs, NULL);
+    }
+
+    LogConn("Forwarding for data from %s to %s", backend->name, path->inName);
+    forwardAndExit(outSocket, inSocket, backend->name, path, startedMs, &stats);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                connectUpstream
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect with the upstream socket options of the path.
+--                          October 17, 2026 - Skip backends whose circuit is open and report every connect.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool connectUpstream(fwd_path *path, fwd_backend *first, int *sock, fwd_backend **backend)
+--                              fwd_path *path: The path to connect for.
+--                              fwd_backend *first: The backend chosen by pickBackend.
+--                              int *sock: Pointer to where the connected socket will be placed.
+--                              fwd_backend **backend: Pointer to where the backend that answered will be placed.
+--
+-- RETURNS:                 True if a backend was connected before path.connectTimeout, false otherwise.
+--
+-- NOTES:
+-- The forking model's version of the epoll engine's connect attempts. Connects without blocking,
+-- starting with first, and races a connect to the next backend every CONNECT_ATTEMPT_DELAY
+-- milliseconds or as soon as an attempt fails, up to CONNECT_ATTEMPTS at once. The first socket to
+-- connect is made blocking again and returned, the others are closed.
+--------------------------------------------------------------------------------------------------*/
+bool connectUpstream(fwd_path *path, fwd_backend *first, int *sock, fwd_backend **backend)
+{
+    struct pollfd fds[CONNECT_ATTEMPTS];
+    fwd_backend *tried[CONNECT_ATTEMPTS];
+    int active = 0;
+    int started = 0;
+    int err;
+    socklen_t length;
+    long long now;
+    long long wait;
+    long long deadline = monotonicMs() + path->connectTimeout;
+    long long nextAttempt = 0;
+
+    while ((now = monotonicMs()) < deadline)
+    {
+        if (now >= nextAttempt && active < CONNECT_ATTEMPTS && started < path->backendCount)
         {
-            Log("Forwarding for data from %s to %s", inet_ntoa(path->in.sin_addr), inet_ntoa(path->out.sin_addr));
-            while (1)
+            tried[active] = alternateBackend(path, first, started++);
+            if (tried[active] != first && !healthUsable(path, tried[active]))
             {
-                numRead = recv(inSocket, buffer, READ_BUFFER_SIZE, 0);
-                send(outSocket, buffer, numRead, 0);
+                continue;
+            }
+            if (!createNonBlockingConnectedSocket(&fds[active].fd, &tried[active]->addr, &path->upstreamTuning))
+            {
+                Error("Could not connect to %s", tried[active]->name);
+                healthFailed(path, tried[active], now);
+                continue;
+            }
+            fds[active].events = POLLOUT;
+            active++;
+            nextAttempt = now + CONNECT_ATTEMPT_DELAY;
+            continue;
+        }
 
-                if (numRead <= 0)
-                {
-                    close(inSocket);
-                    Log("Closing connection to %s", inet_ntoa(path->in.sin_addr));
-                    exit(0);
-                }
+        if (active == 0)
+        {
+            break;
+        }
+
+        wait = deadline - now;
+        if (active < CONNECT_ATTEMPTS && started < path->backendCount && nextAttempt - now < wait)
+        {
+            wait = nextAttempt - now;
+        }
+
+        if (poll(fds, active, wait) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
             }
+            break;
         }
 
-        if (!fork()) // child
+        for (int i = 0; i < active; i++)
         {
-            Log("Forwarding for data from %s to %s", inet_ntoa(path->out.sin_addr), inet_ntoa(path->in.sin_addr));
-            while (1)
+            if (!fds[i].revents)
             {
-                numRead = recv(outSocket, buffer, READ_BUFFER_SIZE, 0);
-                send(inSocket, buffer, numRead, 0);
+                continue;
+            }
 
-                if (numRead <= 0)
+            err = 0;
+            length = sizeof(err);
+            if (getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, &err, &length) == 0 && err == 0
+                && uwuSetBlocking(fds[i].fd))
+            {
+                *sock = fds[i].fd;
+                *backend = tried[i];
+                healthConnected(path, tried[i]);
+                for (int j = 0; j < active; j++)
                 {
-                    close(outSocket);
-                    Log("Closing connection to %s", inet_ntoa(path->out.sin_addr));
-                    exit(0);
+                    if (j != i)
+                    {
+                        close(fds[j].fd);
+                    }
                 }
+                return true;
+            }
+
+            // the failed attempt makes room for the next backend right away
+            Error("Could not connect to %s", tried[i]->name);
+            healthFailed(path, tried[i], now);
+            close(fds[i].fd);
+            active--;
+            fds[i] = fds[active];
+            tried[i] = tried[active];
+            nextAttempt = now;
+            i--;
+        }
+    }
+
+    for (int i = 0; i < active; i++)
+    {
+        healthFailed(path, tried[i], monotonicMs());
+        close(fds[i].fd);
+    }
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                forwardAndExit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Pass the end of stream on with shutdown.
+--                          October 17, 2026 - Close connections on the idle timeout and maximum lifetime of the path.
+--                          October 17, 2026 - Sample TCP_INFO and log the summary of the connection.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void forwardAndExit(const int from, const int to, const char *name, const fwd_path *path, const long long startedMs, tcp_stats *stats)
+--                              const int from: The socket to read from.
+--                              const int to: The socket to write to.
+--                              const char *name: The address of from, used for logging.
+--                              const fwd_path *path: The path of the connection.
+--                              const long long startedMs: When the connection was accepted, in monotonic milliseconds.
+--                              tcp_stats *stats: The TCP_INFO telemetry of the connection when from
+--                                                is the upstream socket, NULL otherwise.
+--
+-- NOTES:
+-- Body of the forked relay processes. Relays from one socket to the other with splice when the
+-- relay mode is splice and the kernel supports it, or by copying otherwise, then closes from and
+-- exits. The relay path that was used is logged when the connection closes.
+--
+-- Both processes of a connection share its sockets, so closing from ends nothing for the peers.
+-- The end of stream is passed on with shutdown(SHUT_WR) on to, which leaves the other direction
+-- running for half-closed connections. If a socket failed or the connection timed out instead, to
+-- is shut down both ways so the process relaying the other direction wakes up from its read and
+-- exits too.
+--
+-- On a path with an idle timeout or a maximum lifetime the relay runs with a receive timeout on
+-- from and forwardAlive decides whether to go on every time it expires. The idle timeout also
+-- becomes the send timeout of from, so the other process gives up on a peer that stops reading.
+-- A receive timeout never expires on a connection that keeps moving data, so those are ended by an
+-- alarm, which kills the process, a second after their lifetime is over.
+--
+-- The process relaying from the upstream also samples TCP_INFO of both sockets on a path with the
+-- tcp_info option. Its samples are taken when the receive timeout expires, so only while the
+-- upstream is quiet, and once more before the connection is shut down. There are no metrics in
+-- this engine, the samples only make it into the summary that is logged.
+--------------------------------------------------------------------------------------------------*/
+void forwardAndExit(const int from, const int to, const char *name, const fwd_path *path, const long long startedMs, tcp_stats *stats)
+{
+    ssize_t total = 0;
+    ssize_t relayed;
+    bool splice = options.relay == RELAY_SPLICE;
+    relay_end end = RELAY_TIMEOUT;
+
+    if (path->idleTimeout)
+    {
+        uwuSetSocketTimeout(path->idleTimeout, 0, from);
+    }
+    if (path->maxLifetime)
+    {
+        alarm((startedMs + path->maxLifetime * 1000LL - monotonicMs() + 999) / 1000 + 1);
+    }
+    if (stats)
+    {
+        tcpInfoStart(stats, path, monotonicMs());
+    }
+
+    while (end == RELAY_TIMEOUT && forwardAlive(from, to, path, startedMs, stats))
+    {
+        relayed = splice ? relaySpliceBlocking(from, to, &end) : -1;
+        if (relayed == -1)
+        {
+            splice = false;
+            relayed = relayCopyBlocking(from, to, &end);
+        }
+        total += relayed;
+        if (stats)
+        {
+            tcpInfoTick(stats, path, to, from, NULL, monotonicMs());
+        }
+    }
+
+    if (stats)
+    {
+        tcpInfoFinish(stats, to, from, NULL, path, name, (monotonicMs() - startedMs) * 1000);
+    }
+    shutdown(to, end == RELAY_EOF ? SHUT_WR : SHUT_RDWR);
+    close(from);
+    LogConn("Closing connection to %s (%s relay, %zd bytes)", name, splice ? "splice" : "copy", total);
+    exit(0);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                forwardAlive
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Wake up for the next TCP_INFO sample.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool forwardAlive(const int from, const int to, const fwd_path *path, const long long startedMs, const tcp_stats *stats)
+--                              const int from: The socket the process reads from.
+--                              const int to: The socket the process writes to.
+--                              const fwd_path *path: The path of the connection.
+--                              const long long startedMs: When the connection was accepted, in monotonic milliseconds.
+--                              const tcp_stats *stats: The TCP_INFO telemetry of the connection, NULL for none.
+--
+-- RETURNS:                 True if the connection may go on, false if it reached the maximum lifetime
+--                          or the idle timeout of the path.
+--
+-- NOTES:
+-- The other direction of the connection is relayed by another process, so whether the connection
+-- is idle is asked of the kernel, which keeps the time data was last received on each socket in
+-- TCP_INFO. A connection moving data one way only is therefore not idle. When the connection may go
+-- on, the receive timeout of from is set to when it would next have to be checked, or to the next
+-- TCP_INFO sample if that comes first.
+--------------------------------------------------------------------------------------------------*/
+bool forwardAlive(const int from, const int to, const fwd_path *path, const long long startedMs, const tcp_stats *stats)
+{
+    long long left = LLONG_MAX;
+    long long quiet = LLONG_MAX;
+    long long sample;
+    struct tcp_info info;
+    socklen_t length;
+    struct timeval timeout;
+
+    if (path->maxLifetime)
+    {
+        if ((left = startedMs + path->maxLifetime * 1000LL - monotonicMs()) <= 0)
+        {
+            LogConn("Connection to %s reached its maximum lifetime", path->inName);
+            return false;
+        }
+    }
+
+    if (path->idleTimeout)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            length = sizeof(info);
+            if (getsockopt(i ? to : from, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 && info.tcpi_last_data_recv < quiet)
+            {
+                quiet = info.tcpi_last_data_recv;
             }
         }
+        if (quiet != LLONG_MAX && quiet >= path->idleTimeout * 1000LL)
+        {
+            LogConn("Connection to %s was idle for %d seconds", path->inName, path->idleTimeout);
+            return false;
+        }
+        if (quiet != LLONG_MAX && path->idleTimeout * 1000LL - quiet < left)
+        {
+            left = path->idleTimeout * 1000LL - quiet;
+        }
+    }
+
+    if (stats && stats->nextSample != LLONG_MAX)
+    {
+        // a timeout of 0 would never expire
+        sample = stats->nextSample - monotonicMs();
+        if (sample < 1)
+        {
+            sample = 1;
+        }
+        if (sample < left)
+        {
+            left = sample;
+        }
+    }
+
+    if (left == LLONG_MAX)
+    {
+        return true;
     }
+
+    // only the receive timeout, the send timeout stays at the idle timeout
+    timeout.tv_sec = left / 1000;
+    timeout.tv_usec = left % 1000 * 1000;
+    setsockopt(from, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                usage
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Added the -l option.
+--                          October 17, 2026 - Added the -m option.
+--                          October 17, 2026 - Added the -d option.
+--                          October 17, 2026 - Added the -c option.
+--                          October 17, 2026 - Added the -b option.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void usage(const char *name)
+--                              const char *name: The name the program was invoked with.
+--
+-- NOTES:
+-- Prints the command line options.
+--------------------------------------------------------------------------------------------------*/
+void usage(const char *name)
+{
+    printf("Usage: %s [-e epoll|uring|fork] [-r copy|splice] [-w workers] [-c cpus] [-l rate] [-m addr] [-d ttl] [-b cache]\n", name);
+    printf("    -e engine   epoll serves every path from one event loop (default),\n");
+    printf("                uring relays with io_uring, falls back to epoll if unavailable,\n");
+    printf("                fork forks a process per path and two per connection\n");
+    printf("    -r relay    copy relays through a user space buffer (default),\n");
+    printf("                splice moves data socket -> pipe -> socket without copying\n");
+    printf("    -w workers  number of epoll or uring worker threads, 0 for one per core (default 0)\n");
+    printf("    -c cpus     pin the workers to a list of cpus such as 0-3,8, auto for every cpu allowed\n");
+    printf("                or irq for the cpus handling network interrupts (epoll and uring)\n");
+    printf("    -l rate     connection log lines per second, 0 for no limit (default 0)\n");
+    printf("    -m addr     serve metrics on host:port, :port or unix:path (epoll and uring)\n");
+    printf("    -d ttl      seconds host names are cached before resolving again, 0 to never refresh (default 60)\n");
+    printf("    -b cache    keep the compiled paths of forwarder.conf in the file cache and load them\n");
+    printf("                from it while forwarder.conf is unchanged\n");
 }
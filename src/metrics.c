@@ -0,0 +1,982 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             metrics.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool metricsInit(fwd_path *paths, const int size, const int shards)
+--                          bool metricsAttach(fwd_path *paths, const int size)
+--                          fwd_metrics *metricsShard(fwd_path *path, const int shard)
+--                          void metricsAdd(uint64_t *counter, const uint64_t value)
+--                          int histogramBucket(const uint64_t value)
+--                          uint64_t histogramUpper(const int bucket)
+--                          void histogramRecord(fwd_histogram *hist, const uint64_t value)
+--                          void metricsWriteHistogram(FILE *out, const char *name, const char *label, fwd_path *path, const size_t offset, const int minExp, const int maxExp, const bool seconds)
+--                          void metricsSum(fwd_path *path, uint64_t *totals)
+--                          void metricsWrite(FILE *out, fwd_path *paths, const int size)
+--                          void metricsWriteHealth(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+--                          void metricsWriteTcpInfo(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+--                          void metricsWriteAcl(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+--                          bool metricsListen(int *sock, const char *spec)
+--                          void metricsServe(const int client)
+--                          void *metricsThread(void *arg)
+--                          bool metricsStart(const char *spec)
+--                          void metricsStop(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Per path traffic metrics. Every path has one shard of counters per worker and each shard is
+-- only ever written by its own worker, so updates are plain relaxed stores with no lock and no
+-- locked instruction, and shards sit on their own cache lines. The shards are summed when the
+-- metrics are read.
+--
+-- Latencies are kept in log-linear histograms in the style of HdrHistogram. Every power of two
+-- microseconds is split into 1 << HIST_SUB_BITS buckets, so a recorded value is off by at most
+-- 25% whatever its size, from a microsecond up to 2^HIST_MAX_EXP microseconds.
+--
+-- The metrics are served in the Prometheus text format by an admin thread on the address given
+-- with -m, either host:port or unix:path.
+---------------------------------------------------------------------------------------*/
+
+#define HIST_EXPORT_MIN 4
+#define ADMIN_BACKLOG 16
+#define ADMIN_REQUEST_SIZE 4096
+
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "acl.h"
+#include "health.h"
+#include "io.h"
+#include "net.h"
+#include "relay.h"
+#include "reload.h"
+#include "upgrade.h"
+
+static int metricsShards;
+static pthread_t metricsAdmin;
+static bool metricsRunning;
+
+// every series of one metric has to follow the one before it
+static const metrics_series metricsSeries[] = {
+    {"forwarder_connections_accepted_total", "counter", "", TOTAL_ACCEPTED},
+    {"forwarder_connections_active", "gauge", "", TOTAL_ACTIVE},
+    {"forwarder_connections_rejected_total", "counter", "", TOTAL_REJECTED},
+    {"forwarder_connections_rate_limited_total", "counter", "", TOTAL_RATE_LIMITED},
+    {"forwarder_connections_unavailable_total", "counter", "", TOTAL_UNAVAILABLE},
+    {"forwarder_connect_failures_total", "counter", "", TOTAL_CONNECT_FAILURES},
+    {"forwarder_connections_timed_out_total", "counter", ",reason=\"connect\"", TOTAL_CONNECT_TIMEOUTS},
+    {"forwarder_connections_timed_out_total", "counter", ",reason=\"idle\"", TOTAL_IDLE_TIMEOUTS},
+    {"forwarder_connections_timed_out_total", "counter", ",reason=\"lifetime\"", TOTAL_LIFETIME_TIMEOUTS},
+    {"forwarder_bytes_total", "counter", ",direction=\"upstream\"", TOTAL_BYTES_TO_UPSTREAM},
+    {"forwarder_bytes_total", "counter", ",direction=\"client\"", TOTAL_BYTES_TO_CLIENT},
+    {"forwarder_queued_bytes", "gauge", "", TOTAL_QUEUED},
+    {"forwarder_throttled_total", "counter", ",direction=\"upstream\"", TOTAL_THROTTLED_TO_UPSTREAM},
+    {"forwarder_throttled_total", "counter", ",direction=\"client\"", TOTAL_THROTTLED_TO_CLIENT},
+    {"forwarder_mirror_bytes_total", "counter", ",direction=\"upstream\"", TOTAL_MIRRORED_TO_UPSTREAM},
+    {"forwarder_mirror_bytes_total", "counter", ",direction=\"client\"", TOTAL_MIRRORED_TO_CLIENT},
+    {"forwarder_mirror_dropped_bytes_total", "counter", ",direction=\"upstream\"", TOTAL_MIRROR_DROPPED_TO_UPSTREAM},
+    {"forwarder_mirror_dropped_bytes_total", "counter", ",direction=\"client\"", TOTAL_MIRROR_DROPPED_TO_CLIENT},
+    {"forwarder_accept_queue_length", "gauge", "", TOTAL_ACCEPT_QUEUE_LENGTH},
+    {"forwarder_accept_queue_limit", "gauge", "", TOTAL_ACCEPT_QUEUE_LIMIT},
+    {"forwarder_pool_hits_total", "counter", "", TOTAL_POOL_HITS},
+    {"forwarder_pool_misses_total", "counter", "", TOTAL_POOL_MISSES},
+};
+
+#define METRICS_SERIES ((int)(sizeof(metricsSeries) / sizeof(metricsSeries[0])))
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Allocate through metricsAttach.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool metricsInit(fwd_path *paths, const int size, const int shards)
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--                              const int shards: The number of workers that will update the metrics.
+--
+-- RETURNS:                 True if every path has its metrics, false otherwise.
+--
+-- NOTES:
+-- Sets the number of shards every path gets and allocates them for paths.
+--------------------------------------------------------------------------------------------------*/
+bool metricsInit(fwd_path *paths, const int size, const int shards)
+{
+    metricsShards = shards;
+    return metricsAttach(paths, size);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsAttach
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool metricsAttach(fwd_path *paths, const int size)
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--
+-- RETURNS:                 True if every path has its metrics, false otherwise.
+--
+-- NOTES:
+-- Allocates one zeroed shard per worker for every path that does not have metrics yet, such as
+-- the paths added by a reload. Does nothing before metricsInit, as with the fork engine.
+--------------------------------------------------------------------------------------------------*/
+bool metricsAttach(fwd_path *paths, const int size)
+{
+    for (int i = 0; i < size && metricsShards > 0; i++)
+    {
+        if (paths[i].metrics)
+        {
+            continue;
+        }
+        if ((paths[i].metrics = aligned_alloc(64, sizeof(fwd_metrics) * metricsShards)) == NULL)
+        {
+            return false;
+        }
+        bzero(paths[i].metrics, sizeof(fwd_metrics) * metricsShards);
+        for (int j = 0; j < metricsShards; j++)
+        {
+            paths[i].metrics[j].listenFd = -1;
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsShard
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_metrics *metricsShard(fwd_path *path, const int shard)
+--                              fwd_path *path: The path to get the metrics of.
+--                              const int shard: The id of the worker.
+--
+-- RETURNS:                 The shard of the metrics of path that belongs to the worker.
+--------------------------------------------------------------------------------------------------*/
+fwd_metrics *metricsShard(fwd_path *path, const int shard)
+{
+    return path->metrics + shard;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsAdd
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsAdd(uint64_t *counter, const uint64_t value)
+--                              uint64_t *counter: The counter of a shard.
+--                              const uint64_t value: The amount to add.
+--
+-- NOTES:
+-- Adds to a counter that only the calling worker writes. The store is atomic so a reader never
+-- sees a torn value, but no read-modify-write is needed since there is a single writer.
+--------------------------------------------------------------------------------------------------*/
+void metricsAdd(uint64_t *counter, const uint64_t value)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                histogramBucket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int histogramBucket(const uint64_t value)
+--                              const uint64_t value: The value to record, in microseconds.
+--
+-- RETURNS:                 The index of the bucket that holds value.
+--
+-- NOTES:
+-- Values below 1 << HIST_SUB_BITS get a bucket each. Above that, the position of the highest set
+-- bit picks the power of two and the next HIST_SUB_BITS bits pick the bucket within it. Values
+-- past the last power of two land in the last bucket.
+--------------------------------------------------------------------------------------------------*/
+int histogramBucket(const uint64_t value)
+{
+    int exp;
+
+    if (value < (1 << HIST_SUB_BITS))
+    {
+        return value;
+    }
+
+    exp = 63 - __builtin_clzll(value);
+    if (exp >= HIST_MAX_EXP)
+    {
+        return HIST_BUCKETS - 1;
+    }
+
+    return ((exp - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+           + ((value >> (exp - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                histogramUpper
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uint64_t histogramUpper(const int bucket)
+--                              const int bucket: The index of a bucket.
+--
+-- RETURNS:                 The smallest value above the bucket, in microseconds.
+--------------------------------------------------------------------------------------------------*/
+uint64_t histogramUpper(const int bucket)
+{
+    int exp;
+    int sub;
+
+    if (bucket < (1 << HIST_SUB_BITS))
+    {
+        return bucket + 1;
+    }
+
+    exp = (bucket >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    sub = bucket & ((1 << HIST_SUB_BITS) - 1);
+    return (uint64_t)((1 << HIST_SUB_BITS) + sub + 1) << (exp - HIST_SUB_BITS);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                histogramRecord
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void histogramRecord(fwd_histogram *hist, const uint64_t value)
+--                              fwd_histogram *hist: The histogram of a shard.
+--                              const uint64_t value: The value to record, in microseconds.
+--
+-- NOTES:
+-- Records a value in a histogram that only the calling worker writes.
+--------------------------------------------------------------------------------------------------*/
+void histogramRecord(fwd_histogram *hist, const uint64_t value)
+{
+    metricsAdd(hist->buckets + histogramBucket(value), 1);
+    metricsAdd(&hist->count, 1);
+    metricsAdd(&hist->sum, value);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsWriteHistogram
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Write the range given and histograms of counts.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsWriteHistogram(FILE *out, const char *name, const char *label, fwd_path *path, const size_t offset, const int minExp, const int maxExp, const bool seconds)
+--                              FILE *out: Where to write the histogram.
+--                              const char *name: The metric name.
+--                              const char *label: The path label of the metric.
+--                              fwd_path *path: The path whose histogram to write.
+--                              const size_t offset: Where the histogram is within fwd_metrics.
+--                              const int minExp: The lowest power of two written as a bucket.
+--                              const int maxExp: The power of two past the highest bucket written.
+--                              const bool seconds: Whether the values are microseconds to be
+--                                                  written in seconds, or plain counts.
+--
+-- NOTES:
+-- Sums the histogram over every shard and writes it as a Prometheus histogram. Only the powers of
+-- two from 2^minExp up to 2^maxExp are written as le buckets, which all fall on bucket boundaries,
+-- to keep the output short. Counts are whole numbers, so the bucket of the values below 2^exp is
+-- written as le="2^exp - 1".
+--------------------------------------------------------------------------------------------------*/
+void metricsWriteHistogram(FILE *out, const char *name, const char *label, fwd_path *path, const size_t offset, const int minExp, const int maxExp, const bool seconds)
+{
+    fwd_histogram total;
+    fwd_histogram *shard;
+    uint64_t cumulative = 0;
+    int bucket = 0;
+
+    bzero(&total, sizeof(total));
+    for (int i = 0; i < metricsShards; i++)
+    {
+        shard = (fwd_histogram *)((char *)(path->metrics + i) + offset);
+        for (int j = 0; j < HIST_BUCKETS; j++)
+        {
+            total.buckets[j] += __atomic_load_n(shard->buckets + j, __ATOMIC_RELAXED);
+        }
+        total.count += __atomic_load_n(&shard->count, __ATOMIC_RELAXED);
+        total.sum += __atomic_load_n(&shard->sum, __ATOMIC_RELAXED);
+    }
+
+    for (int exp = minExp; exp < maxExp; exp++)
+    {
+        for (; bucket < HIST_BUCKETS && histogramUpper(bucket) <= (1ULL << exp); bucket++)
+        {
+            cumulative += total.buckets[bucket];
+        }
+        if (seconds)
+        {
+            fprintf(out, "%s_bucket{%s,le=\"%.6f\"} %lu\n", name, label, (double)(1ULL << exp) / 1e6, cumulative);
+        }
+        else
+        {
+            fprintf(out, "%s_bucket{%s,le=\"%llu\"} %lu\n", name, label, (1ULL << exp) - 1, cumulative);
+        }
+    }
+    fprintf(out, "%s_bucket{%s,le=\"+Inf\"} %lu\n", name, label, total.count);
+    if (seconds)
+    {
+        fprintf(out, "%s_sum{%s} %.6f\n", name, label, (double)total.sum / 1e6);
+    }
+    else
+    {
+        fprintf(out, "%s_sum{%s} %lu\n", name, label, total.sum);
+    }
+    fprintf(out, "%s_count{%s} %lu\n", name, label, total.count);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsSum
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsSum(fwd_path *path, uint64_t *totals)
+--                              fwd_path *path: A path that has metrics.
+--                              uint64_t *totals: The METRICS_TOTALS totals of the path to fill in.
+--
+-- NOTES:
+-- Sums the counters of every shard of a path. The accept queue is read from TCP_INFO on the
+-- listening sockets of every worker, where tcpi_unacked is the current length of the queue and
+-- tcpi_sacked its limit.
+--------------------------------------------------------------------------------------------------*/
+void metricsSum(fwd_path *path, uint64_t *totals)
+{
+    uint64_t closed = 0;
+    fwd_metrics *shard;
+    struct tcp_info info;
+    socklen_t length;
+
+    bzero(totals, METRICS_TOTALS * sizeof(uint64_t));
+    for (int j = 0; j < metricsShards; j++)
+    {
+        shard = path->metrics + j;
+        totals[TOTAL_ACCEPTED] += __atomic_load_n(&shard->accepted, __ATOMIC_RELAXED);
+        closed += __atomic_load_n(&shard->closed, __ATOMIC_RELAXED);
+        totals[TOTAL_REJECTED] += __atomic_load_n(&shard->rejected, __ATOMIC_RELAXED);
+        totals[TOTAL_RATE_LIMITED] += __atomic_load_n(&shard->rateLimited, __ATOMIC_RELAXED);
+        totals[TOTAL_CONNECT_FAILURES] += __atomic_load_n(&shard->connectFailures, __ATOMIC_RELAXED);
+        totals[TOTAL_BYTES_TO_UPSTREAM] += __atomic_load_n(&shard->bytesToUpstream, __ATOMIC_RELAXED);
+        totals[TOTAL_BYTES_TO_CLIENT] += __atomic_load_n(&shard->bytesToClient, __ATOMIC_RELAXED);
+        totals[TOTAL_QUEUED] += __atomic_load_n(&shard->queued, __ATOMIC_RELAXED);
+        totals[TOTAL_THROTTLED_TO_UPSTREAM] += __atomic_load_n(&shard->throttledToUpstream, __ATOMIC_RELAXED);
+        totals[TOTAL_THROTTLED_TO_CLIENT] += __atomic_load_n(&shard->throttledToClient, __ATOMIC_RELAXED);
+        totals[TOTAL_CONNECT_TIMEOUTS] += __atomic_load_n(&shard->connectTimeouts, __ATOMIC_RELAXED);
+        totals[TOTAL_IDLE_TIMEOUTS] += __atomic_load_n(&shard->idleTimeouts, __ATOMIC_RELAXED);
+        totals[TOTAL_LIFETIME_TIMEOUTS] += __atomic_load_n(&shard->lifetimeTimeouts, __ATOMIC_RELAXED);
+        totals[TOTAL_UNAVAILABLE] += __atomic_load_n(&shard->unavailable, __ATOMIC_RELAXED);
+        totals[TOTAL_MIRRORED_TO_UPSTREAM] += __atomic_load_n(&shard->mirroredToUpstream, __ATOMIC_RELAXED);
+        totals[TOTAL_MIRRORED_TO_CLIENT] += __atomic_load_n(&shard->mirroredToClient, __ATOMIC_RELAXED);
+        totals[TOTAL_MIRROR_DROPPED_TO_UPSTREAM] += __atomic_load_n(&shard->mirrorDroppedToUpstream, __ATOMIC_RELAXED);
+        totals[TOTAL_MIRROR_DROPPED_TO_CLIENT] += __atomic_load_n(&shard->mirrorDroppedToClient, __ATOMIC_RELAXED);
+
+        length = sizeof(info);
+        if (shard->listenFd != -1 && getsockopt(shard->listenFd, IPPROTO_TCP, TCP_INFO, &info, &length) == 0)
+        {
+            totals[TOTAL_ACCEPT_QUEUE_LENGTH] += info.tcpi_unacked;
+            totals[TOTAL_ACCEPT_QUEUE_LIMIT] += info.tcpi_sacked;
+        }
+    }
+    totals[TOTAL_ACTIVE] = totals[TOTAL_ACCEPTED] - closed;
+    totals[TOTAL_POOL_HITS] = __atomic_load_n(&path->poolHits, __ATOMIC_RELAXED);
+    totals[TOTAL_POOL_MISSES] = __atomic_load_n(&path->poolMisses, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsWrite
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Added the rejected connections and access list hits.
+--                          October 17, 2026 - Label the UDP paths.
+--                          October 17, 2026 - Added the relay buffer memory.
+--                          October 17, 2026 - Added the queued bytes.
+--                          October 17, 2026 - Added the rate limited connections and throttled reads.
+--                          October 17, 2026 - Added the timed out connections.
+--                          October 17, 2026 - Added the unavailable connections and the health of the backends.
+--                          October 17, 2026 - Added the mirrored and dropped mirror bytes.
+--                          October 17, 2026 - Added the TCP_INFO histograms of both legs.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsWrite(FILE *out, fwd_path *paths, const int size)
+--                              FILE *out: Where to write the metrics.
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--
+-- NOTES:
+-- Writes the metrics of every path in the Prometheus text format. Paths are labelled with their
+-- incoming address and port. The format wants every series of a metric right after its TYPE line,
+-- so the totals of every path are summed first with metricsSum and then written one metric at a
+-- time, every path within each. The memory held by relay buffers is written once for the whole
+-- process.
+--------------------------------------------------------------------------------------------------*/
+void metricsWrite(FILE *out, fwd_path *paths, const int size)
+{
+    size_t inUse;
+    size_t pooled;
+    char (*labels)[METRICS_LABEL_SIZE];
+    uint64_t (*totals)[METRICS_TOTALS];
+    int end;
+
+    if ((labels = calloc(size + 1, sizeof(*labels))) == NULL || (totals = calloc(size + 1, sizeof(*totals))) == NULL)
+    {
+        free(labels);
+        return;
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        if (paths[i].metrics)
+        {
+            snprintf(labels[i], sizeof(labels[i]), "path=\"%s:%d\"%s", paths[i].inName, ntohs(paths[i].in.sin_port),
+                paths[i].udp ? ",proto=\"udp\"" : "");
+            metricsSum(paths + i, totals[i]);
+        }
+    }
+
+    relayMemory(&inUse, &pooled);
+    fprintf(out, "# TYPE forwarder_relay_buffer_bytes gauge\n");
+    fprintf(out, "forwarder_relay_buffer_bytes{state=\"in_use\"} %zu\n", inUse);
+    fprintf(out, "forwarder_relay_buffer_bytes{state=\"pooled\"} %zu\n", pooled);
+
+    // the series of one metric are next to each other in the table
+    for (int first = 0; first < METRICS_SERIES; first = end)
+    {
+        end = first;
+        while (end < METRICS_SERIES && !strcmp(metricsSeries[end].name, metricsSeries[first].name))
+        {
+            end++;
+        }
+
+        fprintf(out, "# TYPE %s %s\n", metricsSeries[first].name, metricsSeries[first].type);
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = first; paths[i].metrics && j < end; j++)
+            {
+                fprintf(out, "%s{%s%s} %lu\n", metricsSeries[j].name, labels[i], metricsSeries[j].labels,
+                    totals[i][metricsSeries[j].total]);
+            }
+        }
+    }
+
+    fprintf(out, "# TYPE forwarder_connect_duration_seconds histogram\n");
+    for (int i = 0; i < size; i++)
+    {
+        if (paths[i].metrics)
+        {
+            metricsWriteHistogram(out, "forwarder_connect_duration_seconds", labels[i], paths + i, offsetof(fwd_metrics, connectTime),
+                HIST_EXPORT_MIN, HIST_MAX_EXP, true);
+        }
+    }
+    fprintf(out, "# TYPE forwarder_session_duration_seconds histogram\n");
+    for (int i = 0; i < size; i++)
+    {
+        if (paths[i].metrics)
+        {
+            metricsWriteHistogram(out, "forwarder_session_duration_seconds", labels[i], paths + i, offsetof(fwd_metrics, sessionTime),
+                HIST_EXPORT_MIN, HIST_MAX_EXP, true);
+        }
+    }
+
+    metricsWriteAcl(out, paths, size, labels);
+    metricsWriteHealth(out, paths, size, labels);
+    metricsWriteTcpInfo(out, paths, size, labels);
+    free(labels);
+    free(totals);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsWriteHealth
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsWriteHealth(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+--                              FILE *out: Where to write the metrics.
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--                              char labels[][METRICS_LABEL_SIZE]: The label of every path.
+--
+-- NOTES:
+-- Writes the circuit state, ejections and probe results of every backend of the paths that have
+-- health checks or circuit breaking, labelled with the backend. A backend on trial is not up yet.
+--------------------------------------------------------------------------------------------------*/
+void metricsWriteHealth(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+{
+    static const char *const families[] = {"forwarder_backend_up gauge", "forwarder_backend_ejections_total counter",
+                                           "forwarder_health_checks_total counter"};
+    char backend[64];
+    fwd_health *health;
+
+    for (int family = 0; family < 3; family++)
+    {
+        fprintf(out, "# TYPE %s\n", families[family]);
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = 0; paths[i].metrics && paths[i].health && j < paths[i].backendCount; j++)
+            {
+                health = paths[i].health + j;
+                snprintf(backend, sizeof(backend), "backend=\"%s:%d\"", paths[i].backends[j].name,
+                         ntohs(paths[i].backends[j].addr.sin_port));
+                if (family == 0)
+                {
+                    fprintf(out, "forwarder_backend_up{%s,%s} %d\n", labels[i], backend,
+                            __atomic_load_n(&health->state, __ATOMIC_RELAXED) == HEALTH_UP);
+                }
+                else if (family == 1)
+                {
+                    fprintf(out, "forwarder_backend_ejections_total{%s,%s} %lu\n", labels[i], backend,
+                            __atomic_load_n(&health->ejections, __ATOMIC_RELAXED));
+                }
+                else if (paths[i].healthInterval)
+                {
+                    fprintf(out, "forwarder_health_checks_total{%s,%s,result=\"passed\"} %lu\n", labels[i], backend,
+                            __atomic_load_n(&health->checksPassed, __ATOMIC_RELAXED));
+                    fprintf(out, "forwarder_health_checks_total{%s,%s,result=\"failed\"} %lu\n", labels[i], backend,
+                            __atomic_load_n(&health->checksFailed, __ATOMIC_RELAXED));
+                }
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsWriteTcpInfo
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsWriteTcpInfo(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+--                              FILE *out: Where to write the metrics.
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--                              char labels[][METRICS_LABEL_SIZE]: The label of every path.
+--
+-- NOTES:
+-- Writes the TCP_INFO histograms of both legs of the paths with the tcp_info option, labelled with
+-- leg="client" or leg="upstream". Each histogram only covers the range its values fall in.
+--------------------------------------------------------------------------------------------------*/
+void metricsWriteTcpInfo(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+{
+    static const metrics_histogram histograms[] = {
+        {"forwarder_tcp_rtt_seconds", offsetof(fwd_metrics, tcpRtt), HIST_EXPORT_MIN, 24, true},
+        {"forwarder_tcp_delivery_rate_bytes", offsetof(fwd_metrics, tcpDeliveryRate), 10, HIST_MAX_EXP, false},
+        {"forwarder_tcp_cwnd_segments", offsetof(fwd_metrics, tcpCwnd), 0, 16, false},
+        {"forwarder_tcp_retransmits", offsetof(fwd_metrics, tcpRetrans), 0, 16, false},
+    };
+    char legLabel[96];
+
+    for (size_t h = 0; h < sizeof(histograms) / sizeof(histograms[0]); h++)
+    {
+        fprintf(out, "# TYPE %s histogram\n", histograms[h].name);
+        for (int i = 0; i < size; i++)
+        {
+            for (int leg = 0; paths[i].metrics && paths[i].tcpInfo && leg < 2; leg++)
+            {
+                snprintf(legLabel, sizeof(legLabel), "%s,leg=\"%s\"", labels[i], leg == 0 ? "client" : "upstream");
+                metricsWriteHistogram(out, histograms[h].name, legLabel, paths + i,
+                    histograms[h].offset + leg * sizeof(fwd_histogram), histograms[h].minExp, histograms[h].maxExp,
+                    histograms[h].seconds);
+            }
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsWriteAcl
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsWriteAcl(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+--                              FILE *out: Where to write the metrics.
+--                              fwd_path *paths: The array of forwarding paths.
+--                              const int size: The number of paths.
+--                              char labels[][METRICS_LABEL_SIZE]: The label of every path.
+--
+-- NOTES:
+-- Writes the hits of every access list rule that has decided on a client at least once, labelled
+-- with the rule. Rules that never matched are left out so a list of thousands of prefixes does not
+-- turn into thousands of series. Clients that matched no rule are counted as rule="unmatched".
+--------------------------------------------------------------------------------------------------*/
+void metricsWriteAcl(FILE *out, fwd_path *paths, const int size, char labels[][METRICS_LABEL_SIZE])
+{
+    char rule[ACL_RULE_SIZE];
+    size_t hits;
+    fwd_acl *acl;
+
+    fprintf(out, "# TYPE forwarder_acl_hits_total counter\n");
+    for (int i = 0; i < size; i++)
+    {
+        if (!paths[i].metrics || (acl = paths[i].acl) == NULL)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < acl->ruleCount; j++)
+        {
+            if ((hits = __atomic_load_n(&acl->rules[j].hits, __ATOMIC_RELAXED)) == 0)
+            {
+                continue;
+            }
+            aclFormatRule(acl->rules + j, rule, sizeof(rule));
+            fprintf(out, "forwarder_acl_hits_total{%s,rule=\"%s\"} %zu\n", labels[i], rule, hits);
+        }
+
+        if ((hits = __atomic_load_n(&acl->unmatchedHits, __ATOMIC_RELAXED)) > 0)
+        {
+            fprintf(out, "forwarder_acl_hits_total{%s,rule=\"unmatched\"} %zu\n", labels[i], hits);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsListen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool metricsListen(int *sock, const char *spec)
+--                              int *sock: The pointer that will hold the listening socket.
+--                              const char *spec: unix:path, host:port or :port for 127.0.0.1.
+--
+-- RETURNS:                 True if the admin socket is listening, false otherwise.
+--
+-- NOTES:
+-- Creates the listening socket of the admin endpoint. A stale unix socket left behind by an
+-- earlier run is removed first.
+--------------------------------------------------------------------------------------------------*/
+bool metricsListen(int *sock, const char *spec)
+{
+    char host[64];
+    const char *colon;
+    struct sockaddr_un local;
+    struct sockaddr_in inet;
+    struct sockaddr *addr;
+    socklen_t length;
+    int arg = 1;
+
+    if (!strncmp(spec, "unix:", 5))
+    {
+        bzero(&local, sizeof(local));
+        local.sun_family = AF_UNIX;
+        if (strlen(spec + 5) >= sizeof(local.sun_path))
+        {
+            return false;
+        }
+        strcpy(local.sun_path, spec + 5);
+        unlink(local.sun_path);
+        addr = (struct sockaddr *)&local;
+        length = sizeof(local);
+    }
+    else
+    {
+        if ((colon = strrchr(spec, ':')) == NULL || colon - spec >= (long)sizeof(host))
+        {
+            return false;
+        }
+        memcpy(host, spec, colon - spec);
+        host[colon - spec] = 0;
+
+        bzero(&inet, sizeof(inet));
+        if (!fillAddr(&inet, host[0] ? host : "127.0.0.1", atoi(colon + 1)))
+        {
+            return false;
+        }
+        addr = (struct sockaddr *)&inet;
+        length = sizeof(inet);
+    }
+
+    if ((*sock = socket(addr->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1)
+    {
+        return false;
+    }
+
+    if (addr->sa_family == AF_INET)
+    {
+        setsockopt(*sock, SOL_SOCKET, SO_REUSEADDR, &arg, sizeof(arg));
+    }
+
+    if (bind(*sock, addr, length) == -1 || listen(*sock, ADMIN_BACKLOG) == -1)
+    {
+        close(*sock);
+        *sock = -1;
+        return false;
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsServe
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Serve the paths of the current configuration.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsServe(const int client)
+--                              const int client: The accepted admin connection.
+--
+-- NOTES:
+-- Answers one HTTP request with the metrics of the paths of the current configuration, whatever
+-- the request path, and closes the connection. The request is read with a timeout so a client
+-- that never sends one cannot hold the admin thread.
+--------------------------------------------------------------------------------------------------*/
+void metricsServe(const int client)
+{
+    fwd_config *config;
+    char request[ADMIN_REQUEST_SIZE];
+    char header[128];
+    size_t used = 0;
+    ssize_t n;
+    char *body = NULL;
+    size_t bodyLength = 0;
+    FILE *out;
+
+    uwuSetSocketTimeout(1, 0, client);
+    while (used < sizeof(request) - 1 && (n = recv(client, request + used, sizeof(request) - 1 - used, 0)) > 0)
+    {
+        used += n;
+        request[used] = 0;
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+        {
+            break;
+        }
+    }
+
+    if ((out = open_memstream(&body, &bodyLength)) == NULL)
+    {
+        close(client);
+        return;
+    }
+    config = configAcquireCurrent();
+    metricsWrite(out, config->paths, config->size);
+    configRelease(config);
+    fclose(out);
+
+    n = snprintf(header, sizeof(header),
+                 "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n",
+                 bodyLength);
+    if (send(client, header, n, MSG_NOSIGNAL) == n)
+    {
+        for (size_t off = 0; off < bodyLength; off += n)
+        {
+            if ((n = send(client, body + off, bodyLength - off, MSG_NOSIGNAL)) <= 0)
+            {
+                break;
+            }
+        }
+    }
+
+    free(body);
+    close(client);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Serve the paths of the current configuration.
+--                          October 17, 2026 - Only cancel the thread while it waits for a scrape.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *metricsThread(void *arg)
+--                              void *arg: The listening admin socket.
+--
+-- RETURNS:                 NULL, never returns.
+--
+-- NOTES:
+-- Body of the admin thread. Serves scrapes one at a time, they are rare and cheap. The thread can
+-- only be cancelled by metricsStop in accept, never while it holds a configuration.
+--------------------------------------------------------------------------------------------------*/
+void *metricsThread(void *arg)
+{
+    int sock = (intptr_t)arg;
+    int client;
+
+    while (1)
+    {
+        if ((client = accept4(sock, NULL, NULL, SOCK_CLOEXEC)) == -1)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                Error("Could not accept admin connection");
+            }
+            continue;
+        }
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        metricsServe(client);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Serve the paths of the current configuration.
+--                          October 17, 2026 - Take the admin socket over from the old process of an upgrade.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool metricsStart(const char *spec)
+--                              const char *spec: The admin address given with -m.
+--
+-- RETURNS:                 True if the admin endpoint is up, false otherwise.
+--
+-- NOTES:
+-- Opens the admin endpoint and starts the thread that serves it. metricsInit must have been
+-- called first. After an upgrade the admin socket of the old process is used, so a unix socket is
+-- not removed from under it.
+--------------------------------------------------------------------------------------------------*/
+bool metricsStart(const char *spec)
+{
+    int sock;
+
+    if ((sock = upgradeTake(UPGRADE_METRICS, 0, 0)) == -1 && !metricsListen(&sock, spec))
+    {
+        return false;
+    }
+
+    if (pthread_create(&metricsAdmin, NULL, metricsThread, (void *)(intptr_t)sock))
+    {
+        close(sock);
+        return false;
+    }
+    pthread_detach(metricsAdmin);
+    metricsRunning = true;
+    upgradeTrack(sock, UPGRADE_METRICS, 0, 0);
+
+    Log("Serving metrics on %s", spec);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                metricsStop
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void metricsStop(void)
+--
+-- NOTES:
+-- Stops the admin thread once the admin socket has been handed over by an upgrade, so scrapes are
+-- only answered by the new process. The socket itself is left open, the new process listens on it.
+--------------------------------------------------------------------------------------------------*/
+void metricsStop(void)
+{
+    if (metricsRunning)
+    {
+        pthread_cancel(metricsAdmin);
+        metricsRunning = false;
+    }
+}
@@ -7,8 +7,21 @@
 --                          int uwuCreateTCPSocket(int *sock)
 --                          int createConnectedSocket(int *sock, struct sockaddr_in *addr)
 --                          int uwuCreateBoundSocket(int *sock, const short port)
+--                          int uwuCreateReusePortSocket(int *sock, const short port)
 --                          int uwuAcceptSocket(const int listenSocket, int *newSocket, struct sockaddr_in *client)
 --                          int uwuSetSocketTimeout(const size_t sec, const size_t usec, const int sock)
+--                          int uwuSetNonBlocking(const int sock)
+--                          int uwuSetBlocking(const int sock)
+--                          int createNonBlockingConnectedSocket(int *sock, struct sockaddr_in *addr, const net_tuning *tuning)
+--                          int createListeningSocket(int *sock, const short port, const bool reusePort, const int backlog)
+--                          void uwuResetSocket(const int sock)
+--                          int uwuCreateUDPSocket(int *sock)
+--                          int createBoundUDPSocket(int *sock, const short port)
+--                          int createConnectedUDPSocket(int *sock, struct sockaddr_in *addr)
+--                          void uwuInitTuning(net_tuning *tuning)
+--                          int uwuTuneSocket(const int sock, const net_tuning *tuning, const bool listening)
+--                          void uwuTuneAccepted(const int sock, const net_tuning *tuning)
+--                          int uwuSetIncomingCpu(const int sock, const int cpu)
 --
 -- DATE:                    April 1, 2019
 --
@@ -24,6 +37,7 @@
 
 #include "net.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -145,6 +159,55 @@ int uwuCreateBoundSocket(int *sock, const short port)
     return 1;
 }
 
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuCreateReusePortSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uwuCreateReusePortSocket(int *sock, const short port)
+--                              int *sock: The pointer that will hold the bound socket.
+--                              const short port: The port to listen on.
+--
+-- RETURNS:                 1 if the socket was created and bounded without error, 0 otherwise.
+--
+-- NOTES:
+-- Same as uwuCreateBoundSocket but the socket is also set to SO_REUSEPORT before it is bound, so
+-- several sockets can listen on the same port and the kernel spreads new connections across them.
+--------------------------------------------------------------------------------------------------*/
+int uwuCreateReusePortSocket(int *sock, const short port)
+{
+    int arg = 1;
+    struct sockaddr_in server;
+
+    if (!uwuCreateTCPSocket(sock))
+    {
+        return 0;
+    }
+
+    if (setsockopt(*sock, SOL_SOCKET, SO_REUSEPORT, &arg, sizeof(arg)) == -1)
+    {
+        return 0;
+    }
+
+    bzero(&server, sizeof(struct sockaddr_in));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(*sock, (struct sockaddr *)&server, sizeof(server)) == -1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
 /*--------------------------------------------------------------------------------------------------
 -- FUNCTION:                uwuAcceptSocket
 --
@@ -229,4 +292,483 @@ int uwuSetSocketTimeout(const size_t sec, const size_t usec, const int sock)
     }
 
     return 1;
-}
\ No newline at end of file
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuSetNonBlocking
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uwuSetNonBlocking(const int sock)
+--                              const int sock: The socket to modify.
+--
+-- RETURNS:                 1 if the socket was set to non-blocking, 0 otherwise.
+--
+-- NOTES:
+-- Adds O_NONBLOCK to the file status flags of sock.
+--------------------------------------------------------------------------------------------------*/
+int uwuSetNonBlocking(const int sock)
+{
+    int flags;
+
+    if ((flags = fcntl(sock, F_GETFL, 0)) == -1)
+    {
+        return 0;
+    }
+
+    if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) == -1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuSetBlocking
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uwuSetBlocking(const int sock)
+--                              const int sock: The socket to modify.
+--
+-- RETURNS:                 1 if the socket was set to blocking, 0 otherwise.
+--
+-- NOTES:
+-- Removes O_NONBLOCK from the file status flags of sock.
+--------------------------------------------------------------------------------------------------*/
+int uwuSetBlocking(const int sock)
+{
+    int flags;
+
+    if ((flags = fcntl(sock, F_GETFL, 0)) == -1)
+    {
+        return 0;
+    }
+
+    if (fcntl(sock, F_SETFL, flags & ~O_NONBLOCK) == -1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                createNonBlockingConnectedSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Set the socket options of the path before connecting.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int createNonBlockingConnectedSocket(int *sock, struct sockaddr_in *addr, const net_tuning *tuning)
+--                              int *sock: The pointer that will hold the connecting socket.
+--                              struct sockaddr_in *addr: Pointer to address struct.
+--                              const net_tuning *tuning: The options to set before connecting, may be NULL.
+--
+-- RETURNS:                 1 if the connect completed or is in progress, 0 otherwise.
+--
+-- NOTES:
+-- Non-blocking version of createConnectedSocket. The connect is started but not waited on, the
+-- caller must wait for the socket to become writable and check SO_ERROR to learn the outcome. On
+-- failure the socket is closed and sock is set to -1. The tuning is set before the connect so the
+-- buffer sizes are known to the handshake, an option the kernel refuses does not fail the connect.
+--------------------------------------------------------------------------------------------------*/
+int createNonBlockingConnectedSocket(int *sock, struct sockaddr_in *addr, const net_tuning *tuning)
+{
+    if (!uwuCreateTCPSocket(sock))
+    {
+        return 0;
+    }
+
+    if (tuning)
+    {
+        uwuTuneSocket(*sock, tuning, false);
+    }
+
+    if (!uwuSetNonBlocking(*sock))
+    {
+        close(*sock);
+        *sock = -1;
+        return 0;
+    }
+
+    if (connect(*sock, (struct sockaddr *)addr, sizeof(*addr)) == -1 && errno != EINPROGRESS)
+    {
+        close(*sock);
+        *sock = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                createListeningSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int createListeningSocket(int *sock, const short port, const bool reusePort, const int backlog)
+--                              int *sock: The pointer that will hold the listening socket.
+--                              const short port: The port to listen on.
+--                              const bool reusePort: Whether the port is shared with other sockets.
+--                              const int backlog: The accept queue length.
+--
+-- RETURNS:                 1 if the socket is listening, 0 otherwise.
+--
+-- NOTES:
+-- Creates a bound, non-blocking socket that is listening on port. On failure the socket is closed
+-- and sock is set to -1.
+--------------------------------------------------------------------------------------------------*/
+int createListeningSocket(int *sock, const short port, const bool reusePort, const int backlog)
+{
+    if (!(reusePort ? uwuCreateReusePortSocket : uwuCreateBoundSocket)(sock, port)
+        || !uwuSetNonBlocking(*sock)
+        || listen(*sock, backlog) == -1)
+    {
+        if (*sock != -1)
+        {
+            close(*sock);
+        }
+        *sock = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuResetSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uwuResetSocket(const int sock)
+--                              const int sock: The connected socket to drop.
+--
+-- NOTES:
+-- Closes sock with a reset instead of a FIN by turning lingering on with a zero timeout. Used for
+-- refused clients so they do not leave a TIME_WAIT socket behind.
+--------------------------------------------------------------------------------------------------*/
+void uwuResetSocket(const int sock)
+{
+    struct linger linger = {.l_onoff = 1, .l_linger = 0};
+
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+    close(sock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuCreateUDPSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uwuCreateUDPSocket(int *sock)
+--                              int *sock: The pointer that will hold the new socket.
+--
+-- RETURNS:                 1 if the socket was created without error, 0 otherwise.
+--
+-- NOTES:
+-- Creates a non-blocking UDP socket. On failure the socket is closed and sock is set to -1.
+--------------------------------------------------------------------------------------------------*/
+int uwuCreateUDPSocket(int *sock)
+{
+    if ((*sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                createBoundUDPSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int createBoundUDPSocket(int *sock, const short port)
+--                              int *sock: The pointer that will hold the bound socket.
+--                              const short port: The port to receive datagrams on.
+--
+-- RETURNS:                 1 if the socket is bound, 0 otherwise.
+--
+-- NOTES:
+-- Creates a non-blocking UDP socket bound to port on every address. On failure the socket is
+-- closed and sock is set to -1.
+--------------------------------------------------------------------------------------------------*/
+int createBoundUDPSocket(int *sock, const short port)
+{
+    int arg = 1;
+    struct sockaddr_in server;
+
+    if (!uwuCreateUDPSocket(sock))
+    {
+        return 0;
+    }
+
+    bzero(&server, sizeof(struct sockaddr_in));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (setsockopt(*sock, SOL_SOCKET, SO_REUSEADDR, &arg, sizeof(arg)) == -1
+        || bind(*sock, (struct sockaddr *)&server, sizeof(server)) == -1)
+    {
+        close(*sock);
+        *sock = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                createConnectedUDPSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int createConnectedUDPSocket(int *sock, struct sockaddr_in *addr)
+--                              int *sock: The pointer that will hold the connected socket.
+--                              struct sockaddr_in *addr: Pointer to address struct.
+--
+-- RETURNS:                 1 if the socket was created and connected, 0 otherwise.
+--
+-- NOTES:
+-- Creates a non-blocking UDP socket connected to addr, so it only receives datagrams from addr
+-- and can be written without a destination. On failure the socket is closed and sock is set to -1.
+--------------------------------------------------------------------------------------------------*/
+int createConnectedUDPSocket(int *sock, struct sockaddr_in *addr)
+{
+    if (!uwuCreateUDPSocket(sock))
+    {
+        return 0;
+    }
+
+    if (connect(*sock, (struct sockaddr *)addr, sizeof(*addr)) == -1)
+    {
+        close(*sock);
+        *sock = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuInitTuning
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uwuInitTuning(net_tuning *tuning)
+--                              net_tuning *tuning: The tuning to clear.
+--
+-- NOTES:
+-- Leaves every option at the default of the kernel.
+--------------------------------------------------------------------------------------------------*/
+void uwuInitTuning(net_tuning *tuning)
+{
+    memset(tuning, 0, sizeof(net_tuning));
+    tuning->nodelay = -1;
+    tuning->quickack = -1;
+    tuning->rcvbuf = -1;
+    tuning->sndbuf = -1;
+    tuning->fastopen = -1;
+    tuning->deferAccept = -1;
+    tuning->keepIdle = -1;
+    tuning->keepInterval = -1;
+    tuning->keepCount = -1;
+    tuning->notsentLowat = -1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuTuneSocket
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uwuTuneSocket(const int sock, const net_tuning *tuning, const bool listening)
+--                              const int sock: The TCP socket to tune.
+--                              const net_tuning *tuning: The options to set.
+--                              const bool listening: Whether sock is about to listen or connect.
+--
+-- RETURNS:                 1 if every option was set, 0 if the kernel refused any of them.
+--
+-- NOTES:
+-- Sets every option of the tuning that is not -1 and carries on past the ones that fail. Sockets
+-- accepted by a listener are copies of it, so the options set on the listener reach every accepted
+-- socket without a system call per connection, except TCP_QUICKACK which uwuTuneAccepted sets.
+-- TCP_DEFER_ACCEPT is only set on listeners. fastopen is the length of the TCP_FASTOPEN queue on
+-- a listener and turns TCP_FASTOPEN_CONNECT on for a connecting socket.
+--------------------------------------------------------------------------------------------------*/
+int uwuTuneSocket(const int sock, const net_tuning *tuning, const bool listening)
+{
+    int failed = 0;
+    int on = 1;
+
+    if (tuning->rcvbuf != -1)
+    {
+        failed |= setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &tuning->rcvbuf, sizeof(int));
+    }
+    if (tuning->sndbuf != -1)
+    {
+        failed |= setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &tuning->sndbuf, sizeof(int));
+    }
+    if (tuning->nodelay != -1)
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &tuning->nodelay, sizeof(int));
+    }
+    if (tuning->keepIdle != -1)
+    {
+        failed |= setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &tuning->keepIdle, sizeof(int));
+    }
+    if (tuning->keepInterval != -1)
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &tuning->keepInterval, sizeof(int));
+    }
+    if (tuning->keepCount != -1)
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &tuning->keepCount, sizeof(int));
+    }
+    if (tuning->notsentLowat != -1)
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &tuning->notsentLowat, sizeof(int));
+    }
+    if (tuning->congestion[0])
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_CONGESTION, tuning->congestion, strlen(tuning->congestion));
+    }
+
+    if (listening)
+    {
+        if (tuning->fastopen != -1)
+        {
+            failed |= setsockopt(sock, IPPROTO_TCP, TCP_FASTOPEN, &tuning->fastopen, sizeof(int));
+        }
+        if (tuning->deferAccept != -1)
+        {
+            failed |= setsockopt(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, &tuning->deferAccept, sizeof(int));
+        }
+        return !failed;
+    }
+
+    if (tuning->fastopen > 0)
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on));
+    }
+    if (tuning->quickack != -1)
+    {
+        failed |= setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, &tuning->quickack, sizeof(int));
+    }
+    return !failed;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuTuneAccepted
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uwuTuneAccepted(const int sock, const net_tuning *tuning)
+--                              const int sock: A socket returned by accept.
+--                              const net_tuning *tuning: The options its listener was tuned with.
+--
+-- NOTES:
+-- Sets what an accepted socket does not inherit from its listener, which is only TCP_QUICKACK.
+-- The kernel may leave quick ack mode again on its own, so this only covers the start of the
+-- connection.
+--------------------------------------------------------------------------------------------------*/
+void uwuTuneAccepted(const int sock, const net_tuning *tuning)
+{
+    if (tuning->quickack != -1)
+    {
+        setsockopt(sock, IPPROTO_TCP, TCP_QUICKACK, &tuning->quickack, sizeof(int));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uwuSetIncomingCpu
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uwuSetIncomingCpu(const int sock, const int cpu)
+--                              const int sock: A listening socket in a SO_REUSEPORT group.
+--                              const int cpu: The CPU the socket is served on.
+--
+-- RETURNS:                 1 if the socket option was set, 0 otherwise.
+--
+-- NOTES:
+-- Sets SO_INCOMING_CPU so the kernel prefers this socket of the group for connections whose
+-- packets were received on cpu. Kernels before 6.2 only use it to break ties.
+--------------------------------------------------------------------------------------------------*/
+int uwuSetIncomingCpu(const int sock, const int cpu)
+{
+    return setsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+}
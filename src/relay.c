@@ -0,0 +1,1135 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             relay.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          relay_pool *relayPool(void)
+--                          void relayAccount(const ssize_t inUse, const ssize_t pooled)
+--                          void relayMemory(size_t *inUse, size_t *pooled)
+--                          char *relayBorrow(const int sizeClass)
+--                          void relayReturn(char *buffer, const int sizeClass)
+--                          size_t relayCapacity(const relay_chunk *chunk)
+--                          relay_chunk *relayPush(relay_dir *dir)
+--                          void relayPop(relay_dir *dir)
+--                          void relayPut(relay_dir *dir)
+--                          void relayAdapt(relay_dir *dir, const size_t n, const size_t size)
+--                          bool relayInitSplice(relay_dir *dir)
+--                          void relayRelease(relay_dir *dir)
+--                          bool relayPending(const relay_dir *dir)
+--                          size_t relayQueued(const relay_dir *dir)
+--                          bool relayShutdown(const int to, relay_dir *dir)
+--                          int relayCopy(const int from, const int to, relay_dir *dir)
+--                          int relaySplice(const int from, const int to, relay_dir *dir)
+--                          int relayDirection(const int from, const int to, relay_dir *dir)
+--                          bool relayMirrorInit(relay_mirror *mirror, const size_t limit)
+--                          void relayMirrorTee(relay_dir *dir, const size_t n)
+--                          void relayMirrorWrite(relay_dir *dir, const char *data, const size_t n)
+--                          int relayMirrorFlush(relay_dir *dir)
+--                          void relayMirrorRelease(relay_mirror *mirror)
+--                          ssize_t relayCopyBlocking(const int from, const int to, relay_end *end)
+--                          ssize_t relaySpliceBlocking(const int from, const int to, relay_end *end)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Contains the data plane, the functions that move bytes from one socket to another. The copy
+-- functions read into a user space buffer and write it back out, the splice functions move the
+-- data socket -> pipe -> socket so the payload never leaves the kernel.
+--
+-- Copy buffers are not part of a connection. A direction borrows one from the pool of its thread
+-- when it is about to read and gives it back as soon as everything read has been written, so an
+-- idle connection holds no buffer at all. Buffers come in RELAY_CLASSES sizes from 4 KB to 64 KB
+-- and every direction picks its size from what it has been reading: a read that fills the buffer
+-- moves it up a size, a read that uses less than a quarter of it moves it down one. Every thread
+-- keeps up to RELAY_POOL_KEEP free buffers of each size, the pools need no locking since a buffer
+-- is always returned by the thread that borrowed it.
+--
+-- Data that the other socket will not take yet is queued in a list of such buffers, each one
+-- headed by a relay_chunk. The queue of a direction is bounded by dir.limit: once it is full the
+-- direction stops reading, which leaves the data in the kernel and lets TCP flow control slow the
+-- sender down, and it reads again once the other socket is writable and the queue has drained.
+-- The end of stream is passed on with shutdown(SHUT_WR) once everything before it was written, so
+-- a half-closed connection keeps working in the other direction. A direction also stops reading
+-- once it has read dir.allowance bytes, which is how the caller applies rate limits.
+--
+-- A direction with a dir.mirror hands a copy of everything it reads to a pipe of its own, tee'd
+-- from the splice pipe or written from the copy buffer, and spliced from there into mirror.fd.
+-- That pipe holds at most mirror.limit bytes and anything that does not fit is dropped, so a slow
+-- mirror never holds up the direction it copies.
+---------------------------------------------------------------------------------------*/
+
+#include "relay.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "res.h"
+
+static __thread relay_pool threadPool;
+static relay_pool *pools;
+static pthread_mutex_t poolsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayPool
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               relay_pool *relayPool(void)
+--
+-- RETURNS:                 The buffer pool of the calling thread.
+--
+-- NOTES:
+-- Adds the pool of the calling thread to the list read by relayMemory the first time it is used.
+--------------------------------------------------------------------------------------------------*/
+relay_pool *relayPool(void)
+{
+    if (!threadPool.registered)
+    {
+        pthread_mutex_lock(&poolsLock);
+        threadPool.registered = true;
+        threadPool.next = pools;
+        __atomic_store_n(&pools, &threadPool, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&poolsLock);
+    }
+
+    return &threadPool;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayAccount
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayAccount(const ssize_t inUse, const ssize_t pooled)
+--                              const ssize_t inUse: The change in bytes held by connections.
+--                              const ssize_t pooled: The change in bytes kept free for reuse.
+--
+-- NOTES:
+-- Updates the memory counters of the calling thread. Only the owning thread writes them, the stores
+-- are atomic so relayMemory never reads a torn value. Engines with buffers of their own, such as
+-- the slab of an io_uring worker, report them here too.
+--------------------------------------------------------------------------------------------------*/
+void relayAccount(const ssize_t inUse, const ssize_t pooled)
+{
+    relay_pool *pool = relayPool();
+
+    __atomic_store_n(&pool->inUse, pool->inUse + inUse, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->pooled, pool->pooled + pooled, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayMemory
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayMemory(size_t *inUse, size_t *pooled)
+--                              size_t *inUse: Set to the bytes of relay buffers held by connections.
+--                              size_t *pooled: Set to the bytes of relay buffers kept free for reuse.
+--
+-- NOTES:
+-- Sums the counters of every thread. Safe to call from any thread.
+--------------------------------------------------------------------------------------------------*/
+void relayMemory(size_t *inUse, size_t *pooled)
+{
+    *inUse = 0;
+    *pooled = 0;
+    for (relay_pool *pool = __atomic_load_n(&pools, __ATOMIC_ACQUIRE); pool; pool = pool->next)
+    {
+        *inUse += __atomic_load_n(&pool->inUse, __ATOMIC_RELAXED);
+        *pooled += __atomic_load_n(&pool->pooled, __ATOMIC_RELAXED);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayBorrow
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               char *relayBorrow(const int sizeClass)
+--                              const int sizeClass: The size of the buffer, RELAY_CLASS_SIZE(sizeClass).
+--
+-- RETURNS:                 A buffer of the requested size.
+--
+-- NOTES:
+-- Takes a buffer from the pool of the calling thread, or allocates one if the pool is empty.
+--------------------------------------------------------------------------------------------------*/
+char *relayBorrow(const int sizeClass)
+{
+    relay_pool *pool = relayPool();
+    size_t size = RELAY_CLASS_SIZE(sizeClass);
+    char *buffer;
+
+    if ((buffer = pool->free[sizeClass]) != NULL)
+    {
+        pool->free[sizeClass] = *(char **)buffer;
+        pool->count[sizeClass]--;
+        relayAccount(size, -(ssize_t)size);
+        return buffer;
+    }
+
+    if ((buffer = malloc(size)) == NULL)
+    {
+        die("malloc");
+    }
+    relayAccount(size, 0);
+    return buffer;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayReturn
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayReturn(char *buffer, const int sizeClass)
+--                              char *buffer: A buffer from relayBorrow.
+--                              const int sizeClass: The size it was borrowed with.
+--
+-- NOTES:
+-- Gives a buffer back to the pool of the calling thread, or frees it if the pool already holds
+-- RELAY_POOL_KEEP buffers of that size. Free buffers are linked through their first bytes.
+--------------------------------------------------------------------------------------------------*/
+void relayReturn(char *buffer, const int sizeClass)
+{
+    relay_pool *pool = relayPool();
+    size_t size = RELAY_CLASS_SIZE(sizeClass);
+
+    if (pool->count[sizeClass] >= RELAY_POOL_KEEP)
+    {
+        free(buffer);
+        relayAccount(-(ssize_t)size, 0);
+        return;
+    }
+
+    *(char **)buffer = pool->free[sizeClass];
+    pool->free[sizeClass] = buffer;
+    pool->count[sizeClass]++;
+    relayAccount(-(ssize_t)size, size);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayCapacity
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               size_t relayCapacity(const relay_chunk *chunk)
+--                              const relay_chunk *chunk: A chunk from relayPush.
+--
+-- RETURNS:                 The number of bytes of data the chunk can hold.
+--------------------------------------------------------------------------------------------------*/
+size_t relayCapacity(const relay_chunk *chunk)
+{
+    return RELAY_CLASS_SIZE(chunk->sizeClass) - sizeof(relay_chunk);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayPush
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               relay_chunk *relayPush(relay_dir *dir)
+--                              relay_dir *dir: The direction to add a chunk to.
+--
+-- RETURNS:                 The new, empty, last chunk of the queue.
+--
+-- NOTES:
+-- Borrows a buffer of the size picked by relayAdapt and adds it to the end of the queue.
+--------------------------------------------------------------------------------------------------*/
+relay_chunk *relayPush(relay_dir *dir)
+{
+    relay_chunk *chunk = (relay_chunk *)relayBorrow(dir->sizeClass);
+
+    chunk->next = NULL;
+    chunk->start = 0;
+    chunk->end = 0;
+    chunk->sizeClass = dir->sizeClass;
+    if (dir->tail)
+    {
+        dir->tail->next = chunk;
+    }
+    else
+    {
+        dir->head = chunk;
+    }
+    dir->tail = chunk;
+    return chunk;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayPop
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayPop(relay_dir *dir)
+--                              relay_dir *dir: The direction to take the first chunk from.
+--
+-- NOTES:
+-- Removes the first chunk of the queue and returns its buffer to the pool. Whatever was left in it
+-- is taken off the queued bytes of the direction.
+--------------------------------------------------------------------------------------------------*/
+void relayPop(relay_dir *dir)
+{
+    relay_chunk *chunk = dir->head;
+
+    dir->queued -= chunk->end - chunk->start;
+    if ((dir->head = chunk->next) == NULL)
+    {
+        dir->tail = NULL;
+    }
+    relayReturn((char *)chunk, chunk->sizeClass);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayPut
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Return every chunk of the queue.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayPut(relay_dir *dir)
+--                              relay_dir *dir: The direction to take the buffers from.
+--
+-- NOTES:
+-- Returns every buffer queued in the direction. Anything still in them is discarded.
+--------------------------------------------------------------------------------------------------*/
+void relayPut(relay_dir *dir)
+{
+    while (dir->head)
+    {
+        relayPop(dir);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayAdapt
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Compare with the size of the read instead of the buffer.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayAdapt(relay_dir *dir, const size_t n, const size_t size)
+--                              relay_dir *dir: The direction that read.
+--                              const size_t n: The number of bytes the read returned.
+--                              const size_t size: The number of bytes the read asked for.
+--
+-- NOTES:
+-- Picks the buffer size of the next borrow. A read that filled the buffer means more was waiting,
+-- so the next buffer is twice as big. A read that used less than a quarter of it halves the next
+-- one, so a bulk transfer climbs to 64 KB in a few reads and an interactive session stays at 4 KB.
+-- Buffers never grow past the queue limit of the direction.
+--------------------------------------------------------------------------------------------------*/
+void relayAdapt(relay_dir *dir, const size_t n, const size_t size)
+{
+    if (n == size && dir->sizeClass < RELAY_CLASSES - 1 && RELAY_CLASS_SIZE(dir->sizeClass + 1) <= dir->limit)
+    {
+        dir->sizeClass++;
+    }
+    else if (n < size / 4 && dir->sizeClass > 0)
+    {
+        dir->sizeClass--;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayInitSplice
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool relayInitSplice(relay_dir *dir)
+--                              relay_dir *dir: The direction to set up for splicing.
+--
+-- RETURNS:                 True if the direction will be spliced, false if it will be copied.
+--
+-- NOTES:
+-- Creates the non-blocking pipe that sits between the two sockets of a spliced direction. If the
+-- pipe cannot be created the direction is left in copy mode.
+--------------------------------------------------------------------------------------------------*/
+bool relayInitSplice(relay_dir *dir)
+{
+    if (pipe2(dir->pipe, O_NONBLOCK | O_CLOEXEC) == -1)
+    {
+        dir->spliced = false;
+        return false;
+    }
+
+    fcntl(dir->pipe[1], F_SETPIPE_SZ, RELAY_PIPE_SIZE);
+    dir->piped = 0;
+    dir->spliced = true;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Also returns the copy buffer to the pool.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayRelease(relay_dir *dir)
+--                              relay_dir *dir: The direction to release.
+--
+-- NOTES:
+-- Returns the buffer of a copied direction and closes the pipe of a spliced one.
+--------------------------------------------------------------------------------------------------*/
+void relayRelease(relay_dir *dir)
+{
+    relayPut(dir);
+    if (!dir->spliced)
+    {
+        return;
+    }
+
+    close(dir->pipe[0]);
+    close(dir->pipe[1]);
+    dir->spliced = false;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayPending
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Check the queue.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool relayPending(const relay_dir *dir)
+--                              const relay_dir *dir: The direction to check.
+--
+-- RETURNS:                 True if data was read but not yet written, false otherwise.
+--------------------------------------------------------------------------------------------------*/
+bool relayPending(const relay_dir *dir)
+{
+    return dir->queued > 0 || dir->piped > 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayQueued
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               size_t relayQueued(const relay_dir *dir)
+--                              const relay_dir *dir: The direction to check.
+--
+-- RETURNS:                 The number of bytes read but not yet written, in the queue or the pipe.
+--------------------------------------------------------------------------------------------------*/
+size_t relayQueued(const relay_dir *dir)
+{
+    return dir->queued + dir->piped;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayShutdown
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool relayShutdown(const int to, relay_dir *dir)
+--                              const int to: The socket the direction writes to.
+--                              relay_dir *dir: The direction to check.
+--
+-- RETURNS:                 True if the end of stream has been passed on to, false otherwise.
+--
+-- NOTES:
+-- Shuts down the write side of to once from reached the end of stream and everything read before
+-- it has been written, so the peer on to sees the same half-close as the peer on from made.
+--------------------------------------------------------------------------------------------------*/
+bool relayShutdown(const int to, relay_dir *dir)
+{
+    if (!dir->shut && dir->eof && !relayPending(dir))
+    {
+        shutdown(to, SHUT_WR);
+        dir->shut = true;
+    }
+
+    return dir->shut;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayCopy
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Borrows the buffer only while data is in flight.
+--                          October 17, 2026 - Queue up to dir.limit bytes while to is blocked.
+--                          October 17, 2026 - Read no more than dir.allowance bytes.
+--                          October 17, 2026 - Hand a copy of what is read to dir.mirror.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int relayCopy(const int from, const int to, relay_dir *dir)
+--                              const int from: The non-blocking socket to read from.
+--                              const int to: The non-blocking socket to write to.
+--                              relay_dir *dir: The queue of this direction.
+--
+-- RETURNS:                 -1 if either socket failed, 0 otherwise.
+--
+-- NOTES:
+-- Moves data from one socket to the other until from would block or the queue of the direction is
+-- full. Whatever to does not take right away is queued and written first the next time either
+-- socket becomes ready, so partial writes lose nothing. No more than dir.allowance bytes are read,
+-- what is read is taken off it. Reaching the end of stream on from sets dir.eof.
+--
+-- Buffers are borrowed right before a read and returned as soon as they have been written, so only
+-- a direction with data stuck in it keeps any.
+--------------------------------------------------------------------------------------------------*/
+int relayCopy(const int from, const int to, relay_dir *dir)
+{
+    relay_chunk *chunk;
+    bool blocked = false;
+    size_t size;
+    ssize_t n;
+
+    while (1)
+    {
+        while (!blocked && (chunk = dir->head) != NULL)
+        {
+            if (chunk->start == chunk->end)
+            {
+                relayPop(dir);
+                continue;
+            }
+
+            if ((n = send(to, chunk->data + chunk->start, chunk->end - chunk->start, MSG_NOSIGNAL)) == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    return -1;
+                }
+                blocked = true;
+                break;
+            }
+            chunk->start += n;
+            dir->queued -= n;
+            dir->bytes += n;
+        }
+
+        if (dir->eof || dir->queued >= dir->limit || dir->allowance == 0)
+        {
+            return 0;
+        }
+
+        if ((chunk = dir->tail) == NULL || chunk->end == relayCapacity(chunk))
+        {
+            chunk = relayPush(dir);
+        }
+        size = relayCapacity(chunk) - chunk->end;
+        if (size > dir->limit - dir->queued)
+        {
+            size = dir->limit - dir->queued;
+        }
+        if (size > dir->allowance)
+        {
+            size = dir->allowance;
+        }
+
+        if ((n = recv(from, chunk->data + chunk->end, size, 0)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                if (dir->head == chunk && chunk->end == 0)
+                {
+                    relayPop(dir);
+                }
+                return 0;
+            }
+            return -1;
+        }
+
+        if (n == 0)
+        {
+            dir->eof = true;
+            if (dir->head == chunk && chunk->end == 0)
+            {
+                relayPop(dir);
+            }
+            return 0;
+        }
+        if (dir->mirror)
+        {
+            relayMirrorWrite(dir, chunk->data + chunk->end, n);
+        }
+        relayAdapt(dir, n, size);
+        chunk->end += n;
+        dir->queued += n;
+        dir->allowance -= n;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relaySplice
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Read no more than dir.allowance bytes.
+--                          October 17, 2026 - Hand a copy of what is read to dir.mirror.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int relaySplice(const int from, const int to, relay_dir *dir)
+--                              const int from: The non-blocking socket to read from.
+--                              const int to: The non-blocking socket to write to.
+--                              relay_dir *dir: The pipe state for this direction.
+--
+-- RETURNS:                 -1 if either socket failed, 0 otherwise.
+--
+-- NOTES:
+-- Zero copy version of relayCopy. Data is spliced from the socket into dir.pipe and from the pipe
+-- into the other socket. If the kernel refuses to splice these sockets before anything has been
+-- moved, the pipe is released and the direction falls back to relayCopy for good.
+--------------------------------------------------------------------------------------------------*/
+int relaySplice(const int from, const int to, relay_dir *dir)
+{
+    size_t size;
+    ssize_t n;
+
+    while (1)
+    {
+        if (dir->piped > 0)
+        {
+            if ((n = splice(dir->pipe[0], NULL, to, NULL, dir->piped, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+            }
+            dir->piped -= n;
+            dir->bytes += n;
+            continue;
+        }
+
+        if (dir->eof || dir->allowance == 0)
+        {
+            return 0;
+        }
+
+        size = dir->allowance < RELAY_PIPE_SIZE ? dir->allowance : RELAY_PIPE_SIZE;
+        if ((n = splice(from, NULL, dir->pipe[1], NULL, size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+            if ((errno == EINVAL || errno == ENOSYS) && dir->bytes == 0)
+            {
+                relayRelease(dir);
+                return relayCopy(from, to, dir);
+            }
+            return -1;
+        }
+
+        if (n == 0)
+        {
+            dir->eof = true;
+            return 0;
+        }
+        dir->piped = n;
+        dir->allowance -= n;
+        if (dir->mirror)
+        {
+            relayMirrorTee(dir, n);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayDirection
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int relayDirection(const int from, const int to, relay_dir *dir)
+--                              const int from: The non-blocking socket to read from.
+--                              const int to: The non-blocking socket to write to.
+--                              relay_dir *dir: The state for this direction.
+--
+-- RETURNS:                 -1 if either socket failed, 0 otherwise.
+--
+-- NOTES:
+-- Relays one direction with either relaySplice or relayCopy depending on how dir was set up.
+--------------------------------------------------------------------------------------------------*/
+int relayDirection(const int from, const int to, relay_dir *dir)
+{
+    return dir->spliced ? relaySplice(from, to, dir) : relayCopy(from, to, dir);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayMirrorInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool relayMirrorInit(relay_mirror *mirror, const size_t limit)
+--                              relay_mirror *mirror: The mirror to set up.
+--                              const size_t limit: The most bytes the mirror may hold.
+--
+-- RETURNS:                 True if the mirror takes data, false if its pipe could not be created.
+--
+-- NOTES:
+-- Creates the non-blocking pipe that holds the copy of a direction until the mirror socket takes
+-- it. A mirror without a pipe still counts everything it is handed as dropped. The caller sets
+-- mirror.fd once the socket is connecting, until then the copy just waits in the pipe.
+--------------------------------------------------------------------------------------------------*/
+bool relayMirrorInit(relay_mirror *mirror, const size_t limit)
+{
+    bzero(mirror, sizeof(relay_mirror));
+    mirror->fd = -1;
+    mirror->limit = limit;
+    if (pipe2(mirror->pipe, O_NONBLOCK | O_CLOEXEC) == -1)
+    {
+        return false;
+    }
+
+    fcntl(mirror->pipe[1], F_SETPIPE_SZ, limit);
+    mirror->open = true;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayMirrorTee
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayMirrorTee(relay_dir *dir, const size_t n)
+--                              relay_dir *dir: A spliced direction that has just filled its pipe.
+--                              const size_t n: The number of bytes in the pipe of dir.
+--
+-- NOTES:
+-- Duplicates the data in the pipe of dir into the pipe of its mirror with tee, which only takes
+-- references to the same pages, so the copy costs no more than the splice did. The mirror is
+-- flushed first if the data would not fit. Whatever still does not fit below mirror.limit or into
+-- the pipe is dropped and counted, never waited for.
+--------------------------------------------------------------------------------------------------*/
+void relayMirrorTee(relay_dir *dir, const size_t n)
+{
+    relay_mirror *mirror = dir->mirror;
+    size_t size;
+    ssize_t teed = 0;
+
+    if (mirror->piped + n > mirror->limit)
+    {
+        relayMirrorFlush(dir);
+    }
+    size = mirror->open && mirror->piped < mirror->limit ? mirror->limit - mirror->piped : 0;
+
+    if (size > n)
+    {
+        size = n;
+    }
+    // neither pipe ever blocks, a full one just fails with EAGAIN
+    if (size > 0 && (teed = tee(dir->pipe[0], mirror->pipe[1], size, SPLICE_F_NONBLOCK)) == -1)
+    {
+        teed = 0;
+    }
+    mirror->piped += teed;
+    mirror->dropped += n - teed;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayMirrorWrite
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayMirrorWrite(relay_dir *dir, const char *data, const size_t n)
+--                              relay_dir *dir: A copied direction that has just read data.
+--                              const char *data: What was read.
+--                              const size_t n: The number of bytes read.
+--
+-- NOTES:
+-- Copy mode version of relayMirrorTee. The data is written into the pipe of the mirror, whatever
+-- does not fit is dropped and counted.
+--------------------------------------------------------------------------------------------------*/
+void relayMirrorWrite(relay_dir *dir, const char *data, const size_t n)
+{
+    relay_mirror *mirror = dir->mirror;
+    size_t size;
+    ssize_t written = 0;
+
+    if (mirror->piped + n > mirror->limit)
+    {
+        relayMirrorFlush(dir);
+    }
+    size = mirror->open && mirror->piped < mirror->limit ? mirror->limit - mirror->piped : 0;
+
+    if (size > n)
+    {
+        size = n;
+    }
+    if (size > 0 && (written = write(mirror->pipe[1], data, size)) == -1)
+    {
+        written = 0;
+    }
+    mirror->piped += written;
+    mirror->dropped += n - written;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayMirrorFlush
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int relayMirrorFlush(relay_dir *dir)
+--                              relay_dir *dir: The mirrored direction.
+--
+-- RETURNS:                 -1 if the mirror socket failed, 0 otherwise.
+--
+-- NOTES:
+-- Splices as much of the pipe of the mirror into mirror.fd as it takes without blocking, and shuts
+-- down its write side once dir reached the end of stream and the pipe is empty. A mirror whose
+-- socket failed is released, the caller still has to close the socket.
+--------------------------------------------------------------------------------------------------*/
+int relayMirrorFlush(relay_dir *dir)
+{
+    relay_mirror *mirror = dir->mirror;
+    ssize_t n;
+
+    if (mirror->fd == -1)
+    {
+        return 0;
+    }
+
+    while (mirror->open && mirror->piped > 0)
+    {
+        if ((n = splice(mirror->pipe[0], NULL, mirror->fd, NULL, mirror->piped, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+            relayMirrorRelease(mirror);
+            return -1;
+        }
+        mirror->piped -= n;
+        mirror->bytes += n;
+    }
+
+    if (mirror->open && !mirror->shut && dir->eof && mirror->piped == 0)
+    {
+        shutdown(mirror->fd, SHUT_WR);
+        mirror->shut = true;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayMirrorRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void relayMirrorRelease(relay_mirror *mirror)
+--                              relay_mirror *mirror: The mirror to release.
+--
+-- NOTES:
+-- Closes the pipe of the mirror and counts what was still in it as dropped. The mirror counts
+-- anything it is handed afterwards as dropped too.
+--------------------------------------------------------------------------------------------------*/
+void relayMirrorRelease(relay_mirror *mirror)
+{
+    if (!mirror->open)
+    {
+        return;
+    }
+
+    close(mirror->pipe[0]);
+    close(mirror->pipe[1]);
+    mirror->dropped += mirror->piped;
+    mirror->piped = 0;
+    mirror->open = false;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relayCopyBlocking
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Uses a pooled buffer sized by relayAdapt instead of a
+--                                             64 KB stack buffer.
+--                          October 17, 2026 - Report whether from reached the end of stream.
+--                          October 17, 2026 - Report a receive timeout apart from a failure.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               ssize_t relayCopyBlocking(const int from, const int to, relay_end *end)
+--                              const int from: The blocking socket to read from.
+--                              const int to: The blocking socket to write to.
+--                              relay_end *end: Set to RELAY_EOF if from reached the end of stream,
+--                                              RELAY_TIMEOUT if the receive timeout of from expired
+--                                              and RELAY_FAILED if either socket failed.
+--
+-- RETURNS:                 The number of bytes relayed.
+--
+-- NOTES:
+-- The forking model's relay loop. Reads into a buffer and writes all of it out until from reaches
+-- the end of stream or either socket fails. The buffer starts at the smallest size and follows
+-- relayAdapt like the copy relay of the other engines. Blocking on send is what bounds the queue
+-- here, nothing more than one buffer is read ahead of what to has taken. Nothing is left unsent
+-- when the receive timeout expires, so the relay can simply be called again.
+--------------------------------------------------------------------------------------------------*/
+ssize_t relayCopyBlocking(const int from, const int to, relay_end *end)
+{
+    relay_dir dir = {.limit = SIZE_MAX, .allowance = SIZE_MAX};
+    relay_chunk *chunk;
+    ssize_t total = 0;
+    ssize_t numRead;
+    ssize_t numSent;
+    size_t size;
+
+    *end = RELAY_FAILED;
+    while (1)
+    {
+        chunk = relayPush(&dir);
+        size = relayCapacity(chunk);
+        if ((numRead = recv(from, chunk->data, size, 0)) <= 0)
+        {
+            if (numRead == 0)
+            {
+                *end = RELAY_EOF;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                *end = RELAY_TIMEOUT;
+            }
+            break;
+        }
+        relayAdapt(&dir, numRead, size);
+
+        for (ssize_t off = 0; off < numRead; off += numSent)
+        {
+            if ((numSent = send(to, chunk->data + off, numRead - off, MSG_NOSIGNAL)) <= 0)
+            {
+                relayPut(&dir);
+                return total + off;
+            }
+        }
+        total += numRead;
+        relayPop(&dir);
+    }
+
+    relayPut(&dir);
+    return total;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                relaySpliceBlocking
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Report whether from reached the end of stream.
+--                          October 17, 2026 - Report a receive timeout apart from a failure.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               ssize_t relaySpliceBlocking(const int from, const int to, relay_end *end)
+--                              const int from: The blocking socket to read from.
+--                              const int to: The blocking socket to write to.
+--                              relay_end *end: Set to RELAY_EOF if from reached the end of stream,
+--                                              RELAY_TIMEOUT if the receive timeout of from expired
+--                                              and RELAY_FAILED if either socket failed.
+--
+-- RETURNS:                 The number of bytes relayed, -1 if splice is not available and nothing
+--                          has been relayed.
+--
+-- NOTES:
+-- Zero copy version of relayCopyBlocking. When -1 is returned the caller should fall back to
+-- relayCopyBlocking.
+--------------------------------------------------------------------------------------------------*/
+ssize_t relaySpliceBlocking(const int from, const int to, relay_end *end)
+{
+    int fds[2];
+    ssize_t total = 0;
+    ssize_t numRead;
+    ssize_t numSent;
+    ssize_t off = 0;
+
+    *end = RELAY_FAILED;
+    if (pipe2(fds, O_CLOEXEC) == -1)
+    {
+        return -1;
+    }
+    fcntl(fds[1], F_SETPIPE_SZ, RELAY_PIPE_SIZE);
+
+    while ((numRead = splice(from, NULL, fds[1], NULL, RELAY_PIPE_SIZE, SPLICE_F_MOVE)) > 0)
+    {
+        for (off = 0; off < numRead; off += numSent)
+        {
+            if ((numSent = splice(fds[0], NULL, to, NULL, numRead - off, SPLICE_F_MOVE)) <= 0)
+            {
+                break;
+            }
+        }
+        total += off;
+
+        if (off < numRead)
+        {
+            break;
+        }
+    }
+
+    if (numRead == 0)
+    {
+        *end = RELAY_EOF;
+    }
+    else if (numRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        *end = RELAY_TIMEOUT;
+    }
+    if (numRead == -1 && total == 0 && (errno == EINVAL || errno == ENOSYS))
+    {
+        total = -1;
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return total;
+}
@@ -0,0 +1,823 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             reload.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          fwd_config *configCreate(fwd_path *paths, const int size)
+--                          void configIndex(fwd_config *config)
+--                          fwd_path *configFind(const fwd_config *config, const struct sockaddr_in *in, const bool udp)
+--                          fwd_path *configRoute(const fwd_config *config, const struct sockaddr_in *client, const int port)
+--                          void configStart(fwd_path *paths, const int size)
+--                          fwd_config *configCurrent(void)
+--                          fwd_config *configAcquireCurrent(void)
+--                          void configAcquire(fwd_config *config)
+--                          void configRelease(fwd_config *config)
+--                          bool pathSame(const fwd_path *a, const fwd_path *b)
+--                          void configDiff(fwd_config *old, fwd_config *config)
+--                          void configPublish(fwd_config *config)
+--                          bool configReload(void)
+--                          void configDrain(void)
+--                          bool configDrained(void)
+--                          int configRegister(void)
+--                          void configNotify(void)
+--                          void pathFree(fwd_path *path)
+--                          void configFree(fwd_config *config)
+--                          void configCollect(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Configuration generations. Every parse of forwarder.conf becomes a fwd_config, and the paths
+-- of a generation never move or change once it is published. A reload parses the file into a
+-- new generation, matches its paths to the running ones by incoming address and port, makes it
+-- current and wakes the workers through their eventfds so they can open and close listeners.
+--
+-- Connections keep a reference on the generation they were accepted under, so they stay on the
+-- backends they were given until they close. A generation is freed once nothing refers to it and
+-- every older generation has been freed. A path that is unchanged by a reload hands its backends
+-- and metrics over to the new generation, and since generations are freed oldest first, the
+-- newest generation holding them is always the last one to go and is the one that frees them.
+---------------------------------------------------------------------------------------*/
+
+#include "reload.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "acl.h"
+#include "balance.h"
+#include "health.h"
+#include "io.h"
+#include "limit.h"
+#include "metrics.h"
+
+static fwd_config *current;
+static fwd_config *oldest;
+static int *notifyFds;
+static int notifyCount;
+static pthread_mutex_t configLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configCreate
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Index the paths.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_config *configCreate(fwd_path *paths, const int size)
+--                              fwd_path *paths: The paths returned by parseConfFileForPaths.
+--                              const int size: The number of paths.
+--
+-- RETURNS:                 A new generation that owns paths.
+--
+-- NOTES:
+-- The generation starts with the one reference held on the current generation, and with the hash
+-- index of its paths.
+--------------------------------------------------------------------------------------------------*/
+fwd_config *configCreate(fwd_path *paths, const int size)
+{
+    fwd_config *config;
+
+    if ((config = calloc(1, sizeof(fwd_config))) == NULL)
+    {
+        die("calloc");
+    }
+    config->paths = paths;
+    config->size = size;
+    config->refs = 1;
+
+    for (int i = 0; i < size; i++)
+    {
+        paths[i].config = config;
+        paths[i].previous = -1;
+        paths[i].backendsMoved = false;
+        paths[i].metricsMoved = false;
+        paths[i].pid = 0;
+        paths[i].listenFd = -1;
+    }
+    configIndex(config);
+
+    return config;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configIndex
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configIndex(fwd_config *config)
+--                              fwd_config *config: The generation to index.
+--
+-- NOTES:
+-- Builds the hash index of the paths of a generation, keyed on the incoming address and port.
+-- The index is an open addressed table of path indexes at most half full, so a lookup probes a
+-- slot or two whatever the number of paths.
+--------------------------------------------------------------------------------------------------*/
+void configIndex(fwd_config *config)
+{
+    size_t slot;
+
+    config->slots = 1;
+    while (config->slots < (size_t)config->size * 2)
+    {
+        config->slots <<= 1;
+    }
+    if ((config->index = malloc(sizeof(int) * config->slots)) == NULL)
+    {
+        die("malloc");
+    }
+    memset(config->index, -1, sizeof(int) * config->slots);
+
+    for (int i = 0; i < config->size; i++)
+    {
+        slot = hashAddress(config->paths[i].in.sin_addr.s_addr, config->paths[i].in.sin_port) & (config->slots - 1);
+        while (config->index[slot] != -1)
+        {
+            slot = (slot + 1) & (config->slots - 1);
+        }
+        config->index[slot] = i;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configFind
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_path *configFind(const fwd_config *config, const struct sockaddr_in *in, const bool udp)
+--                              const fwd_config *config: The generation to look in.
+--                              const struct sockaddr_in *in: The incoming address and port.
+--                              const bool udp: Whether to look for a UDP path.
+--
+-- RETURNS:                 The path of the generation for in and the protocol, NULL if there is
+--                          none.
+--------------------------------------------------------------------------------------------------*/
+fwd_path *configFind(const fwd_config *config, const struct sockaddr_in *in, const bool udp)
+{
+    size_t slot = hashAddress(in->sin_addr.s_addr, in->sin_port) & (config->slots - 1);
+    fwd_path *path;
+
+    for (; config->index[slot] != -1; slot = (slot + 1) & (config->slots - 1))
+    {
+        path = config->paths + config->index[slot];
+        if (path->in.sin_addr.s_addr == in->sin_addr.s_addr && path->in.sin_port == in->sin_port && path->udp == udp)
+        {
+            return path;
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configRoute
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Fall back to the paths whose access list admits the client.
+--                          October 17, 2026 - Skip UDP paths.
+--                          October 17, 2026 - Look the client up in the index and the sorted table.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_path *configRoute(const fwd_config *config, const struct sockaddr_in *client, const int port)
+--                              const fwd_config *config: The generation that accepted the client.
+--                              const struct sockaddr_in *client: The address of the client.
+--                              const int port: The port the client connected to.
+--
+-- RETURNS:                 The TCP path of the port that serves the client, NULL if the port has
+--                          no TCP path.
+--
+-- NOTES:
+-- Every TCP path of a port is served by the same listening socket, so the path is picked after the
+-- accept. A client connecting from the incoming address of a path belongs to it, which is one
+-- lookup in the index. Any other client belongs to the first path of the port whose access list
+-- admits it, found in the run of paths of the port in the sorted table, or to the first path of
+-- the port, which refuses it.
+--------------------------------------------------------------------------------------------------*/
+fwd_path *configRoute(const fwd_config *config, const struct sockaddr_in *client, const int port)
+{
+    struct sockaddr_in in = *client;
+    fwd_path *path;
+    int low = 0;
+    int high = config->size;
+    int middle;
+
+    in.sin_port = htons(port);
+    if ((path = configFind(config, &in, false)) != NULL)
+    {
+        return path;
+    }
+
+    // the table is sorted by protocol, port and address, TCP first
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (!config->paths[middle].udp && ntohs(config->paths[middle].in.sin_port) < port)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for (int i = low; i < config->size && !config->paths[i].udp && ntohs(config->paths[i].in.sin_port) == port; i++)
+    {
+        if (aclAdmits(config->paths[i].acl, client->sin_addr))
+        {
+            return config->paths + i;
+        }
+    }
+
+    return low < config->size && !config->paths[low].udp && ntohs(config->paths[low].in.sin_port) == port
+               ? config->paths + low
+               : NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configStart(fwd_path *paths, const int size)
+--                              fwd_path *paths: The paths parsed at startup.
+--                              const int size: The number of paths.
+--
+-- NOTES:
+-- Makes the paths parsed at startup the first generation.
+--------------------------------------------------------------------------------------------------*/
+void configStart(fwd_path *paths, const int size)
+{
+    current = oldest = configCreate(paths, size);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configCurrent
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_config *configCurrent(void)
+--
+-- RETURNS:                 The current generation.
+--
+-- NOTES:
+-- Only safe to use without a reference from the thread that reloads, or before any reload.
+--------------------------------------------------------------------------------------------------*/
+fwd_config *configCurrent(void)
+{
+    return current;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configAcquireCurrent
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_config *configAcquireCurrent(void)
+--
+-- RETURNS:                 The current generation, with a reference taken on it.
+--
+-- NOTES:
+-- Takes the lock so the generation cannot be replaced and freed between reading it and taking the
+-- reference. Workers do not need this since they walk forward from a generation they hold.
+--------------------------------------------------------------------------------------------------*/
+fwd_config *configAcquireCurrent(void)
+{
+    fwd_config *config;
+
+    pthread_mutex_lock(&configLock);
+    config = current;
+    configAcquire(config);
+    pthread_mutex_unlock(&configLock);
+
+    return config;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configAcquire
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configAcquire(fwd_config *config)
+--                              fwd_config *config: A generation the caller already holds, or one
+--                                                  newer than a generation it holds.
+--
+-- NOTES:
+-- Takes a reference on a generation.
+--------------------------------------------------------------------------------------------------*/
+void configAcquire(fwd_config *config)
+{
+    __atomic_fetch_add(&config->refs, 1, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configRelease(fwd_config *config)
+--                              fwd_config *config: A generation the caller holds.
+--
+-- NOTES:
+-- Drops a reference on a generation. The generation is freed later by configCollect.
+--------------------------------------------------------------------------------------------------*/
+void configRelease(fwd_config *config)
+{
+    __atomic_fetch_sub(&config->refs, 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                pathSame
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Compare the access lists.
+--                          October 17, 2026 - Compare the protocol and the UDP idle timeout.
+--                          October 17, 2026 - Compare the queue option.
+--                          October 17, 2026 - Compare the rate limits.
+--                          October 17, 2026 - Compare the backlog and the socket options.
+--                          October 17, 2026 - Compare the idle timeout and the maximum lifetime.
+--                          October 17, 2026 - Compare the health check options.
+--                          October 17, 2026 - Compare the mirror options.
+--                          October 17, 2026 - Compare the tcp_info option.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool pathSame(const fwd_path *a, const fwd_path *b)
+--                              const fwd_path *a: A path.
+--                              const fwd_path *b: Another path.
+--
+-- RETURNS:                 True if both paths are configured the same way, false otherwise.
+--
+-- NOTES:
+-- Compares what is read from the configuration file, not the state kept while running. Every new
+-- path option has to be compared here or changing it will not be picked up by a reload.
+--------------------------------------------------------------------------------------------------*/
+bool pathSame(const fwd_path *a, const fwd_path *b)
+{
+    if (a->in.sin_addr.s_addr != b->in.sin_addr.s_addr || a->in.sin_port != b->in.sin_port
+        || a->backendCount != b->backendCount || a->policy != b->policy || a->connectTimeout != b->connectTimeout
+        || a->poolSize != b->poolSize || a->poolIdle != b->poolIdle || !aclSame(a->acl, b->acl)
+        || a->udp != b->udp || a->udpIdle != b->udpIdle || a->queueLimit != b->queueLimit || a->rate != b->rate
+        || a->idleTimeout != b->idleTimeout || a->maxLifetime != b->maxLifetime
+        || a->clientRate != b->clientRate || a->connRate != b->connRate || a->clientConnRate != b->clientConnRate
+        || a->backlog != b->backlog || memcmp(&a->clientTuning, &b->clientTuning, sizeof(net_tuning))
+        || memcmp(&a->upstreamTuning, &b->upstreamTuning, sizeof(net_tuning))
+        || a->healthInterval != b->healthInterval || a->healthTimeout != b->healthTimeout
+        || a->healthFall != b->healthFall || a->healthRise != b->healthRise || a->healthCooldown != b->healthCooldown
+        || a->healthSendLength != b->healthSendLength || memcmp(a->healthSend, b->healthSend, a->healthSendLength)
+        || a->healthExpectLength != b->healthExpectLength
+        || memcmp(a->healthExpect, b->healthExpect, a->healthExpectLength) || a->mirrored != b->mirrored
+        || a->mirror.sin_addr.s_addr != b->mirror.sin_addr.s_addr || a->mirror.sin_port != b->mirror.sin_port
+        || a->mirrorDirections != b->mirrorDirections || a->mirrorBuffer != b->mirrorBuffer
+        || a->tcpInfo != b->tcpInfo || a->tcpInfoInterval != b->tcpInfoInterval)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < a->backendCount; i++)
+    {
+        if (a->backends[i].addr.sin_addr.s_addr != b->backends[i].addr.sin_addr.s_addr
+            || a->backends[i].addr.sin_port != b->backends[i].addr.sin_port)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configDiff
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Free the access list of an unchanged path.
+--                          October 17, 2026 - Match paths by protocol too.
+--                          October 17, 2026 - Free the health state of an unchanged path.
+--                          October 17, 2026 - Look the running paths up in the index of their generation.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configDiff(fwd_config *old, fwd_config *config)
+--                              fwd_config *old: The running generation.
+--                              fwd_config *config: The generation that will replace it.
+--
+-- NOTES:
+-- Matches every new path to the running path with the same protocol, incoming address and port
+-- through the index of the running generation, so a reload stays linear in the number of paths.
+-- Matched paths remember the index of their predecessor in previous for the workers. An unchanged
+-- path takes over the whole state of its predecessor, including its backends and their open
+-- connection counts. A changed path keeps its own backends but takes over the metrics and pool
+-- statistics.
+--------------------------------------------------------------------------------------------------*/
+void configDiff(fwd_config *old, fwd_config *config)
+{
+    int added = 0;
+    int changed = 0;
+    int kept = 0;
+    fwd_path *path;
+    fwd_path *prev;
+
+    for (int i = 0; i < config->size; i++)
+    {
+        path = config->paths + i;
+        if ((prev = configFind(old, &path->in, path->udp)) == NULL)
+        {
+            added++;
+            continue;
+        }
+
+        if (pathSame(prev, path))
+        {
+            pathFree(path);
+            *path = *prev;
+            path->config = config;
+            path->backendsMoved = false;
+            prev->backendsMoved = true;
+            kept++;
+        }
+        else
+        {
+            path->metrics = prev->metrics;
+            path->poolHits = __atomic_load_n(&prev->poolHits, __ATOMIC_RELAXED);
+            path->poolMisses = __atomic_load_n(&prev->poolMisses, __ATOMIC_RELAXED);
+            path->poolDiscards = __atomic_load_n(&prev->poolDiscards, __ATOMIC_RELAXED);
+            changed++;
+        }
+        path->previous = prev - old->paths;
+        path->metricsMoved = false;
+        prev->metricsMoved = true;
+    }
+
+    Log("Reload: %d paths added, %d changed, %d removed, %d unchanged", added, changed,
+        old->size - changed - kept, kept);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configPublish
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configPublish(fwd_config *config)
+--                              fwd_config *config: A generation already matched to the current one
+--                                                  with configDiff.
+--
+-- NOTES:
+-- Makes config the current generation and wakes every registered worker so they move to it.
+--------------------------------------------------------------------------------------------------*/
+void configPublish(fwd_config *config)
+{
+    fwd_config *old = current;
+
+    // workers look the metrics up as soon as they see the new generation
+    if (!metricsAttach(config->paths, config->size))
+    {
+        die("Could not allocate metrics");
+    }
+
+    pthread_mutex_lock(&configLock);
+    __atomic_store_n(&old->newer, config, __ATOMIC_RELEASE);
+    current = config;
+    pthread_mutex_unlock(&configLock);
+    configRelease(old);
+
+    configNotify();
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configReload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Moved the publishing to configPublish.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool configReload(void)
+--
+-- RETURNS:                 True if the file was parsed and is now the current generation, false if
+--                          the running configuration was kept.
+--
+-- NOTES:
+-- Parses forwarder.conf again, matches it to the running generation with configDiff, makes it the
+-- current generation and wakes every registered worker. Called from the control thread only.
+--------------------------------------------------------------------------------------------------*/
+bool configReload(void)
+{
+    fwd_path *paths;
+    int size;
+    fwd_config *config;
+    long long start = monotonicUs();
+
+    Log("Reloading configuration");
+    if (!parseConfFileForPaths(&paths, &size))
+    {
+        Error("Could not parse file, keeping the running configuration");
+        return false;
+    }
+
+    config = configCreate(paths, size);
+    configDiff(current, config);
+    configPublish(config);
+
+    Log("Reloaded configuration in %lld us", monotonicUs() - start);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configDrain
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configDrain(void)
+--
+-- NOTES:
+-- Publishes a generation without any path, so the workers close every listener as if the paths
+-- had been removed from the file. Connections keep the generation they were accepted under and
+-- run until they close. Used once an upgrade has handed the sockets over. Called from the control
+-- thread only.
+--------------------------------------------------------------------------------------------------*/
+void configDrain(void)
+{
+    fwd_config *config = configCreate(NULL, 0);
+
+    configDiff(current, config);
+    configPublish(config);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configDrained
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool configDrained(void)
+--
+-- RETURNS:                 True if every generation but the current one has been freed, false
+--                          otherwise.
+--
+-- NOTES:
+-- After configDrain, tells when the last connection has closed. Called after configCollect.
+--------------------------------------------------------------------------------------------------*/
+bool configDrained(void)
+{
+    bool drained;
+
+    pthread_mutex_lock(&configLock);
+    drained = oldest == current;
+    pthread_mutex_unlock(&configLock);
+
+    return drained;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configRegister
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int configRegister(void)
+--
+-- RETURNS:                 A non-blocking eventfd that becomes readable after every reload, or -1.
+--
+-- NOTES:
+-- Called by every worker so it can wait for reloads along with its sockets.
+--------------------------------------------------------------------------------------------------*/
+int configRegister(void)
+{
+    int fd;
+    int *fds;
+
+    if ((fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&configLock);
+    if ((fds = realloc(notifyFds, sizeof(int) * (notifyCount + 1))) == NULL)
+    {
+        die("realloc");
+    }
+    notifyFds = fds;
+    notifyFds[notifyCount++] = fd;
+    pthread_mutex_unlock(&configLock);
+
+    return fd;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configNotify
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configNotify(void)
+--
+-- NOTES:
+-- Wakes every registered worker.
+--------------------------------------------------------------------------------------------------*/
+void configNotify(void)
+{
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&configLock);
+    for (int i = 0; i < notifyCount; i++)
+    {
+        if (write(notifyFds[i], &one, sizeof(one)) == -1)
+        {
+            Error("Could not notify worker of the reload");
+        }
+    }
+    pthread_mutex_unlock(&configLock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                pathFree
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void pathFree(fwd_path *path)
+--                              fwd_path *path: The path whose state to free.
+--
+-- NOTES:
+-- Frees the backends of a path and everything set up for them. The metrics are not included, they
+-- outlive the path when it is reloaded.
+--------------------------------------------------------------------------------------------------*/
+void pathFree(fwd_path *path)
+{
+    free(path->backends);
+    free(path->ring);
+    aclFree(path->acl);
+    limitFree(path->limits);
+    healthFree(path->health, path->backendCount);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configFree
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Free the access lists.
+--                          October 17, 2026 - Free the rate limits.
+--                          October 17, 2026 - Free the health state of the backends.
+--                          October 17, 2026 - Free the paths with pathFree and the index.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configFree(fwd_config *config)
+--                              fwd_config *config: A generation that nothing refers to anymore.
+--
+-- NOTES:
+-- Frees a generation along with the backends and metrics it did not hand over to a newer one.
+--------------------------------------------------------------------------------------------------*/
+void configFree(fwd_config *config)
+{
+    for (int i = 0; i < config->size; i++)
+    {
+        if (!config->paths[i].backendsMoved)
+        {
+            pathFree(config->paths + i);
+        }
+        if (!config->paths[i].metricsMoved)
+        {
+            free(config->paths[i].metrics);
+        }
+    }
+
+    free(config->paths);
+    free(config->index);
+    free(config);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                configCollect
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void configCollect(void)
+--
+-- NOTES:
+-- Frees the old generations that nothing refers to anymore, oldest first, stopping at the first
+-- one still in use. Called periodically from the control thread.
+--------------------------------------------------------------------------------------------------*/
+void configCollect(void)
+{
+    fwd_config *next;
+
+    pthread_mutex_lock(&configLock);
+    while (oldest != current && __atomic_load_n(&oldest->refs, __ATOMIC_ACQUIRE) == 0)
+    {
+        next = oldest->newer;
+        configFree(oldest);
+        oldest = next;
+    }
+    pthread_mutex_unlock(&configLock);
+}
@@ -5,6 +5,8 @@
 --
 -- FUNCTIONS:
 --                          void die(const char *msg)
+--                          long long monotonicMs(void)
+--                          long long monotonicUs(void)
 --
 -- DATE:                    March 20, 2019
 --
@@ -15,15 +17,26 @@
 -- PROGRAMMERS:             Benny Wang
 --
 -- NOTES:
--- Generic resource functions.
+-- Generic resource functions and the command line options shared by every module.
 ---------------------------------------------------------------------------------------*/
 
 #include "res.h"
 
 #include <stdlib.h>
+#include <time.h>
 
 #include "io.h"
 
+fwd_options options = {
+    .engine = ENGINE_EPOLL,
+    .relay = RELAY_COPY,
+    .workers = 0,
+    .logRate = 0,
+    .metrics = NULL,
+    .resolveTtl = 60,
+    .cache = NULL,
+};
+
 /*--------------------------------------------------------------------------------------------------
 -- FUNCTION:                die
 --
@@ -47,3 +60,55 @@ void die(const char *msg)
     exit(EXIT_FAILURE);
 }
 
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                monotonicMs
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               long long monotonicMs(void)
+--
+-- RETURNS:                 The time of the monotonic clock in milliseconds.
+--
+-- NOTES:
+-- Used for deadlines so they are not affected by changes to the wall clock.
+--------------------------------------------------------------------------------------------------*/
+long long monotonicMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                monotonicUs
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               long long monotonicUs(void)
+--
+-- RETURNS:                 The time of the monotonic clock in microseconds.
+--
+-- NOTES:
+-- Used to time connects and sessions for the latency histograms.
+--------------------------------------------------------------------------------------------------*/
+long long monotonicUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
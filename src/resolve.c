@@ -0,0 +1,666 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             resolve.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool resolveName(const char *name, struct in_addr *addr)
+--                          unsigned hashName(const char *name)
+--                          int hostFind(const char *name)
+--                          void hostsBegin(void)
+--                          void hostAdd(const char *name)
+--                          bool hostLookup(const char *name, struct in_addr *addr)
+--                          fwd_host *hostsCopy(int *count)
+--                          void hostSeed(const fwd_host *host)
+--                          void *resolveWorker(void *arg)
+--                          void resolveBatch(resolve_task *tasks, const int count)
+--                          int hostsUpdate(resolve_task *tasks, const int count, const time_t now)
+--                          resolve_task *hostsDue(const bool all, const time_t now, int *count)
+--                          void hostsResolve(void)
+--                          void *resolveThread(void *arg)
+--                          bool resolveStart(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Name resolution for the configuration file. Before the paths are parsed every host name in the
+-- file is collected, repeated names only once, and all of them are resolved at the same time with
+-- getaddrinfo on a small pool of threads. Parsing then only looks the addresses up, so startup no
+-- longer waits for one lookup after the other. Dotted decimal addresses never reach the cache.
+--
+-- Resolved names are cached for options.resolveTtl seconds. getaddrinfo does not report the TTL
+-- of the records, so the same lifetime is used for every name. A background thread resolves the
+-- names of the running configuration again as they expire, and if any of them now points
+-- somewhere else it raises SIGHUP so the paths are rebuilt by the normal reload. A name that
+-- stops resolving keeps its last address, and one that never resolved is retried every
+-- RESOLVE_RETRY seconds.
+---------------------------------------------------------------------------------------*/
+
+#define RESOLVE_THREADS 8
+#define RESOLVE_RETRY 5
+#define HOST_BUCKETS 1024
+
+#include "resolve.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "res.h"
+
+static fwd_host *hosts;
+static int hostCount;
+static int hostLimit;
+// index + 1 of the first host of every bucket, 0 for an empty bucket
+static int buckets[HOST_BUCKETS];
+static unsigned long serial;
+static pthread_mutex_t hostsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                resolveName
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool resolveName(const char *name, struct in_addr *addr)
+--                              const char *name: A host name or a dotted decimal address.
+--                              struct in_addr *addr: Pointer to where the address will be placed.
+--
+-- RETURNS:                 True if name has an IPv4 address, false otherwise.
+--
+-- NOTES:
+-- Resolves a single name without the cache. Safe to call from any thread.
+--------------------------------------------------------------------------------------------------*/
+bool resolveName(const char *name, struct in_addr *addr)
+{
+    struct addrinfo hints;
+    struct addrinfo *result;
+
+    if (inet_pton(AF_INET, name, addr) == 1)
+    {
+        return true;
+    }
+
+    bzero(&hints, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(name, NULL, &hints, &result) != 0)
+    {
+        return false;
+    }
+
+    *addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hashName
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               unsigned hashName(const char *name)
+--                              const char *name: The name to hash.
+--
+-- RETURNS:                 The FNV-1a hash of name.
+--------------------------------------------------------------------------------------------------*/
+unsigned hashName(const char *name)
+{
+    unsigned hash = 2166136261u;
+
+    for (; *name; name++)
+    {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+
+    return hash;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostFind
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int hostFind(const char *name)
+--                              const char *name: The name to look for.
+--
+-- RETURNS:                 The index of name in the cache, -1 if it is not cached.
+--
+-- NOTES:
+-- Must be called with hostsLock held.
+--------------------------------------------------------------------------------------------------*/
+int hostFind(const char *name)
+{
+    for (int i = buckets[hashName(name) % HOST_BUCKETS]; i != 0; i = hosts[i - 1].next)
+    {
+        if (!strcmp(hosts[i - 1].name, name))
+        {
+            return i - 1;
+        }
+    }
+
+    return -1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostsBegin
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void hostsBegin(void)
+--
+-- NOTES:
+-- Starts collecting the names of a new parse of the configuration file. Only the names added
+-- since the last call are kept fresh by the background thread.
+--------------------------------------------------------------------------------------------------*/
+void hostsBegin(void)
+{
+    pthread_mutex_lock(&hostsLock);
+    serial++;
+    pthread_mutex_unlock(&hostsLock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostAdd
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void hostAdd(const char *name)
+--                              const char *name: A host name or a dotted decimal address.
+--
+-- NOTES:
+-- Adds name to the cache, if it is not there yet, and marks it as used by the current parse.
+-- Dotted decimal addresses are ignored.
+--------------------------------------------------------------------------------------------------*/
+void hostAdd(const char *name)
+{
+    int i;
+    unsigned bucket;
+    struct in_addr addr;
+    fwd_host *grown;
+
+    if (inet_pton(AF_INET, name, &addr) == 1 || strlen(name) >= HOST_BUFFER_SIZE)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&hostsLock);
+    if ((i = hostFind(name)) == -1)
+    {
+        if (hostCount == hostLimit)
+        {
+            hostLimit = hostLimit ? hostLimit * 2 : 16;
+            if ((grown = realloc(hosts, sizeof(fwd_host) * hostLimit)) == NULL)
+            {
+                die("realloc");
+            }
+            hosts = grown;
+        }
+
+        i = hostCount++;
+        bzero(hosts + i, sizeof(fwd_host));
+        strcpy(hosts[i].name, name);
+        bucket = hashName(name) % HOST_BUCKETS;
+        hosts[i].next = buckets[bucket];
+        buckets[bucket] = i + 1;
+    }
+    hosts[i].seen = serial;
+    pthread_mutex_unlock(&hostsLock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostLookup
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool hostLookup(const char *name, struct in_addr *addr)
+--                              const char *name: A host name or a dotted decimal address.
+--                              struct in_addr *addr: Pointer to where the address will be placed.
+--
+-- RETURNS:                 True if name has an address, false otherwise.
+--
+-- NOTES:
+-- Answers from the cache if name is in it. Names that were never added are resolved right away.
+--------------------------------------------------------------------------------------------------*/
+bool hostLookup(const char *name, struct in_addr *addr)
+{
+    int i;
+    bool resolved = false;
+
+    if (inet_pton(AF_INET, name, addr) == 1)
+    {
+        return true;
+    }
+
+    pthread_mutex_lock(&hostsLock);
+    if ((i = hostFind(name)) != -1)
+    {
+        resolved = hosts[i].resolved;
+        *addr = hosts[i].addr;
+    }
+    pthread_mutex_unlock(&hostsLock);
+
+    return i != -1 ? resolved : resolveName(name, addr);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostsCopy
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               fwd_host *hostsCopy(int *count)
+--                              int *count: Pointer to where the number of names will be placed.
+--
+-- RETURNS:                 A copy of every resolved name of the cache, NULL if there are none. The
+--                          caller frees the copy.
+--
+-- NOTES:
+-- Used to hand the cache over to the new process of an upgrade.
+--------------------------------------------------------------------------------------------------*/
+fwd_host *hostsCopy(int *count)
+{
+    fwd_host *copy = NULL;
+
+    *count = 0;
+    pthread_mutex_lock(&hostsLock);
+    for (int i = 0; i < hostCount; i++)
+    {
+        if (!hosts[i].resolved)
+        {
+            continue;
+        }
+
+        if (copy == NULL && (copy = malloc(sizeof(fwd_host) * (hostCount - i))) == NULL)
+        {
+            die("malloc");
+        }
+        copy[(*count)++] = hosts[i];
+    }
+    pthread_mutex_unlock(&hostsLock);
+
+    return copy;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostSeed
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void hostSeed(const fwd_host *host)
+--                              const fwd_host *host: A name resolved by the old process of an upgrade.
+--
+-- NOTES:
+-- Puts a resolved name in the cache. It is kept until it expires in the old process, and at least
+-- until the next second, so the first parse of the new process uses it instead of resolving it
+-- again. Must be called before the configuration file is parsed.
+--------------------------------------------------------------------------------------------------*/
+void hostSeed(const fwd_host *host)
+{
+    int i;
+    time_t now = time(NULL);
+
+    hostAdd(host->name);
+
+    pthread_mutex_lock(&hostsLock);
+    if ((i = hostFind(host->name)) != -1)
+    {
+        hosts[i].addr = host->addr;
+        hosts[i].resolved = true;
+        hosts[i].expires = host->expires > now ? host->expires : now + 1;
+    }
+    pthread_mutex_unlock(&hostsLock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                resolveWorker
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *resolveWorker(void *arg)
+--                              void *arg: The resolve_batch to work on.
+--
+-- RETURNS:                 NULL.
+--
+-- NOTES:
+-- Takes tasks off the batch one at a time and resolves them until none are left. Does not log so
+-- the short lived threads never get a log ring of their own.
+--------------------------------------------------------------------------------------------------*/
+void *resolveWorker(void *arg)
+{
+    int i;
+    resolve_batch *batch = arg;
+
+    while ((i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED)) < batch->count)
+    {
+        batch->tasks[i].resolved = resolveName(batch->tasks[i].name, &batch->tasks[i].addr);
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                resolveBatch
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void resolveBatch(resolve_task *tasks, const int count)
+--                              resolve_task *tasks: The names to resolve.
+--                              const int count: The number of tasks.
+--
+-- NOTES:
+-- Resolves every task in parallel on up to RESOLVE_THREADS threads, the calling thread included,
+-- and returns once all of them are done.
+--------------------------------------------------------------------------------------------------*/
+void resolveBatch(resolve_task *tasks, const int count)
+{
+    int started = 0;
+    pthread_t threads[RESOLVE_THREADS - 1];
+    resolve_batch batch = {.tasks = tasks, .count = count, .next = 0};
+
+    for (int i = 0; i < RESOLVE_THREADS - 1 && i < count - 1; i++)
+    {
+        if (pthread_create(threads + started, NULL, resolveWorker, &batch) == 0)
+        {
+            started++;
+        }
+    }
+
+    resolveWorker(&batch);
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostsUpdate
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int hostsUpdate(resolve_task *tasks, const int count, const time_t now)
+--                              resolve_task *tasks: The resolved tasks.
+--                              const int count: The number of tasks.
+--                              const time_t now: The current time.
+--
+-- RETURNS:                 The number of cached names whose address changed.
+--
+-- NOTES:
+-- Stores the results of a batch in the cache. A name that fails to resolve keeps the address it
+-- had so a short outage of the resolver does not take a path down, and is retried sooner.
+--------------------------------------------------------------------------------------------------*/
+int hostsUpdate(resolve_task *tasks, const int count, const time_t now)
+{
+    int changed = 0;
+    fwd_host *host;
+
+    pthread_mutex_lock(&hostsLock);
+    for (int i = 0; i < count; i++)
+    {
+        host = hosts + tasks[i].host;
+        if (!tasks[i].resolved)
+        {
+            host->expires = now + (options.resolveTtl < RESOLVE_RETRY ? options.resolveTtl : RESOLVE_RETRY);
+            continue;
+        }
+
+        if (!host->resolved || host->addr.s_addr != tasks[i].addr.s_addr)
+        {
+            changed++;
+        }
+        host->addr = tasks[i].addr;
+        host->resolved = true;
+        host->expires = now + options.resolveTtl;
+    }
+    pthread_mutex_unlock(&hostsLock);
+
+    return changed;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostsDue
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               resolve_task *hostsDue(const bool all, const time_t now, int *count)
+--                              const bool all: Whether names that were never resolved are included.
+--                              const time_t now: The current time.
+--                              int *count: Pointer to where the number of tasks will be placed.
+--
+-- RETURNS:                 A task for every expired name of the current parse, NULL if there are
+--                          none. The caller frees the tasks.
+--
+-- NOTES:
+-- The names are copied into the tasks so the cache can grow while they are being resolved.
+--------------------------------------------------------------------------------------------------*/
+resolve_task *hostsDue(const bool all, const time_t now, int *count)
+{
+    resolve_task *tasks = NULL;
+
+    *count = 0;
+    pthread_mutex_lock(&hostsLock);
+    for (int i = 0; i < hostCount; i++)
+    {
+        if (hosts[i].seen != serial || hosts[i].expires > now || (!all && hosts[i].expires == 0))
+        {
+            continue;
+        }
+
+        if (tasks == NULL && (tasks = malloc(sizeof(resolve_task) * (hostCount - i))) == NULL)
+        {
+            die("malloc");
+        }
+        strcpy(tasks[*count].name, hosts[i].name);
+        tasks[*count].host = i;
+        (*count)++;
+    }
+    pthread_mutex_unlock(&hostsLock);
+
+    return tasks;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                hostsResolve
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void hostsResolve(void)
+--
+-- NOTES:
+-- Resolves every name added since hostsBegin that is not cached or has expired, all at once.
+--------------------------------------------------------------------------------------------------*/
+void hostsResolve(void)
+{
+    int count;
+    long long started = monotonicUs();
+    resolve_task *tasks;
+
+    if ((tasks = hostsDue(true, time(NULL), &count)) == NULL)
+    {
+        return;
+    }
+
+    resolveBatch(tasks, count);
+    hostsUpdate(tasks, count, time(NULL));
+    for (int i = 0; i < count; i++)
+    {
+        if (!tasks[i].resolved)
+        {
+            Error("Could not resolve %s", tasks[i].name);
+        }
+    }
+    Log("Resolved %d names in %lld us", count, monotonicUs() - started);
+    free(tasks);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                resolveThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *resolveThread(void *arg)
+--                              void *arg: Unused.
+--
+-- RETURNS:                 Does not return.
+--
+-- NOTES:
+-- Checks once a second for names of the running configuration that have expired and resolves
+-- them again. If an address changed, the configuration is reloaded with SIGHUP, which parses the
+-- file again against the fresh cache. Never sees the control signals itself.
+--------------------------------------------------------------------------------------------------*/
+void *resolveThread(void *arg)
+{
+    int count;
+    int changed;
+    resolve_task *tasks;
+
+    while (1)
+    {
+        sleep(1);
+        if ((tasks = hostsDue(false, time(NULL), &count)) == NULL)
+        {
+            continue;
+        }
+
+        resolveBatch(tasks, count);
+        if ((changed = hostsUpdate(tasks, count, time(NULL))) > 0)
+        {
+            Log("%d resolved addresses changed, reloading", changed);
+            kill(getpid(), SIGHUP);
+        }
+        free(tasks);
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                resolveStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool resolveStart(void)
+--
+-- RETURNS:                 True if the refresh thread was started or is not needed, false otherwise.
+--
+-- NOTES:
+-- Starts the thread that keeps the cached names fresh, unless options.resolveTtl is 0. The
+-- control signals must already be blocked so the thread inherits the mask.
+--------------------------------------------------------------------------------------------------*/
+bool resolveStart(void)
+{
+    pthread_t thread;
+
+    if (options.resolveTtl <= 0)
+    {
+        return true;
+    }
+
+    if (pthread_create(&thread, NULL, resolveThread, NULL))
+    {
+        return false;
+    }
+
+    pthread_detach(thread);
+    return true;
+}
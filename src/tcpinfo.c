@@ -0,0 +1,246 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             tcpinfo.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          void tcpInfoStart(tcp_stats *stats, const fwd_path *path, const long long nowMs)
+--                          bool tcpInfoRead(const int sock, tcp_leg *leg)
+--                          void tcpInfoSample(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics)
+--                          void tcpInfoTick(tcp_stats *stats, const fwd_path *path, const int client, const int upstream, fwd_metrics *metrics, const long long nowMs)
+--                          void tcpInfoFinish(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics, const fwd_path *path, const char *backend, const long long durationUs)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Telemetry of the two legs of a relayed connection, the client socket and the upstream socket,
+-- read from TCP_INFO. On a path with the tcp_info option both sockets are sampled every
+-- tcp_info milliseconds while the connection is open and once more when it closes. Every sample
+-- records the smoothed RTT, the delivery rate and the congestion window of each leg in the
+-- histograms of the path, and the retransmits of each leg are recorded once, at close. Each
+-- connection then logs a one line summary of both legs, so a slow session can be put down to the
+-- client or the backend side.
+--
+-- A sample is one getsockopt per socket and the samples are run from the timers of the engines,
+-- so a path without the option pays nothing and one with it pays two system calls per connection
+-- per interval.
+---------------------------------------------------------------------------------------*/
+
+#include "tcpinfo.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "io.h"
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                tcpInfoStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void tcpInfoStart(tcp_stats *stats, const fwd_path *path, const long long nowMs)
+--                              tcp_stats *stats: The telemetry of a connection that has just connected.
+--                              const fwd_path *path: The path of the connection.
+--                              const long long nowMs: The current time in monotonic milliseconds.
+--
+-- NOTES:
+-- Clears the telemetry and schedules the first sample one interval from now. stats.nextSample is
+-- LLONG_MAX on paths that only sample at close or not at all, so callers can take the earlier of
+-- it and their other timers without checking the path.
+--------------------------------------------------------------------------------------------------*/
+void tcpInfoStart(tcp_stats *stats, const fwd_path *path, const long long nowMs)
+{
+    bzero(stats, sizeof(tcp_stats));
+    stats->nextSample = path->tcpInfo && path->tcpInfoInterval ? nowMs + path->tcpInfoInterval : LLONG_MAX;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                tcpInfoRead
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool tcpInfoRead(const int sock, tcp_leg *leg)
+--                              const int sock: The socket of the leg.
+--                              tcp_leg *leg: The telemetry of the leg to update.
+--
+-- RETURNS:                 True if the socket was sampled, false otherwise.
+--
+-- NOTES:
+-- Reads TCP_INFO of sock into leg. The minimum RTT and the delivery rate are only known to kernels
+-- that return the fields past the end of the glibc struct, they stay 0 on older ones.
+--------------------------------------------------------------------------------------------------*/
+bool tcpInfoRead(const int sock, tcp_leg *leg)
+{
+    tcp_info_full info;
+    socklen_t length = sizeof(info);
+
+    bzero(&info, sizeof(info));
+    if (sock == -1 || getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &length) == -1)
+    {
+        return false;
+    }
+
+    leg->rtt = info.base.tcpi_rtt;
+    leg->rttVar = info.base.tcpi_rttvar;
+    leg->retrans = info.base.tcpi_total_retrans;
+    leg->cwnd = info.base.tcpi_snd_cwnd;
+    if (length >= offsetof(tcp_info_full, minRtt) + sizeof(info.minRtt))
+    {
+        leg->minRtt = info.minRtt;
+    }
+    if (length >= offsetof(tcp_info_full, deliveryRate) + sizeof(info.deliveryRate))
+    {
+        leg->deliveryRate = info.deliveryRate;
+    }
+    if (leg->rtt > leg->maxRtt)
+    {
+        leg->maxRtt = leg->rtt;
+    }
+    if (leg->deliveryRate > leg->maxDeliveryRate)
+    {
+        leg->maxDeliveryRate = leg->deliveryRate;
+    }
+    leg->sampled = true;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                tcpInfoSample
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void tcpInfoSample(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics)
+--                              tcp_stats *stats: The telemetry of the connection.
+--                              const int client: The client socket.
+--                              const int upstream: The upstream socket.
+--                              fwd_metrics *metrics: The shard of the path to record in, NULL for none.
+--
+-- NOTES:
+-- Samples both legs and records the RTT, delivery rate and congestion window of each one that
+-- answered. The fork engine has no metrics and only keeps the samples for the summary.
+--------------------------------------------------------------------------------------------------*/
+void tcpInfoSample(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics)
+{
+    stats->samples++;
+    for (int i = 0; i < TCP_LEGS; i++)
+    {
+        if (!tcpInfoRead(i == TCP_LEG_CLIENT ? client : upstream, stats->legs + i) || !metrics)
+        {
+            continue;
+        }
+        histogramRecord(metrics->tcpRtt + i, stats->legs[i].rtt);
+        histogramRecord(metrics->tcpDeliveryRate + i, stats->legs[i].deliveryRate);
+        histogramRecord(metrics->tcpCwnd + i, stats->legs[i].cwnd);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                tcpInfoTick
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void tcpInfoTick(tcp_stats *stats, const fwd_path *path, const int client, const int upstream, fwd_metrics *metrics, const long long nowMs)
+--                              tcp_stats *stats: The telemetry of the connection.
+--                              const fwd_path *path: The path of the connection.
+--                              const int client: The client socket.
+--                              const int upstream: The upstream socket.
+--                              fwd_metrics *metrics: The shard of the path to record in, NULL for none.
+--                              const long long nowMs: The current time in monotonic milliseconds.
+--
+-- NOTES:
+-- Takes a sample if one is due and schedules the next one path.tcpInfoInterval milliseconds later.
+-- Called from the timers of the engines, which may fire for other reasons.
+--------------------------------------------------------------------------------------------------*/
+void tcpInfoTick(tcp_stats *stats, const fwd_path *path, const int client, const int upstream, fwd_metrics *metrics, const long long nowMs)
+{
+    if (nowMs < stats->nextSample)
+    {
+        return;
+    }
+
+    tcpInfoSample(stats, client, upstream, metrics);
+    stats->nextSample = nowMs + path->tcpInfoInterval;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                tcpInfoFinish
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void tcpInfoFinish(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics, const fwd_path *path, const char *backend, const long long durationUs)
+--                              tcp_stats *stats: The telemetry of the connection.
+--                              const int client: The client socket.
+--                              const int upstream: The upstream socket.
+--                              fwd_metrics *metrics: The shard of the path to record in, NULL for none.
+--                              const fwd_path *path: The path of the connection.
+--                              const char *backend: The name of the backend of the connection.
+--                              const long long durationUs: How long the connection was open.
+--
+-- NOTES:
+-- Takes the last sample of a connection that is about to close, while both sockets are still
+-- open, records the retransmits of both legs and logs the summary of the connection. RTTs are
+-- logged in milliseconds, the current one with the lowest the kernel saw and the highest sampled.
+--------------------------------------------------------------------------------------------------*/
+void tcpInfoFinish(tcp_stats *stats, const int client, const int upstream, fwd_metrics *metrics, const fwd_path *path, const char *backend, const long long durationUs)
+{
+    tcp_leg *c = stats->legs + TCP_LEG_CLIENT;
+    tcp_leg *u = stats->legs + TCP_LEG_UPSTREAM;
+
+    if (!path->tcpInfo)
+    {
+        return;
+    }
+
+    tcpInfoSample(stats, client, upstream, metrics);
+    for (int i = 0; i < TCP_LEGS && metrics; i++)
+    {
+        if (stats->legs[i].sampled)
+        {
+            histogramRecord(metrics->tcpRetrans + i, stats->legs[i].retrans);
+        }
+    }
+
+    LogConn("TCP %s -> %s, %lld ms, %d samples: client rtt=%.2f/%.2f/%.2fms retrans=%u rate=%luB/s cwnd=%u"
+            ", upstream rtt=%.2f/%.2f/%.2fms retrans=%u rate=%luB/s cwnd=%u",
+        path->inName, backend, durationUs / 1000, stats->samples, c->rtt / 1e3, c->minRtt / 1e3, c->maxRtt / 1e3,
+        c->retrans, c->deliveryRate, c->cwnd, u->rtt / 1e3, u->minRtt / 1e3, u->maxRtt / 1e3, u->retrans,
+        u->deliveryRate, u->cwnd);
+}
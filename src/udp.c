@@ -0,0 +1,1290 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             udp.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool udpWorkerInit(udp_worker *worker, fwd_config *config, const int shard)
+--                          udp_listener *udpListenerOpen(udp_worker *worker, fwd_path *path)
+--                          void udpListenerClose(udp_worker *worker, udp_listener *listener)
+--                          void udpReload(udp_worker *worker)
+--                          void udpApply(udp_worker *worker, fwd_config *config)
+--                          void udpRun(udp_worker *worker)
+--                          void *udpThread(void *arg)
+--                          void udpReceive(udp_worker *worker, udp_listener *listener)
+--                          void udpReturn(udp_worker *worker, udp_flow *flow)
+--                          int udpRead(udp_worker *worker, const int sock)
+--                          void udpPrepare(udp_worker *worker, const int index, struct sockaddr_in *to)
+--                          void udpSend(udp_worker *worker, const int sock, const int first, const int count)
+--                          void udpSendSplit(const int sock, struct msghdr *msg, const int segment)
+--                          uint32_t udpHash(const udp_listener *listener, const struct sockaddr_in *client)
+--                          udp_flow *udpFlowFind(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client)
+--                          udp_flow *udpFlowOpen(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client)
+--                          void udpFlowGrow(udp_worker *worker)
+--                          void udpFlowTouch(udp_worker *worker, udp_flow *flow)
+--                          void udpFlowClose(udp_worker *worker, udp_flow *flow)
+--                          bool udpFlowAllow(udp_flow *flow, const bool toUpstream, const size_t len)
+--                          void udpSweep(udp_worker *worker)
+--                          bool udpStart(fwd_config *config, const int shard)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Datagram forwarding for the paths with proto=udp. Every UDP path is served by one thread with
+-- its own epoll loop, whatever the engine, so the TCP engines never see these paths.
+--
+-- A client is identified by its address and port on the path it sent to. The first datagram of a
+-- client opens a flow: a socket connected to a backend chosen by pickBackend, so the replies of
+-- the backend arrive on that socket and are sent back to the client from the port it wrote to.
+-- Flows are found through a hash table that doubles once it holds as many flows as buckets, and
+-- every listener keeps its flows in order of activity so the ones idle for path.udpIdle seconds
+-- are closed from the old end once a second.
+--
+-- Datagrams are moved UDP_BATCH at a time with recvmmsg and sendmmsg, consecutive datagrams of the
+-- same flow going out in a single call. When the kernel supports it, UDP_GRO lets one receive
+-- return a train of datagrams of the same client coalesced into one buffer, which is sent on with
+-- UDP_SEGMENT so the kernel splits it again, or with a send per datagram if the offload is refused.
+--
+-- On a reload the thread is woken through its eventfd like the other workers. A path that is
+-- still there keeps its socket and its flows, flows stay on the backend they were given and hold
+-- a reference on the generation they were opened under. The flows of a removed path are closed.
+---------------------------------------------------------------------------------------*/
+
+#include "udp.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "acl.h"
+#include "balance.h"
+#include "io.h"
+#include "net.h"
+#include "reload.h"
+#include "upgrade.h"
+
+#define MAX_EVENTS 256
+
+// counters of paths without metrics, as with the fork engine
+static fwd_metrics udpDiscard;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpWorkerInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool udpWorkerInit(udp_worker *worker, fwd_config *config, const int shard)
+--                              udp_worker *worker: The worker to initialize.
+--                              fwd_config *config: The configuration generation to start with.
+--                              const int shard: The metrics shard the worker writes to.
+--
+-- RETURNS:                 True if the worker can run, false otherwise.
+--
+-- NOTES:
+-- Creates the epoll instance, registers for reloads, checks once whether the kernel can coalesce
+-- and split datagrams, sets up the batch buffers and binds a socket for every UDP path. Paths
+-- whose port cannot be bound are skipped.
+--------------------------------------------------------------------------------------------------*/
+bool udpWorkerInit(udp_worker *worker, fwd_config *config, const int shard)
+{
+    int sock;
+    int off = 0;
+    int on = 1;
+    struct epoll_event ev;
+    udp_batch *batch = &worker->batch;
+
+    bzero(worker, sizeof(udp_worker));
+    worker->shard = shard;
+
+    if ((worker->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1)
+    {
+        Error("Could not create epoll instance");
+        return false;
+    }
+
+    if ((worker->control.fd = configRegister()) == -1)
+    {
+        Error("Could not create reload eventfd");
+        return false;
+    }
+    worker->control.kind = UDP_CONTROL;
+    worker->control.owner = worker;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &worker->control;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->control.fd, &ev) == -1)
+    {
+        Error("Could not register reload eventfd");
+        return false;
+    }
+
+    // coalesced trains are only received if they can be sent on without copying them apart
+    if (uwuCreateUDPSocket(&sock))
+    {
+        worker->gro = setsockopt(sock, SOL_UDP, UDP_SEGMENT, &off, sizeof(off)) == 0
+            && setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+        close(sock);
+    }
+
+    if ((batch->buffers = malloc((size_t)UDP_BATCH * UDP_BUFFER_SIZE)) == NULL
+        || (worker->buckets = calloc(UDP_MIN_BUCKETS, sizeof(udp_flow *))) == NULL)
+    {
+        die("malloc");
+    }
+    worker->bucketCount = UDP_MIN_BUCKETS;
+
+    for (int i = 0; i < UDP_BATCH; i++)
+    {
+        batch->recvIov[i].iov_base = batch->buffers + (size_t)i * UDP_BUFFER_SIZE;
+        batch->recvIov[i].iov_len = UDP_BUFFER_SIZE;
+        batch->recv[i].msg_hdr.msg_iov = batch->recvIov + i;
+        batch->recv[i].msg_hdr.msg_iovlen = 1;
+        batch->recv[i].msg_hdr.msg_name = batch->addrs + i;
+        batch->recv[i].msg_hdr.msg_control = batch->recvControl[i];
+        batch->sendIov[i].iov_base = batch->recvIov[i].iov_base;
+        batch->send[i].msg_hdr.msg_iov = batch->sendIov + i;
+        batch->send[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    if ((worker->listeners = calloc(config->size + 1, sizeof(udp_listener *))) == NULL)
+    {
+        die("calloc");
+    }
+    worker->listenerCount = config->size;
+    worker->config = config;
+    configAcquire(config);
+
+    for (int i = 0; i < config->size; i++)
+    {
+        worker->listeners[i] = udpListenerOpen(worker, config->paths + i);
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpListenerOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Take the socket over from the old process of an upgrade.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               udp_listener *udpListenerOpen(udp_worker *worker, fwd_path *path)
+--                              udp_worker *worker: The worker that will own the listener.
+--                              fwd_path *path: The path to receive datagrams for.
+--
+-- RETURNS:                 The new listener, NULL if the path is not a UDP path or its port could
+--                          not be bound.
+--
+-- NOTES:
+-- Binds a non-blocking UDP socket to the incoming port of the path and registers it with the
+-- worker's epoll instance. After an upgrade the socket of the old process is used instead, the
+-- datagrams waiting in it are not lost.
+--------------------------------------------------------------------------------------------------*/
+udp_listener *udpListenerOpen(udp_worker *worker, fwd_path *path)
+{
+    int sock;
+    int on = 1;
+    udp_listener *listener;
+    struct epoll_event ev;
+
+    if (!path->udp)
+    {
+        return NULL;
+    }
+
+    if ((sock = upgradeTake(UPGRADE_UDP, ntohs(path->in.sin_port), 0)) == -1
+        && !createBoundUDPSocket(&sock, ntohs(path->in.sin_port)))
+    {
+        Error("Could not bind UDP port %d, skipping", ntohs(path->in.sin_port));
+        return NULL;
+    }
+    upgradeTrack(sock, UPGRADE_UDP, ntohs(path->in.sin_port), 0);
+
+    if (worker->gro)
+    {
+        setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on));
+    }
+
+    if ((listener = calloc(1, sizeof(udp_listener))) == NULL)
+    {
+        die("calloc");
+    }
+    listener->ep.kind = UDP_LISTENER;
+    listener->ep.fd = sock;
+    listener->ep.owner = listener;
+    listener->path = path;
+    listener->metrics = path->metrics ? metricsShard(path, worker->shard) : &udpDiscard;
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &listener->ep;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+    {
+        Error("Could not register UDP port %d, skipping", ntohs(path->in.sin_port));
+        upgradeUntrack(sock);
+        close(sock);
+        free(listener);
+        return NULL;
+    }
+
+    Log("Receiving datagrams on UDP port %d ...", ntohs(path->in.sin_port));
+    return listener;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpListenerClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Stop tracking the socket for upgrades and remove it from epoll.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpListenerClose(udp_worker *worker, udp_listener *listener)
+--                              udp_worker *worker: The worker that owns the listener.
+--                              udp_listener *listener: The listener to close.
+--
+-- NOTES:
+-- Closes every flow of the listener, since replies can only reach its clients through its
+-- socket, then closes the socket and frees the listener.
+--------------------------------------------------------------------------------------------------*/
+void udpListenerClose(udp_worker *worker, udp_listener *listener)
+{
+    while (listener->oldest)
+    {
+        udpFlowClose(worker, listener->oldest);
+    }
+    upgradeUntrack(listener->ep.fd);
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, listener->ep.fd, NULL);
+    close(listener->ep.fd);
+    Log("Stopped receiving on UDP port %d", ntohs(listener->path->in.sin_port));
+    free(listener);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpReload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpReload(udp_worker *worker)
+--                              udp_worker *worker: The worker that was told about a reload.
+--
+-- NOTES:
+-- Empties the reload eventfd and applies every generation published since the one the worker
+-- serves, one at a time, as workerReload does.
+--------------------------------------------------------------------------------------------------*/
+void udpReload(udp_worker *worker)
+{
+    uint64_t value;
+    fwd_config *next;
+
+    while (read(worker->control.fd, &value, sizeof(value)) == sizeof(value))
+    {
+    }
+
+    while ((next = __atomic_load_n(&worker->config->newer, __ATOMIC_ACQUIRE)) != NULL)
+    {
+        udpApply(worker, next);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpApply
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpApply(udp_worker *worker, fwd_config *config)
+--                              udp_worker *worker: The worker to update.
+--                              fwd_config *config: The generation that follows the one the worker serves.
+--
+-- NOTES:
+-- Moves the listeners over to the paths of the next generation. A path that is still there keeps
+-- its socket and its flows, new flows use its new backends and idle timeout. Listeners of removed
+-- paths are closed before the sockets of new paths are bound so a port can move in one reload.
+--------------------------------------------------------------------------------------------------*/
+void udpApply(udp_worker *worker, fwd_config *config)
+{
+    fwd_config *old = worker->config;
+    udp_listener **listeners;
+    udp_listener *listener;
+    fwd_path *path;
+
+    if ((listeners = calloc(config->size + 1, sizeof(udp_listener *))) == NULL)
+    {
+        die("calloc");
+    }
+
+    for (int i = 0; i < config->size; i++)
+    {
+        path = config->paths + i;
+        if (path->previous == -1 || (listener = worker->listeners[path->previous]) == NULL)
+        {
+            continue;
+        }
+        worker->listeners[path->previous] = NULL;
+        listener->path = path;
+        listener->metrics = path->metrics ? metricsShard(path, worker->shard) : &udpDiscard;
+        listeners[i] = listener;
+    }
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if (worker->listeners[i])
+        {
+            udpListenerClose(worker, worker->listeners[i]);
+        }
+    }
+
+    for (int i = 0; i < config->size; i++)
+    {
+        if (listeners[i] == NULL)
+        {
+            listeners[i] = udpListenerOpen(worker, config->paths + i);
+        }
+    }
+
+    free(worker->listeners);
+    worker->listeners = listeners;
+    worker->listenerCount = config->size;
+    worker->config = config;
+    configAcquire(config);
+    configRelease(old);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpRun
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpRun(udp_worker *worker)
+--                              udp_worker *worker: The initialized worker to run.
+--
+-- NOTES:
+-- The event loop. Datagrams from clients are dispatched to udpReceive and replies from backends
+-- to udpReturn. Reloads, the idle sweep and freeing closed flows wait until the whole batch of
+-- events has been handled since a later event in the batch may still point at them. The loop
+-- only wakes up once a second while there are flows to expire.
+--------------------------------------------------------------------------------------------------*/
+void udpRun(udp_worker *worker)
+{
+    int count;
+    udp_endpoint *ep;
+    udp_flow *flow;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1)
+    {
+        if ((count = epoll_wait(worker->epfd, events, MAX_EVENTS, worker->flowCount ? 1000 : -1)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            die("epoll_wait");
+        }
+        worker->now = time(NULL);
+
+        for (int i = 0; i < count; i++)
+        {
+            ep = events[i].data.ptr;
+            switch (ep->kind)
+            {
+            case UDP_LISTENER:
+                udpReceive(worker, ep->owner);
+                break;
+            case UDP_FLOW:
+                flow = ep->owner;
+                if (!flow->closed)
+                {
+                    udpReturn(worker, flow);
+                }
+                break;
+            case UDP_CONTROL:
+                worker->reload = true;
+                break;
+            }
+        }
+
+        if (worker->reload)
+        {
+            worker->reload = false;
+            udpReload(worker);
+        }
+
+        if (worker->now != worker->lastSweep)
+        {
+            udpSweep(worker);
+        }
+
+        while (worker->closed)
+        {
+            flow = worker->closed;
+            worker->closed = flow->hashNext;
+            free(flow);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *udpThread(void *arg)
+--                              void *arg: The udp_worker to run.
+--
+-- RETURNS:                 NULL.
+--
+-- NOTES:
+-- Thread entry point for the UDP worker.
+--------------------------------------------------------------------------------------------------*/
+void *udpThread(void *arg)
+{
+    udpRun(arg);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpReceive
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Drop datagrams over the rate limits of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpReceive(udp_worker *worker, udp_listener *listener)
+--                              udp_worker *worker: The worker that owns the listener.
+--                              udp_listener *listener: The listener that is readable.
+--
+-- NOTES:
+-- Reads every pending datagram of the listener a batch at a time and forwards each one through the
+-- flow of its client, opening the flow if the client is new. Runs of datagrams from the same client
+-- are sent with one sendmmsg. Datagrams of clients that are refused, whose flow could not be
+-- opened or that are over the rate limits of the path, are dropped.
+--------------------------------------------------------------------------------------------------*/
+void udpReceive(udp_worker *worker, udp_listener *listener)
+{
+    int count;
+    int first = 0;
+    udp_flow *flow;
+    udp_flow *run;
+    udp_batch *batch = &worker->batch;
+
+    while ((count = udpRead(worker, listener->ep.fd)) > 0)
+    {
+        run = NULL;
+        for (int i = 0; i < count; i++)
+        {
+            if ((flow = udpFlowFind(worker, listener, batch->addrs + i)) == NULL)
+            {
+                flow = udpFlowOpen(worker, listener, batch->addrs + i);
+            }
+            if (flow && !udpFlowAllow(flow, true, batch->recv[i].msg_len))
+            {
+                flow = NULL;
+            }
+
+            if (run && flow != run)
+            {
+                udpSend(worker, run->ep.fd, first, i - first);
+                run = NULL;
+            }
+            if (flow == NULL)
+            {
+                continue;
+            }
+            if (run == NULL)
+            {
+                run = flow;
+                first = i;
+            }
+
+            udpPrepare(worker, i, NULL);
+            udpFlowTouch(worker, flow);
+            metricsAdd(&flow->metrics->bytesToUpstream, batch->recv[i].msg_len);
+        }
+
+        if (run)
+        {
+            udpSend(worker, run->ep.fd, first, count - first);
+        }
+
+        if (count < UDP_BATCH)
+        {
+            return;
+        }
+    }
+
+    if (count == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        Error("Could not receive on UDP port %d", ntohs(listener->path->in.sin_port));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpReturn
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Drop replies over the rate limits of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpReturn(udp_worker *worker, udp_flow *flow)
+--                              udp_worker *worker: The worker that owns the flow.
+--                              udp_flow *flow: The flow whose upstream socket is readable.
+--
+-- NOTES:
+-- Reads every pending reply of the backend a batch at a time and sends each batch back to the
+-- client with one sendmmsg on the listener socket, leaving out replies over the rate limits of the
+-- path. An error on the socket, such as the port
+-- unreachable of a backend that is down, closes the flow so the next datagram of the client picks
+-- a backend again.
+--------------------------------------------------------------------------------------------------*/
+void udpReturn(udp_worker *worker, udp_flow *flow)
+{
+    int count;
+    int first;
+    uint64_t bytes;
+
+    while ((count = udpRead(worker, flow->ep.fd)) > 0)
+    {
+        bytes = 0;
+        first = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (!udpFlowAllow(flow, false, worker->batch.recv[i].msg_len))
+            {
+                if (i > first)
+                {
+                    udpSend(worker, flow->listener->ep.fd, first, i - first);
+                }
+                first = i + 1;
+                continue;
+            }
+            udpPrepare(worker, i, &flow->client);
+            bytes += worker->batch.recv[i].msg_len;
+        }
+        if (count > first)
+        {
+            udpSend(worker, flow->listener->ep.fd, first, count - first);
+        }
+        udpFlowTouch(worker, flow);
+        metricsAdd(&flow->metrics->bytesToClient, bytes);
+
+        if (count < UDP_BATCH)
+        {
+            return;
+        }
+    }
+
+    if (count == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        LogConn("UDP backend %s of %s failed: %s", flow->backend->name, inet_ntoa(flow->client.sin_addr),
+            strerror(errno));
+        udpFlowClose(worker, flow);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpRead
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int udpRead(udp_worker *worker, const int sock)
+--                              udp_worker *worker: The worker whose batch receives the datagrams.
+--                              const int sock: The socket to read.
+--
+-- RETURNS:                 The number of datagrams read, 0 or -1 with errno set if there were none.
+--
+-- NOTES:
+-- Reads up to UDP_BATCH datagrams with one recvmmsg and records, for every buffer that holds a
+-- train of coalesced datagrams, the size of the datagrams it holds.
+--------------------------------------------------------------------------------------------------*/
+int udpRead(udp_worker *worker, const int sock)
+{
+    int count;
+    struct msghdr *msg;
+    struct cmsghdr *cmsg;
+    udp_batch *batch = &worker->batch;
+
+    for (int i = 0; i < UDP_BATCH; i++)
+    {
+        batch->recv[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        batch->recv[i].msg_hdr.msg_controllen = worker->gro ? UDP_CONTROL_SIZE : 0;
+        batch->recv[i].msg_hdr.msg_flags = 0;
+    }
+
+    while ((count = recvmmsg(sock, batch->recv, UDP_BATCH, MSG_DONTWAIT, NULL)) == -1 && errno == EINTR)
+    {
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        batch->segments[i] = 0;
+        msg = &batch->recv[i].msg_hdr;
+        for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                memcpy(batch->segments + i, CMSG_DATA(cmsg), sizeof(int));
+            }
+        }
+    }
+
+    return count;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpPrepare
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpPrepare(udp_worker *worker, const int index, struct sockaddr_in *to)
+--                              udp_worker *worker: The worker whose batch holds the datagram.
+--                              const int index: The datagram of the batch to prepare.
+--                              struct sockaddr_in *to: The destination, NULL for a connected socket.
+--
+-- NOTES:
+-- Points the outgoing message at the received datagram. A coalesced train gets a UDP_SEGMENT
+-- control message so the kernel sends it as the datagrams it was made of.
+--------------------------------------------------------------------------------------------------*/
+void udpPrepare(udp_worker *worker, const int index, struct sockaddr_in *to)
+{
+    uint16_t segment;
+    struct cmsghdr *cmsg;
+    udp_batch *batch = &worker->batch;
+    struct msghdr *msg = &batch->send[index].msg_hdr;
+
+    msg->msg_name = to;
+    msg->msg_namelen = to ? sizeof(struct sockaddr_in) : 0;
+    msg->msg_control = NULL;
+    msg->msg_controllen = 0;
+    batch->sendIov[index].iov_len = batch->recv[index].msg_len;
+
+    if (batch->segments[index] > 0 && (unsigned)batch->segments[index] < batch->recv[index].msg_len)
+    {
+        msg->msg_control = batch->sendControl[index];
+        msg->msg_controllen = CMSG_SPACE(sizeof(segment));
+        cmsg = CMSG_FIRSTHDR(msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(segment));
+        segment = batch->segments[index];
+        memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpSend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpSend(udp_worker *worker, const int sock, const int first, const int count)
+--                              udp_worker *worker: The worker whose batch holds the datagrams.
+--                              const int sock: The socket to send on.
+--                              const int first: The first prepared message to send.
+--                              const int count: The number of messages to send.
+--
+-- NOTES:
+-- Sends the prepared messages with as few sendmmsg calls as the socket allows. If the send buffer
+-- is full the rest are dropped, as a router would. A message that fails on its own is skipped,
+-- unless it is a coalesced train whose segmentation was refused, then its datagrams are sent one
+-- at a time.
+--------------------------------------------------------------------------------------------------*/
+void udpSend(udp_worker *worker, const int sock, const int first, const int count)
+{
+    int sent;
+    int done = 0;
+    struct msghdr *msg;
+
+    while (done < count)
+    {
+        if ((sent = sendmmsg(sock, worker->batch.send + first + done, count - done, MSG_DONTWAIT)) > 0)
+        {
+            done += sent;
+            continue;
+        }
+        if (sent == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return;
+        }
+
+        msg = &worker->batch.send[first + done].msg_hdr;
+        if (msg->msg_controllen)
+        {
+            udpSendSplit(sock, msg, worker->batch.segments[first + done]);
+        }
+        done++;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpSendSplit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpSendSplit(const int sock, struct msghdr *msg, const int segment)
+--                              const int sock: The socket to send on.
+--                              struct msghdr *msg: The message holding a coalesced train.
+--                              const int segment: The size of the datagrams in the train.
+--
+-- NOTES:
+-- Sends a coalesced train as separate datagrams of segment bytes, the last one may be shorter.
+--------------------------------------------------------------------------------------------------*/
+void udpSendSplit(const int sock, struct msghdr *msg, const int segment)
+{
+    char *data = msg->msg_iov->iov_base;
+    size_t left = msg->msg_iov->iov_len;
+    size_t size;
+
+    while (left > 0)
+    {
+        size = left < (size_t)segment ? left : (size_t)segment;
+        if (sendto(sock, data, size, MSG_DONTWAIT, msg->msg_name, msg->msg_namelen) == -1)
+        {
+            return;
+        }
+        data += size;
+        left -= size;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpHash
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uint32_t udpHash(const udp_listener *listener, const struct sockaddr_in *client)
+--                              const udp_listener *listener: The listener the client sent to.
+--                              const struct sockaddr_in *client: The address and port of the client.
+--
+-- RETURNS:                 The hash of the flow.
+--------------------------------------------------------------------------------------------------*/
+uint32_t udpHash(const udp_listener *listener, const struct sockaddr_in *client)
+{
+    return hashAddress(client->sin_addr.s_addr, client->sin_port ^ (uint32_t)(uintptr_t)listener);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpFlowFind
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               udp_flow *udpFlowFind(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client)
+--                              udp_worker *worker: The worker that owns the flows.
+--                              udp_listener *listener: The listener the client sent to.
+--                              const struct sockaddr_in *client: The address and port of the client.
+--
+-- RETURNS:                 The open flow of the client, NULL if it has none.
+--------------------------------------------------------------------------------------------------*/
+udp_flow *udpFlowFind(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client)
+{
+    uint32_t hash = udpHash(listener, client);
+    udp_flow *flow = worker->buckets[hash & (worker->bucketCount - 1)];
+
+    for (; flow; flow = flow->hashNext)
+    {
+        if (flow->hash == hash && flow->listener == listener && flow->client.sin_addr.s_addr == client->sin_addr.s_addr
+            && flow->client.sin_port == client->sin_port)
+        {
+            return flow;
+        }
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpFlowOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Refuse clients over the connection rates of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               udp_flow *udpFlowOpen(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client)
+--                              udp_worker *worker: The worker that will own the flow.
+--                              udp_listener *listener: The listener the client sent to.
+--                              const struct sockaddr_in *client: The address and port of the client.
+--
+-- RETURNS:                 The new flow, NULL if the client is refused or no socket could be created.
+--
+-- NOTES:
+-- Admits the client through the access list and the connection rates of the path, picks a backend
+-- for it and connects a new socket to the backend. The flow holds a reference on the generation of
+-- its path until it is closed.
+--------------------------------------------------------------------------------------------------*/
+udp_flow *udpFlowOpen(udp_worker *worker, udp_listener *listener, const struct sockaddr_in *client)
+{
+    int sock;
+    int on = 1;
+    size_t bucket;
+    fwd_backend *backend;
+    udp_flow *flow;
+    limit_client *limitClient;
+    struct epoll_event ev;
+
+    if (!aclAllows(listener->path->acl, client->sin_addr))
+    {
+        metricsAdd(&listener->metrics->rejected, 1);
+        LogConn("Refused datagram from %s", inet_ntoa(client->sin_addr));
+        return NULL;
+    }
+
+    limitClient = limitClientAcquire(listener->path->limits, client->sin_addr, monotonicMs());
+    if (!limitAdmit(listener->path->limits, limitClient, monotonicMs()))
+    {
+        limitClientRelease(listener->path->limits, limitClient, monotonicMs());
+        metricsAdd(&listener->metrics->rateLimited, 1);
+        LogConn("Rate limited datagram from %s", inet_ntoa(client->sin_addr));
+        return NULL;
+    }
+
+    backend = pickBackend(listener->path, client);
+    if (!createConnectedUDPSocket(&sock, &backend->addr))
+    {
+        limitClientRelease(listener->path->limits, limitClient, monotonicMs());
+        metricsAdd(&listener->metrics->connectFailures, 1);
+        Error("Could not create UDP socket to %s", backend->name);
+        return NULL;
+    }
+
+    if (worker->gro)
+    {
+        setsockopt(sock, SOL_UDP, UDP_GRO, &on, sizeof(on));
+    }
+
+    if ((flow = calloc(1, sizeof(udp_flow))) == NULL)
+    {
+        die("calloc");
+    }
+    flow->ep.kind = UDP_FLOW;
+    flow->ep.fd = sock;
+    flow->ep.owner = flow;
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &flow->ep;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, sock, &ev) == -1)
+    {
+        metricsAdd(&listener->metrics->connectFailures, 1);
+        Error("Could not register UDP socket to %s", backend->name);
+        limitClientRelease(listener->path->limits, limitClient, monotonicMs());
+        close(sock);
+        free(flow);
+        return NULL;
+    }
+
+    flow->listener = listener;
+    flow->path = listener->path;
+    flow->backend = backend;
+    flow->metrics = listener->metrics;
+    flow->limitClient = limitClient;
+    flow->client = *client;
+    flow->hash = udpHash(listener, client);
+    flow->startedUs = monotonicUs();
+    flow->lastActive = worker->now;
+
+    if (worker->flowCount >= worker->bucketCount)
+    {
+        udpFlowGrow(worker);
+    }
+    bucket = flow->hash & (worker->bucketCount - 1);
+    flow->hashNext = worker->buckets[bucket];
+    worker->buckets[bucket] = flow;
+    worker->flowCount++;
+
+    flow->older = listener->newest;
+    if (listener->newest)
+    {
+        listener->newest->newer = flow;
+    }
+    else
+    {
+        listener->oldest = flow;
+    }
+    listener->newest = flow;
+
+    configAcquire(flow->path->config);
+    backendAcquire(backend);
+    metricsAdd(&flow->metrics->accepted, 1);
+    LogConn("UDP flow from %s:%d to %s", inet_ntoa(client->sin_addr), ntohs(client->sin_port), backend->name);
+    return flow;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpFlowGrow
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpFlowGrow(udp_worker *worker)
+--                              udp_worker *worker: The worker whose flow table is full.
+--
+-- NOTES:
+-- Doubles the number of buckets of the flow table and moves every flow to its new bucket.
+--------------------------------------------------------------------------------------------------*/
+void udpFlowGrow(udp_worker *worker)
+{
+    size_t count = worker->bucketCount * 2;
+    size_t bucket;
+    udp_flow **buckets;
+    udp_flow *flow;
+
+    if ((buckets = calloc(count, sizeof(udp_flow *))) == NULL)
+    {
+        die("calloc");
+    }
+
+    for (size_t i = 0; i < worker->bucketCount; i++)
+    {
+        while ((flow = worker->buckets[i]) != NULL)
+        {
+            worker->buckets[i] = flow->hashNext;
+            bucket = flow->hash & (count - 1);
+            flow->hashNext = buckets[bucket];
+            buckets[bucket] = flow;
+        }
+    }
+
+    free(worker->buckets);
+    worker->buckets = buckets;
+    worker->bucketCount = count;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpFlowTouch
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpFlowTouch(udp_worker *worker, udp_flow *flow)
+--                              udp_worker *worker: The worker that owns the flow.
+--                              udp_flow *flow: The flow that saw a datagram.
+--
+-- NOTES:
+-- Marks the flow as active now and moves it to the new end of the list of its listener, which
+-- keeps the list ordered by the last activity of every flow.
+--------------------------------------------------------------------------------------------------*/
+void udpFlowTouch(udp_worker *worker, udp_flow *flow)
+{
+    udp_listener *listener = flow->listener;
+
+    flow->lastActive = worker->now;
+    if (listener->newest == flow)
+    {
+        return;
+    }
+
+    // not the newest, so there is always a newer flow
+    flow->newer->older = flow->older;
+    if (flow->older)
+    {
+        flow->older->newer = flow->newer;
+    }
+    else
+    {
+        listener->oldest = flow->newer;
+    }
+
+    flow->older = listener->newest;
+    flow->newer = NULL;
+    listener->newest->newer = flow;
+    listener->newest = flow;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpFlowClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Release the rate limit buckets of the client.
+--                          October 17, 2026 - Remove the sockets from epoll before closing them.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpFlowClose(udp_worker *worker, udp_flow *flow)
+--                              udp_worker *worker: The worker that owns the flow.
+--                              udp_flow *flow: The flow to close.
+--
+-- NOTES:
+-- Closes the upstream socket of the flow and removes it from the flow table and from its
+-- listener. The flow is only freed after the current batch of events, through worker.closed.
+--------------------------------------------------------------------------------------------------*/
+void udpFlowClose(udp_worker *worker, udp_flow *flow)
+{
+    udp_flow **link = worker->buckets + (flow->hash & (worker->bucketCount - 1));
+    udp_listener *listener = flow->listener;
+
+    if (flow->closed)
+    {
+        return;
+    }
+
+    LogConn("Closing UDP flow from %s:%d", inet_ntoa(flow->client.sin_addr), ntohs(flow->client.sin_port));
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, flow->ep.fd, NULL);
+    close(flow->ep.fd);
+
+    while (*link != flow)
+    {
+        link = &(*link)->hashNext;
+    }
+    *link = flow->hashNext;
+    worker->flowCount--;
+
+    if (flow->older)
+    {
+        flow->older->newer = flow->newer;
+    }
+    else
+    {
+        listener->oldest = flow->newer;
+    }
+    if (flow->newer)
+    {
+        flow->newer->older = flow->older;
+    }
+    else
+    {
+        listener->newest = flow->older;
+    }
+
+    backendRelease(flow->backend);
+    metricsAdd(&flow->metrics->closed, 1);
+    histogramRecord(&flow->metrics->sessionTime, monotonicUs() - flow->startedUs);
+    limitClientRelease(flow->path->limits, flow->limitClient, monotonicMs());
+
+    // the path and its backends may be freed by a reload from here on
+    configRelease(flow->path->config);
+
+    flow->closed = true;
+    flow->hashNext = worker->closed;
+    worker->closed = flow;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpFlowAllow
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool udpFlowAllow(udp_flow *flow, const bool toUpstream, const size_t len)
+--                              udp_flow *flow: The flow the datagram belongs to.
+--                              const bool toUpstream: Whether the datagram goes to the backend.
+--                              const size_t len: The length of the datagram.
+--
+-- RETURNS:                 True if the datagram may be forwarded, false if it has to be dropped.
+--
+-- NOTES:
+-- A datagram cannot be forwarded in part, so it is let through whenever any tokens are left and
+-- paid for in full, which may leave the buckets owing. Dropped datagrams count as throttled.
+--------------------------------------------------------------------------------------------------*/
+bool udpFlowAllow(udp_flow *flow, const bool toUpstream, const size_t len)
+{
+    if (flow->path->limits == NULL)
+    {
+        return true;
+    }
+
+    if (limitAvailable(flow->path->limits, flow->limitClient, toUpstream, monotonicMs()) == 0)
+    {
+        metricsAdd(toUpstream ? &flow->metrics->throttledToUpstream : &flow->metrics->throttledToClient, 1);
+        return false;
+    }
+
+    limitCharge(flow->path->limits, flow->limitClient, toUpstream, len);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpSweep
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void udpSweep(udp_worker *worker)
+--                              udp_worker *worker: The worker to sweep.
+--
+-- NOTES:
+-- Closes the flows that have not seen a datagram in either direction for the idle timeout of
+-- their path. Every listener's flows are ordered by activity, so only the expired flows and one
+-- more are looked at.
+--------------------------------------------------------------------------------------------------*/
+void udpSweep(udp_worker *worker)
+{
+    udp_listener *listener;
+
+    worker->lastSweep = worker->now;
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if ((listener = worker->listeners[i]) == NULL)
+        {
+            continue;
+        }
+
+        while (listener->oldest && worker->now - listener->oldest->lastActive >= listener->path->udpIdle)
+        {
+            udpFlowClose(worker, listener->oldest);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                udpStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool udpStart(fwd_config *config, const int shard)
+--                              fwd_config *config: The configuration generation to start with.
+--                              const int shard: The metrics shard the UDP worker writes to.
+--
+-- RETURNS:                 True if the UDP worker is running, false otherwise.
+--
+-- NOTES:
+-- Binds the UDP paths and starts the thread that serves them. The thread is started even if there
+-- are no UDP paths yet so a reload can add some.
+--------------------------------------------------------------------------------------------------*/
+bool udpStart(fwd_config *config, const int shard)
+{
+    udp_worker *worker;
+    pthread_t thread;
+
+    if ((worker = calloc(1, sizeof(udp_worker))) == NULL)
+    {
+        die("calloc");
+    }
+
+    if (!udpWorkerInit(worker, config, shard))
+    {
+        free(worker);
+        return false;
+    }
+
+    if (pthread_create(&thread, NULL, udpThread, worker))
+    {
+        die("pthread_create");
+    }
+    pthread_detach(thread);
+    return true;
+}
@@ -0,0 +1,727 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             upgrade.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          void upgradeInit(char *argv[])
+--                          void upgradeAppend(upgrade_list *list, const int fd, const upgrade_kind kind, const int port, const int slot)
+--                          void upgradeTrack(const int fd, const upgrade_kind kind, const int port, const int slot)
+--                          bool upgradeUntrack(const int fd)
+--                          int upgradeTake(const upgrade_kind kind, const int port, const int slot)
+--                          bool upgradeListen(int *sock, const int port, const int slot, const bool reusePort, const int backlog)
+--                          void upgradeCloseAll(const int keep)
+--                          bool upgradeSend(const int channel, const upgrade_record *record, const int fd)
+--                          bool upgradeRecv(const int channel, upgrade_record *record, int *fd)
+--                          bool upgradeHandOver(const int channel)
+--                          char **upgradeEnvironment(const int channel)
+--                          bool upgradeStart(void)
+--                          void upgradeReceive(void)
+--                          void upgradeReady(void)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Binary upgrades without closing a port. Every listening socket, along with the admin socket of
+-- the metrics, is tracked here by its kind, port and worker while it is open. On SIGUSR2 the
+-- running process starts the binary it was started from again, with the same arguments, and sends
+-- it every tracked socket over a unix socket with SCM_RIGHTS, followed by the resolved names of the
+-- cache. The new process looks its listeners up here before binding, so the sockets, and the
+-- connections already waiting in their accept queues, are never closed. Once the new process has
+-- started its workers it says so and the old one stops accepting and drains.
+--
+-- The new process finds the channel through the FORWARDER_UPGRADE_FD environment variable. If it
+-- does not answer within UPGRADE_TIMEOUT seconds it is killed and the old process keeps running
+-- as if nothing happened.
+---------------------------------------------------------------------------------------*/
+
+#include "upgrade.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "net.h"
+#include "res.h"
+
+extern char **environ;
+
+static upgrade_list tracked;
+static upgrade_list inherited;
+static int upgradeChannel = -1;
+static bool handedOver;
+static char **upgradeArgv;
+static char upgradePath[PATH_MAX];
+static pthread_mutex_t upgradeLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void upgradeInit(char *argv[])
+--                              char *argv[]: The command line arguments.
+--
+-- NOTES:
+-- Remembers the binary and the arguments the process was started with, for the next upgrade.
+-- The binary is read now since /proc/self/exe no longer names it once it has been replaced. If
+-- the process was started by an upgrade, takes in what the old process sends with
+-- upgradeReceive. Must be called before the configuration file is parsed.
+--------------------------------------------------------------------------------------------------*/
+void upgradeInit(char *argv[])
+{
+    ssize_t n;
+    const char *channel;
+
+    upgradeArgv = argv;
+    if ((n = readlink("/proc/self/exe", upgradePath, sizeof(upgradePath) - 1)) == -1)
+    {
+        Error("Could not find the binary, upgrades will start %s", argv[0]);
+        strncpy(upgradePath, argv[0], sizeof(upgradePath) - 1);
+    }
+    else
+    {
+        upgradePath[n] = 0;
+    }
+
+    if ((channel = getenv(UPGRADE_ENV)) == NULL)
+    {
+        return;
+    }
+
+    upgradeChannel = atoi(channel);
+    unsetenv(UPGRADE_ENV);
+    upgradeReceive();
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeAppend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void upgradeAppend(upgrade_list *list, const int fd, const upgrade_kind kind, const int port, const int slot)
+--                              upgrade_list *list: The list to grow.
+--                              const int fd: The socket.
+--                              const upgrade_kind kind: What the socket is used for.
+--                              const int port: The port of the socket, 0 for the admin socket.
+--                              const int slot: The worker that owns the socket, 0 if there is one
+--                                              socket per port.
+--
+-- NOTES:
+-- Adds a socket to a list, growing it as needed. Must be called with upgradeLock held.
+--------------------------------------------------------------------------------------------------*/
+void upgradeAppend(upgrade_list *list, const int fd, const upgrade_kind kind, const int port, const int slot)
+{
+    upgrade_socket *grown;
+
+    if (list->count == list->limit)
+    {
+        list->limit = list->limit ? list->limit * 2 : 16;
+        if ((grown = realloc(list->sockets, sizeof(upgrade_socket) * list->limit)) == NULL)
+        {
+            die("realloc");
+        }
+        list->sockets = grown;
+    }
+
+    list->sockets[list->count].fd = fd;
+    list->sockets[list->count].kind = kind;
+    list->sockets[list->count].port = port;
+    list->sockets[list->count].slot = slot;
+    list->count++;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeTrack
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void upgradeTrack(const int fd, const upgrade_kind kind, const int port, const int slot)
+--                              const int fd: A socket that was just opened.
+--                              const upgrade_kind kind: What the socket is used for.
+--                              const int port: The port of the socket, 0 for the admin socket.
+--                              const int slot: The worker that owns the socket, 0 if there is one
+--                                              socket per port.
+--
+-- NOTES:
+-- Adds a socket to the ones handed over by the next upgrade. Safe to call from any thread.
+--------------------------------------------------------------------------------------------------*/
+void upgradeTrack(const int fd, const upgrade_kind kind, const int port, const int slot)
+{
+    pthread_mutex_lock(&upgradeLock);
+    upgradeAppend(&tracked, fd, kind, port, slot);
+    pthread_mutex_unlock(&upgradeLock);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeUntrack
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool upgradeUntrack(const int fd)
+--                              const int fd: A tracked socket that is about to be closed.
+--
+-- RETURNS:                 True if the socket was handed over to a new process, which still uses
+--                          it, false otherwise.
+--
+-- NOTES:
+-- Removes a socket from the ones handed over by the next upgrade. Safe to call from any thread.
+--------------------------------------------------------------------------------------------------*/
+bool upgradeUntrack(const int fd)
+{
+    bool shared = false;
+
+    pthread_mutex_lock(&upgradeLock);
+    for (int i = 0; i < tracked.count; i++)
+    {
+        if (tracked.sockets[i].fd == fd)
+        {
+            tracked.sockets[i] = tracked.sockets[--tracked.count];
+            shared = handedOver;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&upgradeLock);
+
+    return shared;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeTake
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int upgradeTake(const upgrade_kind kind, const int port, const int slot)
+--                              const upgrade_kind kind: What the socket will be used for.
+--                              const int port: The port to look for, 0 for the admin socket.
+--                              const int slot: The worker the socket is for, 0 if there is one
+--                                              socket per port.
+--
+-- RETURNS:                 A socket inherited from the old process, -1 if there is none left.
+--
+-- NOTES:
+-- Hands out each inherited socket once. With several workers sharing a port there is one socket
+-- per worker and port, and each worker gets the one of the same slot in the old process. A
+-- socket left over when the new process has fewer workers is closed by upgradeReady.
+--------------------------------------------------------------------------------------------------*/
+int upgradeTake(const upgrade_kind kind, const int port, const int slot)
+{
+    int fd = -1;
+
+    pthread_mutex_lock(&upgradeLock);
+    for (int i = 0; i < inherited.count; i++)
+    {
+        if (inherited.sockets[i].kind == kind && inherited.sockets[i].port == port && inherited.sockets[i].slot == slot)
+        {
+            fd = inherited.sockets[i].fd;
+            inherited.sockets[i] = inherited.sockets[--inherited.count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&upgradeLock);
+
+    return fd;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeListen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool upgradeListen(int *sock, const int port, const int slot, const bool reusePort, const int backlog)
+--                              int *sock: The pointer that will hold the listening socket.
+--                              const int port: The port to listen on.
+--                              const int slot: The worker the socket is for, 0 if there is one
+--                                              socket per port.
+--                              const bool reusePort: Whether the port is shared with other sockets.
+--                              const int backlog: The accept queue length.
+--
+-- RETURNS:                 True if the socket is listening, false otherwise.
+--
+-- NOTES:
+-- Same as createListeningSocket, but takes the socket of the port over from the old process if
+-- there is one, and tracks it for the next upgrade. listen is called again on an inherited socket
+-- since the backlog may have changed.
+--------------------------------------------------------------------------------------------------*/
+bool upgradeListen(int *sock, const int port, const int slot, const bool reusePort, const int backlog)
+{
+    if ((*sock = upgradeTake(UPGRADE_TCP, port, slot)) != -1)
+    {
+        listen(*sock, backlog);
+        Log("Took over port %d from the old process", port);
+    }
+    else if (!createListeningSocket(sock, port, reusePort, backlog))
+    {
+        return false;
+    }
+
+    upgradeTrack(*sock, UPGRADE_TCP, port, slot);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeCloseAll
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void upgradeCloseAll(const int keep)
+--                              const int keep: The socket to keep open, or -1.
+--
+-- NOTES:
+-- Closes every tracked and inherited socket but keep. Called by the path processes of the fork
+-- engine right after the fork, so they do not hold the ports of the other paths open. The lock is
+-- not taken since the threads that could be holding it do not exist in the child.
+--------------------------------------------------------------------------------------------------*/
+void upgradeCloseAll(const int keep)
+{
+    for (int i = 0; i < tracked.count; i++)
+    {
+        if (tracked.sockets[i].fd != keep)
+        {
+            close(tracked.sockets[i].fd);
+        }
+    }
+    for (int i = 0; i < inherited.count; i++)
+    {
+        close(inherited.sockets[i].fd);
+    }
+    if (upgradeChannel != -1)
+    {
+        close(upgradeChannel);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeSend
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool upgradeSend(const int channel, const upgrade_record *record, const int fd)
+--                              const int channel: The upgrade channel.
+--                              const upgrade_record *record: The record to send.
+--                              const int fd: The socket to send with the record, or -1.
+--
+-- RETURNS:                 True if the record was sent, false otherwise.
+--------------------------------------------------------------------------------------------------*/
+bool upgradeSend(const int channel, const upgrade_record *record, const int fd)
+{
+    struct msghdr msg;
+    struct iovec iov = {.iov_base = (void *)record, .iov_len = sizeof(upgrade_record)};
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct cmsghdr *cmsg;
+
+    bzero(&msg, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (fd != -1)
+    {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg(channel, &msg, MSG_NOSIGNAL) == sizeof(upgrade_record);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeRecv
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool upgradeRecv(const int channel, upgrade_record *record, int *fd)
+--                              const int channel: The upgrade channel.
+--                              upgrade_record *record: Pointer to where the record will be placed.
+--                              int *fd: Pointer to where the socket sent with it will be placed, -1
+--                                       if there was none.
+--
+-- RETURNS:                 True if a whole record was received, false otherwise.
+--
+-- NOTES:
+-- Received sockets are close on exec, as every other socket of the process.
+--------------------------------------------------------------------------------------------------*/
+bool upgradeRecv(const int channel, upgrade_record *record, int *fd)
+{
+    struct msghdr msg;
+    struct iovec iov = {.iov_base = record, .iov_len = sizeof(upgrade_record)};
+    union
+    {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct cmsghdr *cmsg;
+
+    bzero(&msg, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    *fd = -1;
+    if (recvmsg(channel, &msg, MSG_CMSG_CLOEXEC) != sizeof(upgrade_record))
+    {
+        return false;
+    }
+
+    if ((cmsg = CMSG_FIRSTHDR(&msg)) != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeHandOver
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool upgradeHandOver(const int channel)
+--                              const int channel: The upgrade channel.
+--
+-- RETURNS:                 True if everything was sent, false otherwise.
+--
+-- NOTES:
+-- Sends the resolved names of the cache, then every tracked socket, then the end record. The lock
+-- is held while the sockets are sent so a reload cannot close one of them in between.
+--------------------------------------------------------------------------------------------------*/
+bool upgradeHandOver(const int channel)
+{
+    upgrade_record record;
+    fwd_host *hosts;
+    int count;
+    bool sent = true;
+
+    bzero(&record, sizeof(record));
+    record.type = UPGRADE_HOST;
+    hosts = hostsCopy(&count);
+    for (int i = 0; sent && i < count; i++)
+    {
+        record.host = hosts[i];
+        sent = upgradeSend(channel, &record, -1);
+    }
+    free(hosts);
+
+    bzero(&record, sizeof(record));
+    record.type = UPGRADE_SOCKET;
+    pthread_mutex_lock(&upgradeLock);
+    for (int i = 0; sent && i < tracked.count; i++)
+    {
+        record.kind = tracked.sockets[i].kind;
+        record.port = tracked.sockets[i].port;
+        record.slot = tracked.sockets[i].slot;
+        sent = upgradeSend(channel, &record, tracked.sockets[i].fd);
+    }
+    pthread_mutex_unlock(&upgradeLock);
+
+    record.type = UPGRADE_END;
+    return sent && upgradeSend(channel, &record, -1);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeEnvironment
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               char **upgradeEnvironment(const int channel)
+--                              const int channel: The end of the channel the new process gets.
+--
+-- RETURNS:                 The environment of the new process. The caller frees the array only.
+--
+-- NOTES:
+-- Copies the environment of the process and points FORWARDER_UPGRADE_FD at channel. Built before
+-- the fork since the child may only make async signal safe calls until it runs the new binary.
+--------------------------------------------------------------------------------------------------*/
+char **upgradeEnvironment(const int channel)
+{
+    static char variable[64];
+    char **envp;
+    int count = 0;
+    int used = 0;
+
+    while (environ[count])
+    {
+        count++;
+    }
+    if ((envp = malloc(sizeof(char *) * (count + 2))) == NULL)
+    {
+        die("malloc");
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (strncmp(environ[i], UPGRADE_ENV "=", sizeof(UPGRADE_ENV)))
+        {
+            envp[used++] = environ[i];
+        }
+    }
+    snprintf(variable, sizeof(variable), UPGRADE_ENV "=%d", channel);
+    envp[used++] = variable;
+    envp[used] = NULL;
+
+    return envp;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeStart
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool upgradeStart(void)
+--
+-- RETURNS:                 True if the new process took the sockets over and is serving, false if
+--                          this process has to keep serving.
+--
+-- NOTES:
+-- Starts the binary the process was started from with the same arguments and hands the sockets
+-- over to it. The child gets a clean signal mask and every descriptor but its end of the channel
+-- is closed by the exec. Sending and waiting for the new process are both bounded by
+-- UPGRADE_TIMEOUT. Called from the control thread only.
+--------------------------------------------------------------------------------------------------*/
+bool upgradeStart(void)
+{
+    int fds[2];
+    pid_t pid;
+    char ready;
+    char **envp;
+    sigset_t none;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1)
+    {
+        Error("Could not create the upgrade channel");
+        return false;
+    }
+
+    envp = upgradeEnvironment(fds[1]);
+    sigemptyset(&none);
+    Log("Upgrading, starting %s", upgradePath);
+
+    if ((pid = fork()) == -1)
+    {
+        Error("Could not fork the new process");
+        close(fds[0]);
+        close(fds[1]);
+        free(envp);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        sigprocmask(SIG_SETMASK, &none, NULL);
+        close_range(3, ~0U, CLOSE_RANGE_CLOEXEC);
+        fcntl(fds[1], F_SETFD, 0);
+        execve(upgradePath, upgradeArgv, envp);
+        _exit(EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    free(envp);
+
+    uwuSetSocketTimeout(UPGRADE_TIMEOUT, 0, fds[0]);
+    if (!upgradeHandOver(fds[0]) || recv(fds[0], &ready, 1, 0) != 1)
+    {
+        Error("New process %d did not start, keeping this one", pid);
+        kill(pid, SIGKILL);
+        close(fds[0]);
+        return false;
+    }
+    close(fds[0]);
+
+    pthread_mutex_lock(&upgradeLock);
+    handedOver = true;
+    pthread_mutex_unlock(&upgradeLock);
+
+    Log("New process %d is serving, draining this one", pid);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeReceive
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void upgradeReceive(void)
+--
+-- NOTES:
+-- Reads everything the old process sends. Resolved names go into the cache so the first parse of
+-- the configuration file does not resolve them again, and sockets are kept until a listener takes
+-- them with upgradeTake. If the channel breaks early, whatever was received is still used and the
+-- rest is bound again as in a normal start.
+--------------------------------------------------------------------------------------------------*/
+void upgradeReceive(void)
+{
+    upgrade_record record;
+    int fd;
+    int names = 0;
+    bool complete = false;
+
+    while (upgradeRecv(upgradeChannel, &record, &fd))
+    {
+        if (record.type == UPGRADE_END)
+        {
+            complete = true;
+            break;
+        }
+
+        if (record.type == UPGRADE_HOST)
+        {
+            hostSeed(&record.host);
+            names++;
+        }
+        else if (fd != -1)
+        {
+            pthread_mutex_lock(&upgradeLock);
+            upgradeAppend(&inherited, fd, record.kind, record.port, record.slot);
+            pthread_mutex_unlock(&upgradeLock);
+        }
+    }
+
+    if (!complete)
+    {
+        Error("Upgrade channel closed early, binding the remaining ports again");
+    }
+    Log("Inherited %d sockets and %d resolved names from the old process", inherited.count, names);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                upgradeReady
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void upgradeReady(void)
+--
+-- NOTES:
+-- Tells the old process that this one is serving so it can start draining. Inherited sockets that
+-- no listener took, such as those of paths removed from the configuration file or of workers the
+-- new process does not have, are closed. Does nothing if the process was not started by an
+-- upgrade.
+--------------------------------------------------------------------------------------------------*/
+void upgradeReady(void)
+{
+    char ready = 1;
+
+    if (upgradeChannel == -1)
+    {
+        return;
+    }
+
+    if (send(upgradeChannel, &ready, 1, MSG_NOSIGNAL) != 1)
+    {
+        Error("Could not tell the old process this one is serving");
+    }
+    close(upgradeChannel);
+    upgradeChannel = -1;
+
+    pthread_mutex_lock(&upgradeLock);
+    for (int i = 0; i < inherited.count; i++)
+    {
+        Log("Closing the inherited socket of port %d, nothing uses it", inherited.sockets[i].port);
+        close(inherited.sockets[i].fd);
+    }
+    inherited.count = 0;
+    pthread_mutex_unlock(&upgradeLock);
+}
@@ -0,0 +1,2061 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             uring.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          bool uringSetup(fwd_uring *ring, const unsigned entries)
+--                          void uringTeardown(fwd_uring *ring)
+--                          void uringReserve(fwd_uring *ring, const unsigned count)
+--                          struct io_uring_sqe *uringGetSqe(fwd_uring *ring)
+--                          int uringSubmit(fwd_uring *ring, const unsigned wait)
+--                          bool uringRegisterBuffers(fwd_uring *ring, char *slab, const int count, const size_t size)
+--                          bool uringWorkerInit(uring_worker *worker, fwd_config *config, const int id, const bool reusePort)
+--                          uring_socket *uringSocketOpen(uring_worker *worker, fwd_path *path)
+--                          void uringSocketRelease(uring_worker *worker, uring_socket *socket)
+--                          uring_listener *uringListenerOpen(uring_worker *worker, fwd_path *path)
+--                          void uringListenerClose(uring_worker *worker, uring_listener *listener)
+--                          void uringPostControl(uring_worker *worker)
+--                          void uringReload(uring_worker *worker)
+--                          void uringQueues(uring_worker *worker)
+--                          void uringWorkerRun(uring_worker *worker)
+--                          void *uringWorkerThread(void *arg)
+--                          void uringArmAccept(uring_worker *worker, uring_socket *socket)
+--                          void uringAccept(uring_worker *worker, uring_socket *socket, const int res, const unsigned flags)
+--                          void uringAdmit(uring_worker *worker, uring_socket *socket, const int sock)
+--                          bool uringConnect(uring_worker *worker, uring_conn *conn)
+--                          void uringBufferTake(uring_worker *worker, uring_dir *dir)
+--                          void uringBufferPut(uring_worker *worker, uring_dir *dir)
+--                          void uringPostPoll(uring_worker *worker, uring_dir *dir)
+--                          void uringPostRead(uring_worker *worker, uring_dir *dir)
+--                          void uringPostWrite(uring_worker *worker, uring_dir *dir)
+--                          void uringRead(uring_worker *worker, uring_dir *dir)
+--                          void uringThrottle(uring_worker *worker, uring_dir *dir)
+--                          void uringTick(uring_worker *worker)
+--                          void uringArm(uring_worker *worker, uring_conn *conn)
+--                          void uringExpire(uring_worker *worker, uring_conn *conn)
+--                          void uringTimers(uring_worker *worker)
+--                          void uringComplete(uring_worker *worker, uring_op *op, const int res, const unsigned flags)
+--                          void uringConnClose(uring_worker *worker, uring_conn *conn)
+--                          void uringConnRelease(uring_worker *worker, uring_conn *conn)
+--                          bool uringAvailable(void)
+--                          void uringRoutine(fwd_config *config)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- io_uring engine. Talks to the kernel through the raw io_uring_setup, io_uring_enter and
+-- io_uring_register system calls so there is no dependency on liburing. Every listening socket has
+-- a multishot accept armed, upstream connects are IORING_OP_CONNECT linked to an
+-- IORING_OP_LINK_TIMEOUT for the connect deadline, and relaying is done with READ_FIXED/WRITE_FIXED
+-- on buffers registered with the ring. All the submissions queued while handling a batch of
+-- completions are submitted with a single io_uring_enter which also waits for the next batch.
+-- Workers are laid out the same way as in the epoll engine, one ring per worker. Reloads are
+-- announced by a read on the eventfd of the worker completing.
+--
+-- A direction waits for data with an IORING_OP_POLL_ADD and only takes a buffer from the slab once
+-- the poll fires, the buffer goes back as soon as what was read has been written. Idle connections
+-- hold no buffer, so the slab is shared by however many connections are moving data at the time.
+--
+-- Directions that ran out of tokens on a path with rate limits wait on a list of the worker, which
+-- a single IORING_OP_TIMEOUT of LIMIT_TICK milliseconds retries all at once.
+--
+-- Idle timeouts and lifetimes are kept on a timer wheel per worker, which is run after every batch
+-- of completions and woken up by one more IORING_OP_TIMEOUT while it holds any timer.
+---------------------------------------------------------------------------------------*/
+
+#define URING_ENTRIES 4096
+#define URING_BUFFER_COUNT 256
+
+#include "uring.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "acl.h"
+#include "affinity.h"
+#include "balance.h"
+#include "control.h"
+#include "event.h"
+#include "health.h"
+#include "io.h"
+#include "net.h"
+#include "relay.h"
+#include "reload.h"
+#include "udp.h"
+#include "upgrade.h"
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringSetup
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool uringSetup(fwd_uring *ring, const unsigned entries)
+--                              fwd_uring *ring: The ring to set up.
+--                              const unsigned entries: The size of the submission queue.
+--
+-- RETURNS:                 True if the ring was created and mapped, false otherwise.
+--
+-- NOTES:
+-- Creates an io_uring instance and maps its submission queue, completion queue and submission
+-- queue entries. The completion queue is made four times larger than the submission queue since
+-- multishot accepts post more completions than they take submissions.
+--------------------------------------------------------------------------------------------------*/
+bool uringSetup(fwd_uring *ring, const unsigned entries)
+{
+    struct io_uring_params params;
+
+    bzero(ring, sizeof(fwd_uring));
+    bzero(&params, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+
+    if ((ring->fd = syscall(__NR_io_uring_setup, entries, &params)) == -1)
+    {
+        return false;
+    }
+
+    ring->entries = params.sq_entries;
+    ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cqMapSize > ring->sqMapSize)
+        {
+            ring->sqMapSize = ring->cqMapSize;
+        }
+        ring->cqMapSize = ring->sqMapSize;
+    }
+
+    ring->sqMap = mmap(NULL, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqMap == MAP_FAILED)
+    {
+        close(ring->fd);
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cqMap = ring->sqMap;
+    }
+    else if ((ring->cqMap = mmap(NULL, ring->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING)) == MAP_FAILED)
+    {
+        munmap(ring->sqMap, ring->sqMapSize);
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        if (ring->cqMap != ring->sqMap)
+        {
+            munmap(ring->cqMap, ring->cqMapSize);
+        }
+        munmap(ring->sqMap, ring->sqMapSize);
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sqHead = (unsigned *)((char *)ring->sqMap + params.sq_off.head);
+    ring->sqTail = (unsigned *)((char *)ring->sqMap + params.sq_off.tail);
+    ring->sqMask = (unsigned *)((char *)ring->sqMap + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)((char *)ring->sqMap + params.sq_off.array);
+    ring->cqHead = (unsigned *)((char *)ring->cqMap + params.cq_off.head);
+    ring->cqTail = (unsigned *)((char *)ring->cqMap + params.cq_off.tail);
+    ring->cqMask = (unsigned *)((char *)ring->cqMap + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cqMap + params.cq_off.cqes);
+    ring->sqeTail = *ring->sqTail;
+    ring->sqeSubmitted = ring->sqeTail;
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringTeardown
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringTeardown(fwd_uring *ring)
+--                              fwd_uring *ring: The ring to destroy.
+--
+-- NOTES:
+-- Unmaps the queues of the ring and closes it.
+--------------------------------------------------------------------------------------------------*/
+void uringTeardown(fwd_uring *ring)
+{
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqMap != ring->sqMap)
+    {
+        munmap(ring->cqMap, ring->cqMapSize);
+    }
+    munmap(ring->sqMap, ring->sqMapSize);
+    close(ring->fd);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringReserve
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringReserve(fwd_uring *ring, const unsigned count)
+--                              fwd_uring *ring: The ring to make room in.
+--                              const unsigned count: The number of entries needed.
+--
+-- NOTES:
+-- Submits everything queued so far until count submission queue entries are free. Linked entries
+-- must be reserved together so the queue cannot be submitted in the middle of the chain.
+--------------------------------------------------------------------------------------------------*/
+void uringReserve(fwd_uring *ring, const unsigned count)
+{
+    while (ring->sqeTail - __atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE) > ring->entries - count)
+    {
+        if (uringSubmit(ring, 0) == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            die("io_uring_enter");
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringGetSqe
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Make room with uringReserve.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               struct io_uring_sqe *uringGetSqe(fwd_uring *ring)
+--                              fwd_uring *ring: The ring to queue a submission on.
+--
+-- RETURNS:                 A zeroed submission queue entry.
+--
+-- NOTES:
+-- Reserves the next submission queue entry. The entry is only handed to the kernel by the next
+-- call to uringSubmit, unless the queue is full in which case everything queued so far is
+-- submitted first to make room.
+--------------------------------------------------------------------------------------------------*/
+struct io_uring_sqe *uringGetSqe(fwd_uring *ring)
+{
+    unsigned index;
+    struct io_uring_sqe *sqe;
+
+    uringReserve(ring, 1);
+
+    index = ring->sqeTail & *ring->sqMask;
+    sqe = ring->sqes + index;
+    ring->sqArray[index] = index;
+    ring->sqeTail++;
+
+    bzero(sqe, sizeof(struct io_uring_sqe));
+    return sqe;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringSubmit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int uringSubmit(fwd_uring *ring, const unsigned wait)
+--                              fwd_uring *ring: The ring to submit on.
+--                              const unsigned wait: The number of completions to wait for.
+--
+-- RETURNS:                 The number of entries submitted, -1 on error.
+--
+-- NOTES:
+-- Hands every queued submission to the kernel and optionally waits for completions, all with one
+-- io_uring_enter call.
+--------------------------------------------------------------------------------------------------*/
+int uringSubmit(fwd_uring *ring, const unsigned wait)
+{
+    int submitted;
+
+    __atomic_store_n(ring->sqTail, ring->sqeTail, __ATOMIC_RELEASE);
+
+    submitted = syscall(__NR_io_uring_enter, ring->fd, ring->sqeTail - ring->sqeSubmitted, wait,
+                        wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    if (submitted > 0)
+    {
+        ring->sqeSubmitted += submitted;
+    }
+
+    return submitted;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringRegisterBuffers
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool uringRegisterBuffers(fwd_uring *ring, char *slab, const int count, const size_t size)
+--                              fwd_uring *ring: The ring to register the buffers with.
+--                              char *slab: The memory that holds the buffers.
+--                              const int count: The number of buffers in slab.
+--                              const size_t size: The size of each buffer.
+--
+-- RETURNS:                 True if the buffers were registered, false otherwise.
+--
+-- NOTES:
+-- Registers count buffers of size bytes laid out back to back in slab. Registered buffers are
+-- pinned once up front instead of on every read and write.
+--------------------------------------------------------------------------------------------------*/
+bool uringRegisterBuffers(fwd_uring *ring, char *slab, const int count, const size_t size)
+{
+    struct iovec *iov;
+    int ret;
+
+    if ((iov = calloc(count, sizeof(struct iovec))) == NULL)
+    {
+        die("calloc");
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        iov[i].iov_base = slab + i * size;
+        iov[i].iov_len = size;
+    }
+
+    ret = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iov, count);
+    free(iov);
+
+    return ret == 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringWorkerInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Serve a configuration generation and listen for reloads.
+--                          October 17, 2026 - Leave UDP paths to the UDP worker.
+--                          October 17, 2026 - Account the slab in the relay buffer statistics.
+--                          October 17, 2026 - Prepare the rate limit tick.
+--                          October 17, 2026 - Set up the timer wheel.
+--                          October 17, 2026 - Allocate the slab on the NUMA node of the worker.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool uringWorkerInit(uring_worker *worker, fwd_config *config, const int id, const bool reusePort)
+--                              uring_worker *worker: The worker to initialize.
+--                              fwd_config *config: The configuration generation to serve.
+--                              const int id: The index of the worker, used to pick its metrics shard.
+--                              const bool reusePort: Whether the listeners are shared with other workers.
+--
+-- RETURNS:                 True if the ring was created and at least one listener was armed or there
+--                          are only UDP paths, false otherwise.
+--
+-- NOTES:
+-- Creates the ring of the worker, registers its relay buffers, queues a read on its reload eventfd
+-- and opens a listener for every path, on the listening socket of the port of the path as with the
+-- epoll engine. If the buffers cannot be registered, because of RLIMIT_MEMLOCK for example, the
+-- same buffers are used with plain recv and send instead. The worker holds a reference on the
+-- configuration it serves.
+--------------------------------------------------------------------------------------------------*/
+bool uringWorkerInit(uring_worker *worker, fwd_config *config, const int id, const bool reusePort)
+{
+    int open = 0;
+    int tcp = 0;
+
+    bzero(worker, sizeof(uring_worker));
+    worker->id = id;
+    worker->cpu = affinityCpu(id);
+    worker->reusePort = reusePort;
+    worker->multishot = true;
+
+    if (!uringSetup(&worker->ring, URING_ENTRIES))
+    {
+        Error("Could not create io_uring instance");
+        return false;
+    }
+
+    if ((worker->controlFd = configRegister()) == -1)
+    {
+        Error("Could not create reload eventfd");
+        return false;
+    }
+    worker->control.kind = URING_CONTROL;
+    worker->control.owner = worker;
+    uringPostControl(worker);
+    worker->tick.kind = URING_TICK;
+    worker->tick.owner = worker;
+    worker->tickTimeout.tv_nsec = LIMIT_TICK * 1000000L;
+    worker->wheelOp.kind = URING_WHEEL;
+    worker->wheelOp.owner = worker;
+    worker->nowMs = monotonicMs();
+    wheelInit(&worker->wheel, worker->nowMs);
+
+    // registering pins the slab where it is, so it has to be placed on the node of the worker first
+    if ((worker->slab = affinityAlloc((size_t)URING_BUFFER_COUNT * RELAY_BUFFER_SIZE, affinityNode(worker->cpu))) == NULL
+        || (worker->freeBuffers = malloc(URING_BUFFER_COUNT * sizeof(int))) == NULL
+        || (worker->listeners = calloc(config->size, sizeof(uring_listener *))) == NULL
+        || (worker->ports = calloc(NET_PORTS, sizeof(uring_socket *))) == NULL)
+    {
+        die("malloc");
+    }
+
+    for (int i = 0; i < URING_BUFFER_COUNT; i++)
+    {
+        worker->freeBuffers[worker->freeCount++] = URING_BUFFER_COUNT - 1 - i;
+    }
+
+    if (!(worker->registered = uringRegisterBuffers(&worker->ring, worker->slab, URING_BUFFER_COUNT, RELAY_BUFFER_SIZE)))
+    {
+        Error("Could not register io_uring buffers, using recv and send");
+    }
+    relayAccount(0, (ssize_t)URING_BUFFER_COUNT * RELAY_BUFFER_SIZE);
+
+    worker->listenerCount = config->size;
+    worker->config = config;
+    configAcquire(config);
+
+    for (int i = 0; i < config->size; i++)
+    {
+        tcp += !config->paths[i].udp;
+        if ((worker->listeners[i] = uringListenerOpen(worker, config->paths + i)) != NULL)
+        {
+            open++;
+        }
+    }
+    uringQueues(worker);
+
+    return open > 0 || tcp == 0;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringSocketOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Reference counted by the paths of the port.
+--                          October 17, 2026 - Listen with the backlog and socket options of the path.
+--                          October 17, 2026 - Take the socket over from the old process of an upgrade.
+--                          October 17, 2026 - Prefer the listener of a pinned worker for its CPU.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uring_socket *uringSocketOpen(uring_worker *worker, fwd_path *path)
+--                              uring_worker *worker: The worker that will own the socket.
+--                              fwd_path *path: The path to listen for.
+--
+-- RETURNS:                 The listening socket of the port of the path, NULL if the port could
+--                          not be listened on.
+--
+-- NOTES:
+-- The first path of a port creates its listening socket with its backlog and client side socket
+-- options and arms a multishot accept on it, the others take a reference on it. After an upgrade
+-- the socket of the old process is used instead of a new one.
+--------------------------------------------------------------------------------------------------*/
+uring_socket *uringSocketOpen(uring_worker *worker, fwd_path *path)
+{
+    int port = ntohs(path->in.sin_port);
+    int sock;
+    uring_socket *socket;
+
+    if ((socket = worker->ports[port]) != NULL)
+    {
+        socket->refs++;
+        return socket;
+    }
+
+    if (!upgradeListen(&sock, port, worker->id, worker->reusePort, path->backlog))
+    {
+        Error("Could not listen on port %d, skipping", port);
+        return NULL;
+    }
+    if (!uwuTuneSocket(sock, &path->clientTuning, true))
+    {
+        Error("Could not set every socket option on port %d", port);
+    }
+    if (worker->reusePort && worker->cpu != -1 && !uwuSetIncomingCpu(sock, worker->cpu))
+    {
+        Error("Could not set SO_INCOMING_CPU on port %d", port);
+    }
+
+    if ((socket = calloc(1, sizeof(uring_socket))) == NULL)
+    {
+        die("calloc");
+    }
+    socket->op.kind = URING_ACCEPT;
+    socket->op.owner = socket;
+    socket->fd = sock;
+    socket->port = port;
+    socket->refs = 1;
+
+    worker->ports[port] = socket;
+    uringArmAccept(worker, socket);
+    Log("Listening for connection on port %d ...", port);
+    return socket;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringSocketRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Cancel the accept of a socket handed over by an upgrade.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringSocketRelease(uring_worker *worker, uring_socket *socket)
+--                              uring_worker *worker: The worker that owns the socket.
+--                              uring_socket *socket: The socket a path stopped using.
+--
+-- NOTES:
+-- Drops the reference of a path on the socket of its port. Once no path uses it, shutting the
+-- socket down makes the pending accept complete, and uringAccept frees the socket once that
+-- completion arrives. The port can be listened on again right away. A socket handed over by an
+-- upgrade is still listened on by the new process, so the accept is cancelled instead, and the
+-- socket keeps the generation of the worker until then to route the clients it accepts in the
+-- meantime.
+--------------------------------------------------------------------------------------------------*/
+void uringSocketRelease(uring_worker *worker, uring_socket *socket)
+{
+    struct io_uring_sqe *sqe;
+
+    if (--socket->refs > 0)
+    {
+        return;
+    }
+
+    socket->closing = true;
+    worker->ports[socket->port] = NULL;
+    if ((socket->shared = upgradeUntrack(socket->fd)))
+    {
+        socket->config = worker->config;
+        configAcquire(socket->config);
+        sqe = uringGetSqe(&worker->ring);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = (uintptr_t)&socket->op;
+        sqe->user_data = 0;
+    }
+    else
+    {
+        shutdown(socket->fd, SHUT_RDWR);
+    }
+    Log("Stopped listening on port %d", socket->port);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringListenerOpen
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Skip UDP paths.
+--                          October 17, 2026 - Listen with the backlog and socket options of the path.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               uring_listener *uringListenerOpen(uring_worker *worker, fwd_path *path)
+--                              uring_worker *worker: The worker that will own the listener.
+--                              fwd_path *path: The path to listen for.
+--
+-- RETURNS:                 The new listener, NULL if the path is a UDP path or the port could not
+--                          be listened on.
+--
+-- NOTES:
+-- Creates the listener of the path on the listening socket of its port.
+--------------------------------------------------------------------------------------------------*/
+uring_listener *uringListenerOpen(uring_worker *worker, fwd_path *path)
+{
+    uring_socket *socket;
+    uring_listener *listener;
+
+    // served by the UDP worker
+    if (path->udp)
+    {
+        return NULL;
+    }
+
+    if ((socket = uringSocketOpen(worker, path)) == NULL)
+    {
+        return NULL;
+    }
+
+    if ((listener = calloc(1, sizeof(uring_listener))) == NULL)
+    {
+        die("calloc");
+    }
+    listener->socket = socket;
+    listener->path = path;
+    listener->metrics = metricsShard(path, worker->id);
+    return listener;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringListenerClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringListenerClose(uring_worker *worker, uring_listener *listener)
+--                              uring_worker *worker: The worker that owns the listener.
+--                              uring_listener *listener: The listener to close.
+--
+-- NOTES:
+-- Releases the listening socket of the port of the listener and frees the listener.
+--------------------------------------------------------------------------------------------------*/
+void uringListenerClose(uring_worker *worker, uring_listener *listener)
+{
+    if (listener->metrics->listenFd == listener->socket->fd)
+    {
+        listener->metrics->listenFd = -1;
+    }
+    uringSocketRelease(worker, listener->socket);
+    free(listener);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringPostControl
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringPostControl(uring_worker *worker)
+--                              uring_worker *worker: The worker to wait for reloads on.
+--
+-- NOTES:
+-- Queues a read on the reload eventfd of the worker. It completes after the next reload.
+--------------------------------------------------------------------------------------------------*/
+void uringPostControl(uring_worker *worker)
+{
+    struct io_uring_sqe *sqe = uringGetSqe(&worker->ring);
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = worker->controlFd;
+    sqe->addr = (uintptr_t)&worker->controlValue;
+    sqe->len = sizeof(worker->controlValue);
+    sqe->user_data = (uintptr_t)&worker->control;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringReload
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Apply the backlog and socket options of changed paths.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringReload(uring_worker *worker)
+--                              uring_worker *worker: The worker that was told about a reload.
+--
+-- NOTES:
+-- Moves the worker forward through every generation published since the one it serves, the same
+-- way as workerReload, and waits for the next reload. A path that is still there keeps its
+-- listener. Listeners of new paths are opened before listeners of removed paths are closed, so a
+-- port that moves between addresses in one reload keeps its socket.
+--------------------------------------------------------------------------------------------------*/
+void uringReload(uring_worker *worker)
+{
+    fwd_config *old;
+    fwd_config *next;
+    uring_listener **listeners;
+    uring_listener *listener;
+    fwd_path *path;
+
+    while ((next = __atomic_load_n(&worker->config->newer, __ATOMIC_ACQUIRE)) != NULL)
+    {
+        old = worker->config;
+        if ((listeners = calloc(next->size + 1, sizeof(uring_listener *))) == NULL)
+        {
+            die("calloc");
+        }
+
+        for (int i = 0; i < next->size; i++)
+        {
+            path = next->paths + i;
+            if (path->previous == -1 || (listener = worker->listeners[path->previous]) == NULL)
+            {
+                continue;
+            }
+            worker->listeners[path->previous] = NULL;
+            if (!old->paths[path->previous].backendsMoved)
+            {
+                listen(listener->socket->fd, path->backlog);
+                uwuTuneSocket(listener->socket->fd, &path->clientTuning, true);
+            }
+            listener->path = path;
+            listener->metrics = metricsShard(path, worker->id);
+            listeners[i] = listener;
+        }
+
+        // new paths are opened first so a port they share with removed paths keeps its socket
+        for (int i = 0; i < next->size; i++)
+        {
+            if (listeners[i] == NULL)
+            {
+                listeners[i] = uringListenerOpen(worker, next->paths + i);
+            }
+        }
+
+        for (int i = 0; i < worker->listenerCount; i++)
+        {
+            if (worker->listeners[i])
+            {
+                uringListenerClose(worker, worker->listeners[i]);
+            }
+        }
+
+        free(worker->listeners);
+        worker->listeners = listeners;
+        worker->listenerCount = next->size;
+        worker->config = next;
+        configAcquire(next);
+        configRelease(old);
+        uringQueues(worker);
+    }
+
+    uringPostControl(worker);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringQueues
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringQueues(uring_worker *worker)
+--                              uring_worker *worker: The worker whose listeners changed.
+--
+-- NOTES:
+-- Picks the metrics shard that reports the accept queue of every listening socket of the worker,
+-- the first path of the port in the configuration, the same way as workerQueues.
+--------------------------------------------------------------------------------------------------*/
+void uringQueues(uring_worker *worker)
+{
+    uring_listener *listener;
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if (worker->listeners[i])
+        {
+            worker->listeners[i]->socket->reported = false;
+        }
+    }
+
+    for (int i = 0; i < worker->listenerCount; i++)
+    {
+        if ((listener = worker->listeners[i]) == NULL)
+        {
+            continue;
+        }
+        listener->metrics->listenFd = listener->socket->reported ? -1 : listener->socket->fd;
+        listener->socket->reported = true;
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringWorkerRun
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Run the timers of the connections after every batch.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringWorkerRun(uring_worker *worker)
+--                              uring_worker *worker: The initialized worker to run.
+--
+-- NOTES:
+-- The completion loop. Submits everything queued since the last iteration while waiting for at
+-- least one completion, then handles every completion that is ready and runs the timers that are
+-- due.
+--------------------------------------------------------------------------------------------------*/
+void uringWorkerRun(uring_worker *worker)
+{
+    unsigned head;
+    unsigned tail;
+    struct io_uring_cqe *cqe;
+    uring_op *op;
+    int res;
+    unsigned flags;
+
+    while (1)
+    {
+        if (uringSubmit(&worker->ring, 1) == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            die("io_uring_enter");
+        }
+        worker->nowMs = monotonicMs();
+
+        head = *worker->ring.cqHead;
+        tail = __atomic_load_n(worker->ring.cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            cqe = worker->ring.cqes + (head & *worker->ring.cqMask);
+            op = (uring_op *)(uintptr_t)cqe->user_data;
+            res = cqe->res;
+            flags = cqe->flags;
+
+            if (op)
+            {
+                uringComplete(worker, op, res, flags);
+            }
+        }
+        __atomic_store_n(worker->ring.cqHead, head, __ATOMIC_RELEASE);
+
+        uringTimers(worker);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringWorkerThread
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void *uringWorkerThread(void *arg)
+--                              void *arg: The uring_worker to run.
+--
+-- RETURNS:                 NULL.
+--
+-- NOTES:
+-- Thread entry point for a worker.
+--------------------------------------------------------------------------------------------------*/
+void *uringWorkerThread(void *arg)
+{
+    uringWorkerRun(arg);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringArmAccept
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringArmAccept(uring_worker *worker, uring_socket *socket)
+--                              uring_worker *worker: The worker that owns the socket.
+--                              uring_socket *socket: The listening socket to accept on.
+--
+-- NOTES:
+-- Queues an accept on the listening socket. The accept is multishot unless the kernel has already
+-- refused a multishot accept, in which case it has to be queued again after every connection.
+--------------------------------------------------------------------------------------------------*/
+void uringArmAccept(uring_worker *worker, uring_socket *socket)
+{
+    struct io_uring_sqe *sqe = uringGetSqe(&worker->ring);
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = socket->fd;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->ioprio = worker->multishot ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe->user_data = (uintptr_t)&socket->op;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringAccept
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Connect with a deadline and fail over to the other backends.
+--                          October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Free sockets released by a reload.
+--                          October 17, 2026 - Admit clients through the access list of the path.
+--                          October 17, 2026 - Buffers are taken when data arrives instead.
+--                          October 17, 2026 - Refuse clients over the connection rates of the path.
+--                          October 17, 2026 - Set the socket options of both sides.
+--                          October 17, 2026 - Point the timer at the connection.
+--                          October 17, 2026 - Moved the handling of the client to uringAdmit.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringAccept(uring_worker *worker, uring_socket *socket, const int res, const unsigned flags)
+--                              uring_worker *worker: The worker that owns the socket.
+--                              uring_socket *socket: The listening socket that accepted.
+--                              const int res: The accepted socket or a negated errno.
+--                              const unsigned flags: The completion flags.
+--
+-- NOTES:
+-- Handles an accept completion and hands the client to uringAdmit. The accept is re-armed whenever
+-- the kernel reports that the multishot accept has stopped. Completions for a socket released by a
+-- reload only close what was accepted, unless the socket was handed over by an upgrade, and the
+-- last one frees the socket.
+--------------------------------------------------------------------------------------------------*/
+void uringAccept(uring_worker *worker, uring_socket *socket, const int res, const unsigned flags)
+{
+    // no path uses the socket since a reload, the last completion of its accept frees it
+    if (socket->closing)
+    {
+        // a socket handed over by an upgrade is shared, what was accepted before the cancel is
+        // served here with the generation the socket holds
+        if (res >= 0 && socket->shared)
+        {
+            uringAdmit(worker, socket, res);
+        }
+        else if (res >= 0)
+        {
+            close(res);
+        }
+        if (!(flags & IORING_CQE_F_MORE))
+        {
+            if (socket->shared)
+            {
+                configRelease(socket->config);
+            }
+            close(socket->fd);
+            free(socket);
+        }
+        return;
+    }
+
+    if (!(flags & IORING_CQE_F_MORE))
+    {
+        if (res == -EINVAL && worker->multishot)
+        {
+            Log("Multishot accept not supported, re-arming after every accept");
+            worker->multishot = false;
+        }
+        uringArmAccept(worker, socket);
+    }
+
+    if (res < 0)
+    {
+        if (res != -EINVAL)
+        {
+            Error("No incoming connection");
+        }
+        return;
+    }
+
+    uringAdmit(worker, socket, res);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringAdmit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Reset clients when the circuit of every backend is open.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringAdmit(uring_worker *worker, uring_socket *socket, const int sock)
+--                              uring_worker *worker: The worker that owns the socket.
+--                              uring_socket *socket: The listening socket that accepted.
+--                              const int sock: The accepted socket.
+--
+-- NOTES:
+-- Takes a client accepted by uringAccept and picks its path with configRoute, from the generation a
+-- closing socket holds or else the one the worker serves, clients no path of the port is for are
+-- reset. Clients refused by the access list or over one of the connection rates of the path are
+-- reset, for the rest a connect is queued with uringConnect.
+--------------------------------------------------------------------------------------------------*/
+void uringAdmit(uring_worker *worker, uring_socket *socket, const int sock)
+{
+    int outSocket;
+    fwd_path *path;
+    fwd_metrics *metrics;
+    uring_conn *conn;
+    fwd_backend *backend;
+    limit_client *limitClient;
+    struct sockaddr_in incomingStruct;
+    socklen_t length = sizeof(incomingStruct);
+
+    if (getpeername(sock, (struct sockaddr *)&incomingStruct, &length) == -1)
+    {
+        close(sock);
+        Error("No incoming connection");
+        return;
+    }
+
+    // the paths of the port share the socket, the client belongs to one of them
+    if ((path = configRoute(socket->closing ? socket->config : worker->config, &incomingStruct, socket->port)) == NULL)
+    {
+        uwuResetSocket(sock);
+        return;
+    }
+    metrics = metricsShard(path, worker->id);
+
+    if (!aclAllows(path->acl, incomingStruct.sin_addr))
+    {
+        uwuResetSocket(sock);
+        metricsAdd(&metrics->rejected, 1);
+        LogConn("Refused connection from %s", inet_ntoa(incomingStruct.sin_addr));
+        return;
+    }
+
+    limitClient = limitClientAcquire(path->limits, incomingStruct.sin_addr, monotonicMs());
+    if (!limitAdmit(path->limits, limitClient, monotonicMs()))
+    {
+        limitClientRelease(path->limits, limitClient, monotonicMs());
+        uwuResetSocket(sock);
+        metricsAdd(&metrics->rateLimited, 1);
+        LogConn("Rate limited connection from %s", inet_ntoa(incomingStruct.sin_addr));
+        return;
+    }
+    uwuTuneAccepted(sock, &path->clientTuning);
+    LogConn("Connection accpeted from %s", inet_ntoa(incomingStruct.sin_addr));
+
+    if ((backend = pickBackend(path, &incomingStruct)) == NULL)
+    {
+        limitClientRelease(path->limits, limitClient, monotonicMs());
+        uwuResetSocket(sock);
+        metricsAdd(&metrics->unavailable, 1);
+        LogConn("No backend available for connection from %s", inet_ntoa(incomingStruct.sin_addr));
+        return;
+    }
+
+    LogConn("Connecting to destination host");
+    if (!uwuCreateTCPSocket(&outSocket))
+    {
+        limitClientRelease(path->limits, limitClient, monotonicMs());
+        close(sock);
+        Error("Could not connect to outgoing server");
+        return;
+    }
+    uwuTuneSocket(outSocket, &path->upstreamTuning, false);
+
+    if ((conn = calloc(1, sizeof(uring_conn))) == NULL)
+    {
+        die("calloc");
+    }
+    conn->client = sock;
+    conn->upstream = outSocket;
+    conn->path = path;
+    conn->metrics = metrics;
+    conn->limitClient = limitClient;
+    conn->startedUs = monotonicUs();
+    conn->timer.owner = conn;
+    metricsAdd(&conn->metrics->accepted, 1);
+    conn->first = backend;
+    configAcquire(conn->path->config);
+    conn->deadline = monotonicMs() + path->connectTimeout;
+    conn->connectOp.kind = URING_CONNECT;
+    conn->connectOp.owner = conn;
+
+    conn->toUpstream.conn = conn;
+    conn->toUpstream.from = sock;
+    conn->toUpstream.to = outSocket;
+    conn->toClient.conn = conn;
+    conn->toClient.from = outSocket;
+    conn->toClient.to = sock;
+    for (uring_dir *dir = &conn->toUpstream; dir <= &conn->toClient; dir++)
+    {
+        dir->op.owner = dir;
+        dir->bufIndex = -1;
+    }
+    worker->connCount++;
+
+    if (!uringConnect(worker, conn))
+    {
+        Error("Could not connect to outgoing server");
+        uringConnClose(worker, conn);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringConnect
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Set the upstream socket options on replaced sockets.
+--                          October 17, 2026 - Skip backends whose circuit is open.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool uringConnect(uring_worker *worker, uring_conn *conn)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_conn *conn: The connection that needs an upstream socket.
+--
+-- RETURNS:                 True if a connect was queued, false if every backend has been tried or
+--                          the deadline has passed.
+--
+-- NOTES:
+-- Queues a connect to the next backend that has not been tried yet, beginning with the one
+-- pickBackend chose and skipping the others while their circuit is open. The connect is linked to
+-- a timeout so an unresponsive backend cannot hold the connection. What is left of the connect
+-- deadline is split evenly between the backends that have not been tried yet, so a dead first
+-- backend still leaves time for the others. The socket of a failed attempt cannot be connected
+-- again and is replaced first.
+--------------------------------------------------------------------------------------------------*/
+bool uringConnect(uring_worker *worker, uring_conn *conn)
+{
+    long long remaining = conn->deadline - monotonicMs();
+    long long slice;
+    struct io_uring_sqe *sqe;
+
+    while (conn->attempts > 0 && conn->attempts < conn->path->backendCount
+           && !healthUsable(conn->path, alternateBackend(conn->path, conn->first, conn->attempts)))
+    {
+        conn->attempts++;
+    }
+
+    if (conn->attempts >= conn->path->backendCount || remaining <= 0)
+    {
+        return false;
+    }
+
+    if (conn->attempts > 0)
+    {
+        close(conn->upstream);
+        if (!uwuCreateTCPSocket(&conn->upstream))
+        {
+            return false;
+        }
+        uwuTuneSocket(conn->upstream, &conn->path->upstreamTuning, false);
+        conn->toUpstream.to = conn->upstream;
+        conn->toClient.from = conn->upstream;
+    }
+
+    // share what is left of the deadline with the backends that have not been tried yet
+    slice = remaining / (conn->path->backendCount - conn->attempts);
+    conn->backend = alternateBackend(conn->path, conn->first, conn->attempts++);
+    conn->timeout.tv_sec = slice / 1000;
+    conn->timeout.tv_nsec = slice % 1000 * 1000000;
+
+    // the connect and its timeout must be submitted together
+    uringReserve(&worker->ring, 2);
+
+    sqe = uringGetSqe(&worker->ring);
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->fd = conn->upstream;
+    sqe->addr = (uintptr_t)&conn->backend->addr;
+    sqe->off = sizeof(struct sockaddr_in);
+    sqe->user_data = (uintptr_t)&conn->connectOp;
+
+    sqe = uringGetSqe(&worker->ring);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->addr = (uintptr_t)&conn->timeout;
+    sqe->len = 1;
+    sqe->user_data = 0;
+
+    conn->inflight++;
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringBufferTake
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringBufferTake(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction that is about to read.
+--
+-- NOTES:
+-- Gives the direction a buffer from the slab of the worker, or a malloc'd one of the same size if
+-- the slab is used up. Does nothing if the direction already holds a buffer.
+--------------------------------------------------------------------------------------------------*/
+void uringBufferTake(uring_worker *worker, uring_dir *dir)
+{
+    if (dir->buffer != NULL)
+    {
+        return;
+    }
+
+    if (worker->freeCount > 0)
+    {
+        dir->bufIndex = worker->freeBuffers[--worker->freeCount];
+        dir->buffer = worker->slab + (size_t)dir->bufIndex * RELAY_BUFFER_SIZE;
+        relayAccount(RELAY_BUFFER_SIZE, -RELAY_BUFFER_SIZE);
+        return;
+    }
+
+    dir->bufIndex = -1;
+    if ((dir->buffer = malloc(RELAY_BUFFER_SIZE)) == NULL)
+    {
+        die("malloc");
+    }
+    relayAccount(RELAY_BUFFER_SIZE, 0);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringBufferPut
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringBufferPut(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction to take the buffer from.
+--
+-- NOTES:
+-- Returns the buffer of the direction to the slab, or frees it if it did not come from the slab.
+-- Does nothing if the direction holds no buffer.
+--------------------------------------------------------------------------------------------------*/
+void uringBufferPut(uring_worker *worker, uring_dir *dir)
+{
+    if (dir->buffer == NULL)
+    {
+        return;
+    }
+
+    if (dir->bufIndex >= 0)
+    {
+        worker->freeBuffers[worker->freeCount++] = dir->bufIndex;
+        relayAccount(-RELAY_BUFFER_SIZE, RELAY_BUFFER_SIZE);
+    }
+    else
+    {
+        free(dir->buffer);
+        relayAccount(-RELAY_BUFFER_SIZE, 0);
+    }
+    dir->buffer = NULL;
+    dir->bufIndex = -1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringPostPoll
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringPostPoll(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction to wait for.
+--
+-- NOTES:
+-- Queues a one shot poll for dir.from becoming readable. The direction holds no buffer while the
+-- poll is pending.
+--------------------------------------------------------------------------------------------------*/
+void uringPostPoll(uring_worker *worker, uring_dir *dir)
+{
+    struct io_uring_sqe *sqe = uringGetSqe(&worker->ring);
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = dir->from;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = (uintptr_t)&dir->op;
+
+    dir->op.kind = URING_POLL;
+    dir->conn->inflight++;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringPostRead
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Read at most dir.want bytes.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringPostRead(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction to read for.
+--
+-- NOTES:
+-- Queues a read of at most dir.want bytes from dir.from into the buffer of the direction.
+--------------------------------------------------------------------------------------------------*/
+void uringPostRead(uring_worker *worker, uring_dir *dir)
+{
+    struct io_uring_sqe *sqe = uringGetSqe(&worker->ring);
+
+    if (worker->registered && dir->bufIndex >= 0)
+    {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = dir->bufIndex;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_RECV;
+    }
+    sqe->fd = dir->from;
+    sqe->addr = (uintptr_t)dir->buffer;
+    sqe->len = dir->want;
+    sqe->user_data = (uintptr_t)&dir->op;
+
+    dir->op.kind = URING_READ;
+    dir->conn->inflight++;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringPostWrite
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringPostWrite(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction to write for.
+--
+-- NOTES:
+-- Queues a write of the unsent part of the buffer of the direction to dir.to.
+--------------------------------------------------------------------------------------------------*/
+void uringPostWrite(uring_worker *worker, uring_dir *dir)
+{
+    struct io_uring_sqe *sqe = uringGetSqe(&worker->ring);
+
+    if (worker->registered && dir->bufIndex >= 0)
+    {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = dir->bufIndex;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+    }
+    sqe->fd = dir->to;
+    sqe->addr = (uintptr_t)(dir->buffer + dir->off);
+    sqe->len = dir->len - dir->off;
+    sqe->user_data = (uintptr_t)&dir->op;
+
+    dir->op.kind = URING_WRITE;
+    dir->conn->inflight++;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringRead
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringRead(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction that has data to read.
+--
+-- NOTES:
+-- Queues the next read of the direction, no larger than the rate limits of the path allow. A
+-- direction without tokens left is counted as throttled and waits for the next tick without a
+-- buffer.
+--------------------------------------------------------------------------------------------------*/
+void uringRead(uring_worker *worker, uring_dir *dir)
+{
+    uring_conn *conn = dir->conn;
+    size_t allowance;
+
+    allowance = limitAvailable(conn->path->limits, conn->limitClient, dir == &conn->toUpstream, monotonicMs());
+    if (allowance == 0)
+    {
+        uringBufferPut(worker, dir);
+        metricsAdd(dir == &conn->toUpstream ? &conn->metrics->throttledToUpstream : &conn->metrics->throttledToClient, 1);
+        uringThrottle(worker, dir);
+        return;
+    }
+
+    dir->want = allowance < RELAY_BUFFER_SIZE ? allowance : RELAY_BUFFER_SIZE;
+    uringBufferTake(worker, dir);
+    uringPostRead(worker, dir);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringThrottle
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringThrottle(uring_worker *worker, uring_dir *dir)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_dir *dir: The direction that ran out of tokens.
+--
+-- NOTES:
+-- Puts the direction on the throttled list of the worker, arming the tick if the list was empty.
+-- The wait counts as an operation in flight so the connection is not released under the list.
+--------------------------------------------------------------------------------------------------*/
+void uringThrottle(uring_worker *worker, uring_dir *dir)
+{
+    struct io_uring_sqe *sqe;
+
+    dir->conn->inflight++;
+    dir->throttledNext = worker->throttled;
+    if (worker->throttled == NULL)
+    {
+        sqe = uringGetSqe(&worker->ring);
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->addr = (uintptr_t)&worker->tickTimeout;
+        sqe->len = 1;
+        sqe->user_data = (uintptr_t)&worker->tick;
+    }
+    worker->throttled = dir;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringTick
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringTick(uring_worker *worker)
+--                              uring_worker *worker: The worker whose tick fired.
+--
+-- NOTES:
+-- Retries every throttled direction once. The list is taken over first, so directions that run
+-- out again arm the next tick. Connections that were closed while waiting are released here.
+--------------------------------------------------------------------------------------------------*/
+void uringTick(uring_worker *worker)
+{
+    uring_dir *dir = worker->throttled;
+    uring_dir *next;
+
+    worker->throttled = NULL;
+    for (; dir; dir = next)
+    {
+        next = dir->throttledNext;
+        dir->conn->inflight--;
+        if (dir->conn->closing)
+        {
+            uringConnClose(worker, dir->conn);
+        }
+        else
+        {
+            uringRead(worker, dir);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringArm
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Wake up for the next TCP_INFO sample.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringArm(uring_worker *worker, uring_conn *conn)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_conn *conn: A connected connection.
+--
+-- NOTES:
+-- Sets the timer of the connection on the wheel of the worker for the idle timeout or the maximum
+-- lifetime of its path or its next TCP_INFO sample, whichever comes first. Connections with none
+-- of them have no timer.
+--------------------------------------------------------------------------------------------------*/
+void uringArm(uring_worker *worker, uring_conn *conn)
+{
+    long long due = LLONG_MAX;
+
+    if (conn->path->idleTimeout)
+    {
+        due = conn->lastActive + conn->path->idleTimeout * 1000LL;
+    }
+    if (conn->path->maxLifetime && conn->startedUs / 1000 + conn->path->maxLifetime * 1000LL < due)
+    {
+        due = conn->startedUs / 1000 + conn->path->maxLifetime * 1000LL;
+    }
+    if (conn->tcp.nextSample < due)
+    {
+        due = conn->tcp.nextSample;
+    }
+
+    if (due == LLONG_MAX)
+    {
+        wheelCancel(&worker->wheel, &conn->timer);
+        return;
+    }
+    wheelAdd(&worker->wheel, &conn->timer, due);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringExpire
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Take the TCP_INFO samples that are due.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringExpire(uring_worker *worker, uring_conn *conn)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_conn *conn: The connection whose timer expired.
+--
+-- NOTES:
+-- Closes the connection once it is older than path.maxLifetime seconds or nothing was read from
+-- either side for path.idleTimeout seconds. Reads only note the time, so a connection that was
+-- active since its timer was set is armed again for the time left. The timer also takes the
+-- TCP_INFO samples of the connection.
+--------------------------------------------------------------------------------------------------*/
+void uringExpire(uring_worker *worker, uring_conn *conn)
+{
+    if (conn->closing)
+    {
+        return;
+    }
+
+    tcpInfoTick(&conn->tcp, conn->path, conn->client, conn->upstream, conn->metrics, worker->nowMs);
+    if (conn->path->maxLifetime && worker->nowMs >= conn->startedUs / 1000 + conn->path->maxLifetime * 1000LL)
+    {
+        LogConn("Connection to %s reached its maximum lifetime", conn->path->inName);
+        metricsAdd(&conn->metrics->lifetimeTimeouts, 1);
+        uringConnClose(worker, conn);
+        return;
+    }
+
+    if (conn->path->idleTimeout && worker->nowMs >= conn->lastActive + conn->path->idleTimeout * 1000LL)
+    {
+        LogConn("Connection to %s was idle for %d seconds", conn->path->inName, conn->path->idleTimeout);
+        metricsAdd(&conn->metrics->idleTimeouts, 1);
+        uringConnClose(worker, conn);
+        return;
+    }
+
+    uringArm(worker, conn);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringTimers
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringTimers(uring_worker *worker)
+--                              uring_worker *worker: The worker whose timer wheel to run.
+--
+-- NOTES:
+-- Runs the timers on the wheel of the worker that are due, then makes sure a single
+-- IORING_OP_TIMEOUT is queued for the next one while any timer is left. The timeout is never
+-- longer than a turn of the lowest level of the wheel, which is shorter than the shortest idle
+-- timeout, so a timer added later never needs an earlier wake up than the one already queued.
+--------------------------------------------------------------------------------------------------*/
+void uringTimers(uring_worker *worker)
+{
+    wheel_timer *timer;
+    wheel_timer *next;
+    struct io_uring_sqe *sqe;
+    int timeout;
+
+    // the handlers may arm a timer again, which reuses its link
+    for (timer = wheelExpire(&worker->wheel, worker->nowMs); timer; timer = next)
+    {
+        next = timer->next;
+        uringExpire(worker, timer->owner);
+    }
+
+    if (worker->wheelArmed || (timeout = wheelTimeout(&worker->wheel, worker->nowMs)) == -1)
+    {
+        return;
+    }
+
+    worker->wheelTimeout.tv_sec = timeout / 1000;
+    worker->wheelTimeout.tv_nsec = (timeout % 1000) * 1000000L;
+    sqe = uringGetSqe(&worker->ring);
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = (uintptr_t)&worker->wheelTimeout;
+    sqe->len = 1;
+    sqe->user_data = (uintptr_t)&worker->wheelOp;
+    worker->wheelArmed = true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringComplete
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Connect with a deadline and fail over to the other backends.
+--                          October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Apply reloads.
+--                          October 17, 2026 - Wait with a poll and hold a buffer only while relaying.
+--                          October 17, 2026 - End one direction on end of stream and account the queued bytes.
+--                          October 17, 2026 - Apply the rate limits of the path.
+--                          October 17, 2026 - Arm the timer of the connection and note its last activity.
+--                          October 17, 2026 - Report connects to the circuit breaker.
+--                          October 17, 2026 - Start the TCP_INFO telemetry of a connected connection.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringComplete(uring_worker *worker, uring_op *op, const int res, const unsigned flags)
+--                              uring_worker *worker: The worker that owns the operation.
+--                              uring_op *op: The operation that completed.
+--                              const int res: The result of the operation.
+--                              const unsigned flags: The completion flags.
+--
+-- NOTES:
+-- Advances the state machine of whatever the completion belongs to. A failed or timed out connect
+-- moves on to the next backend, a finished connect starts a poll in both directions, a finished
+-- poll takes a buffer and queues a read, a finished read queues a write of what was read and a
+-- finished write queues either the rest of the buffer or, once the buffer is drained, the next
+-- read. A read that filled the buffer keeps it for the next read since more is likely waiting,
+-- otherwise the buffer goes back and the direction polls again. Reads are only queued once the
+-- buffer has been written, so each direction queues at most one buffer and a slow side stops the
+-- other from being read.
+--
+-- On a path with rate limits a read is only queued for as many bytes as the buckets allow, and a
+-- direction that has run out is handed to uringThrottle instead.
+--
+-- A connect that succeeds arms the timer of the connection, and every read notes the time for the
+-- idle timeout of the path.
+--
+-- A read that reaches the end of stream shuts down the write side of the other socket and ends that
+-- direction only, the connection is closed once both directions have ended or anything fails. The
+-- bytes read but not yet written are added to the metrics of the path. A closing connection is only
+-- released once all of its operations have completed.
+--------------------------------------------------------------------------------------------------*/
+void uringComplete(uring_worker *worker, uring_op *op, const int res, const unsigned flags)
+{
+    uring_conn *conn;
+    uring_dir *dir;
+
+    if (op->kind == URING_ACCEPT)
+    {
+        uringAccept(worker, op->owner, res, flags);
+        return;
+    }
+
+    if (op->kind == URING_CONTROL)
+    {
+        uringReload(worker);
+        return;
+    }
+
+    if (op->kind == URING_TICK)
+    {
+        uringTick(worker);
+        return;
+    }
+
+    if (op->kind == URING_WHEEL)
+    {
+        // the timers themselves are run once the whole batch has been handled
+        worker->wheelArmed = false;
+        return;
+    }
+
+    if (op->kind == URING_CONNECT)
+    {
+        conn = op->owner;
+        conn->inflight--;
+        if (res < 0)
+        {
+            Error(res == -ECANCELED ? "Timed out connecting to %s" : "Could not connect to %s",
+                  conn->backend->name);
+            if (!conn->closing)
+            {
+                healthFailed(conn->path, conn->backend, worker->nowMs);
+            }
+            if (conn->closing || !uringConnect(worker, conn))
+            {
+                Error("Could not connect to outgoing server");
+                metricsAdd(&conn->metrics->connectTimeouts, !conn->closing && res == -ECANCELED);
+                uringConnClose(worker, conn);
+            }
+            return;
+        }
+
+        conn->connected = true;
+        conn->lastActive = worker->nowMs;
+        tcpInfoStart(&conn->tcp, conn->path, worker->nowMs);
+        uringArm(worker, conn);
+        backendAcquire(conn->backend);
+        healthConnected(conn->path, conn->backend);
+        histogramRecord(&conn->metrics->connectTime, monotonicUs() - conn->startedUs);
+        LogConn("Connected %s to  %s", conn->path->inName, conn->backend->name);
+        uringPostPoll(worker, &conn->toUpstream);
+        uringPostPoll(worker, &conn->toClient);
+        return;
+    }
+
+    dir = op->owner;
+    conn = dir->conn;
+    conn->inflight--;
+
+    if (!conn->closing && op->kind == URING_READ && res == 0)
+    {
+        dir->eof = true;
+        uringBufferPut(worker, dir);
+        shutdown(dir->to, SHUT_WR);
+        if (conn->toUpstream.eof && conn->toClient.eof)
+        {
+            uringConnClose(worker, conn);
+        }
+        return;
+    }
+
+    if (conn->closing || res <= 0)
+    {
+        uringConnClose(worker, conn);
+        return;
+    }
+
+    if (op->kind == URING_POLL)
+    {
+        uringRead(worker, dir);
+        return;
+    }
+
+    if (op->kind == URING_READ)
+    {
+        limitCharge(conn->path->limits, conn->limitClient, dir == &conn->toUpstream, res);
+        metricsAdd(&conn->metrics->queued, res);
+        conn->lastActive = worker->nowMs;
+        dir->len = res;
+        dir->off = 0;
+        uringPostWrite(worker, dir);
+        return;
+    }
+
+    metricsAdd(&conn->metrics->queued, -(uint64_t)res);
+    dir->off += res;
+    dir->bytes += res;
+    metricsAdd(dir == &conn->toUpstream ? &conn->metrics->bytesToUpstream : &conn->metrics->bytesToClient, res);
+    if (dir->off < dir->len)
+    {
+        uringPostWrite(worker, dir);
+    }
+    else if (dir->len == RELAY_BUFFER_SIZE)
+    {
+        uringRead(worker, dir);
+    }
+    else
+    {
+        uringBufferPut(worker, dir);
+        uringPostPoll(worker, dir);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringConnClose
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Log the TCP_INFO summary of the connection.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringConnClose(uring_worker *worker, uring_conn *conn)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_conn *conn: The connection to close.
+--
+-- NOTES:
+-- Shuts down both sockets so any read or write still in flight completes, and releases the
+-- connection once nothing is in flight anymore. The last TCP_INFO sample is taken before the
+-- shutdown, while the sockets still describe the connection.
+--------------------------------------------------------------------------------------------------*/
+void uringConnClose(uring_worker *worker, uring_conn *conn)
+{
+    if (!conn->closing)
+    {
+        conn->closing = true;
+        LogConn("Closing connection to %s (io_uring relay, %zu bytes in, %zu bytes out)", conn->path->inName,
+            conn->toUpstream.bytes, conn->toClient.bytes);
+        if (conn->connected)
+        {
+            tcpInfoFinish(&conn->tcp, conn->client, conn->upstream, conn->metrics, conn->path, conn->backend->name,
+                monotonicUs() - conn->startedUs);
+        }
+        shutdown(conn->client, SHUT_RDWR);
+        shutdown(conn->upstream, SHUT_RDWR);
+    }
+
+    if (conn->inflight == 0)
+    {
+        uringConnRelease(worker, conn);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringConnRelease
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Connect to the backend chosen by pickBackend.
+--                          October 17, 2026 - Connect with a deadline and fail over to the other backends.
+--                          October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Release the configuration generation.
+--                          October 17, 2026 - Return buffers with uringBufferPut.
+--                          October 17, 2026 - Take the queued bytes off the metrics.
+--                          October 17, 2026 - Release the rate limit buckets of the client.
+--                          October 17, 2026 - Cancel the timer of the connection.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringConnRelease(uring_worker *worker, uring_conn *conn)
+--                              uring_worker *worker: The worker that owns the connection.
+--                              uring_conn *conn: The connection to free.
+--
+-- NOTES:
+-- Closes both sockets, returns the buffers of the connection to the worker and frees it. The
+-- connection's reference on its configuration generation is dropped last.
+--------------------------------------------------------------------------------------------------*/
+void uringConnRelease(uring_worker *worker, uring_conn *conn)
+{
+    wheelCancel(&worker->wheel, &conn->timer);
+    close(conn->client);
+    close(conn->upstream);
+    if (conn->connected)
+    {
+        backendRelease(conn->backend);
+    }
+    else
+    {
+        metricsAdd(&conn->metrics->connectFailures, 1);
+    }
+    metricsAdd(&conn->metrics->closed, 1);
+    histogramRecord(&conn->metrics->sessionTime, monotonicUs() - conn->startedUs);
+
+    for (uring_dir *dir = &conn->toUpstream; dir <= &conn->toClient; dir++)
+    {
+        if (dir->buffer != NULL)
+        {
+            metricsAdd(&conn->metrics->queued, -(uint64_t)(dir->len - dir->off));
+        }
+        uringBufferPut(worker, dir);
+    }
+
+    worker->connCount--;
+    limitClientRelease(conn->path->limits, conn->limitClient, monotonicMs());
+    configRelease(conn->path->config);
+    free(conn);
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringAvailable
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               bool uringAvailable(void)
+--
+-- RETURNS:                 True if the kernel lets this process create an io_uring, false otherwise.
+--
+-- NOTES:
+-- Probes for io_uring by creating and destroying a small ring. Fails on kernels without io_uring
+-- and where it has been disabled, through kernel.io_uring_disabled or a seccomp filter.
+--------------------------------------------------------------------------------------------------*/
+bool uringAvailable(void)
+{
+    fwd_uring ring;
+
+    if (!uringSetup(&ring, 8))
+    {
+        return false;
+    }
+
+    uringTeardown(&ring);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                uringRoutine
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               October 17, 2026 - Update the metrics of the path.
+--                          October 17, 2026 - Serve configuration generations.
+--                          October 17, 2026 - Start the UDP worker.
+--                          October 17, 2026 - Pin the workers and allocate them on their NUMA nodes.
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void uringRoutine(fwd_config *config)
+--                              fwd_config *config: The configuration generation to start with.
+--
+-- NOTES:
+-- Serves every path with options.workers io_uring workers, laid out and pinned the same way as
+-- eventRoutine.
+-- Falls back to eventRoutine when io_uring is not available. Warm pools are not supported by this
+-- engine. Does not return.
+--------------------------------------------------------------------------------------------------*/
+void uringRoutine(fwd_config *config)
+{
+    int count;
+    uring_worker **workers;
+
+    if (!uringAvailable())
+    {
+        Error("io_uring is not available, falling back to the epoll engine");
+        eventRoutine(config);
+    }
+
+    // a write to a socket the peer has closed must fail the operation, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((count = options.workers) <= 0)
+    {
+        count = affinityWorkers();
+    }
+
+    if ((workers = calloc(count, sizeof(uring_worker *))) == NULL)
+    {
+        die("calloc");
+    }
+
+    if (!metricsInit(config->paths, config->size, count + 1))
+    {
+        die("Could not allocate metrics");
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if ((workers[i] = affinityAlloc(sizeof(uring_worker), affinityNode(affinityCpu(i)))) == NULL)
+        {
+            die("malloc");
+        }
+        if (!uringWorkerInit(workers[i], config, i, count > 1))
+        {
+            die("Could not listen on any path");
+        }
+    }
+
+    if (!udpStart(config, count))
+    {
+        die("Could not start the UDP worker");
+    }
+
+    blockControlSignals();
+    if (options.metrics && !metricsStart(options.metrics))
+    {
+        die("Could not serve metrics");
+    }
+
+    Log("Starting %d workers", count);
+    affinityReport(count);
+    for (int i = 0; i < count; i++)
+    {
+        if (!affinitySpawn(uringWorkerThread, workers[i], workers[i]->cpu))
+        {
+            die("pthread_create");
+        }
+    }
+
+    controlRoutine();
+}
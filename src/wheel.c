@@ -0,0 +1,313 @@
+/*---------------------------------------------------------------------------------------
+-- SOURCE FILE:             wheel.c
+--
+-- PROGRAM:                 forwarder.out
+--
+-- FUNCTIONS:
+--                          void wheelInit(timer_wheel *wheel, const long long nowMs)
+--                          void wheelAdd(timer_wheel *wheel, wheel_timer *timer, const long long dueMs)
+--                          void wheelCancel(timer_wheel *wheel, wheel_timer *timer)
+--                          void wheelPlace(timer_wheel *wheel, wheel_timer *timer)
+--                          void wheelCascade(timer_wheel *wheel, const int level)
+--                          wheel_timer *wheelExpire(timer_wheel *wheel, const long long nowMs)
+--                          int wheelTimeout(timer_wheel *wheel, const long long nowMs)
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNERS:               Benny Wang
+--
+-- PROGRAMMERS:             Benny Wang
+--
+-- NOTES:
+-- Hierarchical timing wheel for the connection timers of a worker. Time is counted in ticks of
+-- WHEEL_TICK milliseconds. Level 0 has a slot for each of the next WHEEL_SLOTS ticks, and every
+-- level above has slots WHEEL_SLOTS times as wide as the one below, so five levels of 64 slots
+-- cover about four months. A timer goes into the lowest level whose slots can still tell its tick
+-- apart from the current one, and when the current tick reaches the start of a slot of a higher
+-- level the timers in it are spread over the levels below. Adding and cancelling a timer only
+-- link and unlink it from a slot, so neither depends on how many timers there are, and no timer
+-- is looked at more than once per level before it expires.
+--
+-- Timers never expire early, only up to a tick late. A wheel is used by a single thread.
+---------------------------------------------------------------------------------------*/
+
+#include "wheel.h"
+
+#include <string.h>
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelInit
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void wheelInit(timer_wheel *wheel, const long long nowMs)
+--                              timer_wheel *wheel: The wheel to set up.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- NOTES:
+-- Sets up an empty wheel whose next tick is the one after nowMs.
+--------------------------------------------------------------------------------------------------*/
+void wheelInit(timer_wheel *wheel, const long long nowMs)
+{
+    memset(wheel, 0, sizeof(timer_wheel));
+    wheel->tick = nowMs / WHEEL_TICK + 1;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelAdd
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void wheelAdd(timer_wheel *wheel, wheel_timer *timer, const long long dueMs)
+--                              timer_wheel *wheel: The wheel to add the timer to.
+--                              wheel_timer *timer: The timer, which may already be on the wheel.
+--                              const long long dueMs: When the timer expires, in monotonic milliseconds.
+--
+-- NOTES:
+-- Arms the timer for dueMs, moving it if it was already armed. A time that has already passed
+-- expires on the next call to wheelExpire.
+--------------------------------------------------------------------------------------------------*/
+void wheelAdd(timer_wheel *wheel, wheel_timer *timer, const long long dueMs)
+{
+    wheelCancel(wheel, timer);
+    timer->due = (dueMs + WHEEL_TICK - 1) / WHEEL_TICK;
+    wheelPlace(wheel, timer);
+    wheel->count++;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelCancel
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void wheelCancel(timer_wheel *wheel, wheel_timer *timer)
+--                              timer_wheel *wheel: The wheel the timer was added to.
+--                              wheel_timer *timer: The timer to disarm.
+--
+-- NOTES:
+-- Takes the timer off the wheel. Does nothing if it is not armed.
+--------------------------------------------------------------------------------------------------*/
+void wheelCancel(timer_wheel *wheel, wheel_timer *timer)
+{
+    if (timer->slot == NULL)
+    {
+        return;
+    }
+
+    if (timer->prev)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        *timer->slot = timer->next;
+    }
+    if (timer->next)
+    {
+        timer->next->prev = timer->prev;
+    }
+    timer->slot = NULL;
+    wheel->count--;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelPlace
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void wheelPlace(timer_wheel *wheel, wheel_timer *timer)
+--                              timer_wheel *wheel: The wheel to link the timer into.
+--                              wheel_timer *timer: A timer whose due tick is set.
+--
+-- NOTES:
+-- Links the timer into the slot of the lowest level where its tick is less than WHEEL_SLOTS slots
+-- away from the current one. A timer farther out than the last level reaches waits in the last
+-- slot of that level and is placed again when the slot cascades.
+--------------------------------------------------------------------------------------------------*/
+void wheelPlace(timer_wheel *wheel, wheel_timer *timer)
+{
+    long long due = timer->due < wheel->tick ? wheel->tick : timer->due;
+    int level = 0;
+    int shift = 0;
+
+    while (level < WHEEL_LEVELS - 1 && (due >> shift) - (wheel->tick >> shift) >= WHEEL_SLOTS)
+    {
+        level++;
+        shift += WHEEL_BITS;
+    }
+    if ((due >> shift) - (wheel->tick >> shift) >= WHEEL_SLOTS)
+    {
+        due = ((wheel->tick >> shift) + WHEEL_SLOTS - 1) << shift;
+    }
+
+    timer->slot = &wheel->slots[level][(due >> shift) & (WHEEL_SLOTS - 1)];
+    timer->prev = NULL;
+    timer->next = *timer->slot;
+    if (timer->next)
+    {
+        timer->next->prev = timer;
+    }
+    *timer->slot = timer;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelCascade
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               void wheelCascade(timer_wheel *wheel, const int level)
+--                              timer_wheel *wheel: The wheel whose current tick starts a slot of level.
+--                              const int level: The level to cascade, above 0.
+--
+-- NOTES:
+-- Places every timer of the slot of level that starts at the current tick again, which moves them
+-- to the levels below.
+--------------------------------------------------------------------------------------------------*/
+void wheelCascade(timer_wheel *wheel, const int level)
+{
+    wheel_timer **slot = &wheel->slots[level][(wheel->tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)];
+    wheel_timer *timer = *slot;
+    wheel_timer *next;
+
+    *slot = NULL;
+    for (; timer; timer = next)
+    {
+        next = timer->next;
+        wheelPlace(wheel, timer);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelExpire
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               wheel_timer *wheelExpire(timer_wheel *wheel, const long long nowMs)
+--                              timer_wheel *wheel: The wheel to advance.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 The timers that expired, linked through next, NULL if none did.
+--
+-- NOTES:
+-- Advances the wheel over every tick up to nowMs, cascading the higher levels on the way. The
+-- expired timers are disarmed before they are returned, so the caller may add them again while
+-- going through the list. An empty wheel skips straight to nowMs.
+--------------------------------------------------------------------------------------------------*/
+wheel_timer *wheelExpire(timer_wheel *wheel, const long long nowMs)
+{
+    long long target = nowMs / WHEEL_TICK;
+    wheel_timer *expired = NULL;
+    wheel_timer *timer;
+    wheel_timer **slot;
+
+    while (wheel->tick <= target)
+    {
+        if (wheel->count == 0)
+        {
+            wheel->tick = target + 1;
+            break;
+        }
+
+        for (int level = WHEEL_LEVELS - 1; level > 0; level--)
+        {
+            if ((wheel->tick & ((1LL << (WHEEL_BITS * level)) - 1)) == 0)
+            {
+                wheelCascade(wheel, level);
+            }
+        }
+
+        slot = &wheel->slots[0][wheel->tick & (WHEEL_SLOTS - 1)];
+        while ((timer = *slot) != NULL)
+        {
+            *slot = timer->next;
+            timer->slot = NULL;
+            timer->next = expired;
+            expired = timer;
+            wheel->count--;
+        }
+        wheel->tick++;
+    }
+
+    return expired;
+}
+
+/*--------------------------------------------------------------------------------------------------
+-- FUNCTION:                wheelTimeout
+--
+-- DATE:                    October 17, 2026
+--
+-- REVISIONS:               N/A
+--
+-- DESIGNER:                Benny Wang
+--
+-- PROGRAMMER:              Benny Wang
+--
+-- INTERFACE:               int wheelTimeout(timer_wheel *wheel, const long long nowMs)
+--                              timer_wheel *wheel: The wheel to look at.
+--                              const long long nowMs: The current monotonic time in milliseconds.
+--
+-- RETURNS:                 Milliseconds until wheelExpire should be called again, -1 if the wheel
+--                          is empty.
+--
+-- NOTES:
+-- Looks for the first armed slot of level 0 up to the next cascade, so the answer is exact for
+-- timers on level 0 and the start of the next cascade otherwise, at most WHEEL_SLOTS ticks away.
+--------------------------------------------------------------------------------------------------*/
+int wheelTimeout(timer_wheel *wheel, const long long nowMs)
+{
+    long long tick = wheel->tick;
+
+    if (wheel->count == 0)
+    {
+        return -1;
+    }
+
+    while (wheel->slots[0][tick & (WHEEL_SLOTS - 1)] == NULL && ((tick + 1) & (WHEEL_SLOTS - 1)) != 0)
+    {
+        tick++;
+    }
+    if (wheel->slots[0][tick & (WHEEL_SLOTS - 1)] == NULL)
+    {
+        tick++;
+    }
+
+    return tick * WHEEL_TICK > nowMs ? tick * WHEEL_TICK - nowMs : 0;
+}